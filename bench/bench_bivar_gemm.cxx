@@ -0,0 +1,127 @@
+/** Copyright (c) 2011, Edgar Solomonik, all rights reserved.
+  * \addtogroup benchmarks
+  * @{
+  * \addtogroup bench_bivar_gemm
+  * @{
+  * \brief Benchmarks the blocked gemm kernel of Bivar_Kernel against the unblocked reference loop
+  */
+
+#include <ctf.hpp>
+#include <assert.h>
+
+using namespace CTF;
+
+double tropical_mul(double a, double b){ return a+b; }
+
+void tropical_add(double a, double & b){ b = std::min(a,b); }
+
+int64_t int_mul(int64_t a, int64_t b){ return a*b; }
+
+template <typename dtype, typename kernel>
+void bench_kernel_gemm(char const * name,
+                       char         tA,
+                       char         tB,
+                       int          m,
+                       int          n,
+                       int          k,
+                       int          niter){
+  int64_t sz_A = ((int64_t)m)*k;
+  int64_t sz_B = ((int64_t)k)*n;
+  int64_t sz_C = ((int64_t)m)*n;
+  dtype * A     = (dtype*)malloc(sizeof(dtype)*sz_A);
+  dtype * B     = (dtype*)malloc(sizeof(dtype)*sz_B);
+  dtype * C     = (dtype*)malloc(sizeof(dtype)*sz_C);
+  dtype * C_ref = (dtype*)malloc(sizeof(dtype)*sz_C);
+
+  srand48(7);
+  for (int64_t i=0; i<sz_A; i++) A[i] = (dtype)(100*drand48());
+  for (int64_t i=0; i<sz_B; i++) B[i] = (dtype)(100*drand48());
+  for (int64_t i=0; i<sz_C; i++) C[i] = (dtype)(100*drand48());
+  memcpy(C_ref, C, sizeof(dtype)*sz_C);
+
+  //check correctness of blocked kernel
+  kernel::gemm_ref(tA, tB, m, n, k, A, B, C_ref);
+  kernel::gemm(tA, tB, m, n, k, A, B, C);
+  for (int64_t i=0; i<sz_C; i++){
+    assert(C[i] == C_ref[i]);
+  }
+
+  double t_ref = 0.0;
+  double t_blk = 0.0;
+  for (int i=0; i<niter; i++){
+    double t_st = MPI_Wtime();
+    kernel::gemm_ref(tA, tB, m, n, k, A, B, C_ref);
+    t_ref += MPI_Wtime() - t_st;
+    t_st = MPI_Wtime();
+    kernel::gemm(tA, tB, m, n, k, A, B, C);
+    t_blk += MPI_Wtime() - t_st;
+  }
+  double nops = ((double)m)*n*k;
+  printf("%s m=%d n=%d k=%d tA=%c tB=%c: reference %lf sec/iter (%lf Gop/s), blocked %lf sec/iter (%lf Gop/s), speed-up %lf\n",
+         name, m, n, k, tA, tB, t_ref/niter, 1.E-9*nops*niter/t_ref, t_blk/niter, 1.E-9*nops*niter/t_blk, t_ref/t_blk);
+
+  free(A);
+  free(B);
+  free(C);
+  free(C_ref);
+}
+
+void bench_bivar_gemm(int m,
+                      int n,
+                      int k,
+                      int niter){
+  char const * ts = "NT";
+  for (int a=0; a<2; a++){
+    for (int b=0; b<2; b++){
+      bench_kernel_gemm< double, Bivar_Kernel<double,double,double,tropical_mul,tropical_add> >
+        ("(min,+) double", ts[a], ts[b], m, n, k, niter);
+      bench_kernel_gemm< int64_t, Bivar_Kernel<int64_t,int64_t,int64_t,int_mul> >
+        ("(+,*) int64_t", ts[a], ts[b], m, n, k, niter);
+    }
+  }
+}
+
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int niter, m, n, k;
+  int const in_num = argc;
+  char ** input_str = argv;
+  MPI_Init(NULL, NULL);
+  if (getCmdOption(input_str, input_str+in_num, "-m")){
+    m = atoi(getCmdOption(input_str, input_str+in_num, "-m"));
+    if (m < 0) m = 512;
+  } else m = 512;
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 512;
+  } else n = 512;
+  if (getCmdOption(input_str, input_str+in_num, "-k")){
+    k = atoi(getCmdOption(input_str, input_str+in_num, "-k"));
+    if (k < 0) k = 512;
+  } else k = 512;
+
+  if (getCmdOption(input_str, input_str+in_num, "-niter")){
+    niter = atoi(getCmdOption(input_str, input_str+in_num, "-niter"));
+    if (niter < 0) niter = 3;
+  } else niter = 3;
+
+  bench_bivar_gemm(m, n, k, niter);
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
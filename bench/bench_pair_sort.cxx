@@ -0,0 +1,144 @@
+/** Copyright (c) 2011, Edgar Solomonik, all rights reserved.
+  * \addtogroup benchmarks
+  * @{
+  * \addtogroup bench_pair_sort
+  * @{
+  * \brief Benchmarks the sort of key-value pairs used by sparse reads, writes, and redistributions against std::sort
+  */
+
+#include <ctf.hpp>
+#include <assert.h>
+
+using namespace CTF;
+
+template <int l>
+struct bench_sort_el {
+  char data[l];
+};
+
+template <int l>
+struct bench_sort_pair {
+  int64_t key;
+  char data[l];
+  bool operator < (const bench_sort_pair& other) const {
+    return (key < other.key);
+  }
+} __attribute__((packed));
+
+template <int l>
+void bench_pair_sort(int64_t n,
+                     int     nbits,
+                     int     niter){
+  printf("Sorting %ld pairs with %d-byte values and %d-bit keys:\n",n,l,nbits);
+  Set<bench_sort_el<l>, false> s;
+  int64_t psz = s.pair_size();
+  assert(psz == sizeof(bench_sort_pair<l>));
+
+  bench_sort_pair<l> * pairs = (bench_sort_pair<l>*)malloc(psz*n);
+  bench_sort_pair<l> * ref = (bench_sort_pair<l>*)malloc(psz*n);
+  bench_sort_pair<l> * data = (bench_sort_pair<l>*)malloc(psz*n);
+  srand48(7);
+  int64_t kmax = nbits >= 63 ? INT64_MAX : (((int64_t)1)<<nbits);
+  for (int64_t i=0; i<n; i++){
+    pairs[i].key = (int64_t)(drand48()*kmax);
+    for (int j=0; j<l; j++){
+      pairs[i].data[j] = (char)(i>>(8*(j%8)));
+    }
+  }
+
+  //check that the keys are sorted and each pair is kept intact
+  memcpy(ref, pairs, psz*n);
+  std::stable_sort(ref, ref+n);
+  memcpy(data, pairs, psz*n);
+  CTF_int::PairIterator pi(&s, (char*)data);
+  pi.sort(n);
+  assert(memcmp(ref, data, psz*n) == 0);
+  printf("Passed correctness test\n");
+
+  double t_std = 0.0;
+  double t_pi = 0.0;
+  for (int i=0; i<niter; i++){
+    memcpy(data, pairs, psz*n);
+    double t_st = MPI_Wtime();
+    std::sort(data, data+n);
+    t_std += MPI_Wtime() - t_st;
+
+    memcpy(data, pairs, psz*n);
+    t_st = MPI_Wtime();
+    pi.sort(n);
+    t_pi += MPI_Wtime() - t_st;
+  }
+
+  printf("Performed %d iterations\n",niter);
+  printf("std::sort sec/iter: %lf (Mpairs/s = %lf)\n",
+          t_std/niter, 1.E-6*n/(t_std/niter));
+  printf("PairIterator::sort sec/iter: %lf (Mpairs/s = %lf), speedup = %lf\n",
+          t_pi/niter, 1.E-6*n/(t_pi/niter), t_std/t_pi);
+
+  free(pairs);
+  free(ref);
+  free(data);
+}
+
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int niter, el, nbits;
+  int64_t n;
+  int const in_num = argc;
+  char ** input_str = argv;
+  MPI_Init(&argc, &argv);
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atol(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 1000000;
+  } else n = 1000000;
+
+  if (getCmdOption(input_str, input_str+in_num, "-niter")){
+    niter = atoi(getCmdOption(input_str, input_str+in_num, "-niter"));
+    if (niter < 0) niter = 8;
+  } else niter = 8;
+
+  if (getCmdOption(input_str, input_str+in_num, "-bits")){
+    nbits = atoi(getCmdOption(input_str, input_str+in_num, "-bits"));
+    if (nbits < 1 || nbits > 63) nbits = 40;
+  } else nbits = 40;
+
+  if (getCmdOption(input_str, input_str+in_num, "-el")){
+    el = atoi(getCmdOption(input_str, input_str+in_num, "-el"));
+  } else el = 8;
+
+  switch (el){
+    case 4:
+      bench_pair_sort<4>(n, nbits, niter);
+      break;
+    case 8:
+      bench_pair_sort<8>(n, nbits, niter);
+      break;
+    case 16:
+      bench_pair_sort<16>(n, nbits, niter);
+      break;
+    case 40:
+      bench_pair_sort<40>(n, nbits, niter);
+      break;
+    default:
+      printf("Value sizes supported by -el are 4, 8, 16, and 40 bytes\n");
+      break;
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
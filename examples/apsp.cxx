@@ -25,12 +25,8 @@ int apsp(int     n,
          World & dw,
          int     niter=0){
 
-  //tropical semiring, define additive identity to be INT_MAX/2 to prevent integer overflow
-  Semiring<int> s(INT_MAX/2, 
-                  [](int a, int b){ return std::min(a,b); },
-                  MPI_MIN,
-                  0,
-                  [](int a, int b){ return a+b; });
+  //tropical (min,+) semiring, additive identity is INT_MAX/2 to prevent integer overflow
+  Tropical_Semiring<int> s;
 
   //random adjacency matrix
   Matrix<int> A(n, n, dw, s);
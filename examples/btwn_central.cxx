@@ -216,12 +216,8 @@ int btwn_cnt(int     n,
              bool    sp_B=1,
              bool    sp_C=1){
 
-  //tropical semiring, define additive identity to be INT_MAX/2 to prevent integer overflow
-  Semiring<int> s(INT_MAX/2, 
-                  [](int a, int b){ return std::min(a,b); },
-                  MPI_MIN,
-                  0,
-                  [](int a, int b){ return a+b; });
+  //tropical (min,+) semiring, additive identity is INT_MAX/2 to prevent integer overflow
+  Tropical_Semiring<int> s;
 
   //random adjacency matrix
   Matrix<int> A(n, n, SP, dw, s, "A");
@@ -20,7 +20,10 @@
 #include "../sparse_formats/coo.h"
 #include "../sparse_formats/csr.h"
 #include <cfloat>
+#include <climits>
 #include <limits>
+#include <map>
+#include <string>
 
 namespace CTF_int {
 
@@ -30,6 +33,8 @@ namespace CTF_int {
     if (idx_A != NULL) cdealloc(idx_A);
     if (idx_B != NULL) cdealloc(idx_B);
     if (idx_C != NULL) cdealloc(idx_C);
+    if (nnz_hist_A != NULL) cdealloc(nnz_hist_A);
+    if (nnz_hist_B != NULL) cdealloc(nnz_hist_B);
   }
 
   contraction::contraction(contraction const & other){
@@ -47,6 +52,15 @@ namespace CTF_int {
     func      = other.func;
     alpha = other.alpha;
     beta  = other.beta;
+    epilogue = other.epilogue;
+    mem_budget = other.mem_budget;
+    mem_pred = other.mem_pred;
+    nnz_hist_A = NULL;
+    nnz_hist_B = NULL;
+    mask = other.mask;
+    is_mask_cmp = other.is_mask_cmp;
+    is_mask_valued = other.is_mask_valued;
+    pipeline_bcast = other.pipeline_bcast;
   }
  
   contraction::contraction(tensor *               A_,
@@ -66,6 +80,15 @@ namespace CTF_int {
     func = func_;
     alpha = alpha_;
     beta  = beta_;
+    epilogue = NULL;
+    mem_budget = -1;
+    mem_pred = NULL;
+    nnz_hist_A = NULL;
+    nnz_hist_B = NULL;
+    mask = NULL;
+    is_mask_cmp = false;
+    is_mask_valued = false;
+    pipeline_bcast = true;
     
     idx_A = (int*)alloc(sizeof(int)*A->order);
     idx_B = (int*)alloc(sizeof(int)*B->order);
@@ -92,6 +115,15 @@ namespace CTF_int {
     func = func_;
     alpha = alpha_;
     beta  = beta_;
+    epilogue = NULL;
+    mem_budget = -1;
+    mem_pred = NULL;
+    nnz_hist_A = NULL;
+    nnz_hist_B = NULL;
+    mask = NULL;
+    is_mask_cmp = false;
+    is_mask_valued = false;
+    pipeline_bcast = true;
     
     conv_idx(A->order, cidx_A, &idx_A, B->order, cidx_B, &idx_B, C->order, cidx_C, &idx_C);
   }
@@ -108,10 +140,126 @@ namespace CTF_int {
 //      update_all_models(A->wrld->cdt.cm);
     //}
     
-    int stat = home_contract();
+    //operands stored in types other than that of C, but no wider (e.g. float into double), are widened in the local kernels
+    if (!is_custom && (A->sr->el_size > C->sr->el_size || B->sr->el_size > C->sr->el_size ||
+                       ((!A->sr->is_same_type(C->sr) || !B->sr->is_same_type(C->sr)) && is_sparse()))){
+      printf("CTF ERROR: mixed-precision contraction requires dense operands stored in types no wider than the output\n");
+      IASSERT(0);
+      return;
+    }
+
+    int stat;
+    if (mask != NULL)
+      stat = masked_contract();
+    else
+      stat = home_contract();
     if (stat != SUCCESS)
       printf("CTF ERROR: Failed to perform contraction\n");
   }
+
+  int contraction::masked_contract(){
+    if (mask->wrld != C->wrld || mask->order != C->order){
+      printf("CTF ERROR: mask of contraction must be defined on the same World and have the same order as the output\n");
+      IASSERT(0);
+      return ERROR;
+    }
+    for (int i=0; i<C->order; i++){
+      if (mask->lens[i] != C->lens[i] || mask->sym[i] != NS || C->sym[i] != NS){
+        printf("CTF ERROR: mask of contraction must have the same lengths as the output, and both must be nonsymmetric\n");
+        IASSERT(0);
+        return ERROR;
+      }
+      for (int j=0; j<i; j++){
+        if (idx_C[i] == idx_C[j]){
+          printf("CTF ERROR: masked contraction cannot have repeated output indices\n");
+          IASSERT(0);
+          return ERROR;
+        }
+      }
+    }
+    if (is_custom && func->is_accumulator()){
+      printf("CTF ERROR: masked contraction requires a function whose output is added to C, not a transform of C\n");
+      IASSERT(0);
+      return ERROR;
+    }
+    int stat;
+    if (!mask->is_sparse || (is_mask_valued && mask->sr->addid() != NULL)){
+      /* reduce the mask to the structure of the entries that select the output */
+      tensor * M = new tensor(mask, 1, 1);
+      if (M->is_sparse){
+        M->has_home = 0;
+        M->is_home = 0;
+      }
+      if (is_mask_valued && M->sr->addid() != NULL)
+        M->sparsify([&](char const * c){ return !M->sr->isequal(c, M->sr->addid()); });
+      else
+        M->sparsify([](char const * c){ return true; });
+      contraction new_ctr(*this);
+      new_ctr.mask = M;
+      new_ctr.is_mask_valued = false;
+      stat = new_ctr.masked_contract();
+      delete M;
+      return stat;
+    }
+    if (!C->is_sparse || (C->nnz_tot > 0 && !C->sr->isequal(beta, C->sr->addid()))){
+      /* the selected entries are computed into a sparse intermediate, which is then added to beta*C,
+         so that the mask, which is applied to the output of the contraction, never removes entries of C */
+      tensor * C_buf = new tensor(C->sr, C->order, C->lens, C->sym, C->wrld, 1, C->name, 0, 1);
+      contraction new_ctr(*this);
+      new_ctr.C = C_buf;
+      new_ctr.beta = C->sr->addid();
+      new_ctr.epilogue = NULL;
+      stat = new_ctr.home_contract();
+      if (stat == SUCCESS){
+        int sidx_C[C->order];
+        for (int i=0; i<C->order; i++){ sidx_C[i] = i; }
+        summation s(C_buf, sidx_C, C->sr->mulid(), C, sidx_C, beta);
+        s.execute();
+        if (epilogue != NULL){
+          scaling escl = scaling(C, sidx_C, C->sr->mulid(), epilogue);
+          escl.execute();
+        }
+      }
+      delete C_buf;
+      return stat;
+    }
+    return home_contract();
+  }
+
+  /**
+   * \brief removes the local entries of C absent from (or, if is_mask_cmp, present in) the local entries
+   *        of a sparse mask with the same distribution as C, which must hold only alpha*A*B (masked_contract
+   *        computes into an intermediate when beta*C is nonzero)
+   * \param[in,out] C sparse output tensor
+   * \param[in] M sparse mask tensor aligned with C
+   * \param[in] is_mask_cmp whether entries present in, rather than absent from, M are removed
+   */
+  static void filter_by_mask(tensor * C, tensor const * M, bool is_mask_cmp){
+    TAU_FSTART(filter_by_mask);
+    int64_t * mkeys = (int64_t*)alloc(sizeof(int64_t)*std::max((int64_t)1, M->nnz_loc));
+    ConstPairIterator pm(M->sr, M->data);
+    for (int64_t i=0; i<M->nnz_loc; i++){
+      mkeys[i] = pm[i].k();
+    }
+    std::sort(mkeys, mkeys+M->nnz_loc);
+    int nvirt = C->calc_nvirt();
+    int64_t nnz_blk[nvirt];
+    PairIterator pc(C->sr, C->data);
+    int64_t i = 0, nnz_new = 0;
+    for (int v=0; v<nvirt; v++){
+      nnz_blk[v] = 0;
+      for (int64_t j=0; j<C->nnz_blk[v]; j++, i++){
+        if (std::binary_search(mkeys, mkeys+M->nnz_loc, pc[i].k()) != is_mask_cmp){
+          if (nnz_new != i) memcpy(pc[nnz_new].ptr, pc[i].ptr, C->sr->pair_size());
+          nnz_new++;
+          nnz_blk[v]++;
+        }
+      }
+    }
+    cdealloc(mkeys);
+    C->set_new_nnz_glb(nnz_blk);
+    TAU_FSTOP(filter_by_mask);
+  }
   
   template<typename ptype>
   void get_perm(int     perm_order,
@@ -252,6 +400,39 @@ namespace CTF_int {
     return A->is_sparse || B->is_sparse || C->is_sparse;
   }
 
+  bool contraction::use_csf() const {
+    if (!A->is_sparse || !A->is_csf || A->order < 3 || B->is_sparse || C->is_sparse) return false;
+    for (int i=0; i<A->order; i++){
+      if (A->sym[i] != NS) return false;
+    }
+    for (int i=0; i<B->order; i++){
+      if (B->sym[i] != NS) return false;
+    }
+    for (int i=0; i<C->order; i++){
+      if (C->sym[i] != NS) return false;
+    }
+    return true;
+  }
+
+  void contraction::get_csf_mode_order(int * mode_order) const {
+    if (A->csf_mode_order != NULL){
+      memcpy(mode_order, A->csf_mode_order, sizeof(int)*A->order);
+      return;
+    }
+    //modes indexing C are closest to the root, so that the offset into C is fixed within deeper subtrees
+    //and root fibers may be processed concurrently, otherwise modes are kept in order of significance in the key
+    int l = 0;
+    for (int in_C=1; in_C>=0; in_C--){
+      for (int i=A->order-1; i>=0; i--){
+        bool is_in_C = false;
+        for (int j=0; j<C->order; j++){
+          if (idx_A[i] == idx_C[j]) is_in_C = true;
+        }
+        if (is_in_C == (bool)in_C) mode_order[l++] = i;
+      }
+    }
+  }
+
   void contraction::get_fold_indices(int *  num_fold,
                                      int ** fold_idx){
     int i, in, num_tot, nfold, broken;
@@ -403,6 +584,8 @@ namespace CTF_int {
         if (idx_C[i] == idx_C[j]) return 0;
       }
     }
+    //CSF trees are traversed by the unfolded sparse kernel
+    if (use_csf()) return 0;
     get_fold_indices(&nfold, &fold_idx);
     if (is_sparse()){
       //when A is sparse we must fold all indices and reduce block contraction entirely to coomm
@@ -767,6 +950,7 @@ namespace CTF_int {
     select_ctr_perm(fold_ctr, all_fdim_A, all_fdim_B, all_fdim_C,
                               all_flen_A, all_flen_B, all_flen_C,
                     bperm_order, btime, iprm);
+    iprm.dcsr_A = false;
     if (is_sparse()){
       bperm_order = 1;
       iprm.tA = 'N';
@@ -801,7 +985,13 @@ namespace CTF_int {
             if (idx_A[i] == idx_C[j]) nrow_idx++;
           }
         }
-        A->spmatricize(iprm.m, iprm.k, nrow_idx, csr_or_coo);
+        //the kernels take A, but not B or C, in DCSR layout
+        bool allow_dcsr = A != B && A != C;
+  #ifdef OFFLOAD
+        if (is_custom && func->has_off_gemm) allow_dcsr = false;
+  #endif
+        A->spmatricize(iprm.m, iprm.k, nrow_idx, csr_or_coo, allow_dcsr);
+        iprm.dcsr_A = A->is_dcsr;
       }
       if (!B->is_sparse){
         nosym_transpose(B, all_fdim_B, all_flen_B, B->inner_ordering, 1);
@@ -886,6 +1076,11 @@ namespace CTF_int {
       nB = new tensor(B, 0, 0);
       nC = new tensor(C, 0, 0);
       nctr = new contraction(nA, idx_A, nB, idx_B, alpha, nC, idx_C, beta, func);
+      nctr->mem_budget = mem_budget;
+      nctr->mask = mask;
+      nctr->is_mask_cmp = is_mask_cmp;
+      nctr->is_mask_valued = is_mask_valued;
+      nctr->mem_pred = mem_pred;
       *new_contraction = nctr;
 
       nA->clear_mapping();
@@ -2430,10 +2625,66 @@ namespace CTF_int {
 
   }
 
-  void contraction::get_best_sel_map(distribution const * dA, distribution const * dB, distribution const * dC, topology * old_topo_A, topology * old_topo_B, topology * old_topo_C, mapping const * old_map_A, mapping const * old_map_B, mapping const * old_map_C, int & idx, double & time){
+  int64_t contraction::get_mem_limit(){
+    int64_t max_memuse = proc_bytes_available();
+    int64_t budget = mem_budget >= 0 ? mem_budget : A->wrld->mem_budget;
+    if (budget >= 0) max_memuse = std::min(max_memuse, budget);
+    return max_memuse;
+  }
+
+  /**
+   * \brief number of predictions kept for autotuning, which exceeds the number of mappings
+   *        timed, since many of the variants considered by the searches give the same mapping
+   */
+  static int get_num_top_maps(World const * wrld){
+    return 8*wrld->autotune;
+  }
+
+  /**
+   * \brief inserts a mapping into the list of the ntop mappings with the least predicted time
+   */
+  static void push_top_map(std::vector< std::pair<double,int> > & top, int ntop, double time, int idx){
+    std::pair<double,int> p(time, idx);
+    top.insert(std::upper_bound(top.begin(), top.end(), p), p);
+    if ((int)top.size() > ntop) top.pop_back();
+  }
+
+  /**
+   * \brief predicted time below which a mapping enters the list of the ntop fastest mappings
+   */
+  static double top_map_bound(std::vector< std::pair<double,int> > const & top, int ntop){
+    if ((int)top.size() < ntop) return DBL_MAX;
+    return top.back().first;
+  }
+
+  /**
+   * \brief replaces the list of the ntop fastest mappings found by this process with that of all processes
+   */
+  static void allgather_top_maps(std::vector< std::pair<double,int> > & top, int ntop, CommData & cdt){
+    double * times = (double*)CTF_int::alloc(sizeof(double)*ntop);
+    int * idxs = (int*)CTF_int::alloc(sizeof(int)*ntop);
+    double * all_times = (double*)CTF_int::alloc(sizeof(double)*ntop*cdt.np);
+    int * all_idxs = (int*)CTF_int::alloc(sizeof(int)*ntop*cdt.np);
+    for (int i=0; i<ntop; i++){
+      times[i] = i < (int)top.size() ? top[i].first : DBL_MAX;
+      idxs[i] = i < (int)top.size() ? top[i].second : INT_MAX;
+    }
+    MPI_Allgather(times, ntop, MPI_DOUBLE, all_times, ntop, MPI_DOUBLE, cdt.cm);
+    MPI_Allgather(idxs, ntop, MPI_INT, all_idxs, ntop, MPI_INT, cdt.cm);
+    top.clear();
+    for (int i=0; i<ntop*cdt.np; i++){
+      if (all_times[i] < DBL_MAX) push_top_map(top, ntop, all_times[i], all_idxs[i]);
+    }
+    cdealloc(times);
+    cdealloc(idxs);
+    cdealloc(all_times);
+    cdealloc(all_idxs);
+  }
+
+  void contraction::get_best_sel_map(distribution const * dA, distribution const * dB, distribution const * dC, topology * old_topo_A, topology * old_topo_B, topology * old_topo_C, mapping const * old_map_A, mapping const * old_map_B, mapping const * old_map_C, int & idx, double & time, int64_t & mem, std::vector< std::pair<double,int> > * top){
     int ret, j, d;
     int need_remap_A, need_remap_B, need_remap_C;
-    int64_t memuse;//, bmemuse;
+    int64_t memuse, bmemuse;
     double est_time, best_time;
     int btopo;
     bool is_ctr_sparse = is_sparse();
@@ -2447,7 +2698,8 @@ namespace CTF_int {
             B->order, idx_B,
             C->order, idx_C,
             &num_tot, &idx_arr);
-    int64_t max_memuse = proc_bytes_available();
+    int64_t max_memuse = get_mem_limit();
+    bmemuse = 0;
     for (j=0; j<6; j++){
       // Attempt to map to all possible permutations of processor topology 
   #if DEBUG < 3 
@@ -2530,6 +2782,9 @@ namespace CTF_int {
         double nnz_frac_C = 1.0;
         if (A->is_sparse) nnz_frac_A = std::min(1.,((double)A->nnz_tot)/(A->size*A->calc_npe()));
         if (B->is_sparse) nnz_frac_B = std::min(1.,((double)B->nnz_tot)/(B->size*B->calc_npe()));
+        //the most loaded process determines the time and memory of the mapping
+        if (nnz_hist_A != NULL) nnz_frac_A = std::min(1.,nnz_frac_A*A->est_nnz_imbalance(nnz_hist_A));
+        if (nnz_hist_B != NULL) nnz_frac_B = std::min(1.,nnz_frac_B*B->est_nnz_imbalance(nnz_hist_B));
         if (C->is_sparse){
           nnz_frac_C = std::min(1.,((double)C->nnz_tot)/(C->size*C->calc_npe()));
           int64_t len_ctr = 1;
@@ -2638,12 +2893,14 @@ namespace CTF_int {
 
         if (est_time < best_time) {
           best_time = est_time;
-          //bmemuse = memuse;
+          bmemuse = memuse;
           btopo = 6*t+j;
         }  
+        if (top != NULL) push_top_map(*top, get_num_top_maps(wrld), est_time, 6*t+j);
         delete sctr;
       }
     }
+    if (top != NULL) allgather_top_maps(*top, get_num_top_maps(wrld), global_comm);
     TAU_FSTART(all_select_ctr_map);
     double gbest_time;
     MPI_Allreduce(&best_time, &gbest_time, 1, MPI_DOUBLE, MPI_MIN, global_comm.cm);
@@ -2652,6 +2909,9 @@ namespace CTF_int {
     }
     int ttopo;
     MPI_Allreduce(&btopo, &ttopo, 1, MPI_INT, MPI_MIN, global_comm.cm);
+    //memory of the chosen mapping, which was evaluated by a single process
+    int64_t lmem = btopo == ttopo ? bmemuse : 0;
+    MPI_Allreduce(&lmem, &mem, 1, MPI_INT64_T, MPI_MAX, global_comm.cm);
     TAU_FSTOP(all_select_ctr_map);
 
     idx=ttopo;
@@ -2660,10 +2920,10 @@ namespace CTF_int {
     cdealloc(idx_arr);
   }
 
-  void contraction::get_best_exh_map(distribution const * dA, distribution const * dB, distribution const * dC, topology * old_topo_A, topology * old_topo_B, topology * old_topo_C, mapping const * old_map_A, mapping const * old_map_B, mapping const * old_map_C, int & idx, double & time, double init_best_time=DBL_MAX){
+  void contraction::get_best_exh_map(distribution const * dA, distribution const * dB, distribution const * dC, topology * old_topo_A, topology * old_topo_B, topology * old_topo_C, mapping const * old_map_A, mapping const * old_map_B, mapping const * old_map_C, int & idx, double & time, int64_t & mem, double init_best_time, std::vector< std::pair<double,int> > * top){
     int d;
     int need_remap_A, need_remap_B, need_remap_C;
-    int64_t memuse;//, bmemuse;
+    int64_t memuse, bmemuse;
     double est_time, best_time;
     int btopo;
     bool is_ctr_sparse = is_sparse();
@@ -2684,7 +2944,8 @@ namespace CTF_int {
     }
     int64_t valid_mappings = 0;
     int64_t choice_offset = 0;
-    int64_t max_memuse = proc_bytes_available();
+    int64_t max_memuse = get_mem_limit();
+    bmemuse = 0;
     TAU_FSTOP(init_select_ctr_map);
     for (int i=0; i<(int)wrld->topovec.size(); i++){
 //      int tnum_choices = pow(num_choices,(int) wrld->topovec[i]->order);
@@ -2745,6 +3006,9 @@ namespace CTF_int {
         double nnz_frac_C = 1.0;
         if (A->is_sparse) nnz_frac_A = std::min(1.,((double)A->nnz_tot)/(A->size*A->calc_npe()));
         if (B->is_sparse) nnz_frac_B = std::min(1.,((double)B->nnz_tot)/(B->size*B->calc_npe()));
+        //the most loaded process determines the time and memory of the mapping
+        if (nnz_hist_A != NULL) nnz_frac_A = std::min(1.,nnz_frac_A*A->est_nnz_imbalance(nnz_hist_A));
+        if (nnz_hist_B != NULL) nnz_frac_B = std::min(1.,nnz_frac_B*B->est_nnz_imbalance(nnz_hist_B));
         if (C->is_sparse){
           nnz_frac_C = std::min(1.,((double)C->nnz_tot)/(C->size*C->calc_npe()));
           nnz_frac_C = std::max(nnz_frac_C,nnz_frac_A);
@@ -2828,7 +3092,8 @@ namespace CTF_int {
           memuse = std::max(1.*memuse,2.*C->get_redist_mem(*dC, nnz_frac_C));
         }
  
-        if (est_time >= best_time) continue;
+        if (est_time >= best_time &&
+            (top == NULL || est_time >= top_map_bound(*top, get_num_top_maps(wrld)))) continue;
 
         if (is_ctr_sparse)
           memuse = MAX(((spctr*)sctr)->spmem_rec(nnz_frac_A,nnz_frac_B,nnz_frac_C), memuse);
@@ -2857,12 +3122,14 @@ namespace CTF_int {
         }
         if (est_time < best_time) {
           best_time = est_time;
-          //bmemuse = memuse;
+          bmemuse = memuse;
           btopo = old_off+j;
         }  
+        if (top != NULL) push_top_map(*top, get_num_top_maps(wrld), est_time, old_off+j);
         delete sctr;
       }
     }
+    if (top != NULL) allgather_top_maps(*top, get_num_top_maps(wrld), global_comm);
 #if DEBUG >= 2 
     int64_t tot_valid_mappings;
     MPI_Allreduce(&valid_mappings, &tot_valid_mappings, 1, MPI_INT64_T, MPI_SUM, global_comm.cm);
@@ -2876,6 +3143,9 @@ namespace CTF_int {
     }
     int ttopo;
     MPI_Allreduce(&btopo, &ttopo, 1, MPI_INT, MPI_MIN, global_comm.cm);
+    //memory of the chosen mapping, which was evaluated by a single process
+    int64_t lmem = btopo == ttopo ? bmemuse : 0;
+    MPI_Allreduce(&lmem, &mem, 1, MPI_INT64_T, MPI_MAX, global_comm.cm);
     TAU_FSTOP(all_select_ctr_map);
 
     idx=ttopo;
@@ -2885,8 +3155,508 @@ namespace CTF_int {
 
   }
 
-  int contraction::map(ctr ** ctrf, bool do_remap){
-    int ret, j, need_remap, d;
+  /**
+   * \brief mapping chosen by contraction::map for a contraction signature
+   */
+  struct ctr_plan {
+    World const * wrld;
+    topology * topo;
+    mapping * map_A;
+    mapping * map_B;
+    mapping * map_C;
+    double est_time;
+    int64_t mem;
+    /** \brief value of ctr_plan_cache_clock when the plan was last used */
+    int64_t last_use;
+    /** \brief tree constructed for the mapping, copied and rebound on later hits, NULL if not kept */
+    ctr * ctrf;
+    /** \brief value of contraction::pipeline_bcast with which the mapping was found */
+    bool pipeline_bcast;
+  };
+
+  /** \brief maximum number of distinct contraction signatures kept in the plan cache */
+  #define MAX_CTR_PLAN_CACHE_SIZE 1024
+
+  static std::map< std::vector<int64_t>, ctr_plan > * ctr_plan_cache = NULL;
+  static int64_t ctr_plan_cache_hits = 0;
+  static int64_t ctr_plan_cache_misses = 0;
+  static int64_t ctr_plan_cache_clock = 0;
+
+  /** \brief nonzero imbalance of the operands of the last mapped sparse contraction */
+  static double sp_ctr_imb_A = 1.;
+  static double sp_ctr_imb_B = 1.;
+
+  /**
+   * \brief computes the ratio of the largest number of nonzeros of a sparse tensor held by a
+   *        process to the average over the processes holding a block of it (collective)
+   */
+  static double calc_nnz_imbalance(tensor const * T){
+    if (T->nnz_tot == 0) return 1.;
+    int64_t max_nnz;
+    int64_t nnz_loc = T->nnz_loc;
+    T->wrld->cdt.allred(&nnz_loc, &max_nnz, 1, MPI_INT64_T, MPI_MAX);
+    return ((double)max_nnz*T->calc_npe())/T->nnz_tot;
+  }
+
+  static void free_ctr_plan(ctr_plan & plan){
+    delete [] plan.map_A;
+    delete [] plan.map_B;
+    delete [] plan.map_C;
+    if (plan.ctrf != NULL) delete plan.ctrf;
+  }
+
+  /**
+   * \brief makes room for a new plan by dropping the least recently used one once the cache is full
+   */
+  static void evict_ctr_plan(){
+    if ((int64_t)ctr_plan_cache->size() < MAX_CTR_PLAN_CACHE_SIZE) return;
+    std::map< std::vector<int64_t>, ctr_plan >::iterator lru = ctr_plan_cache->begin();
+    for (std::map< std::vector<int64_t>, ctr_plan >::iterator it=ctr_plan_cache->begin(); it!=ctr_plan_cache->end(); it++){
+      if (it->second.last_use < lru->second.last_use) lru = it;
+    }
+    free_ctr_plan(lru->second);
+    ctr_plan_cache->erase(lru);
+  }
+
+  /**
+   * \brief records the mapping of A, B, and C as the plan for signature sig
+   */
+  static void add_ctr_plan(std::vector<int64_t> const & sig, World const * wrld, tensor const * A, tensor const * B, tensor const * C, double est_time, int64_t mem, bool pipeline_bcast){
+    std::map< std::vector<int64_t>, ctr_plan >::iterator plan_it = ctr_plan_cache->find(sig);
+    if (plan_it != ctr_plan_cache->end()){
+      free_ctr_plan(plan_it->second);
+      ctr_plan_cache->erase(plan_it);
+    } else
+      evict_ctr_plan();
+    ctr_plan plan;
+    plan.wrld     = wrld;
+    plan.topo     = A->topo;
+    plan.map_A    = new mapping[A->order];
+    plan.map_B    = new mapping[B->order];
+    plan.map_C    = new mapping[C->order];
+    copy_mapping(A->order, A->edge_map, plan.map_A);
+    copy_mapping(B->order, B->edge_map, plan.map_B);
+    copy_mapping(C->order, C->edge_map, plan.map_C);
+    plan.est_time = est_time;
+    plan.mem      = mem;
+    plan.last_use = ctr_plan_cache_clock++;
+    plan.ctrf     = NULL;
+    plan.pipeline_bcast = pipeline_bcast;
+    (*ctr_plan_cache)[sig] = plan;
+  }
+
+  static void append_mapping_sig(std::vector<int64_t> & sig, mapping const * map){
+    while (map != NULL){
+      sig.push_back(map->type);
+      if (map->type != NOT_MAPPED) sig.push_back(map->np);
+      if (map->type == PHYSICAL_MAP) sig.push_back(map->cdt);
+      if (map->has_child) map = map->child;
+      else map = NULL;
+    }
+    sig.push_back(-1);
+  }
+
+  /**
+   * \brief FNV-1a hash of the name of the element type of sr, which agrees on all processes and
+   *        across runs of the same executable (unlike std::type_info::hash_code)
+   */
+  static int64_t get_el_type_sig(algstrct const * sr){
+    uint64_t h = 14695981039346656037ULL;
+    for (char const * c = sr->el_type().name(); *c != '\0'; c++){
+      h ^= (uint64_t)(unsigned char)*c;
+      h *= 1099511628211ULL;
+    }
+    return (int64_t)h;
+  }
+
+  static void append_tensor_sig(std::vector<int64_t> & sig, tensor const * T, int const * idx){
+    sig.push_back(T->order);
+    // types of the same size, e.g. float and int, do not share plans
+    sig.push_back(T->sr->el_size);
+    sig.push_back(get_el_type_sig(T->sr));
+    sig.push_back(T->is_sparse);
+    if (T->is_sparse) sig.push_back(T->nnz_tot);
+    sig.push_back(T->is_cyclic);
+    // record topology by its index rather than address, so keys agree on all processes
+    int itopo = -1;
+    for (int i=0; i<(int)T->wrld->topovec.size(); i++){
+      if (T->wrld->topovec[i] == T->topo) itopo = i;
+    }
+    sig.push_back(itopo);
+    for (int i=0; i<T->order; i++){
+      sig.push_back(T->lens[i]);
+      sig.push_back(T->sym[i]);
+      sig.push_back(idx[i]);
+      append_mapping_sig(sig, T->edge_map+i);
+    }
+  }
+
+  /**
+   * \brief computes a key that determines the outcome of the mapping search, except for the
+   *        available memory, which is checked again (by an MPI_Allreduce) whenever the key is found,
+   *        so a cache hit still costs one collective, though not the mapping search
+   */
+  static std::vector<int64_t> get_ctr_plan_sig(tensor const * A, int const * idx_A,
+                                              tensor const * B, int const * idx_B,
+                                              tensor const * C, int const * idx_C,
+                                              bool is_custom, int64_t mem_budget){
+    std::vector<int64_t> sig;
+    sig.push_back((int64_t)(intptr_t)A->wrld);
+    sig.push_back(is_custom);
+    sig.push_back(mem_budget);
+    append_tensor_sig(sig, A, idx_A);
+    append_tensor_sig(sig, B, idx_B);
+    append_tensor_sig(sig, C, idx_C);
+    return sig;
+  }
+
+  /**
+   * \brief mapping chosen by autotuning for a contraction signature, kept for the rest of the run
+   *        and in the tuning file (World::tuning_file) for later runs
+   */
+  struct ctr_tuned_plan {
+    /** \brief index of the topology in World::topovec */
+    int itopo;
+    /** \brief mappings of the modes of A, B, and C, each as given by append_mapping_sig() */
+    std::vector<int64_t> maps;
+    double est_time;
+    int64_t mem;
+    /** \brief measured time of the contraction with this mapping */
+    double run_time;
+  };
+
+  /** \brief tuned plans by signature, with the World replaced by its number of processes */
+  static std::map< std::vector<int64_t>, ctr_tuned_plan > * ctr_tuned_plans = NULL;
+  /** \brief (tuning file, World) pairs whose file has been read */
+  static std::set< std::pair<std::string, World const *> > * ctr_tuning_files_read = NULL;
+  /** \brief whether contractions are being executed to time candidate mappings */
+  static bool in_ctr_autotune = false;
+
+  static std::vector<int64_t> get_ctr_tuned_sig(std::vector<int64_t> const & plan_sig, World const * wrld){
+    std::vector<int64_t> sig(plan_sig);
+    sig[0] = wrld->np;
+    return sig;
+  }
+
+  static int get_topo_index(World const * wrld, topology const * topo){
+    for (int i=0; i<(int)wrld->topovec.size(); i++){
+      if (wrld->topovec[i] == topo) return i;
+    }
+    return -1;
+  }
+
+  /**
+   * \brief reads mapping of order modes written by append_mapping_sig()
+   * \return position after the mapping in maps, -1 if maps is malformed
+   */
+  static int read_mapping_sig(std::vector<int64_t> const & maps, int pos, int order, mapping * map){
+    for (int i=0; i<order; i++){
+      map[i].clear();
+      mapping * m = map+i;
+      for (;;){
+        if (pos >= (int)maps.size() || maps[pos] < NOT_MAPPED || maps[pos] > VIRTUAL_MAP) return -1;
+        m->type = (map_type)maps[pos++];
+        if (m->type != NOT_MAPPED){
+          if (pos >= (int)maps.size()) return -1;
+          m->np = maps[pos++];
+        }
+        if (m->type == PHYSICAL_MAP){
+          if (pos >= (int)maps.size()) return -1;
+          m->cdt = maps[pos++];
+        }
+        if (pos >= (int)maps.size()) return -1;
+        if (maps[pos] == -1){
+          pos++;
+          break;
+        }
+        m->has_child = 1;
+        m->child = new mapping();
+        m = m->child;
+      }
+    }
+    return pos;
+  }
+
+  /**
+   * \brief reads the plans in the tuning file of wrld, if it has not been read for wrld already
+   *        (collective on wrld, the file is read by its first process)
+   */
+  static void read_ctr_tuning_file(World const * wrld){
+    if (ctr_tuned_plans == NULL)
+      ctr_tuned_plans = new std::map< std::vector<int64_t>, ctr_tuned_plan >();
+    if (ctr_tuning_files_read == NULL)
+      ctr_tuning_files_read = new std::set< std::pair<std::string, World const *> >();
+    std::pair<std::string, World const *> key(wrld->tuning_file, wrld);
+    if (ctr_tuning_files_read->find(key) != ctr_tuning_files_read->end()) return;
+    ctr_tuning_files_read->insert(key);
+
+    int64_t sz = 0;
+    char * buf = NULL;
+    if (wrld->rank == 0){
+      FILE * f = fopen(wrld->tuning_file.c_str(), "r");
+      if (f != NULL){
+        fseek(f, 0, SEEK_END);
+        sz = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        buf = (char*)CTF_int::alloc(sz+1);
+        sz = fread(buf, 1, sz, f);
+        fclose(f);
+      }
+    }
+    MPI_Bcast(&sz, 1, MPI_INT64_T, 0, wrld->comm);
+    if (sz == 0){
+      if (buf != NULL) cdealloc(buf);
+      return;
+    }
+    if (wrld->rank != 0) buf = (char*)CTF_int::alloc(sz+1);
+    MPI_Bcast(buf, sz, MPI_CHAR, 0, wrld->comm);
+    buf[sz] = '\0';
+
+    //each line is: nsig sig[0] ... sig[nsig-1] itopo nmaps maps[0] ... maps[nmaps-1] est_time mem run_time
+    char * ptr = buf;
+    for (;;){
+      char * end;
+      int64_t nsig = strtoll(ptr, &end, 10);
+      if (end == ptr) break;
+      ptr = end;
+      bool valid = nsig > 0;
+      std::vector<int64_t> sig;
+      for (int64_t i=0; valid && i<nsig; i++){
+        sig.push_back(strtoll(ptr, &end, 10));
+        valid = end != ptr;
+        ptr = end;
+      }
+      ctr_tuned_plan plan;
+      int64_t nmaps = 0;
+      if (valid){
+        plan.itopo = strtol(ptr, &end, 10);
+        valid = end != ptr;
+        ptr = end;
+      }
+      if (valid){
+        nmaps = strtoll(ptr, &end, 10);
+        valid = end != ptr && nmaps >= 0;
+        ptr = end;
+      }
+      for (int64_t i=0; valid && i<nmaps; i++){
+        plan.maps.push_back(strtoll(ptr, &end, 10));
+        valid = end != ptr;
+        ptr = end;
+      }
+      if (valid){
+        plan.est_time = strtod(ptr, &end);
+        valid = end != ptr;
+        ptr = end;
+      }
+      if (valid){
+        plan.mem = strtoll(ptr, &end, 10);
+        valid = end != ptr;
+        ptr = end;
+      }
+      if (valid){
+        plan.run_time = strtod(ptr, &end);
+        valid = end != ptr;
+        ptr = end;
+      }
+      if (!valid){
+        if (wrld->rank == 0)
+          printf("CTF WARNING: ignoring malformed remainder of tuning file %s\n", wrld->tuning_file.c_str());
+        break;
+      }
+      (*ctr_tuned_plans)[sig] = plan;
+    }
+    cdealloc(buf);
+  }
+
+  /**
+   * \brief records the current mapping of A, B, and C as the tuned plan for sig and appends it
+   *        to the tuning file of the World, if any
+   */
+  static void write_ctr_tuned_plan(std::vector<int64_t> const & sig, tensor const * A, tensor const * B, tensor const * C, double est_time, int64_t mem, double run_time){
+    World const * wrld = A->wrld;
+    ctr_tuned_plan plan;
+    plan.itopo = get_topo_index(wrld, A->topo);
+    if (plan.itopo == -1) return;
+    for (int i=0; i<A->order; i++) append_mapping_sig(plan.maps, A->edge_map+i);
+    for (int i=0; i<B->order; i++) append_mapping_sig(plan.maps, B->edge_map+i);
+    for (int i=0; i<C->order; i++) append_mapping_sig(plan.maps, C->edge_map+i);
+    plan.est_time = est_time;
+    plan.mem = mem;
+    plan.run_time = run_time;
+    if (ctr_tuned_plans == NULL)
+      ctr_tuned_plans = new std::map< std::vector<int64_t>, ctr_tuned_plan >();
+    (*ctr_tuned_plans)[sig] = plan;
+    if (wrld->tuning_file.empty() || wrld->rank != 0) return;
+    FILE * f = fopen(wrld->tuning_file.c_str(), "a");
+    if (f == NULL){
+      printf("CTF WARNING: unable to open tuning file %s, tuned mapping not saved\n", wrld->tuning_file.c_str());
+      return;
+    }
+    fprintf(f, "%ld", (int64_t)sig.size());
+    for (int i=0; i<(int)sig.size(); i++) fprintf(f, " %ld", sig[i]);
+    fprintf(f, " %d %ld", plan.itopo, (int64_t)plan.maps.size());
+    for (int i=0; i<(int)plan.maps.size(); i++) fprintf(f, " %ld", plan.maps[i]);
+    fprintf(f, " %.17g %ld %.17g\n", est_time, mem, run_time);
+    fclose(f);
+  }
+
+  /**
+   * \brief maps A, B, and C as the tuned plan for sig, if there is one
+   * \return true if a tuned plan was found and gives a valid mapping
+   */
+  static bool get_ctr_tuned_plan(std::vector<int64_t> const & sig, tensor * A, tensor * B, tensor * C, double & est_time, int64_t & mem){
+    if (ctr_tuned_plans == NULL) return false;
+    std::map< std::vector<int64_t>, ctr_tuned_plan >::iterator it = ctr_tuned_plans->find(sig);
+    if (it == ctr_tuned_plans->end()) return false;
+    ctr_tuned_plan const & plan = it->second;
+    World * wrld = A->wrld;
+    if (plan.itopo < 0 || plan.itopo >= (int)wrld->topovec.size()) return false;
+    int pos = read_mapping_sig(plan.maps, 0, A->order, A->edge_map);
+    if (pos != -1) pos = read_mapping_sig(plan.maps, pos, B->order, B->edge_map);
+    if (pos != -1) pos = read_mapping_sig(plan.maps, pos, C->order, C->edge_map);
+    if (pos != (int)plan.maps.size()) return false;
+    A->topo = wrld->topovec[plan.itopo];
+    B->topo = wrld->topovec[plan.itopo];
+    C->topo = wrld->topovec[plan.itopo];
+    A->is_mapped = 1;
+    B->is_mapped = 1;
+    C->is_mapped = 1;
+    est_time = plan.est_time;
+    mem = plan.mem;
+    return true;
+  }
+
+  /**
+   * \brief sets the mapping of a tensor back to the one of its data
+   */
+  static void restore_mapping(tensor * T, topology * old_topo, mapping const * old_map){
+    T->clear_mapping();
+    T->topo = old_topo;
+    copy_mapping(T->order, old_map, T->edge_map);
+    T->is_mapped = 1;
+    T->set_padding();
+  }
+
+  int contraction::set_best_map(bool is_sel, int ttopo, topology * old_topo_A, topology * old_topo_B, topology * old_topo_C, mapping const * old_map_A, mapping const * old_map_B, mapping const * old_map_C){
+    World * wrld = A->wrld;
+    A->clear_mapping();
+    B->clear_mapping();
+    C->clear_mapping();
+    A->set_padding();
+    B->set_padding();
+    C->set_padding();
+    topology * topo_g = NULL;
+    int j_g;
+    if (is_sel){
+      j_g = ttopo%6;
+      if (ttopo < 48){
+        if (((ttopo/6) & 1) > 0){
+          topo_g = old_topo_A;
+          copy_mapping(A->order, old_map_A, A->edge_map);
+        }
+        if (((ttopo/6) & 2) > 0){
+          topo_g = old_topo_B;
+          copy_mapping(B->order, old_map_B, B->edge_map);
+        }
+
+        if (((ttopo/6) & 4) > 0){
+          topo_g = old_topo_C;
+          copy_mapping(C->order, old_map_C, C->edge_map);
+        }
+        assert(topo_g != NULL);
+
+      } else topo_g = wrld->topovec[(ttopo-48)/6];
+    } else {
+      int64_t choice_offset = 0;
+      int i=0;
+      int64_t old_off = 0;
+      for (i=0; i<(int)wrld->topovec.size(); i++){
+        //int tnum_choices = pow(num_choices,(int) wrld->topovec[i]->order);
+        int tnum_choices = get_num_map_variants(wrld->topovec[i]);
+        old_off = choice_offset;
+        choice_offset += tnum_choices;
+        if (choice_offset > ttopo) break;
+      }
+      topo_g = wrld->topovec[i];
+      j_g = ttopo-old_off;
+    }
+
+    A->topo = topo_g;
+    B->topo = topo_g;
+    C->topo = topo_g;
+    A->is_mapped = 1;
+    B->is_mapped = 1;
+    C->is_mapped = 1;
+  
+    if (is_sel){
+      int ret = map_to_topology(topo_g, j_g);
+      if (ret == NEGATIVE || ret == ERROR) return ERROR;
+    } else {
+      exh_map_to_topo(topo_g, j_g);
+      switch_topo_perm();
+    }
+    return SUCCESS;
+  }
+
+  int contraction::autotune_map(std::vector< std::pair<bool,int> > const & cands, std::vector<int64_t> const & plan_sig, topology * old_topo_A, topology * old_topo_B, topology * old_topo_C, mapping const * old_map_A, mapping const * old_map_B, mapping const * old_map_C, double & time){
+    TAU_FSTART(autotune_ctr_map);
+    CommData global_comm = A->wrld->cdt;
+    int64_t hits = ctr_plan_cache_hits;
+    int64_t misses = ctr_plan_cache_misses;
+    int ibest = 0;
+    time = DBL_MAX;
+    in_ctr_autotune = true;
+    //the first candidate is run once more beforehand, so that no candidate is timed with cold caches
+    for (int it=0; it<=(int)cands.size(); it++){
+      int i = std::max(0, it-1);
+      //copy the operands in the distributions of their data
+      restore_mapping(A, old_topo_A, old_map_A);
+      restore_mapping(B, old_topo_B, old_map_B);
+      restore_mapping(C, old_topo_C, old_map_C);
+      tensor * tA = new tensor(A);
+      tensor * tB = new tensor(B);
+      tensor * tC = new tensor(C);
+
+      //the contraction of the copies finds the candidate mapping in the plan cache
+      set_best_map(cands[i].first, cands[i].second, old_topo_A, old_topo_B, old_topo_C, old_map_A, old_map_B, old_map_C);
+      add_ctr_plan(plan_sig, A->wrld, A, B, C, 0., 0, pipeline_bcast);
+
+      contraction tctr(*this);
+      tctr.A = tA;
+      tctr.B = tB;
+      tctr.C = tC;
+      tctr.mem_pred = NULL;
+      MPI_Barrier(global_comm.cm);
+      double st_time = MPI_Wtime();
+      int ret = tctr.contract();
+      double ltime = MPI_Wtime()-st_time;
+      double ttime;
+      MPI_Allreduce(&ltime, &ttime, 1, MPI_DOUBLE, MPI_MAX, global_comm.cm);
+      if (it > 0 && ret == SUCCESS && ttime < time){
+        time = ttime;
+        ibest = i;
+      }
+      delete tA;
+      delete tB;
+      delete tC;
+    }
+    in_ctr_autotune = false;
+    std::map< std::vector<int64_t>, ctr_plan >::iterator it = ctr_plan_cache->find(plan_sig);
+    if (it != ctr_plan_cache->end()){
+      free_ctr_plan(it->second);
+      ctr_plan_cache->erase(it);
+    }
+    ctr_plan_cache_hits = hits;
+    ctr_plan_cache_misses = misses;
+    restore_mapping(A, old_topo_A, old_map_A);
+    restore_mapping(B, old_topo_B, old_map_B);
+    restore_mapping(C, old_topo_C, old_map_C);
+    TAU_FSTOP(autotune_ctr_map);
+    return ibest;
+  }
+
+  int contraction::map(ctr ** ctrf, bool do_remap, bool * is_cached){
+    int j, need_remap, d;
     int * old_phase_A, * old_phase_B, * old_phase_C;
     topology * old_topo_A, * old_topo_B, * old_topo_C;
     distribution * dA, * dB, * dC;
@@ -2949,102 +3719,170 @@ namespace CTF_int {
     //bmemuse = UINT64_MAX;
     int ttopo, ttopo_sel, ttopo_exh;
     double gbest_time_sel, gbest_time_exh;
-  
-    TAU_FSTART(get_best_sel_map);
-    get_best_sel_map(dA, dB, dC, old_topo_A, old_topo_B, old_topo_C, old_map_A, old_map_B, old_map_C, ttopo_sel, gbest_time_sel);
-    TAU_FSTOP(get_best_sel_map);
-    if (gbest_time_sel < 1.){
-      gbest_time_exh = gbest_time_sel+1.;
-      ttopo_exh = ttopo_sel;
-    } else {
-      TAU_FSTART(get_best_exh_map);
-      get_best_exh_map(dA, dB, dC, old_topo_A, old_topo_B, old_topo_C, old_map_A, old_map_B, old_map_C, ttopo_exh, gbest_time_exh, gbest_time_sel);
-      TAU_FSTOP(get_best_exh_map);
-    }
-    if (gbest_time_sel <= gbest_time_exh){
-      ttopo = ttopo_sel;
+
+    int64_t mem_sel, mem_exh;
+    std::vector<int64_t> plan_sig = get_ctr_plan_sig(A, idx_A, B, idx_B, C, idx_C, is_custom,
+                                                     mem_budget >= 0 ? mem_budget : wrld->mem_budget);
+    if (ctr_plan_cache == NULL)
+      ctr_plan_cache = new std::map< std::vector<int64_t>, ctr_plan >();
+    std::map< std::vector<int64_t>, ctr_plan >::iterator plan_it = ctr_plan_cache->find(plan_sig);
+    //the memory available may have shrunk since the plan was made, in which case the mapping is searched for again
+    if (do_remap && plan_it != ctr_plan_cache->end()){
+      int fits = plan_it->second.mem < get_mem_limit();
+      int all_fit;
+      MPI_Allreduce(&fits, &all_fit, 1, MPI_INT, MPI_MIN, global_comm.cm);
+      if (!all_fit){
+        free_ctr_plan(plan_it->second);
+        ctr_plan_cache->erase(plan_it);
+        plan_it = ctr_plan_cache->end();
+      }
+    }
+    //a mapping chosen by autotuning, in this or an earlier run, is used instead of a search
+    bool do_tune = false;
+    bool is_tuned = false;
+    std::vector<int64_t> tuned_sig;
+    if (do_remap && plan_it == ctr_plan_cache->end() && !in_ctr_autotune &&
+        (wrld->autotune > 0 || !wrld->tuning_file.empty())){
+      tuned_sig = get_ctr_tuned_sig(plan_sig, wrld);
+      if (!wrld->tuning_file.empty()) read_ctr_tuning_file(wrld);
+      double tuned_time;
+      int64_t tuned_mem;
+      is_tuned = get_ctr_tuned_plan(tuned_sig, A, B, C, tuned_time, tuned_mem) && check_mapping();
+      if (is_tuned){
+        gbest_time_sel = tuned_time;
+        gbest_time_exh = tuned_time;
+        mem_sel = tuned_mem;
+        mem_exh = tuned_mem;
+      } else
+        do_tune = wrld->autotune > 0;
+    }
+    if (do_remap && plan_it != ctr_plan_cache->end()){
+      // all processes see the same contraction sequence, so they hit/miss in lockstep
+      ctr_plan_cache_hits++;
+      plan_it->second.last_use = ctr_plan_cache_clock++;
+      ctr_plan const & plan = plan_it->second;
+      pipeline_bcast = plan.pipeline_bcast;
+      gbest_time_sel = plan.est_time;
+      gbest_time_exh = plan.est_time;
+      mem_sel = plan.mem;
+      mem_exh = plan.mem;
+      A->topo = plan.topo;
+      B->topo = plan.topo;
+      C->topo = plan.topo;
+      copy_mapping(A->order, plan.map_A, A->edge_map);
+      copy_mapping(B->order, plan.map_B, B->edge_map);
+      copy_mapping(C->order, plan.map_C, C->edge_map);
+      A->is_mapped = 1;
+      B->is_mapped = 1;
+      C->is_mapped = 1;
+    } else if (is_tuned){
+      ctr_plan_cache_misses++;
+      add_ctr_plan(plan_sig, wrld, A, B, C, gbest_time_sel, mem_sel, pipeline_bcast);
     } else {
-      ttopo = ttopo_exh;
-    }
+      std::vector< std::pair<double,int> > top_sel, top_exh;
+      if (wrld->np > 1){
+        if (A->is_sparse && nnz_hist_A == NULL) nnz_hist_A = A->calc_nnz_hist();
+        if (B->is_sparse && nnz_hist_B == NULL) nnz_hist_B = B->calc_nnz_hist();
+      }
+      for (;;){
+        TAU_FSTART(get_best_sel_map);
+        get_best_sel_map(dA, dB, dC, old_topo_A, old_topo_B, old_topo_C, old_map_A, old_map_B, old_map_C, ttopo_sel, gbest_time_sel, mem_sel, do_tune ? &top_sel : NULL);
+        TAU_FSTOP(get_best_sel_map);
+        //autotuning also considers the mappings of the exhaustive search for quick contractions
+        if (gbest_time_sel < 1. && !do_tune){
+          gbest_time_exh = gbest_time_sel+1.;
+          ttopo_exh = ttopo_sel;
+          mem_exh = mem_sel;
+        } else {
+          TAU_FSTART(get_best_exh_map);
+          get_best_exh_map(dA, dB, dC, old_topo_A, old_topo_B, old_topo_C, old_map_A, old_map_B, old_map_C, ttopo_exh, gbest_time_exh, mem_exh, gbest_time_sel, do_tune ? &top_exh : NULL);
+          TAU_FSTOP(get_best_exh_map);
+        }
+        //the second panel buffers of pipelined broadcasts are dropped if no mapping fits with them
+        bool is_fit = (ttopo_sel != INT_MAX && ttopo_sel != -1) || (ttopo_exh != INT_MAX && ttopo_exh != -1);
+        if (is_fit || !pipeline_bcast || is_sparse()) break;
+        pipeline_bcast = false;
+        top_sel.clear();
+        top_exh.clear();
+      }
+      bool is_sel = gbest_time_sel <= gbest_time_exh;
+      if (is_sel){
+        ttopo = ttopo_sel;
+      } else {
+        ttopo = ttopo_exh;
+      }
 
-    A->clear_mapping();
-    B->clear_mapping();
-    C->clear_mapping();
-    A->set_padding();
-    B->set_padding();
-    C->set_padding();
+      A->clear_mapping();
+      B->clear_mapping();
+      C->clear_mapping();
+      A->set_padding();
+      B->set_padding();
+      C->set_padding();
     
-    if (!do_remap || ttopo == INT_MAX || ttopo == -1){
-      CTF_int::cdealloc(old_phase_A);
-      CTF_int::cdealloc(old_phase_B);
-      CTF_int::cdealloc(old_phase_C);
-      delete [] old_map_A;
-      delete [] old_map_B;
-      delete [] old_map_C;
-      delete dA;
-      delete dB;
-      delete dC;
-
-      if (ttopo == INT_MAX || ttopo == -1){
-        printf("ERROR: Failed to map contraction!\n");
-        //ABORT;
-        return ERROR;
-      }
-      return SUCCESS;
-    }
-    topology * topo_g = NULL;
-    int j_g;
-    if (gbest_time_sel <= gbest_time_exh){
-      j_g = ttopo%6;
-      if (ttopo < 48){
-        if (((ttopo/6) & 1) > 0){
-          topo_g = old_topo_A;
-          copy_mapping(A->order, old_map_A, A->edge_map);
+      if (!do_remap || ttopo == INT_MAX || ttopo == -1){
+        CTF_int::cdealloc(old_phase_A);
+        CTF_int::cdealloc(old_phase_B);
+        CTF_int::cdealloc(old_phase_C);
+        delete [] old_map_A;
+        delete [] old_map_B;
+        delete [] old_map_C;
+        delete dA;
+        delete dB;
+        delete dC;
+
+        if (ttopo == INT_MAX || ttopo == -1){
+          int64_t max_memuse = get_mem_limit();
+          if (global_comm.rank == 0 && max_memuse < proc_bytes_available())
+            printf("CTF ERROR: no mapping of contraction fits in memory budget of %ld bytes per process\n", max_memuse);
+          printf("ERROR: Failed to map contraction!\n");
+          //ABORT;
+          return ERROR;
         }
-        if (((ttopo/6) & 2) > 0){
-          topo_g = old_topo_B;
-          copy_mapping(B->order, old_map_B, B->edge_map);
+        return SUCCESS;
+      }
+      double run_time = 0.;
+      if (do_tune){
+        //time the fastest predicted mappings of either search, skipping those found by both
+        std::vector< std::pair<double, std::pair<bool,int> > > preds;
+        for (int i=0; i<(int)top_sel.size(); i++)
+          preds.push_back(std::make_pair(top_sel[i].first, std::make_pair(true, top_sel[i].second)));
+        for (int i=0; i<(int)top_exh.size(); i++)
+          preds.push_back(std::make_pair(top_exh[i].first, std::make_pair(false, top_exh[i].second)));
+        std::stable_sort(preds.begin(), preds.end());
+        std::vector< std::pair<bool,int> > cands;
+        std::set< std::vector<int64_t> > cand_maps;
+        for (int i=0; i<(int)preds.size() && (int)cands.size()<wrld->autotune; i++){
+          if (set_best_map(preds[i].second.first, preds[i].second.second, old_topo_A, old_topo_B, old_topo_C, old_map_A, old_map_B, old_map_C) != SUCCESS) continue;
+          std::vector<int64_t> msig;
+          msig.push_back(get_topo_index(wrld, A->topo));
+          for (int d=0; d<A->order; d++) append_mapping_sig(msig, A->edge_map+d);
+          for (int d=0; d<B->order; d++) append_mapping_sig(msig, B->edge_map+d);
+          for (int d=0; d<C->order; d++) append_mapping_sig(msig, C->edge_map+d);
+          if (cand_maps.insert(msig).second)
+            cands.push_back(preds[i].second);
         }
-
-        if (((ttopo/6) & 4) > 0){
-          topo_g = old_topo_C;
-          copy_mapping(C->order, old_map_C, C->edge_map);
+        if (cands.size() > 1){
+          int ibest = autotune_map(cands, plan_sig, old_topo_A, old_topo_B, old_topo_C, old_map_A, old_map_B, old_map_C, run_time);
+          if (cands[ibest].first != is_sel || cands[ibest].second != ttopo){
+            //the memory usage of the chosen mapping is bounded by the largest prediction
+            mem_sel = std::max(mem_sel, mem_exh);
+            mem_exh = mem_sel;
+          }
+          is_sel = cands[ibest].first;
+          ttopo = cands[ibest].second;
         }
-        assert(topo_g != NULL);
-
-      } else topo_g = wrld->topovec[(ttopo-48)/6];
-    } else {
-      int64_t choice_offset = 0;
-      int i=0;
-      int64_t old_off = 0;
-      for (i=0; i<(int)wrld->topovec.size(); i++){
-        //int tnum_choices = pow(num_choices,(int) wrld->topovec[i]->order);
-        int tnum_choices = get_num_map_variants(wrld->topovec[i]);
-        old_off = choice_offset;
-        choice_offset += tnum_choices;
-        if (choice_offset > ttopo) break;
       }
-      topo_g = wrld->topovec[i];
-      j_g = ttopo-old_off;
-    }
-
-    A->topo = topo_g;
-    B->topo = topo_g;
-    C->topo = topo_g;
-    A->is_mapped = 1;
-    B->is_mapped = 1;
-    C->is_mapped = 1;
-    
-    if (gbest_time_sel <= gbest_time_exh){
-      ret = map_to_topology(topo_g, j_g);
-      if (ret == NEGATIVE || ret == ERROR) {
+      if (set_best_map(is_sel, ttopo, old_topo_A, old_topo_B, old_topo_C, old_map_A, old_map_B, old_map_C) != SUCCESS){
         printf("ERROR ON FINAL MAP ATTEMPT, THIS SHOULD NOT HAPPEN\n");
         return ERROR;
       }
-    } else {
-      exh_map_to_topo(topo_g, j_g);
-      switch_topo_perm();
+      ctr_plan_cache_misses++;
+      add_ctr_plan(plan_sig, wrld, A, B, C, std::min(gbest_time_sel, gbest_time_exh), is_sel ? mem_sel : mem_exh, pipeline_bcast);
+      if (do_tune)
+        write_ctr_tuned_plan(tuned_sig, A, B, C, std::min(gbest_time_sel, gbest_time_exh), is_sel ? mem_sel : mem_exh, run_time);
     }
+    if (mem_pred != NULL)
+      *mem_pred = std::max(*mem_pred, gbest_time_sel <= gbest_time_exh ? mem_sel : mem_exh);
   #if DEBUG > 2
     if (!check_mapping())
       printf("ERROR ON FINAL MAP ATTEMPT, THIS SHOULD NOT HAPPEN\n");
@@ -3054,14 +3892,33 @@ namespace CTF_int {
     A->set_padding();
     B->set_padding();
     C->set_padding();
-    if (can_fold()){
-      iparam prm = map_fold(false);
-      *ctrf = construct_ctr(1, &prm);
-      A->remove_fold();
-      B->remove_fold();
-      C->remove_fold();
-    } else
-      *ctrf = construct_ctr();
+    //the tree kept with the plan is copied instead of constructed again, dense trees depend only on the signature
+    ctr_plan * plan = NULL;
+    if (do_remap){
+      plan_it = ctr_plan_cache->find(plan_sig);
+      if (plan_it != ctr_plan_cache->end()) plan = &plan_it->second;
+    }
+    bool is_tree_cached = false;
+    if (plan != NULL && plan->ctrf != NULL){
+      *ctrf = plan->ctrf->clone();
+      is_tree_cached = (*ctrf)->rebind(this);
+      ASSERT(is_tree_cached);
+    } else {
+      if (can_fold()){
+        iparam prm = map_fold(false);
+        *ctrf = construct_ctr(1, &prm);
+        A->remove_fold();
+        B->remove_fold();
+        C->remove_fold();
+      } else
+        *ctrf = construct_ctr();
+      if (plan != NULL && !is_sparse() && !is_custom){
+        ctr * pctrf = (*ctrf)->clone();
+        if (pctrf != NULL && pctrf->rebind(this)) plan->ctrf = pctrf;
+        else if (pctrf != NULL) delete pctrf;
+      }
+    }
+    if (is_cached != NULL) *is_cached = is_tree_cached;
     #if DEBUG > 2
     if (global_comm.rank == 0)
       printf("New mappings:\n");
@@ -3156,6 +4013,12 @@ namespace CTF_int {
       C->redistribute(*dC);
                    
     TAU_FSTOP(redistribute_for_contraction);
+    if (is_sparse()){
+      sp_ctr_imb_A = A->is_sparse ? calc_nnz_imbalance(A) : 1.;
+      sp_ctr_imb_B = B->is_sparse ? calc_nnz_imbalance(B) : 1.;
+      if (global_comm.rank == 0)
+        VPRINTF(1,"Sparse contraction operands have nonzero imbalance (max/mean per process) A: %lf B: %lf\n", sp_ctr_imb_A, sp_ctr_imb_B);
+    }
     
     CTF_int::cdealloc( old_phase_A );
     CTF_int::cdealloc( old_phase_B );
@@ -3601,7 +4464,8 @@ namespace CTF_int {
              &vrt_sz_C, virt_blk_len_C, blk_len_C);
 
     if (!is_inner){
-      if (A->is_sparse && A->wrld->np > 1){
+      //CSF trees of A are built in the coordinates of each block, so need no pinning
+      if (A->is_sparse && A->wrld->np > 1 && !use_csf()){
         spctr_pin_keys * skctr = new spctr_pin_keys(this, 0);
         if (is_top){
           hctr = skctr;
@@ -4026,11 +4890,12 @@ namespace CTF_int {
   int contraction::contract(){
     int stat;
     ctr * ctrf;
+    bool is_ctrf_cached = false;
     CommData global_comm = C->wrld->cdt;
 
     if (A->has_zero_edge_len || B->has_zero_edge_len
         || C->has_zero_edge_len){
-      if (!C->sr->isequal(beta,C->sr->mulid()) && !C->has_zero_edge_len){ 
+      if ((!C->sr->isequal(beta,C->sr->mulid()) || epilogue != NULL) && !C->has_zero_edge_len){ 
         int * new_idx_C; 
         int num_diag = 0;
         new_idx_C = (int*)CTF_int::alloc(sizeof(int)*C->order);
@@ -4044,8 +4909,14 @@ namespace CTF_int {
             }
           }
         }
-        scaling scl = scaling(C, new_idx_C, beta);
-        scl.execute();
+        if (!C->sr->isequal(beta,C->sr->mulid())){
+          scaling scl = scaling(C, new_idx_C, beta);
+          scl.execute();
+        }
+        if (epilogue != NULL){
+          scaling escl = scaling(C, new_idx_C, C->sr->mulid(), epilogue);
+          escl.execute();
+        }
         CTF_int::cdealloc(new_idx_C);
       }
       return SUCCESS;
@@ -4072,6 +4943,12 @@ namespace CTF_int {
 //      ASSERT(!A->is_sparse);
       //FIXME ASSERT that commitative
       contraction CBA(B,idx_B,A,idx_A,alpha,C,idx_C,beta,func);
+      CBA.epilogue = epilogue;
+      CBA.mask = mask;
+      CBA.is_mask_cmp = is_mask_cmp;
+      CBA.is_mask_valued = is_mask_valued;
+      CBA.mem_budget = mem_budget;
+      CBA.mem_pred = mem_pred;
       CBA.contract();
       return SUCCESS;
     }
@@ -4176,7 +5053,7 @@ namespace CTF_int {
   #endif
   #if REDIST
     //stat = map_tensors(type, fftsr, felm, alpha, beta, &ctrf);
-    stat = map(&ctrf);
+    stat = map(&ctrf, 1, &is_ctrf_cached);
     if (stat == ERROR) {
       printf("Failed to map tensors to physical grid\n");
       return ERROR;
@@ -4198,7 +5075,7 @@ namespace CTF_int {
       }
   #endif
     } 
-    stat = map(&ctrf);
+    stat = map(&ctrf, 1, &is_ctrf_cached);
     if (stat == ERROR) {
       printf("Failed to map tensors to physical grid\n");
       return ERROR;
@@ -4229,6 +5106,16 @@ namespace CTF_int {
   #endif
   #endif
     //ASSERT(check_mapping());
+    /* a copy of the mask is distributed like C, so that the local blocks of both match */
+    tensor * M = NULL;
+    bool is_mask_fused = false;
+    if (mask != NULL){
+      ASSERT(C->is_sparse && mask->is_sparse);
+      M = new tensor(mask, 1, 1);
+      M->has_home = 0;
+      M->is_home = 0;
+      M->align(C);
+    }
     bool is_inner = false;
   #if FOLD_TSR
     is_inner = can_fold();
@@ -4237,8 +5124,24 @@ namespace CTF_int {
       TAU_FSTART(map_fold);
       prm = map_fold();
       TAU_FSTOP(map_fold);
-      delete ctrf;
-      ctrf = construct_ctr(1, &prm);
+      if (!is_ctrf_cached){
+        delete ctrf;
+        ctrf = construct_ctr(1, &prm);
+      }
+      /* the mask is passed to the sparse kernels in the same CSR layout as C */
+      if (M != NULL && ((spctr*)ctrf)->fuse_mask()){
+        int nfold, * fold_idx, all_fdim_M, * all_flen_M;
+        get_fold_indices(&nfold, &fold_idx);
+        M->fold(nfold, fold_idx, idx_C, &all_fdim_M, &all_flen_M);
+        memcpy(M->inner_ordering, C->inner_ordering, sizeof(int)*all_fdim_M);
+        M->spmatricize(prm.m, prm.n, C->nrow_idx, true);
+        ((spctr*)ctrf)->mask_C          = M->rec_tsr->data;
+        ((spctr*)ctrf)->size_blk_mask_C = M->rec_tsr->nnz_blk;
+        ((spctr*)ctrf)->is_mask_cmp     = is_mask_cmp;
+        is_mask_fused = true;
+        CTF_int::cdealloc(fold_idx);
+        CTF_int::cdealloc(all_flen_M);
+      }
     } 
   #endif
   #if DEBUG >=2
@@ -4274,6 +5177,8 @@ namespace CTF_int {
     MPI_Barrier(global_comm.cm);
     TAU_FSTOP(pre_ctr_func_barrier);
   #endif
+    /* apply the epilogue to each block of C as it is computed if possible */
+    bool is_epi_fused = epilogue == NULL || (!C->is_sparse && ctrf->fuse_epilogue(epilogue));
     TAU_FSTART(ctr_func);
     /* Invoke the contraction algorithm */
     A->topo->activate();
@@ -4288,7 +5193,15 @@ namespace CTF_int {
         data_A = A->data;
         data_B = B->data;
         data_C = C->data;
-        if (A->nnz_blk != NULL){
+        if (use_csf()){
+          //A is passed as the CSF trees of its blocks, which it keeps for later contractions until it is modified or remapped
+          int csf_mode_order[A->order];
+          get_csf_mode_order(csf_mode_order);
+          A->build_csf(csf_mode_order);
+          data_A = A->csf_data;
+          alloc_ptr(A->calc_nvirt()*sizeof(int64_t), (void**)&size_blk_A);
+          memcpy(size_blk_A, A->csf_blk_sz, A->calc_nvirt()*sizeof(int64_t));
+        } else if (A->nnz_blk != NULL){
           alloc_ptr(A->calc_nvirt()*sizeof(int64_t), (void**)&size_blk_A);
           for (int i=0; i<A->calc_nvirt(); i++){
             size_blk_A[i] = A->nnz_blk[i]*A->sr->pair_size();
@@ -4355,6 +5268,29 @@ namespace CTF_int {
   #endif
     TAU_FSTOP(ctr_func);
     C->unfold(1);
+    if (M != NULL){
+      if (!is_mask_fused){
+        TAU_FSTART(ctr_mask);
+        filter_by_mask(C, M, is_mask_cmp);
+        TAU_FSTOP(ctr_mask);
+      }
+      M->unfold();
+      delete M;
+    }
+    if (!is_epi_fused){
+      TAU_FSTART(ctr_epilogue);
+      if (C->is_sparse){
+        PairIterator pi(C->sr, C->data);
+        for (int64_t i=0; i<C->nnz_loc; i++){
+          epilogue->apply_f(pi[i].d());
+        }
+      } else {
+        for (int64_t i=0; i<C->size; i++){
+          epilogue->apply_f(C->data+i*C->sr->el_size);
+        }
+      }
+      TAU_FSTOP(ctr_epilogue);
+    }
   #ifndef SEQ
     if (C->is_cyclic)
       stat = C->zero_out_padding();
@@ -4475,7 +5411,7 @@ namespace CTF_int {
     C->unfold();
     if (A->has_zero_edge_len || B->has_zero_edge_len
         || C->has_zero_edge_len){
-      if (!C->sr->isequal(beta,C->sr->mulid()) && !C->has_zero_edge_len){ 
+      if ((!C->sr->isequal(beta,C->sr->mulid()) || epilogue != NULL) && !C->has_zero_edge_len){ 
         int * new_idx_C; 
         int num_diag = 0;
         new_idx_C = (int*)CTF_int::alloc(sizeof(int)*C->order);
@@ -4489,8 +5425,14 @@ namespace CTF_int {
             }
           }
         }
-        scaling scl = scaling(C, new_idx_C, beta);
-        scl.execute();
+        if (!C->sr->isequal(beta,C->sr->mulid())){
+          scaling scl = scaling(C, new_idx_C, beta);
+          scl.execute();
+        }
+        if (epilogue != NULL){
+          scaling escl = scaling(C, new_idx_C, C->sr->mulid(), epilogue);
+          escl.execute();
+        }
         CTF_int::cdealloc(new_idx_C);
       }
       return SUCCESS;
@@ -4501,6 +5443,10 @@ namespace CTF_int {
       tensor * new_tsr_A = A->self_reduce(idx_A, &new_idx_A, B->order, idx_B, &new_idx_B, C->order, idx_C, &new_idx_C);
       if (new_tsr_A != A) {
         contraction ctr(new_tsr_A, new_idx_A, B, new_idx_B, alpha, C, new_idx_C, beta, func);
+        ctr.epilogue = epilogue;
+        ctr.mask = mask;
+        ctr.is_mask_cmp = is_mask_cmp;
+        ctr.is_mask_valued = is_mask_valued;
         ctr.execute();
         delete new_tsr_A;
         return SUCCESS;
@@ -4511,6 +5457,10 @@ namespace CTF_int {
       tensor * new_tsr_B = B->self_reduce(idx_B, &new_idx_B, A->order, idx_A, &new_idx_A, C->order, idx_C, &new_idx_C);
       if (new_tsr_B != B) {
         contraction ctr(A, new_idx_A, new_tsr_B, new_idx_B, alpha, C, new_idx_C, beta, func);
+        ctr.epilogue = epilogue;
+        ctr.mask = mask;
+        ctr.is_mask_cmp = is_mask_cmp;
+        ctr.is_mask_valued = is_mask_valued;
         ctr.execute();
         delete new_tsr_B;
         return SUCCESS;
@@ -4558,6 +5508,12 @@ namespace CTF_int {
     else fptr = NULL;
 
     contraction new_ctr = contraction(tnsr_A, map_A, tnsr_B, map_B, alpha, tnsr_C, map_C, beta, fptr);
+    new_ctr.epilogue = epilogue;
+    new_ctr.mask = mask;
+    new_ctr.is_mask_cmp = is_mask_cmp;
+    new_ctr.is_mask_valued = is_mask_valued;
+    new_ctr.mem_budget = mem_budget;
+    new_ctr.mem_pred = mem_pred;
     tnsr_A->unfold();
     tnsr_B->unfold();
     tnsr_C->unfold();
@@ -4694,6 +5650,7 @@ namespace CTF_int {
             }
             perm_types[i].alpha = new_alpha;
             perm_types[i].beta = dbeta;
+            perm_types[i].epilogue = NULL;
             stat = perm_types[i].contract();
             dbeta = new_ctr.C->sr->mulid();
           }
@@ -4701,6 +5658,15 @@ namespace CTF_int {
           signs.clear();
         }
         delete unfold_ctr;
+        /* the output is accumulated over multiple contractions, so apply the epilogue at the end */
+        if (epilogue != NULL){
+          int sidx_C[tnsr_C->order];
+          for (int iis=0; iis<tnsr_C->order; iis++){
+            sidx_C[iis] = iis;
+          }
+          scaling escl = scaling(tnsr_C, sidx_C, tnsr_C->sr->mulid(), epilogue);
+          escl.execute();
+        }
       } else {
         new_ctr.alpha = oc_align_alpha;
         stat = new_ctr.contract();
@@ -4754,12 +5720,19 @@ namespace CTF_int {
       contraction new_ctr(*this);
       new_ctr.C = C_buf;
       new_ctr.beta = C->sr->mulid();
+      new_ctr.epilogue = NULL;
       new_ctr.execute();
       char idx[C->order];
       for (int i=0; i<C->order; i++){ idx[i] = 'a'+i; }
       summation s(C_buf, idx, C->sr->mulid(), C, idx, beta);
       s.execute();
       delete C_buf;
+      if (epilogue != NULL){
+        int sidx_C[C->order];
+        for (int i=0; i<C->order; i++){ sidx_C[i] = i; }
+        scaling escl = scaling(C, sidx_C, C->sr->mulid(), epilogue);
+        escl.execute();
+      }
       return SUCCESS;
       
     }
@@ -4767,7 +5740,7 @@ namespace CTF_int {
     if (A->has_zero_edge_len || 
         B->has_zero_edge_len || 
         C->has_zero_edge_len){
-      if (!C->sr->isequal(beta,C->sr->mulid()) && !C->has_zero_edge_len){ 
+      if ((!C->sr->isequal(beta,C->sr->mulid()) || epilogue != NULL) && !C->has_zero_edge_len){ 
         int * new_idx_C; 
         int num_diag = 0;
         new_idx_C = (int*)CTF_int::alloc(sizeof(int)*C->order);
@@ -4781,8 +5754,14 @@ namespace CTF_int {
             }
           }
         }
-        scaling scl = scaling(C, new_idx_C, beta);
-        scl.execute();
+        if (!C->sr->isequal(beta,C->sr->mulid())){
+          scaling scl = scaling(C, new_idx_C, beta);
+          scl.execute();
+        }
+        if (epilogue != NULL){
+          scaling escl = scaling(C, new_idx_C, C->sr->mulid(), epilogue);
+          escl.execute();
+        }
         CTF_int::cdealloc(new_idx_C);
       }
       return SUCCESS;
@@ -4830,6 +5809,8 @@ namespace CTF_int {
       if (A->is_sparse){
         CTF_int::alloc_ptr(new_ctr.A->calc_nvirt()*sizeof(int64_t), (void**)&new_ctr.A->nnz_blk);
         new_ctr.A->set_new_nnz_glb(A->nnz_blk);
+        //the CSF trees kept by A are used by the copy, and returned to A if it stays home
+        new_ctr.A->take_csf(A);
       }
     }     
     if (was_home_B){
@@ -4928,6 +5909,7 @@ namespace CTF_int {
         delete new_ctr.A;
       } else if (was_home_A) {
         A->data = new_ctr.A->data;
+        A->take_csf(new_ctr.A);
         new_ctr.A->is_data_aliased = 1;
         delete new_ctr.A;
       }
@@ -5237,3 +6219,159 @@ namespace CTF_int {
     }
   }
 }
+
+namespace CTF_int {
+  /**
+   * \brief whether the local data of tsr holds all its elements, dense,
+   *        in column-major order (as for nonsymmetric tensors on one processor)
+   */
+  static bool is_local_dense(tensor const * tsr){
+    if (tsr->wrld->np != 1 || tsr->is_sparse || !tsr->is_mapped ||
+        tsr->is_folded || tsr->is_scp_padded || tsr->has_zero_edge_len)
+      return false;
+    int64_t sz = 1;
+    for (int i=0; i<tsr->order; i++){
+      if (tsr->sym[i] != NS || tsr->padding[i] != 0) return false;
+      sz *= tsr->lens[i];
+    }
+    return tsr->calc_nvirt() == 1 && tsr->size == sz;
+  }
+
+  /**
+   * \brief determines whether C[idx_C] = A[idx_A]*B[idx_B] is a (possibly
+   *        transposed) matrix multiplication of the local data, swapping A and B
+   *        if needed so that the leading indices of C belong to A
+   * \return true if so, with tA/tB/m/n/k set for gemm and swap set if A and B exchange roles
+   */
+  static bool get_batch_gemm_dims(tensor const * A,
+                                  char const *   idx_A,
+                                  tensor const * B,
+                                  char const *   idx_B,
+                                  tensor const * C,
+                                  char const *   idx_C,
+                                  char &         tA,
+                                  char &         tB,
+                                  int64_t &      m,
+                                  int64_t &      n,
+                                  int64_t &      k,
+                                  bool &         swap){
+    std::string sA(idx_A, A->order), sB(idx_B, B->order), sC(idx_C, C->order);
+    std::string const * s[3] = {&sA, &sB, &sC};
+    std::map<char,int> lens;
+    for (int t=0; t<3; t++){
+      tensor const * tsr = t==0 ? A : (t==1 ? B : C);
+      for (int i=0; i<(int)s[t]->size(); i++){
+        char c = (*s[t])[i];
+        //every index must appear once in exactly two of the tensors
+        if (s[t]->find(c) != (size_t)i) return false;
+        int nocc = (sA.find(c) != std::string::npos) + (sB.find(c) != std::string::npos) + (sC.find(c) != std::string::npos);
+        if (nocc != 2) return false;
+        if (lens.find(c) != lens.end() && lens[c] != tsr->lens[i]) return false;
+        lens[c] = tsr->lens[i];
+      }
+    }
+    swap = sC.size() > 0 && sA.find(sC[0]) == std::string::npos;
+    if (swap) std::swap(sA, sB);
+    int pm = 0;
+    while (pm < (int)sC.size() && sA.find(sC[pm]) != std::string::npos) pm++;
+    std::string sM = sC.substr(0, pm);
+    std::string sN = sC.substr(pm);
+    std::string sK;
+    for (int i=0; i<(int)sA.size(); i++){
+      if (sC.find(sA[i]) == std::string::npos) sK.push_back(sA[i]);
+    }
+    if (sA == sM + sK) tA = 'N';
+    else if (sA == sK + sM) tA = 'T';
+    else return false;
+    if (sB == sK + sN) tB = 'N';
+    else if (sB == sN + sK) tB = 'T';
+    else return false;
+    m = 1;
+    n = 1;
+    k = 1;
+    for (int i=0; i<(int)sM.size(); i++) m *= lens[sM[i]];
+    for (int i=0; i<(int)sN.size(); i++) n *= lens[sN[i]];
+    for (int i=0; i<(int)sK.size(); i++) k *= lens[sK[i]];
+    return m <= INT_MAX && n <= INT_MAX && k <= INT_MAX;
+  }
+
+  int contract_batch(int64_t          num,
+                     tensor * const * A,
+                     char const *     idx_A,
+                     tensor * const * B,
+                     char const *     idx_B,
+                     char const *     alpha,
+                     tensor * const * C,
+                     char const *     idx_C,
+                     char const *     beta){
+    if (num <= 0) return SUCCESS;
+    TAU_FSTART(contract_batch);
+    char tA = 'N', tB = 'N';
+    int64_t m = 0, n = 0, k = 0;
+    bool swap = false;
+    algstrct const * sr = C[0]->sr;
+    bool is_gemm = num <= INT_MAX && sr->has_mul() &&
+                   get_batch_gemm_dims(A[0], idx_A, B[0], idx_B, C[0], idx_C, tA, tB, m, n, k, swap);
+    for (int64_t i=0; i<num && is_gemm; i++){
+      tensor const * tsrs[3] = {A[i], B[i], C[i]};
+      for (int t=0; t<3; t++){
+        tensor const * tsr0 = t==0 ? A[0] : (t==1 ? B[0] : C[0]);
+        if (!is_local_dense(tsrs[t]) || !tsrs[t]->sr->is_same_type(sr) ||
+            tsrs[t]->order != tsr0->order ||
+            memcmp(tsrs[t]->lens, tsr0->lens, sizeof(int)*tsr0->order) != 0){
+          is_gemm = false;
+          break;
+        }
+      }
+    }
+    if (!is_gemm){
+      for (int64_t i=0; i<num; i++){
+        contraction ctr(A[i], idx_A, B[i], idx_B, alpha, C[i], idx_C, beta);
+        ctr.execute();
+      }
+      TAU_FSTOP(contract_batch);
+      return NEGATIVE;
+    }
+    if (swap) std::swap(A, B);
+    //the operands are multiplied in place, gemm_batch_ptrs only needs their addresses
+    char const ** ptrs_A = (char const **)alloc(sizeof(char*)*num);
+    char const ** ptrs_B = (char const **)alloc(sizeof(char*)*num);
+    char ** ptrs_C = (char **)alloc(sizeof(char*)*num);
+    for (int64_t i=0; i<num; i++){
+      ptrs_A[i] = A[i]->data;
+      ptrs_B[i] = B[i]->data;
+      ptrs_C[i] = C[i]->data;
+    }
+    sr->gemm_batch_ptrs(tA, tB, num, m, n, k,
+                        alpha == NULL ? sr->mulid() : alpha, ptrs_A, ptrs_B,
+                        beta == NULL ? sr->mulid() : beta, ptrs_C);
+    cdealloc(ptrs_A);
+    cdealloc(ptrs_B);
+    cdealloc(ptrs_C);
+    TAU_FSTOP(contract_batch);
+    return SUCCESS;
+  }
+}
+
+namespace CTF {
+  void get_ctr_plan_cache_stats(int64_t & hits, int64_t & misses){
+    hits   = CTF_int::ctr_plan_cache_hits;
+    misses = CTF_int::ctr_plan_cache_misses;
+  }
+
+  void get_sparse_ctr_imbalance(double & imb_A, double & imb_B){
+    imb_A = CTF_int::sp_ctr_imb_A;
+    imb_B = CTF_int::sp_ctr_imb_B;
+  }
+
+  void invalidate_ctr_plan_cache(World const * wrld){
+    if (CTF_int::ctr_plan_cache == NULL) return;
+    std::map< std::vector<int64_t>, CTF_int::ctr_plan >::iterator it = CTF_int::ctr_plan_cache->begin();
+    while (it != CTF_int::ctr_plan_cache->end()){
+      if (wrld == NULL || it->second.wrld == wrld){
+        CTF_int::free_ctr_plan(it->second);
+        CTF_int::ctr_plan_cache->erase(it++);
+      } else it++;
+    }
+  }
+}
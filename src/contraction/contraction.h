@@ -37,9 +37,36 @@ namespace CTF_int {
       bool is_custom;
       /** \brief function to execute on elements */
       bivar_function const * func;
+      /** \brief elementwise function applied to C after the contraction, NULL if none,
+                 fused into the local kernels when each output block is computed once */
+      endomorphism const * epilogue;
+      /** \brief bytes per process the contraction may use in addition to its operands
+                 (for redistribution and intermediate buffers), -1 to use the budget of the World */
+      int64_t mem_budget;
+      /** \brief if not NULL, raised to the memory (bytes per process, in addition to the operands)
+                 predicted for each mapping chosen to perform this contraction */
+      int64_t * mem_pred;
+      /** \brief if not NULL, counts of the nonzeros of sparse A by their index residues
+                 modulo the number of processes (see tensor::calc_nnz_hist()), used by the
+                 mapping search to account for the load imbalance of each mapping */
+      int64_t * nnz_hist_A;
+      /** \brief if not NULL, counts of the nonzeros of sparse B, as nnz_hist_A */
+      int64_t * nnz_hist_B;
+      /** \brief if not NULL, only the entries of alpha*A*B in (or, if is_mask_cmp, not in) the sparsity
+                 pattern of mask, which has the same lengths as C, are computed and added to C */
+      tensor * mask;
+      /** \brief whether the entries of alpha*A*B absent from mask are computed, rather than those present */
+      bool is_mask_cmp;
+      /** \brief whether entries of mask equal to its additive identity are absent from its pattern,
+                 rather than only entries that are not stored */
+      bool is_mask_valued;
+      /** \brief whether ctr_2d_general nodes of the trees constructed for this contraction may
+                 double-buffer their panel broadcasts, cleared by the mapping search if no mapping
+                 fits in memory with the second buffers */
+      bool pipeline_bcast;
 
       /** \brief lazy constructor */
-      contraction(){ idx_A = NULL; idx_B = NULL; idx_C=NULL; is_custom=0; alpha=NULL; beta=NULL; };
+      contraction(){ idx_A = NULL; idx_B = NULL; idx_C=NULL; is_custom=0; alpha=NULL; beta=NULL; epilogue=NULL; mem_budget=-1; mem_pred=NULL; nnz_hist_A=NULL; nnz_hist_B=NULL; mask=NULL; is_mask_cmp=false; is_mask_valued=false; pipeline_bcast=true; };
       
       /** \brief destructor */
       ~contraction();
@@ -116,6 +143,19 @@ namespace CTF_int {
        */
       int is_equal(contraction const & os);
 
+      /**
+       * \brief returns true if the local blocks of A are compressed into CSF trees rather than matricized,
+       *        which is done when A is sparse, of order three or more and set to CSF, while B and C are dense, and all are nonsymmetric
+       */
+      bool use_csf() const;
+
+      /**
+       * \brief gives the mode of A stored at each level of its CSF trees from the root, the order set for A if any,
+       *        otherwise the modes indexing C closest to the root and the rest in order of significance in the key
+       * \param[out] mode_order preallocated array of A->order modes
+       */
+      void get_csf_mode_order(int * mode_order) const;
+
     private:
       /**
        * \brief returns true if one of the tensors is sparse 
@@ -266,17 +306,55 @@ namespace CTF_int {
        */
       int try_topo_morph();
 
-      void get_best_sel_map(distribution const * dA, distribution const * dB, distribution const * dC, topology * old_topo_A, topology * old_topo_B, topology * old_topo_C, mapping const * old_map_A, mapping const * old_map_B, mapping const * old_map_C, int & idx, double & time);
+      /**
+       * \brief memory limit enforced by the mapping search
+       * \return bytes per process available to the contraction in addition to its operands,
+       *         the smaller of the available memory and mem_budget (or the budget of the World)
+       */
+      int64_t get_mem_limit();
+
+      /**
+       * \brief searches the mappings onto each topology with the heuristic choices of map_to_topology()
+       * \param[out] idx index of the mapping with the least predicted time (INT_MAX or -1 if none)
+       * \param[out] time predicted time of that mapping
+       * \param[out] mem predicted memory usage of that mapping
+       * \param[out] top if not NULL, (predicted time, index) of the World::autotune fastest mappings
+       */
+      void get_best_sel_map(distribution const * dA, distribution const * dB, distribution const * dC, topology * old_topo_A, topology * old_topo_B, topology * old_topo_C, mapping const * old_map_A, mapping const * old_map_B, mapping const * old_map_C, int & idx, double & time, int64_t & mem, std::vector< std::pair<double,int> > * top=NULL);
+
+      /**
+       * \brief searches all mappings with exh_map_to_topo(), see get_best_sel_map()
+       * \param[in] init_best_time only mappings predicted to be faster are considered
+       */
+      void get_best_exh_map(distribution const * dA, distribution const * dB, distribution const * dC, topology * old_topo_A, topology * old_topo_B, topology * old_topo_C, mapping const * old_map_A, mapping const * old_map_B, mapping const * old_map_C, int & idx, double & time, int64_t & mem, double init_best_time, std::vector< std::pair<double,int> > * top=NULL);
+
+      /**
+       * \brief maps A, B, and C as a mapping found by get_best_sel_map() or get_best_exh_map()
+       * \param[in] is_sel whether idx was given by get_best_sel_map() rather than get_best_exh_map()
+       * \param[in] idx index of the mapping
+       * \return SUCCESS or ERROR
+       */
+      int set_best_map(bool is_sel, int idx, topology * old_topo_A, topology * old_topo_B, topology * old_topo_C, mapping const * old_map_A, mapping const * old_map_B, mapping const * old_map_C);
 
-      void get_best_exh_map(distribution const * dA, distribution const * dB, distribution const * dC, topology * old_topo_A, topology * old_topo_B, topology * old_topo_C, mapping const * old_map_A, mapping const * old_map_B, mapping const * old_map_C, int & idx, double & time, double init_best_time);
+      /**
+       * \brief times one execution of the contraction for each of the candidate mappings, on
+       *        copies of the operands in their current distributions, synchronized across global_comm
+       * \param[in] cands (is_sel, idx) of the candidate mappings, as for set_best_map()
+       * \param[in] plan_sig key of the contraction in the plan cache
+       * \param[out] time the time of the fastest mapping
+       * \return position of the fastest mapping in cands
+       */
+      int autotune_map(std::vector< std::pair<bool,int> > const & cands, std::vector<int64_t> const & plan_sig, topology * old_topo_A, topology * old_topo_B, topology * old_topo_C, mapping const * old_map_A, mapping const * old_map_B, mapping const * old_map_C, double & time);
 
       /**
        * \brief find best possible mapping for contraction and redistribute tensors to this mapping
        * \param[out] ctrf contraction class to run
        * \param[in] do_remap whether to redistribute tensors
+       * \param[out] is_cached if not NULL, set to whether ctrf is a copy of the tree kept in the plan cache,
+       *                       which is already constructed for the folded tensors if the contraction can be folded
        * \return SUCCESS if valid mapping found, ERROR if not enough memory or another issue
        */
-      int map(ctr ** ctrf, bool do_remap=1);
+      int map(ctr ** ctrf, bool do_remap=1, bool * is_cached=NULL);
  
       /**
         * \brief contracts tensors alpha*A*B+beta*C -> C.
@@ -325,6 +403,13 @@ namespace CTF_int {
        */
       int home_contract();
 
+      /**
+       * \brief contracts tensors mask.*(alpha*A*B)+beta*C -> C, after checking the mask and
+       *          reducing it to a structural sparse tensor, via a sparse intermediate if C is dense
+       * \return completion status
+       */
+      int masked_contract();
+
       /**
        * \brief applies scaling factor to diagonals for symmetric groups that are contracted over
        */
@@ -399,6 +484,36 @@ namespace CTF_int {
                         int64_t &                  blk_sz_C,
                         int const *                virt_blk_len_C,
                         int &                      load_phase_C);
+
+  /**
+   * \brief contracts num triples of tensors with identical shapes and index maps,
+   *          C[i][idx_C] = beta*C[i][idx_C] + alpha*A[i][idx_A]*B[i][idx_B]
+   *        the contraction pattern is analyzed once, and if all tensors are dense,
+   *        nonsymmetric, and each on a World with one process (np==1, e.g. a
+   *        World over MPI_COMM_SELF in a larger run), and the indices form a
+   *        (possibly transposed) matrix multiplication, the whole batch is
+   *        executed in place by a single algstrct::gemm_batch_ptrs call, otherwise
+   *        each triple is contracted individually
+   * \param[in] num number of contractions
+   * \param[in] A left operand tensors
+   * \param[in] idx_A indices of left operands
+   * \param[in] B right operand tensors
+   * \param[in] idx_B indices of right operands
+   * \param[in] alpha scaling factor of A*B (can be NULL)
+   * \param[in] C output tensors
+   * \param[in] idx_C indices of outputs
+   * \param[in] beta scaling factor of output (can be NULL)
+   * \return SUCCESS if the batch was done by gemm_batch_ptrs, NEGATIVE if contracted individually
+   */
+  int contract_batch(int64_t         num,
+                     tensor * const * A,
+                     char const *     idx_A,
+                     tensor * const * B,
+                     char const *     idx_B,
+                     char const *     alpha,
+                     tensor * const * C,
+                     char const *     idx_C,
+                     char const *     beta);
 }
 
 #endif
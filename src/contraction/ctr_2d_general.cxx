@@ -1,6 +1,7 @@
 /*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
 
 #include "ctr_2d_general.h"
+#include "contraction.h"
 #include "../tensor/untyped_tensor.h"
 #include "../mapping/mapping.h"
 #include "../shared/util.h"
@@ -168,6 +169,13 @@ namespace CTF_int {
       delete rec_ctr;
   }
 
+  ctr_2d_general::ctr_2d_general(contraction * c) : ctr(c) {
+    move_A   = 0;
+    move_B   = 0;
+    move_C   = 0;
+    pipeline = c->pipeline_bcast;
+  }
+
   ctr_2d_general::ctr_2d_general(ctr * other) : ctr(other) {
     ctr_2d_general * o = (ctr_2d_general*)other;
     rec_ctr = o->rec_ctr->clone();
@@ -184,6 +192,7 @@ namespace CTF_int {
     ctr_sub_lda_C = o->ctr_sub_lda_C;
     cdt_C         = o->cdt_C;
     move_C        = o->move_C;
+    pipeline      = o->pipeline;
 #ifdef OFFLOAD
     alloc_host_buf = o->alloc_host_buf;
 #endif
@@ -213,6 +222,11 @@ namespace CTF_int {
     return new ctr_2d_general(this);
   }
 
+  bool ctr_2d_general::rebind(contraction const * c){
+    rebind_ctr(c);
+    return rec_ctr->rebind(c);
+  }
+
   void ctr_2d_general::find_bsizes(int64_t & b_A,
                                    int64_t & b_B,
                                    int64_t & b_C,
@@ -251,13 +265,31 @@ namespace CTF_int {
   }
 
   double ctr_2d_general::est_time_rec(int nlyr) {
-    return rec_ctr->est_time_rec(1)*(double)edge_len/MIN(nlyr,edge_len) + est_time_fp(nlyr);
+    double nstep = (double)edge_len/MIN(nlyr,edge_len);
+    double comp_time = rec_ctr->est_time_rec(1);
+    if (is_pipelined()){
+      /* the first broadcast and the last contraction are not overlapped */
+      double comm_time = est_time_fp(nlyr)/nstep;
+      return comm_time + (nstep-1.)*MAX(comm_time, comp_time) + comp_time;
+    }
+    return comp_time*nstep + est_time_fp(nlyr);
+  }
+
+  bool ctr_2d_general::is_pipelined() {
+#ifdef OFFLOAD
+    if (alloc_host_buf) return false;
+#endif
+    return pipeline && (move_A || move_B) && !move_C && edge_len > 1;
   }
 
   int64_t ctr_2d_general::mem_fp() {
     int64_t b_A, b_B, b_C, s_A, s_B, s_C, aux_size;
     find_bsizes(b_A, b_B, b_C, s_A, s_B, s_C, aux_size);
-    return sr_A->el_size*s_A+sr_B->el_size*s_B+sr_C->el_size*s_C+aux_size;
+    int64_t mem = sr_A->el_size*s_A+sr_B->el_size*s_B+sr_C->el_size*s_C+aux_size;
+    /* second buffer for panels received while contracting */
+    if (is_pipelined())
+      mem += move_A*sr_A->el_size*s_A + move_B*sr_B->el_size*s_B;
+    return mem;
   }
 
   int64_t ctr_2d_general::mem_rec() {
@@ -303,6 +335,12 @@ namespace CTF_int {
       iidx_lyr         = 0;
     }
 
+
+    if (is_pipelined()){
+      run_pipelined(A, B, C, iidx_lyr, inum_lyr);
+      TAU_FSTOP(ctr_2d_general);
+      return;
+    }
     
     find_bsizes(b_A, b_B, b_C, s_A, s_B, s_C, aux_size);
     
@@ -461,5 +499,129 @@ namespace CTF_int {
     }
     TAU_FSTOP(ctr_2d_general);
   }
-}
 
+  void ctr_2d_general::run_pipelined(char * A, char * B, char * C, int iidx_lyr, int inum_lyr){
+    int64_t ib, istep, nstep;
+    int ret, owner, cur;
+    char * buf_A[2], * buf_B[2], * buf_C;
+    char * op_A[2], * op_B[2], * op_C;
+    MPI_Request req_A[2], req_B[2];
+    int64_t b_A, b_B, b_C, s_A, s_B, s_C, aux_size;
+    find_bsizes(b_A, b_B, b_C, s_A, s_B, s_C, aux_size);
+    ASSERT(!move_C);
+
+    TAU_FSTART(ctr_2d_general_pipelined);
+    for (int i=0; i<2; i++){
+      buf_A[i] = NULL;
+      buf_B[i] = NULL;
+      req_A[i] = MPI_REQUEST_NULL;
+      req_B[i] = MPI_REQUEST_NULL;
+    }
+    ret = CTF_int::mst_alloc_ptr(s_A*sr_A->el_size, (void**)&buf_A[0]);
+    ASSERT(ret==0);
+    ret = CTF_int::mst_alloc_ptr(s_B*sr_B->el_size, (void**)&buf_B[0]);
+    ASSERT(ret==0);
+    ret = CTF_int::mst_alloc_ptr(s_C*sr_C->el_size, (void**)&buf_C);
+    ASSERT(ret==0);
+    if (move_A){
+      ret = CTF_int::mst_alloc_ptr(s_A*sr_A->el_size, (void**)&buf_A[1]);
+      ASSERT(ret==0);
+    }
+    if (move_B){
+      ret = CTF_int::mst_alloc_ptr(s_B*sr_B->el_size, (void**)&buf_B[1]);
+      ASSERT(ret==0);
+    }
+
+    nstep = (edge_len - iidx_lyr + inum_lyr - 1)/inum_lyr;
+    for (istep=-1; istep<nstep; istep++){
+      /* post broadcasts of the panels needed in the next step */
+      if (istep+1 < nstep){
+        ib  = iidx_lyr + (istep+1)*inum_lyr;
+        cur = (istep+1)%2;
+        if (move_A){
+          owner = ib % cdt_A->np;
+          op_A[cur] = buf_A[cur];
+          if (cdt_A->rank == owner){
+            if (b_A == 1) op_A[cur] = A;
+            else
+              sr_A->copy(ctr_sub_lda_A, ctr_lda_A, 
+                         A+sr_A->el_size*(ib/cdt_A->np)*ctr_sub_lda_A, ctr_sub_lda_A*b_A, 
+                         op_A[cur], ctr_sub_lda_A);
+          }
+          cdt_A->ibcast(op_A[cur], s_A, sr_A->mdtype(), owner, &req_A[cur]);
+        }
+        if (move_B){
+          owner = ib % cdt_B->np;
+          op_B[cur] = buf_B[cur];
+          if (cdt_B->rank == owner){
+            if (b_B == 1) op_B[cur] = B;
+            else
+              sr_B->copy(ctr_sub_lda_B, ctr_lda_B,
+                         B+sr_B->el_size*(ib/cdt_B->np)*ctr_sub_lda_B, ctr_sub_lda_B*b_B, 
+                         op_B[cur], ctr_sub_lda_B);
+          }
+          cdt_B->ibcast(op_B[cur], s_B, sr_B->mdtype(), owner, &req_B[cur]);
+        }
+      }
+      if (istep < 0) continue;
+
+      ib  = iidx_lyr + istep*inum_lyr;
+      cur = istep%2;
+      /* operands that are not communicated are sliced locally, as in run() */
+      if (!move_A){
+        if (ctr_sub_lda_A == 0)
+          op_A[cur] = A;
+        else if (ctr_lda_A == 1)
+          op_A[cur] = A+sr_A->el_size*ib*ctr_sub_lda_A;
+        else {
+          op_A[cur] = buf_A[0];
+          sr_A->copy(ctr_sub_lda_A, ctr_lda_A,
+                     A+sr_A->el_size*ib*ctr_sub_lda_A, ctr_sub_lda_A*edge_len, 
+                     buf_A[0], ctr_sub_lda_A);
+        }
+      }
+      if (!move_B){
+        if (ctr_sub_lda_B == 0)
+          op_B[cur] = B;
+        else if (ctr_lda_B == 1)
+          op_B[cur] = B+sr_B->el_size*ib*ctr_sub_lda_B;
+        else {
+          op_B[cur] = buf_B[0];
+          sr_B->copy(ctr_sub_lda_B, ctr_lda_B,
+                     B+sr_B->el_size*ib*ctr_sub_lda_B, ctr_sub_lda_B*edge_len, 
+                     buf_B[0], ctr_sub_lda_B);
+        }
+      }
+      if (ctr_sub_lda_C == 0)
+        op_C = C;
+      else {
+        if (ctr_lda_C == 1) 
+          op_C = C+sr_C->el_size*ib*ctr_sub_lda_C;
+        else {
+          op_C = buf_C;
+          rec_ctr->beta = sr_C->addid();
+        }
+      }
+      TAU_FSTART(ctr_2d_general_wait);
+      if (move_A) cdt_A->wait_bcast(&req_A[cur]);
+      if (move_B) cdt_B->wait_bcast(&req_B[cur]);
+      TAU_FSTOP(ctr_2d_general_wait);
+
+      rec_ctr->run(op_A[cur], op_B[cur], op_C);
+
+      if (ctr_lda_C != 1 && ctr_sub_lda_C != 0)
+        sr_C->copy(ctr_sub_lda_C, ctr_lda_C,
+                   buf_C, ctr_sub_lda_C, sr_C->mulid(), 
+                   C+sr_C->el_size*ib*ctr_sub_lda_C, 
+                   ctr_sub_lda_C*edge_len, this->beta);
+      if (ctr_sub_lda_C == 0)
+        rec_ctr->beta = sr_C->mulid();
+    }
+    CTF_int::cdealloc(buf_A[0]);
+    CTF_int::cdealloc(buf_B[0]);
+    CTF_int::cdealloc(buf_C);
+    if (move_A) CTF_int::cdealloc(buf_A[1]);
+    if (move_B) CTF_int::cdealloc(buf_B[1]);
+    TAU_FSTOP(ctr_2d_general_pipelined);
+  }
+}
@@ -64,6 +64,8 @@ namespace CTF_int{
       bool move_A;
       bool move_B;
       bool move_C;
+      /* whether the panel broadcasts may be double-buffered, see is_pipelined() */
+      bool pipeline;
 
       CommData * cdt_A;
       CommData * cdt_B;
@@ -81,6 +83,18 @@ namespace CTF_int{
        *  where b is the smallest blocking factor among A and B or A and C or B and C. 
        */
       void run(char * A, char * B, char * C);
+      /**
+       * \brief whether run() will overlap the broadcast of the next panels
+       *  of A/B with the contraction of the current ones (double-buffered SUMMA)
+       */
+      bool is_pipelined();
+      /**
+       * \brief double-buffered SUMMA, posts nonblocking broadcasts of the
+       *  panels of step ib+inum_lyr before contracting the panels of step ib
+       * \param[in] iidx_lyr first step performed by this layer
+       * \param[in] inum_lyr stride between steps performed by this layer
+       */
+      void run_pipelined(char * A, char * B, char * C, int iidx_lyr, int inum_lyr);
       /**
        * \brief returns the number of bytes of buffer space
        *  we need 
@@ -103,6 +117,7 @@ namespace CTF_int{
        */
       double est_time_rec(int nlyr);
       ctr * clone();
+      bool rebind(contraction const * c);
 
       /**
        * \brief determines buffer and block sizes needed for ctr_2d_general
@@ -134,7 +149,7 @@ namespace CTF_int{
        * \brief partial constructor, most of the logic is in the ctr_2d_gen_build function
        * \param[in] c contraction object to get info about ctr from
        */
-      ctr_2d_general(contraction * c) : ctr(c){ move_A=0; move_B=0; move_C=0; }
+      ctr_2d_general(contraction * c);
   };
 }
 #endif
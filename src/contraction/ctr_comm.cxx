@@ -40,6 +40,13 @@ namespace CTF_int {
   ctr::~ctr(){
   }
 
+  void ctr::rebind_ctr(contraction const * c){
+    sr_A = c->A->sr;
+    sr_B = c->B->sr;
+    sr_C = c->C->sr;
+    beta = c->beta;
+  }
+
   ctr_replicate::ctr_replicate(contraction const * c,
                                int const *         phys_mapped,
                                int64_t             blk_sz_A,
@@ -143,12 +150,38 @@ namespace CTF_int {
     ncdt_A = o->ncdt_A;
     ncdt_B = o->ncdt_B;
     ncdt_C = o->ncdt_C;
+    cdt_A = NULL;
+    cdt_B = NULL;
+    cdt_C = NULL;
+    if (ncdt_A > 0){
+      CTF_int::alloc_ptr(sizeof(CommData*)*ncdt_A, (void**)&cdt_A);
+      memcpy(cdt_A, o->cdt_A, sizeof(CommData*)*ncdt_A);
+    }
+    if (ncdt_B > 0){
+      CTF_int::alloc_ptr(sizeof(CommData*)*ncdt_B, (void**)&cdt_B);
+      memcpy(cdt_B, o->cdt_B, sizeof(CommData*)*ncdt_B);
+    }
+    if (ncdt_C > 0){
+      CTF_int::alloc_ptr(sizeof(CommData*)*ncdt_C, (void**)&cdt_C);
+      memcpy(cdt_C, o->cdt_C, sizeof(CommData*)*ncdt_C);
+    }
   }
 
   ctr * ctr_replicate::clone() {
     return new ctr_replicate(this);
   }
 
+  bool ctr_replicate::rebind(contraction const * c){
+    rebind_ctr(c);
+    return rec_ctr->rebind(c);
+  }
+
+  bool ctr_replicate::fuse_epilogue(endomorphism const * epi){
+    /* output is reduced after the local contraction if it is replicated */
+    if (ncdt_C > 0) return false;
+    return rec_ctr->fuse_epilogue(epi);
+  }
+
   void ctr_replicate::print() {
     int i;
     printf("ctr_replicate: \n");
@@ -9,6 +9,7 @@
 
 namespace CTF_int{
   class contraction;
+  class endomorphism;
   
   /**
    * \brief untyped internal class for triply-typed bivariate function
@@ -110,7 +111,7 @@ namespace CTF_int{
                 int              k,
                 char const *     A,
                 int const *      JA,
-                int const *      IA,
+                int64_t const *  IA,
                 int64_t          nnz_A,
                 char const *     B,
                 char *           C,
@@ -122,12 +123,12 @@ namespace CTF_int{
                   int              k,
                   char const *     A,
                   int const *      JA,
-                  int const *      IA,
-                  int              nnz_A,
+                  int64_t const *  IA,
+                  int64_t          nnz_A,
                   char const *     B,
                   int const *      JB,
-                  int const *      IB,
-                  int              nnz_B,
+                  int64_t const *  IB,
+                  int64_t          nnz_B,
                   char *           C,
                   algstrct const * sr_C) const { assert(0); }
 
@@ -137,15 +138,33 @@ namespace CTF_int{
                int              k,
                char const *     A,
                int const *      JA,
-               int const *      IA,
-               int              nnz_A,
+               int64_t const *  IA,
+               int64_t          nnz_A,
                char const *     B,
                int const *      JB,
-               int const *      IB,
-               int              nnz_B,
+               int64_t const *  IB,
+               int64_t          nnz_B,
                char *&          C_CSR,
                algstrct const * sr_C) const { assert(0); }
 
+    virtual void cmasked_csrmultcsr
+              (int              m,
+               int              n,
+               int              k,
+               char const *     A,
+               int const *      JA,
+               int64_t const *  IA,
+               int64_t          nnz_A,
+               char const *     B,
+               int const *      JB,
+               int64_t const *  IB,
+               int64_t          nnz_B,
+               char *&          C_CSR,
+               algstrct const * sr_C,
+               int const *      JM,
+               int64_t const *  IM,
+               bool             is_mask_cmp) const { assert(0); }
+
 
     virtual void coffload_csrmm(int          m,
                                 int          n,
@@ -178,6 +197,28 @@ namespace CTF_int{
       virtual double est_time_fp(int nlyr) { return 0; };
       virtual double est_time_rec(int nlyr) { return est_time_fp(nlyr); };
       virtual ctr * clone() { return NULL; };
+
+      /**
+       * \brief points a copy of a tree constructed for another contraction with the same
+       *        mapping at the operands, scalars, and index maps of contraction c
+       * \param[in] c contraction with the signature of the one this tree was constructed for
+       * \return whether this object and its children could be rebound
+       */
+      virtual bool rebind(contraction const * c) { return false; }
+
+      /**
+       * \brief sets the algebraic structures and beta of c, used by rebind()
+       */
+      void rebind_ctr(contraction const * c);
+
+      /**
+       * \brief requests that epi be applied to each local block of the output
+       *        right after the block is computed; only possible if every block
+       *        is computed by a single local kernel call and not reduced later
+       * \param[in] epi elementwise function to apply to output
+       * \return whether epi will be applied by this object or its children
+       */
+      virtual bool fuse_epilogue(endomorphism const * epi) { return false; }
       
       /**
        * \brief deallocates generic ctr object
@@ -211,6 +252,7 @@ namespace CTF_int{
       ctr * rec_ctr;
       
       void run(char * A, char * B, char * C);
+      bool fuse_epilogue(endomorphism const * epi);
       /**
        * \brief returns the number of bytes of buffer space
        *  we need 
@@ -234,6 +276,7 @@ namespace CTF_int{
       double est_time_rec(int nlyr);
       void print();
       ctr * clone();
+      bool rebind(contraction const * c);
 
       ctr_replicate(ctr * other);
       ~ctr_replicate();
@@ -7,6 +7,7 @@
 #include "contraction.h"
 #include "../tensor/untyped_tensor.h"
 #include "../shared/model.h"
+#include "../scaling/sym_seq_scl.h"
 #ifdef USE_OMP
 #include <omp.h>
 #endif
@@ -67,6 +68,14 @@ namespace CTF_int {
     return new ctr_virt(this);
   }
 
+  bool ctr_virt::rebind(contraction const * c){
+    rebind_ctr(c);
+    idx_map_A = c->idx_A;
+    idx_map_B = c->idx_B;
+    idx_map_C = c->idx_C;
+    return rec_ctr->rebind(c);
+  }
+
   void ctr_virt::print() {
     int i;
     printf("ctr_virt:\n");
@@ -89,6 +98,21 @@ namespace CTF_int {
   }
 
 
+  bool ctr_virt::fuse_epilogue(endomorphism const * epi){
+    int i, j;
+    /* blocks of C are accumulated to over virtualized contracted indices */
+    for (i=0; i<num_dim; i++){
+      if (virt_dim[i] > 1){
+        for (j=0; j<order_C; j++){
+          if (idx_map_C[j] == i) break;
+        }
+        if (j == order_C) return false;
+      }
+    }
+    return rec_ctr->fuse_epilogue(epi);
+  }
+
+
   int64_t ctr_virt::mem_fp(){
     return (order_A+order_B+order_C+(3+VIRT_NTD)*num_dim)*sizeof(int);
   }
@@ -189,8 +213,8 @@ namespace CTF_int {
             beta_arr[off_C]       = 1;
             tid_rec_ctr->run(
                      A + off_A*blk_sz_A*sr_A->el_size,
-                     B + off_B*blk_sz_B*sr_A->el_size,
-                     C + off_C*blk_sz_C*sr_A->el_size);
+                     B + off_B*blk_sz_B*sr_B->el_size,
+                     C + off_C*blk_sz_C*sr_C->el_size);
           }
 
           for (i=0; i<num_dim; i++){
@@ -329,6 +353,8 @@ namespace CTF_int {
     this->idx_map_C  = c->idx_C;
     this->edge_len_C = virt_blk_len_C;
     this->sym_C      = new_sym_C;
+    this->blk_sz_C   = vrt_sz_C;
+    this->epilogue   = NULL;
 
 
   }
@@ -380,12 +406,29 @@ namespace CTF_int {
     inner_params = o->inner_params;
     is_custom    = o->is_custom;
     func         = o->func;
+    blk_sz_C     = o->blk_sz_C;
+    epilogue     = o->epilogue;
   }
 
   ctr * seq_tsr_ctr::clone() {
     return new seq_tsr_ctr(this);
   }
 
+  bool seq_tsr_ctr::rebind(contraction const * c){
+    rebind_ctr(c);
+    alpha     = c->alpha;
+    func      = is_custom ? c->func : NULL;
+    idx_map_A = c->idx_A;
+    idx_map_B = c->idx_B;
+    idx_map_C = c->idx_C;
+    return true;
+  }
+
+  bool seq_tsr_ctr::fuse_epilogue(endomorphism const * epi){
+    epilogue = epi;
+    return true;
+  }
+
   int64_t seq_tsr_ctr::mem_fp(){ return 0; }
 
   //double seq_tsr_ctr_mig[] = {1e-6, 9.30e-11, 5.61e-10};
@@ -558,6 +601,13 @@ namespace CTF_int {
       double tps[] = {exe_time, 1.0, (double)est_membw(), est_fp()};
       seq_tsr_ctr_mdl_ref.observe(tps);
     }
+    if (epilogue != NULL){
+      TAU_FSTART(seq_tsr_ctr_epilogue);
+      for (int64_t i=0; i<blk_sz_C; i++){
+        epilogue->apply_f(C+i*sr_C->el_size);
+      }
+      TAU_FSTOP(seq_tsr_ctr_epilogue);
+    }
   }
 
   void inv_idx(int                order_A,
@@ -27,11 +27,16 @@ namespace CTF_int {
        * \brief iterates over the dense virtualization block grid and contracts
        */
       void run(char * A, char * B, char * C);
+      /**
+       * \brief fuses epi into rec_ctr if no virtualized index is contracted over
+       */
+      bool fuse_epilogue(endomorphism const * epi);
       int64_t mem_fp();
       int64_t mem_rec();
 
       double est_time_rec(int nlyr);
       ctr * clone();
+      bool rebind(contraction const * c);
     
       /**
        * \brief deallocates ctr_virt object
@@ -82,6 +87,8 @@ namespace CTF_int {
     char tB;
     char tC;
     bool offload;
+    /** \brief whether the blocks of sparse A are in DCSR rather than CSR layout */
+    bool dcsr_A;
   };
 
   class seq_tsr_ctr : public ctr {
@@ -106,11 +113,17 @@ namespace CTF_int {
       
       int is_custom;
       bivar_function const * func; // custom_params;
+
+      /** \brief size of the C block computed by each call */
+      int64_t blk_sz_C;
+      /** \brief function applied to the C block after each call, NULL if none */
+      endomorphism const * epilogue;
       
       /**
        * \brief wraps user sequential function signature
        */
       void run(char * A, char * B, char * C);
+      bool fuse_epilogue(endomorphism const * epi);
       void print();
       int64_t mem_fp();
       double est_fp();
@@ -118,6 +131,7 @@ namespace CTF_int {
       double est_time_rec(int nlyr);
       double est_time_fp(int nlyr);
       ctr * clone();
+      bool rebind(contraction const * c);
 
       /**
        * \brief clones ctr object
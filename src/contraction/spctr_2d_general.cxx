@@ -65,6 +65,11 @@ namespace CTF_int {
     return new spctr_2d_general(this);
   }
 
+  bool spctr_2d_general::fuse_mask(){
+    if (move_C || (ctr_sub_lda_C != 0 && ctr_lda_C != 1)) return false;
+    return rec_ctr->fuse_mask();
+  }
+
   void spctr_2d_general::find_bsizes(int64_t & b_A,
                                      int64_t & b_B,
                                      int64_t & b_C,
@@ -470,6 +475,16 @@ new_nblk_C = nblk_C/edge_len;
     }
 
 
+    int64_t * offsets_mask_C;
+    if (mask_C != NULL){
+      CTF_int::alloc_ptr(sizeof(int64_t)*nblk_C, (void**)&offsets_mask_C);
+      for (int i=0; i<nblk_C; i++){
+        if (i==0) offsets_mask_C[0] = 0;
+        else offsets_mask_C[i] = offsets_mask_C[i-1]+size_blk_mask_C[i-1];
+      }
+      rec_ctr->is_mask_cmp = is_mask_cmp;
+    }
+
     int64_t * new_size_blk_A;
     int new_nblk_A = nblk_A;
     int64_t * new_size_blk_B;
@@ -485,6 +500,17 @@ new_nblk_C = nblk_C/edge_len;
       op_C = reduce_step_pre(edge_len, new_C, is_sparse_C, move_C, sr_C, b_C, s_C, buf_C, cdt_C, ctr_sub_lda_C, ctr_lda_C, nblk_C, size_blk_C, new_nblk_C, new_size_blk_C, offsets_C, ib, rec_ctr->beta);
 
 
+      if (mask_C != NULL){
+        /* the mask is sliced in the same way as C */
+        if (ctr_sub_lda_C == 0){
+          rec_ctr->mask_C          = mask_C;
+          rec_ctr->size_blk_mask_C = size_blk_mask_C;
+        } else {
+          rec_ctr->mask_C          = mask_C+offsets_mask_C[ib*ctr_sub_lda_C];
+          rec_ctr->size_blk_mask_C = size_blk_mask_C+ib*ctr_sub_lda_C;
+        }
+      }
+
       TAU_FSTOP(spctr_2d_general);
       rec_ctr->run(op_A, new_nblk_A, new_size_blk_A,
                    op_B, new_nblk_B, new_size_blk_B,
@@ -586,6 +612,9 @@ new_nblk_C = nblk_C/edge_len;
     if (is_sparse_B){
       cdealloc(offsets_B);
     }
+    if (mask_C != NULL){
+      cdealloc(offsets_mask_C);
+    }
     if (is_sparse_C){
       cdealloc(offsets_C);
     } else {
@@ -112,6 +112,11 @@ namespace CTF_int{
       double est_time_rec(int nlyr, double nnz_frac_A, double nnz_frac_B, double nnz_frac_C);
 
       spctr * clone();
+      /**
+       * \brief fuses the output mask into rec_ctr if the blocks of C stay in place
+       *        and each step works on a contiguous range of them
+       */
+      bool fuse_mask();
 /*      void set_size_blk_A(int new_nblk_A, int64_t const * nnbA){
         spctr::set_size_blk_A(new_nblk_A, nnbA);
         rec_ctr->set_size_blk_A(new_nblk_A, nnbA);
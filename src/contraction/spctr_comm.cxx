@@ -116,6 +116,16 @@ namespace CTF_int {
     return new spctr_replicate(this);
   }
 
+  bool spctr_replicate::fuse_epilogue(endomorphism const * epi){
+    /* output is reduced after the local contraction if it is replicated */
+    if (ncdt_C > 0 || is_sparse_C) return false;
+    return rec_ctr->fuse_epilogue(epi);
+  }
+
+  bool spctr_replicate::fuse_mask(){
+    return rec_ctr->fuse_mask();
+  }
+
   void spctr_replicate::print() {
     int i;
     printf("spctr_replicate: \n");
@@ -250,6 +260,27 @@ namespace CTF_int {
     if (is_sparse_C){
       memset(new_size_blk_C, 0, sizeof(int64_t)*nblk_C);
     }
+    char * buf_mask_C = mask_C;
+    int64_t new_size_blk_mask_C[nblk_C];
+    if (mask_C != NULL){
+      /* the mask is held alongside the reduction root of C, so all processors computing parts of C need it */
+      memcpy(new_size_blk_mask_C, size_blk_mask_C, nblk_C*sizeof(int64_t));
+      for (i=0; i<ncdt_C; i++){
+        cdt_C[i]->bcast(new_size_blk_mask_C, nblk_C, MPI_INT64_T, 0);
+      }
+      int64_t new_size_mask_C = 0;
+      for (i=0; i<nblk_C; i++){
+        new_size_mask_C += new_size_blk_mask_C[i];
+      }
+      if (crank != 0)
+        buf_mask_C = (char*)alloc(new_size_mask_C);
+      for (i=0; i<ncdt_C; i++){
+        cdt_C[i]->bcast(buf_mask_C, new_size_mask_C, MPI_CHAR, 0);
+      }
+      rec_ctr->mask_C          = buf_mask_C;
+      rec_ctr->size_blk_mask_C = new_size_blk_mask_C;
+      rec_ctr->is_mask_cmp     = is_mask_cmp;
+    }
 //    if (crank != 0) this->sr_C->set(C, this->sr_C->addid(), size_C);
     if (crank == 0 && !sr_C->isequal(this->beta, sr_C->mulid())){
       ASSERT(!is_sparse_C);
@@ -312,6 +343,7 @@ namespace CTF_int {
 
     if (is_sparse_A && buf_A != A) cdealloc(buf_A);
     if (is_sparse_B && buf_B != B) cdealloc(buf_B);
+    if (buf_mask_C != mask_C) cdealloc(buf_mask_C);
     if (!is_sparse_A && arank != 0){
       this->sr_A->set(A, this->sr_A->addid(), size_A);
     }
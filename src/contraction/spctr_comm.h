@@ -31,6 +31,11 @@ namespace CTF_int{
                char * B, int nblk_B, int64_t const * size_blk_B,
                char * C, int nblk_C, int64_t * size_blk_C,
                char *& new_C);
+      bool fuse_epilogue(endomorphism const * epi);
+      /**
+       * \brief fuses the output mask into rec_ctr, the mask is broadcast along with A and B
+       */
+      bool fuse_mask();
       /**
        * \brief returns the number of bytes of buffer space
        *  we need 
@@ -7,7 +7,10 @@
 #include "contraction.h"
 #include "../sparse_formats/coo.h"
 #include "../sparse_formats/csr.h"
+#include "../sparse_formats/dcsr.h"
+#include "../sparse_formats/csf.h"
 #include "../tensor/untyped_tensor.h"
+#include "../scaling/sym_seq_scl.h"
 
 namespace CTF_int {  
   spctr::spctr(contraction const * c)
@@ -15,6 +18,9 @@ namespace CTF_int {
     is_sparse_A = c->A->is_sparse;
     is_sparse_B = c->B->is_sparse;
     is_sparse_C = c->C->is_sparse;
+    mask_C = NULL;
+    size_blk_mask_C = NULL;
+    is_mask_cmp = false;
   }
 
   spctr::spctr(spctr * other)
@@ -22,6 +28,9 @@ namespace CTF_int {
     is_sparse_A = other->is_sparse_A;
     is_sparse_B = other->is_sparse_B;
     is_sparse_C = other->is_sparse_C;
+    mask_C = other->mask_C;
+    size_blk_mask_C = other->size_blk_mask_C;
+    is_mask_cmp = other->is_mask_cmp;
   }
 
   spctr::~spctr(){  }
@@ -131,6 +140,9 @@ namespace CTF_int {
     this->idx_map_C  = c->idx_C;
     this->edge_len_C = virt_blk_len_C;
     this->sym_C      = new_sym_C;
+    this->blk_sz_C   = vrt_sz_C;
+    this->epilogue   = NULL;
+    this->is_csf_A   = krnl_type == 0 && c->use_csf();
 
   }
 
@@ -181,12 +193,26 @@ namespace CTF_int {
     inner_params = o->inner_params;
     is_custom    = o->is_custom;
     func         = o->func;
+    blk_sz_C     = o->blk_sz_C;
+    epilogue     = o->epilogue;
+    is_csf_A     = o->is_csf_A;
   }
 
   spctr * seq_tsr_spctr::clone() {
     return new seq_tsr_spctr(this);
   }
 
+  bool seq_tsr_spctr::fuse_epilogue(endomorphism const * epi){
+    if (is_sparse_C) return false;
+    epilogue = epi;
+    return true;
+  }
+
+  bool seq_tsr_spctr::fuse_mask(){
+    /* only the kernel producing a CSR output computes entries selectively */
+    return krnl_type == 4;
+  }
+
 
   int64_t seq_tsr_spctr::spmem_fp(){ return 0; }
   
@@ -340,6 +366,24 @@ namespace CTF_int {
     switch (krnl_type){
       case 0:
       {
+        if (is_csf_A){
+          TAU_FSTART(CSFCTR);
+          int64_t sz_C = 1;
+          for (int i=0; i<order_C; i++) sz_C *= edge_len_C[i];
+          if (!sr_C->isequal(beta,sr_C->mulid())){
+            if (beta == NULL || sr_C->isequal(beta,sr_C->addid())){
+              sr_C->set(C, sr_C->addid(), sz_C);
+            } else {
+              sr_C->scal(sz_C, beta, C, 1);
+            }
+          }
+          CSF_Tensor::csfctr(this->alpha, A, sr_A, idx_map_A,
+                             B, sr_B, order_B, edge_len_B, idx_map_B,
+                             C, sr_C, order_C, edge_len_C, idx_map_C, func);
+          TAU_FSTOP(CSFCTR);
+          break;
+        }
+
         ASSERT(size_blk_A[0]%sr_A->pair_size() == 0);
 
         int64_t nnz_A = size_blk_A[0]/sr_A->pair_size();
@@ -385,8 +429,12 @@ namespace CTF_int {
       {
         // Do mm using CSR format for A
         TAU_FSTART(CSRMM);
-        CSR_Matrix::csrmm(A, sr_A, inner_params.m, inner_params.n, inner_params.k,
-                          alpha, B, sr_B, sr_C->mulid(), C, sr_C, func, inner_params.offload);
+        if (inner_params.dcsr_A)
+          DCSR_Matrix::dcsrmm(A, sr_A, inner_params.m, inner_params.n, inner_params.k,
+                              alpha, B, sr_B, sr_C->mulid(), C, sr_C, func, inner_params.offload);
+        else
+          CSR_Matrix::csrmm(A, sr_A, inner_params.m, inner_params.n, inner_params.k,
+                            alpha, B, sr_B, sr_C->mulid(), C, sr_C, func, inner_params.offload);
         TAU_FSTOP(CSRMM);
       }
       break;
@@ -395,8 +443,12 @@ namespace CTF_int {
       {
         // Do mm using CSR format for A and B
         TAU_FSTART(CSRMULTD);
-        CSR_Matrix::csrmultd(A, sr_A, inner_params.m, inner_params.n, inner_params.k,
-                             alpha, B, sr_B, sr_C->mulid(), C, sr_C, func, inner_params.offload);
+        if (inner_params.dcsr_A)
+          DCSR_Matrix::dcsrmultd(A, sr_A, inner_params.m, inner_params.n, inner_params.k,
+                                 alpha, B, sr_B, sr_C->mulid(), C, sr_C, func, inner_params.offload);
+        else
+          CSR_Matrix::csrmultd(A, sr_A, inner_params.m, inner_params.n, inner_params.k,
+                               alpha, B, sr_B, sr_C->mulid(), C, sr_C, func, inner_params.offload);
         TAU_FSTOP(CSRMULTD);
       }
       break;
@@ -405,17 +457,28 @@ namespace CTF_int {
       {
         // Do mm using CSR format for A and B and C
         TAU_FSTART(CSRMULTCSR);
-        CSR_Matrix::csrmultcsr(A, sr_A, inner_params.m, inner_params.n, inner_params.k,
-                               alpha, B, sr_B, sr_C->mulid(), new_C, sr_C, func, inner_params.offload);
+        if (inner_params.dcsr_A)
+          DCSR_Matrix::dcsrmultcsr(A, sr_A, inner_params.m, inner_params.n, inner_params.k,
+                                   alpha, B, sr_B, sr_C->mulid(), new_C, sr_C, func, inner_params.offload, mask_C, is_mask_cmp);
+        else
+          CSR_Matrix::csrmultcsr(A, sr_A, inner_params.m, inner_params.n, inner_params.k,
+                                 alpha, B, sr_B, sr_C->mulid(), new_C, sr_C, func, inner_params.offload, mask_C, is_mask_cmp);
         size_blk_C[0] = ((CSR_Matrix)new_C).size();
         //printf("new size = %ld nnz = %ld\n",size_blk_C[0],((CSR_Matrix)new_C).nnz());
         TAU_FSTOP(CSRMULTCSR);
       }
       break;
     }
+    if (epilogue != NULL){
+      TAU_FSTART(seq_tsr_spctr_epilogue);
+      for (int64_t i=0; i<blk_sz_C; i++){
+        epilogue->apply_f(C+i*sr_C->el_size);
+      }
+      TAU_FSTOP(seq_tsr_spctr_epilogue);
+    }
     double nnz_frac_A = 1.0, nnz_frac_B = 1.0, nnz_frac_C = 1.0;
     if (is_sparse_A){
-      nnz_frac_A = size_blk_A[0]/sr_A->pair_size();
+      nnz_frac_A = is_csf_A ? CSF_Tensor(A).nnz() : size_blk_A[0]/sr_A->pair_size();
       for (int i=0; i<order_A; i++){
         nnz_frac_A = nnz_frac_A / edge_len_A[i];
       }
@@ -562,6 +625,24 @@ namespace CTF_int {
 
   #define VIRT_NTD 1
 
+  bool spctr_virt::fuse_epilogue(endomorphism const * epi){
+    int i, j;
+    /* blocks of C are accumulated to over virtualized contracted indices */
+    for (i=0; i<num_dim; i++){
+      if (virt_dim[i] > 1){
+        for (j=0; j<order_C; j++){
+          if (idx_map_C[j] == i) break;
+        }
+        if (j == order_C) return false;
+      }
+    }
+    return rec_ctr->fuse_epilogue(epi);
+  }
+
+  bool spctr_virt::fuse_mask(){
+    return rec_ctr->fuse_mask();
+  }
+
   int64_t spctr_virt::spmem_fp(){
     return (order_A+order_B+order_C+(3+VIRT_NTD)*num_dim)*sizeof(int);
   }
@@ -651,6 +732,14 @@ namespace CTF_int {
         buckets_C[i] = C + sp_offsets_C[i];
       }      
     }
+    int64_t * sp_offsets_mask_C = NULL;
+    if (mask_C != NULL){
+      sp_offsets_mask_C = (int64_t*)alloc(sizeof(int64_t)*nb_C);
+      sp_offsets_mask_C[0] = 0;
+      for (int i=1; i<nb_C; i++){
+        sp_offsets_mask_C[i] = sp_offsets_mask_C[i-1]+size_blk_mask_C[i-1];
+      }
+    }
 
   #if (VIRT_NTD>1)
 //  #pragma omp parallel private(off_A,off_B,off_C,tidx_arr,i) 
@@ -712,6 +801,11 @@ namespace CTF_int {
             bool do_dealloc = beta_arr[off_C] > 0;
             beta_arr[off_C] = 1;
             char * pass_C = is_sparse_C ? buckets_C[off_C] : rec_C;
+            if (mask_C != NULL){
+              tid_rec_ctr->mask_C          = mask_C + sp_offsets_mask_C[off_C];
+              tid_rec_ctr->size_blk_mask_C = size_blk_mask_C + off_C;
+              tid_rec_ctr->is_mask_cmp     = is_mask_cmp;
+            }
             tid_rec_ctr->run(rec_A, 1, size_blk_A+off_A,
                              rec_B, 1, size_blk_B+off_B,
                              rec_C, 1, new_sp_szs_C+off_C,
@@ -765,6 +859,7 @@ namespace CTF_int {
     if (is_sparse_A) cdealloc(sp_offsets_A);
     if (is_sparse_B) cdealloc(sp_offsets_B);
     if (is_sparse_B) cdealloc(sp_offsets_C);
+    if (mask_C != NULL) cdealloc(sp_offsets_mask_C);
     if (alloced){
       CTF_int::cdealloc(idx_arr);
     }
@@ -798,6 +893,11 @@ namespace CTF_int {
     return new spctr_pin_keys(this);
   }
 
+  bool spctr_pin_keys::fuse_epilogue(endomorphism const * epi){
+    if (is_sparse_C) return false;
+    return rec_ctr->fuse_epilogue(epi);
+  }
+
   void spctr_pin_keys::print(){
     printf("spctr_pin_keys:\n");
     switch (AxBxC){ 
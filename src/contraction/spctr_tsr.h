@@ -13,6 +13,12 @@ namespace CTF_int{
       bool      is_sparse_B;
       bool      is_sparse_C;
       char *    new_C;
+      /** \brief CSR blocks of the output mask, NULL if the output is not masked */
+      char *    mask_C;
+      /** \brief sizes of the CSR blocks of the output mask */
+      int64_t const * size_blk_mask_C;
+      /** \brief whether entries absent from, rather than present in, the mask are computed */
+      bool      is_mask_cmp;
 
       ~spctr();
       spctr(spctr * other);
@@ -44,6 +50,12 @@ namespace CTF_int{
        */
       virtual int64_t spmem_rec(double nnz_frac_A, double nnz_frac_B, double nnz_frac_C){ return 0; };
 
+      /**
+       * \brief whether this kernel and its recursive calls can restrict the output to the sparsity pattern
+       *        of a CSR mask with the same blocking as C, passed via mask_C and size_blk_mask_C to run()
+       */
+      virtual bool fuse_mask() { return false; }
+
 
       void run(char * A, char * B, char * C) { printf("CTF ERROR: PROVIDE SPARSITY ARGS TO RUN\n"); assert(0); };
       virtual void run(char * A, int nblk_A, int64_t const * size_blk_A,
@@ -76,6 +88,13 @@ namespace CTF_int{
       
       int is_custom;
       bivar_function const * func; // custom_params;
+
+      /** \brief size of the C block computed by each call, if C is dense */
+      int64_t blk_sz_C;
+      /** \brief function applied to the dense C block after each call, NULL if none */
+      endomorphism const * epilogue;
+      /** \brief whether the blocks of A are CSF trees (built by the tensor before the contraction) rather than pairs */
+      bool is_csf_A;
       
 
       /**
@@ -85,6 +104,8 @@ namespace CTF_int{
                char * B, int nblk_B, int64_t const * size_blk_B,
                char * C, int nblk_C, int64_t * size_blk_C,
                char *& new_C);
+      bool fuse_epilogue(endomorphism const * epi);
+      bool fuse_mask();
       void print();
       int64_t spmem_fp();
       spctr * clone();
@@ -138,6 +159,14 @@ namespace CTF_int{
                char * B, int nblk_B, int64_t const * size_blk_B,
                char * C, int nblk_C, int64_t * size_blk_C,
                char *& new_C);
+      /**
+       * \brief fuses epi into rec_ctr if no virtualized index is contracted over
+       */
+      bool fuse_epilogue(endomorphism const * epi);
+      /**
+       * \brief fuses the output mask into rec_ctr, whose output blocks match those of the mask
+       */
+      bool fuse_mask();
       int64_t spmem_fp();
       int64_t spmem_rec(double nnz_frac_A, double nnz_frac_B, double nnz_frac_C);
 
@@ -176,6 +205,7 @@ namespace CTF_int{
                char * B, int nblk_B, int64_t const * size_blk_B,
                char * C, int nblk_C, int64_t * size_blk_C,
                char *& new_C);
+      bool fuse_epilogue(endomorphism const * epi);
       void print();
       int64_t spmem_fp(double nnz_frac_A, double nnz_frac_B, double nnz_frac_C);
       int64_t spmem_rec(double nnz_frac_A, double nnz_frac_B, double nnz_frac_C);
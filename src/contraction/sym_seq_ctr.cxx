@@ -7,6 +7,27 @@
 #include "../shared/util.h"
 
 namespace CTF_int{
+
+  /**
+   * \brief computes c=a*b in sr_C, widening a and b first if they are stored
+   *        in narrower types (mixed-precision contraction)
+   */
+  inline void widen_mul(algstrct const * sr_A,
+                        char const *     a,
+                        algstrct const * sr_B,
+                        char const *     b,
+                        algstrct const * sr_C,
+                        char *           c){
+    if (sr_C->is_same_type(sr_A) && sr_C->is_same_type(sr_B)){
+      sr_C->mul(a, b, c);
+    } else {
+      char wa[sr_C->el_size];
+      char wb[sr_C->el_size];
+      sr_C->widen(1, sr_A, a, wa);
+      sr_C->widen(1, sr_B, b, wb);
+      sr_C->mul(wa, wb, c);
+    }
+  }
   
   template <int idim>
   void sym_seq_ctr_loop(char const *     alpha,
@@ -206,9 +227,9 @@ namespace CTF_int{
       if (alpha == NULL || sr_C->isequal(alpha,sr_C->mulid())){
         for (int i=imin; i<imax; i++){
           char tmp[sr_C->el_size];
-          sr_C->mul(A+offsets_A[0][i], 
-                    B+offsets_B[0][i], 
-                    tmp);
+          widen_mul(sr_A, A+offsets_A[0][i], 
+                    sr_B, B+offsets_B[0][i], 
+                    sr_C, tmp);
           sr_C->add(tmp, 
                     C+offsets_C[0][i], 
                     C+offsets_C[0][i]);
@@ -217,9 +238,9 @@ namespace CTF_int{
       } else {
         for (int i=imin; i<imax; i++){
           char tmp[sr_C->el_size];
-          sr_C->mul(A+offsets_A[0][i], 
-                    B+offsets_B[0][i], 
-                    tmp);
+          widen_mul(sr_A, A+offsets_A[0][i], 
+                    sr_B, B+offsets_B[0][i], 
+                    sr_C, tmp);
           sr_C->mul(tmp,
                     alpha,
                     tmp);
@@ -413,17 +434,17 @@ namespace CTF_int{
 
     if (idx_max == 0){
       if (alpha == NULL && beta == NULL){
-        sr_C->mul(A, B, C);
+        widen_mul(sr_A, A, sr_B, B, sr_C, C);
         CTF_FLOPS_ADD(1);
       } else  if (alpha == NULL){
         char tmp[sr_C->el_size];
-        sr_C->mul(A, B, tmp);
+        widen_mul(sr_A, A, sr_B, B, sr_C, tmp);
         sr_C->mul(C, beta, C);
         sr_C->add(tmp, C, C);
         CTF_FLOPS_ADD(2);
       } else {
         char tmp[sr_C->el_size];
-        sr_C->mul(A, B, tmp);
+        widen_mul(sr_A, A, sr_B, B, sr_C, tmp);
         sr_C->mul(tmp, alpha, tmp);
         sr_C->mul(C, beta, C);
         sr_C->add(tmp, C, C);
@@ -504,14 +525,14 @@ namespace CTF_int{
             CTF_FLOPS_ADD(1);
           } else*/  if (alpha == NULL){
             char tmp[sr_C->el_size];
-            sr_C->mul(A+idx_A*sr_A->el_size, B+idx_B*sr_B->el_size, 
-                     tmp);
+            widen_mul(sr_A, A+idx_A*sr_A->el_size, sr_B, B+idx_B*sr_B->el_size, 
+                      sr_C, tmp);
             sr_C->add(tmp, C+idx_C*sr_C->el_size, C+idx_C*sr_C->el_size);
             CTF_FLOPS_ADD(2);
           } else {
             char tmp[sr_C->el_size];
-            sr_C->mul(A+idx_A*sr_A->el_size, B+idx_B*sr_B->el_size, 
-                     tmp);
+            widen_mul(sr_A, A+idx_A*sr_A->el_size, sr_B, B+idx_B*sr_B->el_size, 
+                      sr_C, tmp);
             sr_C->mul(tmp, alpha, tmp);
             sr_C->add(tmp, C+idx_C*sr_C->el_size, C+idx_C*sr_C->el_size);
             CTF_FLOPS_ADD(3);
@@ -742,6 +763,164 @@ namespace CTF_int{
     return 0;
   }
 
+  /**
+   * \brief number of packed entries along each index of the symmetric pair in a tile of
+   *        sym_seq_ctr_packed() (divided by the larger of the inner block dimensions m,n)
+   */
+  #define SYM_PACKED_BLK 64
+
+  /**
+   * \brief determines whether the inner-blocked contraction has the form
+   *        C[(ij)] = A[i]*B[j], where (ij) is a packed symmetric pair of C,
+   *        i appears only in one of A and B and j only in the other, no other symmetry is present,
+   *        and all other indices have been folded into the inner (GEMM) blocks.
+   * \param[out] pos_C position of the first index of the pair in C
+   * \param[out] is_A_fst whether the first index of the pair in C is an index of A
+   * \return true if sym_seq_ctr_packed() may be used
+   */
+  bool is_sym_packed_pair(int         order_A,
+                          int const * edge_len_A,
+                          int const * sym_A,
+                          int const * idx_map_A,
+                          int         order_B,
+                          int const * edge_len_B,
+                          int const * sym_B,
+                          int const * idx_map_B,
+                          int         order_C,
+                          int const * edge_len_C,
+                          int const * sym_C,
+                          int const * idx_map_C,
+                          int &       pos_C,
+                          bool &      is_A_fst){
+    pos_C = -1;
+    for (int i=0; i<order_C; i++){
+      if (sym_C[i] != NS){
+        if (pos_C != -1 || i+1 >= order_C || sym_C[i+1] != NS) return false;
+        pos_C = i;
+      }
+    }
+    if (pos_C == -1) return false;
+    for (int i=0; i<order_A; i++){ if (sym_A[i] != NS) return false; }
+    for (int i=0; i<order_B; i++){ if (sym_B[i] != NS) return false; }
+    int ip = idx_map_C[pos_C];
+    int jp = idx_map_C[pos_C+1];
+    if (edge_len_C[pos_C] <= 1) return false;
+    //count appearances of the pair indices in A and B, all other indices must have length one
+    int nip_A = 0, njp_A = 0, nip_B = 0, njp_B = 0;
+    for (int i=0; i<order_A; i++){
+      if (idx_map_A[i] == ip) nip_A++;
+      else if (idx_map_A[i] == jp) njp_A++;
+      else if (edge_len_A[i] != 1) return false;
+    }
+    for (int i=0; i<order_B; i++){
+      if (idx_map_B[i] == ip) nip_B++;
+      else if (idx_map_B[i] == jp) njp_B++;
+      else if (edge_len_B[i] != 1) return false;
+    }
+    for (int i=0; i<order_C; i++){
+      if (i != pos_C && i != pos_C+1 && edge_len_C[i] != 1) return false;
+    }
+    if (nip_A == 1 && njp_A == 0 && nip_B == 0 && njp_B == 1) is_A_fst = true;
+    else if (nip_A == 0 && njp_A == 1 && nip_B == 1 && njp_B == 0) is_A_fst = false;
+    else return false;
+    return true;
+  }
+
+  /**
+   * \brief blocked contraction C[(ij)] += alpha*A[i]*B[j] into the packed triangle of C,
+   *        where each entry of A, B, and C is an inner block as described by prm.
+   *        The triangle is split into square tiles; each tile is computed by a single GEMM on
+   *        tiles of A and B packed into contiguous buffers, and its result is accumulated into
+   *        the packed entries of C. Off-diagonal tiles lie entirely within the triangle, while
+   *        only the stored part of the result is accumulated for tiles on the diagonal.
+   * \param[in] len edge length of the symmetric pair
+   * \param[in] sym symmetry of the pair in C (SY, AS, or SH)
+   * \param[in] is_A_fst whether the first (lesser) index of the pair in C is the index of A
+   */
+  void sym_seq_ctr_packed(char const *     alpha,
+                          char const *     A,
+                          char const *     B,
+                          char *           C,
+                          algstrct const * sr_C,
+                          int              len,
+                          int              sym,
+                          bool             is_A_fst,
+                          iparam const *   prm){
+    TAU_FSTART(sym_seq_ctr_packed);
+    int m = prm->m;
+    int n = prm->n;
+    int k = prm->k;
+    int64_t el = sr_C->el_size;
+    int64_t stride_A = (int64_t)m*k;
+    int64_t stride_B = (int64_t)k*n;
+    int64_t stride_C = (int64_t)m*n;
+    //strides of op(A) (m-by-k), op(B) (k-by-n), and the m-by-n result within the inner blocks
+    int64_t sA_m = prm->tA == 'N' ? 1 : k;
+    int64_t sA_k = prm->tA == 'N' ? m : 1;
+    int64_t sB_k = prm->tB == 'N' ? 1 : n;
+    int64_t sB_n = prm->tB == 'N' ? k : 1;
+    int64_t sC_m = prm->tC == 'N' ? 1 : n;
+    int64_t sC_n = prm->tC == 'N' ? m : 1;
+    int bt = std::max(1, std::min(len, SYM_PACKED_BLK/std::max(m,n)));
+    int nbt = (len+bt-1)/bt;
+    int64_t ntiles = (int64_t)nbt*nbt;
+#ifdef USE_OMP
+    #pragma omp parallel
+#endif
+    {
+      char * buf_A = (char*)CTF_int::alloc(el*bt*m*k);
+      char * buf_B = (char*)CTF_int::alloc(el*bt*n*k);
+      char * buf_C = (char*)CTF_int::alloc(el*bt*m*bt*n);
+#ifdef USE_OMP
+      #pragma omp for schedule(dynamic)
+#endif
+      for (int64_t t=0; t<ntiles; t++){
+        //tile (ti,tj) of rows of A and columns of B, only tiles intersecting the triangle are computed
+        int ti = t%nbt;
+        int tj = t/nbt;
+        if (is_A_fst ? ti > tj : tj > ti) continue;
+        int ist = ti*bt, ni = std::min(bt, len-ist);
+        int jst = tj*bt, nj = std::min(bt, len-jst);
+        int64_t ldA = (int64_t)ni*m;
+        int64_t ldB = k;
+        int64_t ldC = (int64_t)ni*m;
+        for (int i=0; i<ni; i++){
+          char const * a = A+(ist+i)*stride_A*el;
+          for (int ik=0; ik<k; ik++){
+            sr_C->copy(m, a+ik*sA_k*el, sA_m, buf_A+(i*m+ik*ldA)*el, 1);
+          }
+        }
+        for (int j=0; j<nj; j++){
+          char const * b = B+(jst+j)*stride_B*el;
+          for (int in=0; in<n; in++){
+            sr_C->copy(k, b+in*sB_n*el, sB_k, buf_B+(j*n+in)*ldB*el, 1);
+          }
+        }
+        sr_C->set(buf_C, sr_C->addid(), ldC*nj*n);
+        sr_C->gemm('N', 'N', ni*m, nj*n, k, alpha, buf_A, buf_B, sr_C->mulid(), buf_C);
+        CTF_FLOPS_ADD(2*(int64_t)ni*m*nj*n*k);
+        for (int j=0; j<nj; j++){
+          for (int i=0; i<ni; i++){
+            int lo = is_A_fst ? ist+i : jst+j;
+            int hi = is_A_fst ? jst+j : ist+i;
+            if (lo > hi || (lo == hi && sym != SY)) continue;
+            int64_t off = (sym == SY ? ((int64_t)hi*(hi+1))/2 : ((int64_t)hi*(hi-1))/2) + lo;
+            char * c = C+off*stride_C*el;
+            for (int in=0; in<n; in++){
+              for (int im=0; im<m; im++){
+                sr_C->accum(buf_C+((i*m+im)+(j*n+in)*ldC)*el, c+(im*sC_m+in*sC_n)*el);
+              }
+            }
+          }
+        }
+      }
+      CTF_int::cdealloc(buf_A);
+      CTF_int::cdealloc(buf_B);
+      CTF_int::cdealloc(buf_C);
+    }
+    TAU_FSTOP(sym_seq_ctr_packed);
+  }
+
   int sym_seq_ctr_inr(char const *     alpha,
                       char const *     A,
                       algstrct const * sr_A,
@@ -774,6 +953,9 @@ namespace CTF_int{
     stride_A = prm->m*prm->k*prm->l;
     stride_B = prm->k*prm->n*prm->l;
     stride_C = prm->m*prm->n*prm->l;
+    //A and B stored in narrower types than C are widened one panel at a time
+    bool is_widen = !sr_C->is_same_type(sr_A) || !sr_C->is_same_type(sr_B);
+    ASSERT(!is_widen || !prm->offload);
 
     inv_idx(order_A,       idx_map_A,
             order_B,       idx_map_B,
@@ -805,6 +987,23 @@ namespace CTF_int{
         }
       }
     }
+    //a packed symmetric pair of C formed from A and B is contracted by tiles, rather than by one GEMM per pair
+    int pos_C;
+    bool is_A_fst;
+    if (!prm->offload && func == NULL && !is_widen && prm->l == 1 &&
+        is_sym_packed_pair(order_A, edge_len_A, sym_A, idx_map_A,
+                           order_B, edge_len_B, sym_B, idx_map_B,
+                           order_C, edge_len_C, sym_C, idx_map_C, pos_C, is_A_fst)){
+      sym_seq_ctr_packed(alpha, A, B, C, sr_C, edge_len_C[pos_C], sym_C[pos_C], is_A_fst, prm);
+      CTF_int::cdealloc(dlen_A);
+      CTF_int::cdealloc(dlen_B);
+      CTF_int::cdealloc(dlen_C);
+      CTF_int::cdealloc(idx_glb);
+      CTF_int::cdealloc(rev_idx_map);
+      TAU_FSTOP(sym_seq_ctr_inner);
+      return 0;
+    }
+
     idx_A = 0, idx_B = 0, idx_C = 0;
     sym_pass = 1;
    // int cntr=0;  
@@ -828,7 +1027,12 @@ namespace CTF_int{
                                   C+idx_C*stride_C*sr_C->el_size);
             }
           } else {
-            if (func == NULL){
+            if (func == NULL && is_widen){
+              sr_C->gemm_batch_widen(prm->tA, prm->tB, prm->l, prm->m, prm->n, prm->k, alpha, 
+                                     sr_A, A+idx_A*stride_A*sr_A->el_size, 
+                                     sr_B, B+idx_B*stride_B*sr_B->el_size, sr_C->mulid(),
+                                     C+idx_C*stride_C*sr_C->el_size);
+            } else if (func == NULL){
               sr_C->gemm_batch(prm->tA, prm->tB, prm->l, prm->m, prm->n, prm->k, alpha, 
                          A+idx_A*stride_A*sr_A->el_size, 
                          B+idx_B*stride_B*sr_B->el_size, sr_C->mulid(),
@@ -858,7 +1062,12 @@ namespace CTF_int{
                                   C+idx_C*stride_C*sr_C->el_size);
             }
           } else {
-            if (func == NULL){ 
+            if (func == NULL && is_widen){
+              sr_C->gemm_batch_widen(prm->tB, prm->tA, prm->l, prm->n, prm->m, prm->k, alpha, 
+                                     sr_B, B+idx_B*stride_B*sr_B->el_size,
+                                     sr_A, A+idx_A*stride_A*sr_A->el_size, sr_C->mulid(), 
+                                     C+idx_C*stride_C*sr_C->el_size);
+            } else if (func == NULL){ 
               sr_C->gemm_batch(prm->tB, prm->tA, prm->l, prm->n, prm->m, prm->k, alpha, 
                          B+idx_B*stride_B*sr_B->el_size,
                          A+idx_A*stride_A*sr_A->el_size, sr_C->mulid(), 
@@ -79,7 +79,9 @@ namespace CTF_int {
 
 
   /**
-   * \brief performs symmetric contraction with blocked gemm
+   * \brief performs symmetric contraction with blocked gemm,
+   *        a packed symmetric pair of indices of C, one from A and one from B, is contracted
+   *        by tiles of the packed triangle rather than by a gemm for each pair
    */
   int sym_seq_ctr_inr(char const *     alpha,
                       char const *     A,
@@ -13,6 +13,8 @@ namespace CTF {
 }
 
 namespace CTF_int {
+  int64_t const max_int_count = INT_MAX;
+
   std::mersenne_twister_engine<std::uint_fast64_t, 64, 312, 156, 31,
                                0xb5026f5aa96619e9, 29,
                                0x5555555555555555, 17,
@@ -333,12 +335,20 @@ namespace CTF_int {
   }
 
 
-  void CommData::bcast(void * buf, int64_t count, MPI_Datatype mdtype, int root){
+  void CommData::bcast(void * buf, int64_t count, MPI_Datatype mdtype, int root, int64_t max_count){
 #ifdef TUNE
     MPI_Barrier(cm);
 #endif
     double st_time = MPI_Wtime();
-    MPI_Bcast(buf, count, mdtype, root, cm);
+    if (count > max_count){
+      //MPI counts are of type int, so larger messages (e.g. serialized sparse blocks) are broadcast in pieces
+      MPI_Aint lb, extent;
+      MPI_Type_get_extent(mdtype, &lb, &extent);
+      for (int64_t off=0; off<count; off+=max_count){
+        MPI_Bcast(((char*)buf)+off*extent, (int)std::min(count-off, max_count), mdtype, root, cm);
+      }
+    } else
+      MPI_Bcast(buf, count, mdtype, root, cm);
 #ifdef TUNE
     MPI_Barrier(cm);
 #endif
@@ -349,6 +359,25 @@ namespace CTF_int {
     bcast_mdl.observe(tps);
   }
 
+  void CommData::ibcast(void * buf, int64_t count, MPI_Datatype mdtype, int root, MPI_Request * req){
+#if MPI_VERSION >= 3
+    if (count > max_int_count){
+      bcast(buf, count, mdtype, root);
+      *req = MPI_REQUEST_NULL;
+    } else
+      MPI_Ibcast(buf, count, mdtype, root, cm, req);
+#else
+    bcast(buf, count, mdtype, root);
+    *req = MPI_REQUEST_NULL;
+#endif
+  }
+
+  void CommData::wait_bcast(MPI_Request * req){
+    //blocking fallbacks of ibcast are recorded by bcast()
+    if (*req == MPI_REQUEST_NULL) return;
+    MPI_Wait(req, MPI_STATUS_IGNORE);
+  }
+
   void CommData::allred(void * inbuf, void * outbuf, int64_t count, MPI_Datatype mdtype, MPI_Op op){
 #ifdef TUNE
     MPI_Barrier(cm);
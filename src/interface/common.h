@@ -14,6 +14,7 @@
 #include <iostream>
 #include <limits.h>
 #include <random>
+#include <typeinfo>
 
 #include <mpi.h>
 #include "../shared/model.h"
@@ -124,6 +125,12 @@ namespace CTF_int {
 
   int64_t get_flops();
 
+  /**
+   * \brief largest number of elements passed at once to kernels and MPI calls with an int count (INT_MAX),
+   *        functions that split larger counts take the limit as a defaulted parameter, so tests can lower it
+   */
+  extern int64_t const max_int_count;
+
   class CommData {
     public:
       MPI_Comm cm;
@@ -190,9 +197,24 @@ namespace CTF_int {
       double estimate_alltoallv_time(int64_t tot_sz);
 
       /**
-       * \brief broadcast, same interface as MPI_Bcast, but excluding the comm
+       * \brief broadcast, same interface as MPI_Bcast, but excluding the comm,
+       *        counts above max_count (lowered only by tests) are broadcast in pieces
+       */
+      void bcast(void * buf, int64_t count, MPI_Datatype mdtype, int root, int64_t max_count=max_int_count);
+
+      /**
+       * \brief nonblocking broadcast, same interface as MPI_Ibcast, but excluding the comm,
+       *        falls back to a blocking broadcast (setting req to MPI_REQUEST_NULL) before MPI-3
+       */
+      void ibcast(void * buf, int64_t count, MPI_Datatype mdtype, int root, MPI_Request * req);
+
+      /**
+       * \brief completes a broadcast posted by ibcast(), which is not recorded in the broadcast model,
+       *        since neither the time from posting to completion (which includes the overlapped work)
+       *        nor the time spent waiting is the cost of the broadcast
+       * \param[in,out] req request returned by ibcast()
        */
-      void bcast(void * buf, int64_t count, MPI_Datatype mdtype, int root);
+      void wait_bcast(MPI_Request * req);
 
       /**
        * \brief allreduce, same interface as MPI_Allreduce, but excluding the comm
@@ -0,0 +1,36 @@
+namespace CTF {
+  template<typename dtype>
+  File_Tensor<dtype>::File_Tensor(char const *              filename,
+                                  int                       order,
+                                  int const *               len,
+                                  World &                   wrld,
+                                  CTF_int::algstrct const & sr,
+                                  int64_t                   offset)
+    : CTF_int::file_tensor(&sr, order, len, &wrld, filename, offset) { }
+
+  template<typename dtype>
+  void File_Tensor<dtype>::write(Tensor<dtype> & A){
+    IASSERT(A.order == this->order);
+    CTF_int::file_tensor::write(&A);
+  }
+
+  template<typename dtype>
+  void File_Tensor<dtype>::read(Tensor<dtype> & A){
+    IASSERT(A.order == this->order);
+    CTF_int::file_tensor::read(&A);
+  }
+
+  template<typename dtype>
+  void File_Tensor<dtype>::contract(dtype                alpha,
+                                    File_Tensor<dtype> & A,
+                                    char const *         idx_A,
+                                    File_Tensor<dtype> & B,
+                                    char const *         idx_B,
+                                    dtype                beta,
+                                    char const *         idx_C,
+                                    int64_t              max_memory){
+    int ret = CTF_int::file_tensor::contract((char const*)&alpha, &A, idx_A, &B, idx_B,
+                                             (char const*)&beta, idx_C, max_memory);
+    IASSERT(ret == CTF_int::SUCCESS);
+  }
+}
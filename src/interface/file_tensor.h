@@ -0,0 +1,79 @@
+#ifndef __FILE_TENSOR_H__
+#define __FILE_TENSOR_H__
+
+#include "../tensor/untyped_file_tensor.h"
+
+namespace CTF {
+  /**
+   * \addtogroup CTF
+   * @{
+   */
+
+  /**
+   * \brief Tensor stored densely in a binary file rather than in memory, which
+   *        can be used for out-of-core contractions of tensors that do not fit
+   *        in the aggregate memory of all processes. The file layout is the
+   *        nonsymmetric dense element order of Tensor::write_dense_to_file().
+   * \param[in] dtype specifies tensor element type
+   */
+  template<typename dtype=double>
+  class File_Tensor : public CTF_int::file_tensor {
+    public:
+      /**
+       * \brief opens (creating if necessary) a file to store a tensor
+       * \param[in] filename name of file, the same on all processes
+       * \param[in] order number of dimensions of tensor
+       * \param[in] len edge lengths of tensor
+       * \param[in] wrld a world for the tensor to live in
+       * \param[in] sr defines the tensor arithmetic for this tensor
+       * \param[in] offset displacement in bytes at which the tensor starts in the file
+       */
+      File_Tensor(char const *              filename,
+                  int                       order,
+                  int const *               len,
+                  World &                   wrld=get_universe(),
+                  CTF_int::algstrct const & sr=Ring<dtype>(),
+                  int64_t                   offset=0);
+
+      /**
+       * \brief writes all data of a tensor with the same edge lengths to the file
+       * \param[in] A tensor to store, which may be sparse or symmetric
+       */
+      void write(Tensor<dtype> & A);
+
+      /**
+       * \brief reads all data of the file into a tensor with the same edge lengths
+       * \param[in,out] A tensor to overwrite
+       */
+      void read(Tensor<dtype> & A);
+
+      /**
+       * \brief out-of-core contraction this[idx_C] = beta*this[idx_C] + alpha*A[idx_A]*B[idx_B],
+       *        which streams tiles of the operands along the last index of each through memory,
+       *        prefetching the next tiles of A and B while the current ones are contracted
+       * \param[in] alpha scaling factor of A*B
+       * \param[in] A first operand
+       * \param[in] idx_A indices of A, each index may appear at most once
+       * \param[in] B second operand
+       * \param[in] idx_B indices of B
+       * \param[in] beta scaling factor of this tensor
+       * \param[in] idx_C indices of this tensor
+       * \param[in] max_memory bytes per process available for tiles, if less than zero
+       *            the memory available to CTF is used
+       */
+      void contract(dtype                alpha,
+                    File_Tensor<dtype> & A,
+                    char const *         idx_A,
+                    File_Tensor<dtype> & B,
+                    char const *         idx_B,
+                    dtype                beta,
+                    char const *         idx_C,
+                    int64_t              max_memory=-1);
+  };
+  /**
+   * @}
+   */
+}
+
+#include "file_tensor.cxx"
+#endif
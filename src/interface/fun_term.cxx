@@ -6,6 +6,7 @@
 #include "../shared/util.h"
 #include "functions.h"
 #include "idx_tensor.h"
+#include "term_plan.h"
 
 namespace CTF_int {
   Unifun_Term::Unifun_Term(Term *                  A_,
@@ -33,7 +34,7 @@ namespace CTF_int {
   void Unifun_Term::execute(CTF::Idx_Tensor output) const {
     CTF::Idx_Tensor opA = A->execute();
     summation s(opA.parent, opA.idx_map, opA.scale, output.parent, output.idx_map, output.scale, func);
-    s.execute();
+    execute_term_sum(s);
   }
  
   CTF::Idx_Tensor Unifun_Term::execute() const {
@@ -107,7 +108,7 @@ namespace CTF_int {
     }
     contraction c(opA.parent, opA.idx_map, opB.parent, opB.idx_map, output.sr->mulid(), output.parent, output.idx_map, output.scale, func);
     //contraction c(opA.parent, opA.idx_map, opB.parent, opB.idx_map, NULL, output.parent, output.idx_map, output.scale, func);
-    c.execute();
+    execute_term_ctr(c);
 //    if (scl != NULL) cdealloc(scl);
   }
  
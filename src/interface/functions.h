@@ -4,6 +4,8 @@
 #include "../scaling/scaling.h"
 #include "../summation/summation.h"
 #include "../contraction/contraction.h"
+#include "../sparse_formats/spgemm.h"
+#include "../sparse_formats/spmv.h"
 
 
 namespace CTF {
@@ -198,12 +200,20 @@ namespace CTF {
                  int              k,
                  dtype_A const *  A,
                  int const *      JA,
-                 int const *      IA,
+                 int64_t const *  IA,
                  int64_t          nnz_A,
                  dtype_B const *  B,
                  dtype_C *        C,
                  CTF_int::algstrct const * sr_C) const {
         //TAU_FSTART(3type_csrmm);
+        if (n == 1){
+          //sparse matrix times vector, with threads balanced over rows and nonzeros
+          CTF_int::spmv<dtype_A,dtype_B,dtype_C>(m, A, JA, IA, B, C,
+                        [&](dtype_A a, dtype_B b){ return f(a,b); },
+                        [&](dtype_C & acc, dtype_C b){ sr_C->add((char const *)&acc, (char const *)&b, (char *)&acc); },
+                        [&](dtype_C & c, dtype_C acc){ sr_C->add((char const *)&c, (char const *)&acc, (char *)&c); });
+          return;
+        }
   #ifdef _OPENMP
         #pragma omp parallel for
   #endif
@@ -212,7 +222,7 @@ namespace CTF {
           #pragma omp parallel for
   #endif
           for (int col_B=0; col_B<n; col_B++){
-            for (int i_A=IA[row_A]-1; i_A<IA[row_A+1]-1; i_A++){
+            for (int64_t i_A=IA[row_A]-1; i_A<IA[row_A+1]-1; i_A++){
               int col_A = JA[i_A]-1;
               dtype_C tmp = f(A[i_A],B[col_B*k+col_A]);
               sr_C->add((char const *)&C[col_B*m+row_A],(char const*)&tmp,(char *)&C[col_B*m+row_A]);
@@ -230,21 +240,21 @@ namespace CTF {
              int              k,
              dtype_A const *  A,
              int const *      JA,
-             int const *      IA,
-             int              nnz_A,
+             int64_t const *  IA,
+             int64_t          nnz_A,
              dtype_B const *  B,
              int const *      JB,
-             int const *      IB,
-             int              nnz_B,
+             int64_t const *  IB,
+             int64_t          nnz_B,
              dtype_C *        C,
              CTF_int::algstrct const * sr_C) const {
   #ifdef _OPENMP
         #pragma omp parallel for
   #endif
         for (int row_A=0; row_A<m; row_A++){
-          for (int i_A=IA[row_A]-1; i_A<IA[row_A+1]-1; i_A++){
+          for (int64_t i_A=IA[row_A]-1; i_A<IA[row_A+1]-1; i_A++){
             int row_B = JA[i_A]-1; //=col_A
-            for (int i_B=IB[row_B]-1; i_B<IB[row_B+1]-1; i_B++){
+            for (int64_t i_B=IB[row_B]-1; i_B<IB[row_B+1]-1; i_B++){
               int col_B = JB[i_B]-1;
               dtype_C tmp = f(A[i_A],B[i_B]);
               sr_C->add((char const*)&C[col_B*m+row_A],(char const*)&tmp,(char *)&C[col_B*m+row_A]);
@@ -260,58 +270,21 @@ namespace CTF {
                  int              k,
                  dtype_A const *  A,
                  int const *      JA,
-                 int const *      IA,
-                 int              nnz_A,
+                 int64_t const *  IA,
+                 int64_t          nnz_A,
                  dtype_B const *  B,
                  int const *      JB,
-                 int const *      IB,
-                 int              nnz_B,
+                 int64_t const *  IB,
+                 int64_t          nnz_B,
                  char *&          C_CSR,
-                 CTF_int::algstrct const * sr_C) const {
-        int * IC = (int*)CTF_int::alloc(sizeof(int)*(m+1));
-        int * has_col = (int*)CTF_int::alloc(sizeof(int)*n);
-        IC[0] = 1;
-        for (int i=0; i<m; i++){
-          memset(has_col, 0, sizeof(int)*n);
-          IC[i+1] = IC[i];
-          CTF_int::CSR_Matrix::compute_has_col(JA, IA, JB, IB, i, has_col);
-          for (int j=0; j<n; j++){
-            IC[i+1] += has_col[j];
-          }
-        }
-        CTF_int::CSR_Matrix C(IC[m]-1, m, n, sizeof(dtype_C));
-        dtype_C * vC = (dtype_C*)C.vals();
-        int * JC = C.JA();
-        memcpy(C.IA(), IC, sizeof(int)*(m+1));
-        CTF_int::cdealloc(IC);
-        IC = C.IA();
-        int64_t * rev_col = (int64_t*)CTF_int::alloc(sizeof(int64_t)*n);
-        for (int i=0; i<m; i++){
-          memset(has_col, 0, sizeof(int)*n);
-          CTF_int::CSR_Matrix::compute_has_col(JA, IA, JB, IB, i, has_col);
-          int vs = 0;
-          for (int j=0; j<n; j++){
-            if (has_col[j]){
-              JC[IC[i]+vs-1] = j+1;
-              rev_col[j] = IC[i]+vs-1;
-              vs++;
-            }
-          }
-          memset(has_col, 0, sizeof(int)*n);
-          for (int j=0; j<IA[i+1]-IA[i]; j++){
-            int row_B = JA[IA[i]+j-1]-1;
-            int idx_A = IA[i]+j-1;
-            for (int l=0; l<IB[row_B+1]-IB[row_B]; l++){
-              int idx_B = IB[row_B]+l-1;
-              if (has_col[JB[idx_B]-1]){
-                dtype_C tmp = f(A[idx_A],B[idx_B]);
-                sr_C->add((char const *)&vC[rev_col[JB[idx_B]-1]], (char const *)&tmp, (char *)&vC[rev_col[JB[idx_B]-1]]);  
-              } else
-                vC[rev_col[JB[idx_B]-1]] = f(A[idx_A],B[idx_B]);
-              has_col[JB[idx_B]-1] = 1;  
-            }
-          }
-        }
+                 CTF_int::algstrct const * sr_C,
+                 int const *      JM=NULL,
+                 int64_t const *  IM=NULL,
+                 bool             is_mask_cmp=false) const {
+        CTF_int::CSR_Matrix C(CTF_int::spgemm<dtype_A,dtype_B,dtype_C>(m, n, A, JA, IA, B, JB, IB,
+                                [&](dtype_A a, dtype_B b){ return f(a,b); },
+                                [&](dtype_C & acc, dtype_C b){ sr_C->add((char const *)&acc, (char const *)&b, (char *)&acc); },
+                                JM, IM, is_mask_cmp));
         CTF_int::CSR_Matrix C_in(C_CSR);
         if (C_CSR == NULL || C_in.nnz() == 0){
           C_CSR = C.all_data;
@@ -320,8 +293,6 @@ namespace CTF {
           CTF_int::cdealloc(C.all_data);
           C_CSR = ans;
         }
-        CTF_int::cdealloc(has_col);
-        CTF_int::cdealloc(rev_col);
       }
 
       void ccsrmm(int              m,
@@ -329,7 +300,7 @@ namespace CTF {
                   int              k,
                   char const *     A,
                   int const *      JA,
-                  int const *      IA,
+                  int64_t const *  IA,
                   int64_t          nnz_A,
                   char const *     B,
                   char *           C,
@@ -343,12 +314,12 @@ namespace CTF {
                     int              k,
                     char const *     A,
                     int const *      JA,
-                    int const *      IA,
-                    int              nnz_A,
+                    int64_t const *  IA,
+                    int64_t          nnz_A,
                     char const *     B,
                     int const *      JB,
-                    int const *      IB,
-                    int              nnz_B,
+                    int64_t const *  IB,
+                    int64_t          nnz_B,
                     char *           C,
                     CTF_int::algstrct const * sr_C) const {
         csrmultd(m,n,k,(dtype_A const *)A,JA,IA,nnz_A,(dtype_B const *)B,JB,IB,nnz_B,(dtype_C *)C,sr_C);
@@ -360,17 +331,37 @@ namespace CTF {
                  int              k,
                  char const *     A,
                  int const *      JA,
-                 int const *      IA,
-                 int              nnz_A,
+                 int64_t const *  IA,
+                 int64_t          nnz_A,
                  char const *     B,
                  int const *      JB,
-                 int const *      IB,
-                 int              nnz_B,
+                 int64_t const *  IB,
+                 int64_t          nnz_B,
                  char *&          C_CSR,
                  CTF_int::algstrct const * sr_C) const {
         csrmultcsr(m,n,k,(dtype_A const *)A,JA,IA,nnz_A,(dtype_B const *)B, JB, IB, nnz_B, C_CSR, sr_C);
       }
 
+      void cmasked_csrmultcsr
+                (int              m,
+                 int              n,
+                 int              k,
+                 char const *     A,
+                 int const *      JA,
+                 int64_t const *  IA,
+                 int64_t          nnz_A,
+                 char const *     B,
+                 int const *      JB,
+                 int64_t const *  IB,
+                 int64_t          nnz_B,
+                 char *&          C_CSR,
+                 CTF_int::algstrct const * sr_C,
+                 int const *      JM,
+                 int64_t const *  IM,
+                 bool             is_mask_cmp) const {
+        csrmultcsr(m,n,k,(dtype_A const *)A,JA,IA,nnz_A,(dtype_B const *)B, JB, IB, nnz_B, C_CSR, sr_C, JM, IM, is_mask_cmp);
+      }
+
 
 
 
@@ -2,7 +2,9 @@
 
 #include "common.h"
 #include "schedule.h"
+#include "term_plan.h"
 #include "../summation/summation.h"
+#include "../contraction/contraction.h"
 
 using namespace CTF_int;
 
@@ -165,6 +167,50 @@ namespace CTF {
     idx_map = NULL;
   }
 
+  void contract_batch(int64_t            num,
+                      Idx_Tensor const * A,
+                      Idx_Tensor const * B,
+                      Idx_Tensor const * C){
+    if (num <= 0) return;
+    bool is_uniform = true;
+    for (int64_t i=0; i<num; i++){
+      if (A[i].parent == NULL || B[i].parent == NULL || C[i].parent == NULL){
+        printf("CTF ERROR: contract_batch needs tensor operands\n");
+        IASSERT(0);
+        return;
+      }
+      is_uniform = is_uniform &&
+        memcmp(A[i].idx_map, A[0].idx_map, A[0].parent->order) == 0 &&
+        memcmp(B[i].idx_map, B[0].idx_map, B[0].parent->order) == 0 &&
+        memcmp(C[i].idx_map, C[0].idx_map, C[0].parent->order) == 0 &&
+        A[i].sr->isequal(A[i].scale, A[0].scale) &&
+        B[i].sr->isequal(B[i].scale, B[0].scale) &&
+        C[i].sr->isequal(C[i].scale, C[0].scale);
+    }
+    if (is_uniform){
+      std::vector<tensor*> tA(num), tB(num), tC(num);
+      for (int64_t i=0; i<num; i++){
+        tA[i] = A[i].parent;
+        tB[i] = B[i].parent;
+        tC[i] = C[i].parent;
+      }
+      char * alpha = NULL;
+      C[0].sr->safemul(A[0].scale, B[0].scale, alpha);
+      CTF_int::contract_batch(num, &tA[0], A[0].idx_map, &tB[0], B[0].idx_map, alpha,
+                              &tC[0], C[0].idx_map, C[0].scale);
+      if (alpha != NULL) cdealloc(alpha);
+    } else {
+      for (int64_t i=0; i<num; i++){
+        char * alpha = NULL;
+        C[i].sr->safemul(A[i].scale, B[i].scale, alpha);
+        contraction ctr(A[i].parent, A[i].idx_map, B[i].parent, B[i].idx_map, alpha,
+                        C[i].parent, C[i].idx_map, C[i].scale);
+        ctr.execute();
+        if (alpha != NULL) cdealloc(alpha);
+      }
+    }
+  }
+
   Term * Idx_Tensor::clone(std::map<CTF_int::tensor*, CTF_int::tensor*>* remap) const {
     return new Idx_Tensor(*this, 0, remap);
   }
@@ -182,7 +228,7 @@ namespace CTF {
       if (sr->has_mul()){
         sr->safecopy(scale,sr->addid());
       } else {
-        this->parent->set_zero();
+        execute_term_zero(this->parent);
       }
       B.execute(*this);
       sr->safecopy(scale,sr->mulid());
@@ -197,7 +243,7 @@ namespace CTF {
       if (sr->has_mul()){
         sr->safecopy(scale,sr->addid());
       } else {
-        this->parent->set_zero();
+        execute_term_zero(this->parent);
       }
       B.execute(*this);
       sr->safecopy(scale,sr->mulid());
@@ -290,11 +336,11 @@ namespace CTF {
       if (ts.wrld->rank == 0) ts.sr->safecopy(data, scale);
       summation s(&ts, NULL, ts.sr->mulid(), 
                   output.parent, output.idx_map, output.scale);
-      s.execute();
+      execute_term_sum(s, true);
     } else {
       summation s(this->parent, idx_map, scale,
                   output.parent, output.idx_map, output.scale);
-      s.execute();
+      execute_term_sum(s);
 //      output.parent->sum(scale, *this->parent, idx_map,
   //                       output.scale, output.idx_map);
     } 
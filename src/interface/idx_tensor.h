@@ -154,6 +154,22 @@ namespace CTF {
       World * where_am_i() const;
   };
 
+  /**
+   * \brief contracts num triples of indexed tensors with identical indices and shapes,
+   *          C[i] = C[i].scale*C[i] + A[i].scale*B[i].scale*A[i]*B[i],
+   *        e.g. for A[i]=tA[i]["ik"], B[i]=tB[i]["kj"], C[i]=tC[i]["ij"] (whose scale is
+   *        one, so this accumulates as C[i] += A[i]*B[i]); if the scales also agree
+   *        across the batch, it is executed as by Tensor<dtype>::contract_batch
+   * \param[in] num number of contractions
+   * \param[in] A left operands
+   * \param[in] B right operands
+   * \param[in] C outputs
+   */
+  void contract_batch(int64_t            num,
+                      Idx_Tensor const * A,
+                      Idx_Tensor const * B,
+                      Idx_Tensor const * C);
+
   template<typename dtype>
   class Typ_Idx_Tensor;
 
@@ -1,7 +1,8 @@
 #ifndef __KERNEL_H__
 #define __KERNEL_H__
 
-#include "../sparse_formats/csr.h"
+#include "../sparse_formats/spgemm.h"
+#include "../sparse_formats/spmv.h"
 namespace CTF{
   #ifdef __CUDACC__
   #define NBLK 15
@@ -39,14 +40,14 @@ namespace CTF{
                    int             k,
                    dtype_A const * A,
                    int const *     JA,
-                   int const *     IA,
+                   int64_t const * IA,
                    dtype_B const * B,
                    dtype_C *       C){
     int bidx = blockIdx.x;
     int tidx = threadIdx.x;
     for (int col_B=bidx; col_B<n; col_B+=NBLK){
       for (int row_A=tidx; row_A<m; row_A+=NTRD){
-        for (int i_A=IA[row_A]-1; i_A<IA[row_A+1]-1; i_A++){
+        for (int64_t i_A=IA[row_A]-1; i_A<IA[row_A+1]-1; i_A++){
           int col_A = JA[i_A]-1;
           g(f(A[i_A],B[col_B*k+col_A]),C[col_B*m+row_A]);
         }
@@ -62,14 +63,14 @@ namespace CTF{
                    int             k,
                    dtype_A const * A,
                    int const *     JA,
-                   int const *     IA,
+                   int64_t const * IA,
                    dtype_B const * B,
                    dtype_C *       C){
     int bidx = blockIdx.x;
     int tidx = threadIdx.x;
     for (int col_B=bidx; col_B<n; col_B+=NBLK){
       for (int row_A=tidx; row_A<m; row_A+=NTRD){
-        for (int i_A=IA[row_A]-1; i_A<IA[row_A+1]-1; i_A++){
+        for (int64_t i_A=IA[row_A]-1; i_A<IA[row_A+1]-1; i_A++){
           int col_A = JA[i_A]-1;
           g(f(A[i_A],B[col_B*k+col_A]),C[col_B*m+row_A]);
         }
@@ -89,13 +90,13 @@ namespace CTF{
                      dtype_B const * B,
                      dtype_C *       C){
     int64_t nnz_A = ((int64_t*)all_data)[0];
-    int offset = 3*sizeof(int64_t);
+    int64_t offset = 4*sizeof(int64_t);
     if (offset % ALIGN != 0) offset += ALIGN-(offset%ALIGN);
     dtype_A const * A = (dtype_A const *)(all_data + offset);
     offset += nnz_A*sizeof(dtype_A);
     if (offset % ALIGN != 0) offset += ALIGN-(offset%ALIGN);
-    int const * IA = (int*)(all_data + offset); 
-    offset += (m+1)*sizeof(int);
+    int64_t const * IA = (int64_t*)(all_data + offset); 
+    offset += (m+1)*sizeof(int64_t);
     if (offset % ALIGN != 0) offset += ALIGN-(offset%ALIGN);
     int const * JA = (int*)(all_data + offset);
     cuda_csrmmf<dtype_A,dtype_B,dtype_C,f,g>(m,n,k,A,JA,IA,B,C);
@@ -105,6 +106,12 @@ namespace CTF{
 
   #endif
 
+  /** \brief rows and columns of the register tile of Bivar_Kernel::gemm */
+  #define KERNEL_GEMM_MR 4
+  #define KERNEL_GEMM_NR 4
+  /** \brief Bivar_Kernel::gemm calls with at most this many multiply-adds are not blocked */
+  #define KERNEL_GEMM_MIN_BLK 512
+
   template<typename dtype>
   #ifdef __CUDACC__
   __device__ __host__
@@ -167,14 +174,17 @@ namespace CTF{
 
 
 
-    static void gemm(char            tA,
-                     char            tB,
-                     int             m,
-                     int             n,
-                     int             k,
-                     dtype_A const * A,
-                     dtype_B const * B,
-                     dtype_C *       C){
+    /**
+     * \brief reference (unblocked) version of gemm below, C[i,j] = g(f(A[i,l],B[l,j]), C[i,j]) for l=0..k-1
+     */
+    static void gemm_ref(char            tA,
+                         char            tB,
+                         int             m,
+                         int             n,
+                         int             k,
+                         dtype_A const * A,
+                         dtype_B const * B,
+                         dtype_C *       C){
       int lda_A_m = tA == 'N' ? 1 : k;
       int lda_A_k = tA == 'N' ? m : 1;
       int lda_B_k = tB == 'N' ? 1 : n;
@@ -196,6 +206,30 @@ namespace CTF{
       }
     }
 
+    /**
+     * \brief C[i,j] = g(f(A[i,l],B[l,j]), C[i,j]) for l=0..k-1, where A is m-by-k
+     *        (k-by-m if tA='T') and B k-by-n (n-by-k if tB='T'), all column-major;
+     *        larger products go through CTF_int::blocked_gemm with a
+     *        KERNEL_GEMM_MR-by-KERNEL_GEMM_NR tile
+     */
+    static void gemm(char            tA,
+                     char            tB,
+                     int             m,
+                     int             n,
+                     int             k,
+                     dtype_A const * A,
+                     dtype_B const * B,
+                     dtype_C *       C){
+      if (((int64_t)m)*n*k <= KERNEL_GEMM_MIN_BLK){
+        gemm_ref(tA, tB, m, n, k, A, B, C);
+        return;
+      }
+      CTF_int::blocked_gemm<KERNEL_GEMM_MR,KERNEL_GEMM_NR>(tA, tB, m, n, k, A, B, C,
+        [](dtype_A a){ return a; },
+        [](dtype_A a, dtype_B b){ return f(a, b); },
+        [](dtype_C a, dtype_C & c){ g(a, c); });
+    }
+
 
     static void coomm(int             m,
                       int             n,
@@ -203,7 +237,7 @@ namespace CTF{
                       dtype_A const * A,
                       int const *     rows_A,
                       int const *     cols_A,
-                      int             nnz_A,
+                      int64_t         nnz_A,
                       dtype_B const * B,
                       dtype_C *       C){
       //TAU_FSTART(default_fcoomm);
@@ -235,11 +269,19 @@ namespace CTF{
                       int             k,
                       dtype_A const * A,
                       int const *     JA,
-                      int const *     IA,
+                      int64_t const * IA,
                       int64_t         nnz_A,
                       dtype_B const * B,
                       dtype_C *       C){
       //TAU_FSTART(3type_csrmm);
+      if (n == 1){
+        //sparse matrix times vector, with threads balanced over rows and nonzeros
+        CTF_int::spmv<dtype_A,dtype_B,dtype_C>(m, A, JA, IA, B, C,
+                      [](dtype_A a, dtype_B b){ return f(a,b); },
+                      [](dtype_C & acc, dtype_C b){ g(b,acc); },
+                      [](dtype_C & c, dtype_C acc){ g(acc,c); });
+        return;
+      }
 #ifdef _OPENMP
       #pragma omp parallel for
 #endif
@@ -248,7 +290,7 @@ namespace CTF{
         #pragma omp parallel for
 #endif
         for (int col_B=0; col_B<n; col_B++){
-          for (int i_A=IA[row_A]-1; i_A<IA[row_A+1]-1; i_A++){
+          for (int64_t i_A=IA[row_A]-1; i_A<IA[row_A+1]-1; i_A++){
             int col_A = JA[i_A]-1;
             g(f(A[i_A],B[col_B*k+col_A]),C[col_B*m+row_A]);
           }
@@ -276,20 +318,20 @@ namespace CTF{
                   int             k,
                   dtype_A const * A,
                   int const *     JA,
-                  int const *     IA,
-                  int             nnz_A,
+                  int64_t const * IA,
+                  int64_t         nnz_A,
                   dtype_B const * B,
                   int const *     JB,
-                  int const *     IB,
-                  int             nnz_B,
+                  int64_t const * IB,
+                  int64_t         nnz_B,
                   dtype_C *       C){
 #ifdef _OPENMP
       #pragma omp parallel for
 #endif
       for (int row_A=0; row_A<m; row_A++){
-        for (int i_A=IA[row_A]-1; i_A<IA[row_A+1]-1; i_A++){
+        for (int64_t i_A=IA[row_A]-1; i_A<IA[row_A+1]-1; i_A++){
           int row_B = JA[i_A]-1; //=col_A
-          for (int i_B=IB[row_B]-1; i_B<IB[row_B+1]-1; i_B++){
+          for (int64_t i_B=IB[row_B]-1; i_B<IB[row_B+1]-1; i_B++){
             int col_B = JB[i_B]-1;
             g(f(A[i_A],B[i_B]),C[col_B*m+row_A]);
           }
@@ -304,14 +346,14 @@ namespace CTF{
                int           k,
                dtype_A const * A,
                int const *   JA,
-               int const *   IA,
-               int           nnz_A,
+               int64_t const * IA,
+               int64_t       nnz_A,
                dtype_B const * B,
                int const *   JB,
-               int const *   IB,
-               int           nnz_B,
+               int64_t const * IB,
+               int64_t       nnz_B,
                char *&       C_CSR) const {
-      int * IC = (int*)CTF_int::alloc(sizeof(int)*(m+1));
+      int64_t * IC = (int64_t*)CTF_int::alloc(sizeof(int64_t)*(m+1));
       int * has_col = (int*)CTF_int::alloc(sizeof(int)*n);
       IC[0] = 1;
       for (int i=0; i<m; i++){
@@ -325,9 +367,7 @@ namespace CTF{
       CTF_int::CSR_Matrix C(IC[m]-1, m, n, sizeof(dtype_C));
       dtype_C * vC = (dtype_C*)C.vals();
       int * JC = C.JA();
-      memcpy(C.IA(), IC, sizeof(int)*(m+1));
-      CTF_int::cdealloc(IC);
-      IC = C.IA();
+      C.set_IA(IC);
       int64_t * rev_col = (int64_t*)CTF_int::alloc(sizeof(int64_t)*n);
       for (int i=0; i<m; i++){
         memset(has_col, 0, sizeof(int)*n);
@@ -343,9 +383,9 @@ namespace CTF{
         memset(has_col, 0, sizeof(int)*n);
         for (int j=0; j<IA[i+1]-IA[i]; j++){
           int row_B = JA[IA[i]+j-1]-1;
-          int idx_A = IA[i]+j-1;
+          int64_t idx_A = IA[i]+j-1;
           for (int l=0; l<IB[row_B+1]-IB[row_B]; l++){
-            int idx_B = IB[row_B]+l-1;
+            int64_t idx_B = IB[row_B]+l-1;
             if (has_col[JB[idx_B]-1])
               g(f(A[idx_A],B[idx_B]), vC[rev_col[JB[idx_B]-1]]);  
             else
@@ -362,6 +402,7 @@ namespace CTF{
         CTF_int::cdealloc(C.all_data);
         C_CSR = ans;
       }
+      CTF_int::cdealloc(IC);
       CTF_int::cdealloc(has_col);
       CTF_int::cdealloc(rev_col);
     }
@@ -372,96 +413,20 @@ namespace CTF{
                       int           k, 
                       dtype_A const * A, // A m by k
                       int const *   JA,
-                      int const *   IA,
-                      int           nnz_A,
+                      int64_t const * IA,
+                      int64_t       nnz_A,
                       dtype_B const * B, // B k by n
                       int const *   JB,
-                      int const *   IB,
-                      int           nnz_B,
-                      char *&       C_CSR) const {
-        //int *ic = (int*)Malloc(sizeof(int)*(m+1));
-        int * IC = (int*)CTF_int::alloc(sizeof(int)*(m+1));
-        memset(IC, 0, sizeof(int)*(m+1));
-#ifdef _OPENMP
-        #pragma omp parallel
-        {
-#endif
-          int * has_col = (int*)CTF_int::alloc(sizeof(int)*(n+1)); //n is the num of col of B
-          int nnz = 0;
-#ifdef _OPENMP
-          #pragma omp for schedule(dynamic) // TO DO test other strategies
-#endif         
-          for (int i=0; i<m; i++){
-            memset(has_col, 0, sizeof(int)*(n+1)); 
-            nnz = 0;
-            for (int j=0; j<IA[i+1]-IA[i]; j++){
-              int row_B = JA[IA[i]+j-1]-1;
-              for (int kk=0; kk<IB[row_B+1]-IB[row_B]; kk++){
-                int idx_B = IB[row_B]+kk-1;
-                if (has_col[JB[idx_B]] == 0){
-                  nnz++;
-                  has_col[JB[idx_B]] = 1;
-                }
-              }
-              IC[i+1]=nnz;
-            }
-          }
-          CTF_int::cdealloc(has_col);
-#ifdef _OPENMP
-        } // END PARALLEL 
-#endif 
-        int ic_prev = 1;
-        for(int i=0;i < m+1; i++){
-          ic_prev += IC[i];
-          IC[i] = ic_prev;
-        }
-        CTF_int::CSR_Matrix C(IC[m]-1, m, n, sizeof(dtype_C));
-        dtype_C * vC = (dtype_C*)C.vals();
-        int * JC = C.JA();
-        memcpy(C.IA(), IC, sizeof(int)*(m+1));
-        CTF_int::cdealloc(IC);
-        IC = C.IA();
-#ifdef _OPENMP
-        #pragma omp parallel
-        {
-#endif      
-          int ins = 0;
-          int *dcol = (int *) CTF_int::alloc(n*sizeof(int));
-          dtype_C *acc_data = (dtype_C *)CTF_int::alloc(n*sizeof (dtype_C));
-#ifdef _OPENMP
-          #pragma omp for
-#endif            
-          for (int i=0; i<m; i++){
-            memset(dcol, 0, sizeof(int)*(n));
-            ins = 0;
-            for (int j=0; j<IA[i+1]-IA[i]; j++){
-              int row_b = JA[IA[i]+j-1]-1; // 1-based
-              int idx_a = IA[i]+j-1;
-              for (int ii = 0; ii < IB[row_b+1]-IB[row_b]; ii++){
-                int col_b = IB[row_b]+ii-1;
-                int col_c = JB[col_b]-1; // 1-based
-//                    dtype_C val = fmul(A[idx_a], B[col_b]);
-                if (dcol[col_c] == 0){
-                    dcol[col_c] = JB[col_b];
-                    acc_data[col_c] =f(A[idx_a],B[col_b]);
-                } else {
-                    g(f(A[idx_a],B[col_b]), acc_data[col_c]);
-                }
-              }
-            }
-            for(int jj = 0; jj < n; jj++){
-              if (dcol[jj] != 0){
-                JC[IC[i]+ins-1] = dcol[jj];
-                vC[IC[i]+ins-1] = acc_data[jj];
-                ++ins;
-              }
-            }
-          }
-          CTF_int::cdealloc(dcol);
-          CTF_int::cdealloc(acc_data);
-#ifdef _OPENMP
-        } //PRAGMA END
-#endif
+                      int64_t const * IB,
+                      int64_t       nnz_B,
+                      char *&       C_CSR,
+                      int const *   JM=NULL,
+                      int64_t const * IM=NULL,
+                      bool          is_mask_cmp=false) const {
+        CTF_int::CSR_Matrix C(CTF_int::spgemm<dtype_A,dtype_B,dtype_C>(m, n, A, JA, IA, B, JB, IB,
+                                [](dtype_A a, dtype_B b){ return f(a,b); },
+                                [](dtype_C & acc, dtype_C b){ g(b,acc); },
+                                JM, IM, is_mask_cmp));
       CTF_int::CSR_Matrix C_in(C_CSR);
       if (C_CSR == NULL || C_in.nnz() == 0){
         C_CSR = C.all_data;
@@ -481,12 +446,12 @@ namespace CTF{
                   int          k,
                   char const * A,
                   int const *  JA,
-                  int const *  IA,
-                  int          nnz_A,
+                  int64_t const * IA,
+                  int64_t      nnz_A,
                   char const * B,
                   int const *  JB,
-                  int const *  IB,
-                  int          nnz_B,
+                  int64_t const * IB,
+                  int64_t      nnz_B,
                   char *       C,
                   CTF_int::algstrct const * sr_C) const {
       csrmultd(m,n,k,(dtype_A const *)A,JA,IA,nnz_A,(dtype_B const *)B,JB,IB,nnz_B,(dtype_C *)C);
@@ -498,23 +463,43 @@ namespace CTF{
                int          k,
                char const * A,
                int const *  JA,
-               int const *  IA,
-               int          nnz_A,
+               int64_t const * IA,
+               int64_t      nnz_A,
                char const * B,
                int const *  JB,
-               int const *  IB,
-               int          nnz_B,
+               int64_t const * IB,
+               int64_t      nnz_B,
                char *&      C_CSR,
                CTF_int::algstrct const * sr_C) const {
       csrmultcsr(m,n,k,(dtype_A const *)A,JA,IA,nnz_A,(dtype_B const *)B, JB, IB, nnz_B, C_CSR);
     }
 
+    void cmasked_csrmultcsr
+              (int          m,
+               int          n,
+               int          k,
+               char const * A,
+               int const *  JA,
+               int64_t const * IA,
+               int64_t      nnz_A,
+               char const * B,
+               int const *  JB,
+               int64_t const * IB,
+               int64_t      nnz_B,
+               char *&      C_CSR,
+               CTF_int::algstrct const * sr_C,
+               int const *  JM,
+               int64_t const * IM,
+               bool         is_mask_cmp) const {
+      csrmultcsr(m,n,k,(dtype_A const *)A,JA,IA,nnz_A,(dtype_B const *)B, JB, IB, nnz_B, C_CSR, JM, IM, is_mask_cmp);
+    }
+
     void ccsrmm(int          m,
                 int          n,
                 int          k,
                 char const * A,
                 int const *  JA,
-                int const *  IA,
+                int64_t const * IA,
                 int64_t      nnz_A,
                 char const * B,
                 char *       C,
@@ -563,7 +548,7 @@ namespace CTF{
                         int          k,
                         char const * A,
                         int const *  JA,
-                        int const *  IA,
+                        int64_t const * IA,
                         int64_t      nnz_A,
                         char const * B,
                         char *       C) const {
@@ -33,21 +33,33 @@ namespace CTF {
     }
     CSR_Matrix A(cA);
     CSR_Matrix B(cB);
-    int * ic;
     int m = A.nrow();
     int n = A.ncol();
+    //MKL uses 32-bit row pointers, so the sum must have fewer than 2^31 nonzeros
+    if (A.nnz()+B.nnz() > INT_MAX){
+      TAU_FSTOP(mkl_csr_add)
+      return CTF_int::algstrct::csr_add(cA, cB);
+    }
+    //blocks with 32-bit row pointers are passed to MKL directly
+    int * ia = A.IA32();
+    int * ib = B.IA32();
+    if (ia == NULL) ia = get_int_csr_ptrs(m, A.IA64());
+    if (ib == NULL) ib = get_int_csr_ptrs(m, B.IA64());
+    int * ic;
     alloc_ptr(sizeof(int)*(m+1), (void**)&ic);
     char tA = 'N';
     int job = 1;
     int sort = 1;
     double mlid = 1.0;
     int info;
-    CTF_BLAS::MKL_DCSRADD(&tA, &job, &sort, &m, &n, (double*)A.vals(), A.JA(), A.IA(), &mlid, (double*)B.vals(), B.JA(), B.IA(), NULL, NULL, ic, NULL, &info);
+    CTF_BLAS::MKL_DCSRADD(&tA, &job, &sort, &m, &n, (double*)A.vals(), A.JA(), ia, &mlid, (double*)B.vals(), B.JA(), ib, NULL, NULL, ic, NULL, &info);
     CSR_Matrix C(ic[m]-1, m, n, this->el_size);
-    memcpy(C.IA(), ic, sizeof(int)*(m+1));
-    cdealloc(ic);
     job = 2;
-    CTF_BLAS::MKL_DCSRADD(&tA, &job, &sort, &m, &n, (double*)A.vals(), A.JA(), A.IA(), &mlid, (double*)B.vals(), B.JA(), B.IA(), (double*)C.vals(), C.JA(), C.IA(), NULL, &info);
+    CTF_BLAS::MKL_DCSRADD(&tA, &job, &sort, &m, &n, (double*)A.vals(), A.JA(), ia, &mlid, (double*)B.vals(), B.JA(), ib, (double*)C.vals(), C.JA(), ic, NULL, &info);
+    C.set_IA(ic);
+    if (ia != A.IA32()) cdealloc(ia);
+    if (ib != B.IA32()) cdealloc(ib);
+    cdealloc(ic);
     TAU_FSTOP(mkl_csr_add)
     return C.all_data;
 #else
@@ -0,0 +1,352 @@
+#include "../sparse_formats/csf.h"
+
+namespace CTF_int {
+  /**
+   * \brief accumulates into acc the sum over the leaves below node f at level lvl of a CSF tree of the
+   *        value of the leaf times the Hadamard product of the rows of the matrices of the modes on
+   *        the path from node f to the leaf, including that of node f
+   * \param[in] cT CSF tree of the local entries of the tensor
+   * \param[in] lvl level of the node, at least one
+   * \param[in] f node at level lvl
+   * \param[in] R number of columns of the matrices
+   * \param[in] facs matrix of each level of the tree, stored by rows
+   * \param[in] bufs scratch space of R entries for each level
+   * \param[in,out] acc R partial sums
+   * \param[in] addid additive identity
+   * \param[in] fmul multiplication of the algebraic structure
+   * \param[in] fadd addition of the algebraic structure
+   */
+  template<typename dtype, typename fmul_t, typename fadd_t>
+  void mttkrp_csf_rec(CSF_Tensor const & cT,
+                      int                lvl,
+                      int64_t            f,
+                      int64_t            R,
+                      dtype * const *    facs,
+                      dtype *            bufs,
+                      dtype *            acc,
+                      dtype              addid,
+                      fmul_t             fmul,
+                      fadd_t             fadd){
+    dtype const * row = facs[lvl] + ((int64_t)cT.fids(lvl)[f])*R;
+    if (lvl == cT.order()-1){
+      dtype val = ((dtype const*)cT.vals())[f];
+      for (int64_t r=0; r<R; r++){
+        acc[r] = fadd(acc[r], fmul(val, row[r]));
+      }
+      return;
+    }
+    dtype * buf = bufs + lvl*R;
+    std::fill(buf, buf+R, addid);
+    int64_t const * fptr = cT.fptr(lvl);
+    for (int64_t g=fptr[f]; g<fptr[f+1]; g++){
+      mttkrp_csf_rec(cT, lvl+1, g, R, facs, bufs, buf, addid, fmul, fadd);
+    }
+    for (int64_t r=0; r<R; r++){
+      acc[r] = fadd(acc[r], fmul(buf[r], row[r]));
+    }
+  }
+
+  /**
+   * \brief renumbers the indices of the local entries of a tensor in each mode by their position among the distinct
+   *        indices of that mode held locally, so that only the rows of the matrices touched locally are stored
+   * \param[in] npair number of local entries
+   * \param[in,out] pairs (key, value) pairs of the local entries, whose keys are replaced by keys into a tensor of edge lengths clens
+   * \param[in] psz size of each pair
+   * \param[in] order order of the tensor
+   * \param[in] lens edge lengths of the tensor
+   * \param[out] uids distinct indices of each mode held locally in increasing order, allocated here
+   * \param[out] clens number of distinct indices of each mode held locally
+   */
+  inline void mttkrp_compact_keys(int64_t     npair,
+                                  char *      pairs,
+                                  int64_t     psz,
+                                  int         order,
+                                  int const * lens,
+                                  int64_t **  uids,
+                                  int *       clens){
+    int64_t stride[order];
+    stride[0] = 1;
+    for (int j=1; j<order; j++) stride[j] = stride[j-1]*lens[j-1];
+    int64_t * idx = (int64_t*)CTF_int::alloc(sizeof(int64_t)*std::max((int64_t)1, npair));
+    for (int j=0; j<order; j++){
+#ifdef _OPENMP
+      #pragma omp parallel for
+#endif
+      for (int64_t i=0; i<npair; i++){
+        idx[i] = (((int64_t const*)(pairs+i*psz))[0]/stride[j])%lens[j];
+      }
+      std::sort(idx, idx+npair);
+      clens[j] = std::unique(idx, idx+npair)-idx;
+      uids[j] = (int64_t*)CTF_int::alloc(sizeof(int64_t)*std::max(1, clens[j]));
+      memcpy(uids[j], idx, sizeof(int64_t)*clens[j]);
+    }
+    CTF_int::cdealloc(idx);
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (int64_t i=0; i<npair; i++){
+      int64_t * key = (int64_t*)(pairs+i*psz);
+      int64_t ckey = 0;
+      int64_t cstride = 1;
+      for (int j=0; j<order; j++){
+        int64_t ij = (key[0]/stride[j])%lens[j];
+        ckey += (std::lower_bound(uids[j], uids[j]+clens[j], ij)-uids[j])*cstride;
+        cstride *= clens[j];
+      }
+      key[0] = ckey;
+    }
+  }
+
+  /**
+   * \brief reads (rw='r') entries of A, or adds (rw='w') values to them, in collective calls passing at most max_count
+   *        entries of each process, so that the counts of entries exchanged between two processes fit in an int
+   * \param[in] A tensor
+   * \param[in] npair number of entries of this process
+   * \param[in] inds global indices of the entries
+   * \param[in,out] vals values read, or added in the semiring of A
+   * \param[in] rw 'r' to read or 'w' to add
+   * \param[in] max_count largest number of entries per call, lowered only by tests
+   */
+  template<typename dtype>
+  void mttkrp_rw_chunks(CTF::Tensor<dtype> * A,
+                        int64_t              npair,
+                        int64_t const *      inds,
+                        dtype *              vals,
+                        char                 rw,
+                        int64_t              max_count=max_int_count){
+    int64_t nchunk = (npair+max_count-1)/max_count;
+    MPI_Allreduce(MPI_IN_PLACE, &nchunk, 1, MPI_INT64_T, MPI_MAX, A->wrld->comm);
+    dtype mulid = ((dtype const*)A->sr->mulid())[0];
+    for (int64_t c=0; c<nchunk; c++){
+      int64_t st = std::min(npair, c*max_count);
+      int64_t n = std::min(npair, (c+1)*max_count)-st;
+      if (rw == 'r')
+        A->read(n, inds+st, vals+st);
+      else
+        A->write(n, mulid, mulid, inds+st, vals+st);
+    }
+  }
+
+  /**
+   * \brief accumulates into the rows of out the MTTKRP of the local entries of a tensor,
+   *        traversing the nonzeros of a sparse tensor as a CSF tree rooted at the output mode and
+   *        the entries of a dense tensor grouped by output row, so that each row is updated by one thread
+   * \param[in] is_sparse whether the pairs are the nonzeros of a sparse tensor
+   * \param[in] npair number of local entries
+   * \param[in,out] pairs (key, value) pairs of the local entries, sorted if needed by the CSF tree
+   * \param[in] order order of the tensor
+   * \param[in] lens edge lengths of the tensor
+   * \param[in] mo mode of the tensor at each level, mo[0] being the output mode
+   * \param[in] sr algebraic structure of the tensor
+   * \param[in] R number of columns of the matrices
+   * \param[in] facs matrix of the mode at each level but the first, stored by rows
+   * \param[in,out] out partial sums of the lens[mo[0]] rows of the output
+   * \param[in] fmul multiplication of the algebraic structure
+   * \param[in] fadd addition of the algebraic structure
+   */
+  template<typename dtype, typename fmul_t, typename fadd_t>
+  void mttkrp_local(bool              is_sparse,
+                    int64_t           npair,
+                    char *            pairs,
+                    int               order,
+                    int const *       lens,
+                    int const *       mo,
+                    algstrct const *  sr,
+                    int64_t           R,
+                    dtype * const *   facs,
+                    dtype *           out,
+                    fmul_t            fmul,
+                    fadd_t            fadd){
+    dtype addid = ((dtype const*)sr->addid())[0];
+    int64_t m = lens[mo[0]];
+    if (!is_sparse){
+      //every entry of a dense tensor is stored, so the rows of each entry are multiplied directly
+      int64_t psz = sr->pair_size();
+      int64_t stride[order];
+      stride[0] = 1;
+      for (int j=1; j<order; j++) stride[j] = stride[j-1]*lens[j-1];
+      int64_t * row_ptr = (int64_t*)CTF_int::alloc(sizeof(int64_t)*(m+1));
+      int64_t * perm = (int64_t*)CTF_int::alloc(sizeof(int64_t)*npair);
+      std::fill(row_ptr, row_ptr+m+1, 0);
+      for (int64_t i=0; i<npair; i++){
+        row_ptr[(((int64_t const*)(pairs+i*psz))[0]/stride[mo[0]])%m+1]++;
+      }
+      for (int64_t i=0; i<m; i++){
+        row_ptr[i+1] += row_ptr[i];
+      }
+      for (int64_t i=0; i<npair; i++){
+        perm[row_ptr[(((int64_t const*)(pairs+i*psz))[0]/stride[mo[0]])%m]++] = i;
+      }
+      for (int64_t i=m; i>0; i--){
+        row_ptr[i] = row_ptr[i-1];
+      }
+      row_ptr[0] = 0;
+#ifdef _OPENMP
+      #pragma omp parallel
+#endif
+      {
+        dtype * buf = (dtype*)CTF_int::alloc(sizeof(dtype)*R);
+#ifdef _OPENMP
+        #pragma omp for schedule(dynamic)
+#endif
+        for (int64_t row=0; row<m; row++){
+          dtype * acc = out + row*R;
+          for (int64_t t=row_ptr[row]; t<row_ptr[row+1]; t++){
+            char const * pair = pairs+perm[t]*psz;
+            int64_t key = ((int64_t const*)pair)[0];
+            dtype val = ((dtype const*)(pair+sizeof(int64_t)))[0];
+            std::fill(buf, buf+R, val);
+            for (int l=1; l<order; l++){
+              dtype const * frow = facs[l] + ((key/stride[mo[l]])%lens[mo[l]])*R;
+              for (int64_t r=0; r<R; r++){
+                buf[r] = fmul(buf[r], frow[r]);
+              }
+            }
+            for (int64_t r=0; r<R; r++){
+              acc[r] = fadd(acc[r], buf[r]);
+            }
+          }
+        }
+        CTF_int::cdealloc(buf);
+      }
+      CTF_int::cdealloc(row_ptr);
+      CTF_int::cdealloc(perm);
+      return;
+    }
+    //the CSF constructor expects pairs sorted by key if the modes are kept in order of significance
+    if (mo[0] == order-1){
+      CTF_int::PairIterator pi(sr, pairs);
+      pi.sort(npair);
+    }
+    CTF_int::CSF_Tensor cT(npair, order, lens, mo, pairs, sr);
+    int64_t nroot = cT.nfib(0);
+    int const * root_ids = cT.fids(0);
+    int64_t const * root_ptr = cT.fptr(0);
+    //each root fiber updates a distinct row of the output
+#ifdef _OPENMP
+    #pragma omp parallel
+#endif
+    {
+      dtype * bufs = (dtype*)CTF_int::alloc(sizeof(dtype)*order*R);
+#ifdef _OPENMP
+      #pragma omp for schedule(dynamic)
+#endif
+      for (int64_t f=0; f<nroot; f++){
+        dtype * acc = out + ((int64_t)root_ids[f])*R;
+        for (int64_t g=root_ptr[f]; g<root_ptr[f+1]; g++){
+          CTF_int::mttkrp_csf_rec(cT, 1, g, R, facs, bufs, acc, addid, fmul, fadd);
+        }
+      }
+      CTF_int::cdealloc(bufs);
+    }
+    CTF_int::cdealloc(cT.all_data);
+  }
+}
+
+namespace CTF {
+  template<typename dtype>
+  void MTTKRP(Tensor<dtype> * T, Tensor<dtype> ** mat_list, int mode){
+    int order = T->order;
+    if (order < 2 || mode < 0 || mode >= order){
+      printf("CTF ERROR: MTTKRP requires a tensor of order at least two and a mode of the tensor\n");
+      IASSERT(0);
+      return;
+    }
+    for (int j=0; j<order; j++){
+      if (T->sym[j] != NS){
+        printf("CTF ERROR: MTTKRP requires a nonsymmetric tensor\n");
+        IASSERT(0);
+        return;
+      }
+    }
+    if (T->sr->addid() == NULL || T->sr->mulid() == NULL){
+      printf("CTF ERROR: MTTKRP requires a tensor over an algebraic structure with addition and multiplication\n");
+      IASSERT(0);
+      return;
+    }
+    int64_t R = mat_list[0]->lens[1];
+    for (int j=0; j<order; j++){
+      if (mat_list[j]->order != 2 || mat_list[j]->is_sparse || mat_list[j]->sym[0] != NS ||
+          mat_list[j]->lens[0] != T->lens[j] || mat_list[j]->lens[1] != R ||
+          !mat_list[j]->sr->is_same_type(T->sr)){
+        printf("CTF ERROR: MTTKRP requires dense nonsymmetric matrices with as many rows as the length of the corresponding mode of the tensor and the same number of columns\n");
+        IASSERT(0);
+        return;
+      }
+    }
+
+    int64_t npair;
+    char * cpairs;
+    int ret;
+    if (T->is_sparse)
+      ret = T->CTF_int::tensor::read_local_nnz(&npair, &cpairs);
+    else
+      ret = T->CTF_int::tensor::read_local(&npair, &cpairs);
+    if (ret != CTF_int::SUCCESS){ printf("CTF ERROR: failed to read local data of tensor in MTTKRP\n"); IASSERT(0); return; }
+
+    //indices of the local entries are renumbered among those held locally in each mode
+    int64_t * uids[order];
+    int clens[order];
+    CTF_int::mttkrp_compact_keys(npair, cpairs, T->sr->pair_size(), order, T->lens, uids, clens);
+
+    //only the rows of the input matrices touched by the local entries are read, stored by rows
+    dtype * facs[order];
+    int mo[order];
+    mo[0] = mode;
+    for (int j=order-1, l=1; j>=0; j--){
+      if (j != mode) mo[l++] = j;
+    }
+    facs[0] = NULL;
+    for (int l=1; l<order; l++){
+      int j = mo[l];
+      int64_t nv = clens[j]*R;
+      int64_t * inds = (int64_t*)CTF_int::alloc(sizeof(int64_t)*std::max((int64_t)1, nv));
+      for (int64_t i=0; i<clens[j]; i++){
+        for (int64_t r=0; r<R; r++){
+          inds[i*R+r] = uids[j][i]+r*T->lens[j];
+        }
+      }
+      facs[l] = (dtype*)CTF_int::alloc(sizeof(dtype)*std::max((int64_t)1, nv));
+      CTF_int::mttkrp_rw_chunks<dtype>(mat_list[j], nv, inds, facs[l], 'r');
+      CTF_int::cdealloc(inds);
+    }
+
+    //partial sums of the output rows touched by the local entries of T
+    int64_t m = clens[mode];
+    dtype * out = (dtype*)CTF_int::alloc(sizeof(dtype)*std::max((int64_t)1, m*R));
+    std::fill(out, out+m*R, ((dtype const*)T->sr->addid())[0]);
+    if (npair > 0){
+      //the operators of the default semiring are applied directly, those of others through the algstrct
+      CTF::Semiring<dtype> const * dsr = dynamic_cast<CTF::Semiring<dtype> const *>(T->sr);
+      if (dsr != NULL && dsr->is_def){
+        CTF_int::mttkrp_local<dtype>(T->is_sparse, npair, cpairs, order, clens, mo, T->sr, R, facs, out,
+                                     [](dtype a, dtype b){ return a*b; },
+                                     [](dtype a, dtype b){ return a+b; });
+      } else {
+        CTF_int::algstrct const * sr = T->sr;
+        CTF_int::mttkrp_local<dtype>(T->is_sparse, npair, cpairs, order, clens, mo, T->sr, R, facs, out,
+                                     [=](dtype a, dtype b){ dtype c; sr->mul((char const*)&a, (char const*)&b, (char*)&c); return c; },
+                                     [=](dtype a, dtype b){ dtype c; sr->add((char const*)&a, (char const*)&b, (char*)&c); return c; });
+      }
+    }
+    if (cpairs != NULL) CTF_int::cdealloc(cpairs);
+    for (int l=1; l<order; l++){
+      CTF_int::cdealloc(facs[l]);
+    }
+
+    //the partial sums are added into the zeroed output matrix, which reduces them where its rows are stored
+    int64_t * inds = (int64_t*)CTF_int::alloc(sizeof(int64_t)*std::max((int64_t)1, m*R));
+    for (int64_t i=0; i<m; i++){
+      for (int64_t r=0; r<R; r++){
+        inds[i*R+r] = uids[mode][i]+r*T->lens[mode];
+      }
+    }
+    mat_list[mode]->set_zero();
+    CTF_int::mttkrp_rw_chunks<dtype>(mat_list[mode], m*R, inds, out, 'w');
+    CTF_int::cdealloc(inds);
+    CTF_int::cdealloc(out);
+    for (int j=0; j<order; j++){
+      CTF_int::cdealloc(uids[j]);
+    }
+  }
+}
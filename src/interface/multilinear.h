@@ -0,0 +1,34 @@
+#ifndef __MULTILINEAR_H__
+#define __MULTILINEAR_H__
+
+namespace CTF {
+  /**
+   * \addtogroup CTF
+   * @{
+   */
+
+  /**
+   * \brief computes the matricized tensor times Khatri-Rao product (MTTKRP) of an order-N tensor with N-1 matrices,
+   *        e.g. for N=3 and mode=0, M["ir"] = T["ijk"]*B["jr"]*C["kr"], with the Hadamard products over r
+   *        accumulated while traversing the local entries of T, so that no intermediate such as ["ijr"] is formed.
+   *        T is not redistributed. Each process reads only the rows of the input matrices indexed by its local
+   *        entries of T and adds its partial sums of the output rows it touches into the output matrix,
+   *        so neither the matrices nor the output are replicated and the matrices keep their own distribution.
+   *        Local nonzeros of sparse T are traversed as CSF trees rooted at the output mode, local entries of
+   *        dense T grouped by output row. Products and sums are taken in the semiring of T, whose additive
+   *        operator also reduces the partial sums.
+   * \param[in] T dense or sparse nonsymmetric tensor of order at least two over a structure with addition and multiplication
+   * \param[in,out] mat_list dense matrices of dimensions T->lens[j]-by-R for j=0,...,N-1,
+   *                mat_list[mode] is overwritten by the output
+   * \param[in] mode mode of T that is not contracted
+   */
+  template<typename dtype>
+  void MTTKRP(Tensor<dtype> * T, Tensor<dtype> ** mat_list, int mode);
+
+  /**
+   * @}
+   */
+}
+
+#include "multilinear.cxx"
+#endif
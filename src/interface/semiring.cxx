@@ -31,6 +31,28 @@ namespace CTF_int {
       }
       return;
     }
+    dtype ** ptrs_A = get_grp_ptrs(((int64_t)m)*k,l,A);
+    dtype ** ptrs_B = get_grp_ptrs(((int64_t)k)*n,l,B);
+    dtype ** ptrs_C = get_grp_ptrs(((int64_t)m)*n,l,C);
+    gemm_batch_ptrs<dtype>(taA, taB, l, m, n, k, alpha, ptrs_A, ptrs_B, beta, ptrs_C);
+    free(ptrs_A);
+    free(ptrs_B);
+    free(ptrs_C);
+  }
+
+  template <typename dtype>
+  void gemm_batch_ptrs(
+            char           taA,
+            char           taB,
+            int            l,
+            int            m,
+            int            n,
+            int            k,
+            dtype          alpha,
+            dtype   **     ptrs_A,
+            dtype   **     ptrs_B,
+            dtype          beta,
+            dtype   **     ptrs_C){
     int lda, ldb, ldc;
     ldc = m;
     if (taA == 'n' || taA == 'N'){
@@ -43,9 +65,6 @@ namespace CTF_int {
     } else {
       ldb = n;
     }
-    dtype ** ptrs_A = get_grp_ptrs(m*k,l,A);
-    dtype ** ptrs_B = get_grp_ptrs(k*n,l,B);
-    dtype ** ptrs_C = get_grp_ptrs(m*n,l,C);
     #if USE_SP_MKL
     int group_count = 1;
     int size_per_group = l;
@@ -55,9 +74,6 @@ namespace CTF_int {
       CTF_BLAS::gemm<dtype>(&taA,&taB,&m,&n,&k,&alpha, ptrs_A[i] ,&lda, ptrs_B[i] ,&ldb,&beta, ptrs_C[i] ,&ldc);
     }
     #endif
-    free(ptrs_A);
-    free(ptrs_B);
-    free(ptrs_C);
   }
 
 #define INST_GEMM_BATCH(dtype)            \
@@ -78,6 +94,24 @@ namespace CTF_int {
   INST_GEMM_BATCH(std::complex<double>)
 #undef INST_GEMM_BATCH
 
+#define INST_GEMM_BATCH_PTRS(dtype)            \
+  template void gemm_batch_ptrs<dtype>( char , \
+             char ,                            \
+             int ,                             \
+             int ,                             \
+             int ,                             \
+             int ,                             \
+             dtype ,                           \
+             dtype **,                         \
+             dtype **,                         \
+             dtype ,                           \
+             dtype **);
+  INST_GEMM_BATCH_PTRS(float)
+  INST_GEMM_BATCH_PTRS(double)
+  INST_GEMM_BATCH_PTRS(std::complex<float>)
+  INST_GEMM_BATCH_PTRS(std::complex<double>)
+#undef INST_GEMM_BATCH_PTRS
+
   template <typename dtype>
   void gemm(char           tA,
             char           tB,
@@ -326,7 +360,6 @@ namespace CTF_int {
   bool get_def_has_csrmm< std::complex<double> >(){ return true; }
 #endif
 */
-#if (USE_MKL!=1)
   template <typename dtype>
   void muladd_csrmm
                  (int           m,
@@ -335,12 +368,21 @@ namespace CTF_int {
                   dtype         alpha,
                   dtype const * A,
                   int const *   JA,
-                  int const *   IA,
-                  int           nnz_A,
+                  int64_t const * IA,
+                  int64_t       nnz_A,
                   dtype const * B,
                   dtype         beta,
                   dtype *       C){
     //TAU_FSTART(muladd_csrmm);
+    //matrix-vector products are balanced over rows and nonzeros, as rows of skewed length would starve threads of the row-parallel loop
+    if (n == 1){
+      default_scal<dtype>(m, beta, C, 1);
+      spmv<dtype,dtype,dtype>(m, A, JA, IA, B, C,
+                              [](dtype a, dtype b){ return a*b; },
+                              [](dtype & acc, dtype b){ acc += b; },
+                              [&](dtype & c, dtype acc){ c += alpha*acc; });
+      return;
+    }
 #ifdef USE_OMP
     #pragma omp parallel for
 #endif
@@ -351,10 +393,10 @@ namespace CTF_int {
       for (int col_B=0; col_B<n; col_B++){
         C[col_B*m+row_A] *= beta;
         if (IA[row_A] < IA[row_A+1]){
-          int i_A1 = IA[row_A]-1;
+          int64_t i_A1 = IA[row_A]-1;
           int col_A1 = JA[i_A1]-1;
           dtype tmp = A[i_A1]*B[col_B*k+col_A1];
-          for (int i_A=IA[row_A]; i_A<IA[row_A+1]-1; i_A++){
+          for (int64_t i_A=IA[row_A]; i_A<IA[row_A+1]-1; i_A++){
             int col_A = JA[i_A]-1;
             tmp += A[i_A]*B[col_B*k+col_A];
           }
@@ -372,21 +414,21 @@ namespace CTF_int {
                   int           k,
                   dtype const * A,
                   int const *   JA,
-                  int const *   IA,
-                  int           nnz_A,
+                  int64_t const * IA,
+                  int64_t       nnz_A,
                   dtype const * B,
                   int const *   JB,
-                  int const *   IB,
-                  int           nnz_B,
+                  int64_t const * IB,
+                  int64_t       nnz_B,
                   dtype *       C){
     //TAU_FSTART(muladd_csrmultd);
 #ifdef _OPENMP
     #pragma omp parallel for
 #endif
     for (int row_A=0; row_A<m; row_A++){
-      for (int i_A=IA[row_A]-1; i_A<IA[row_A+1]-1; i_A++){
+      for (int64_t i_A=IA[row_A]-1; i_A<IA[row_A+1]-1; i_A++){
         int row_B = JA[i_A]-1; //=col_A
-        for (int i_B=IB[row_B]-1; i_B<IB[row_B+1]-1; i_B++){
+        for (int64_t i_B=IB[row_B]-1; i_B<IB[row_B+1]-1; i_B++){
           int col_B = JB[i_B]-1;
           C[col_B*m+row_A] += A[i_A]*B[i_B];
         }
@@ -394,7 +436,6 @@ namespace CTF_int {
     }
     //TAU_FSTOP(muladd_csrmultd);
   }
-#endif
 }
 
 namespace CTF {
@@ -407,19 +448,22 @@ namespace CTF {
            float         alpha,
            float const * A,
            int const *   JA,
-           int const *   IA,
-           int           nnz_A,
+           int64_t const * IA,
+           int64_t       nnz_A,
            float const * B,
            float         beta,
            float *       C) const {
 #if USE_MKL
-    char transa = 'N';
-    char matdescra[6] = {'G',0,0,'F',0,0};
-    
-    CTF_BLAS::MKL_SCSRMM(&transa, &m, &n, &k, &alpha, matdescra, A, JA, IA, IA+1, B, &k, &beta, C, &m);
-#else
-    CTF_int::muladd_csrmm<float>(m,n,k,alpha,A,JA,IA,nnz_A,B,beta,C);
+    int * iIA = n == 1 ? NULL : CTF_int::get_int_csr_ptrs(m, IA);
+    if (iIA != NULL){
+      char transa = 'N';
+      char matdescra[6] = {'G',0,0,'F',0,0};
+      CTF_BLAS::MKL_SCSRMM(&transa, &m, &n, &k, &alpha, matdescra, A, JA, iIA, iIA+1, B, &k, &beta, C, &m);
+      cdealloc(iIA);
+      return;
+    }
 #endif
+    CTF_int::muladd_csrmm<float>(m,n,k,alpha,A,JA,IA,nnz_A,B,beta,C);
   }
 
   template <>
@@ -430,20 +474,24 @@ namespace CTF {
            double         alpha,
            double const * A,
            int const *    JA,
-           int const *    IA,
-           int            nnz_A,
+           int64_t const * IA,
+           int64_t        nnz_A,
            double const * B,
            double         beta,
            double *       C) const {
 #if USE_MKL
-    char transa = 'N';
-    char matdescra[6] = {'G',0,0,'F',0,0};
-    //TAU_FSTART(MKL_DCSRMM);
-    CTF_BLAS::MKL_DCSRMM(&transa, &m, &n, &k, &alpha, matdescra, A, JA, IA, IA+1, B, &k, &beta, C, &m);
-    //TAU_FSTOP(MKL_DCSRMM);
-#else
-    CTF_int::muladd_csrmm<double>(m,n,k,alpha,A,JA,IA,nnz_A,B,beta,C);
+    int * iIA = n == 1 ? NULL : CTF_int::get_int_csr_ptrs(m, IA);
+    if (iIA != NULL){
+      char transa = 'N';
+      char matdescra[6] = {'G',0,0,'F',0,0};
+      //TAU_FSTART(MKL_DCSRMM);
+      CTF_BLAS::MKL_DCSRMM(&transa, &m, &n, &k, &alpha, matdescra, A, JA, iIA, iIA+1, B, &k, &beta, C, &m);
+      //TAU_FSTOP(MKL_DCSRMM);
+      cdealloc(iIA);
+      return;
+    }
 #endif
+    CTF_int::muladd_csrmm<double>(m,n,k,alpha,A,JA,IA,nnz_A,B,beta,C);
   }
 
 
@@ -455,19 +503,22 @@ namespace CTF {
            std::complex<float>         alpha,
            std::complex<float> const * A,
            int const *                 JA,
-           int const *                 IA,
-           int                         nnz_A,
+           int64_t const *             IA,
+           int64_t                     nnz_A,
            std::complex<float> const * B,
            std::complex<float>         beta,
            std::complex<float> *       C) const {
 #if USE_MKL
-    char transa = 'N';
-    char matdescra[6] = {'G',0,0,'F',0,0};
-    
-    CTF_BLAS::MKL_CCSRMM(&transa, &m, &n, &k, &alpha, matdescra, A, JA, IA, IA+1, B, &k, &beta, C, &m);
-#else
-    CTF_int::muladd_csrmm< std::complex<float> >(m,n,k,alpha,A,JA,IA,nnz_A,B,beta,C);
+    int * iIA = n == 1 ? NULL : CTF_int::get_int_csr_ptrs(m, IA);
+    if (iIA != NULL){
+      char transa = 'N';
+      char matdescra[6] = {'G',0,0,'F',0,0};
+      CTF_BLAS::MKL_CCSRMM(&transa, &m, &n, &k, &alpha, matdescra, A, JA, iIA, iIA+1, B, &k, &beta, C, &m);
+      cdealloc(iIA);
+      return;
+    }
 #endif
+    CTF_int::muladd_csrmm< std::complex<float> >(m,n,k,alpha,A,JA,IA,nnz_A,B,beta,C);
   }
 
   template <>
@@ -478,88 +529,106 @@ namespace CTF {
            std::complex<double>         alpha,
            std::complex<double> const * A,
            int const *                  JA,
-           int const *                  IA,
-           int                          nnz_A,
+           int64_t const *              IA,
+           int64_t                      nnz_A,
            std::complex<double> const * B,
            std::complex<double>         beta,
            std::complex<double> *       C) const {
 #if USE_MKL
-    char transa = 'N';
-    char matdescra[6] = {'G',0,0,'F',0,0};
-    CTF_BLAS::MKL_ZCSRMM(&transa, &m, &n, &k, &alpha, matdescra, A, JA, IA, IA+1, B, &k, &beta, C, &m);
-#else
-    CTF_int::muladd_csrmm< std::complex<double> >(m,n,k,alpha,A,JA,IA,nnz_A,B,beta,C);
+    int * iIA = n == 1 ? NULL : CTF_int::get_int_csr_ptrs(m, IA);
+    if (iIA != NULL){
+      char transa = 'N';
+      char matdescra[6] = {'G',0,0,'F',0,0};
+      CTF_BLAS::MKL_ZCSRMM(&transa, &m, &n, &k, &alpha, matdescra, A, JA, iIA, iIA+1, B, &k, &beta, C, &m);
+      cdealloc(iIA);
+      return;
+    }
 #endif
+    CTF_int::muladd_csrmm< std::complex<double> >(m,n,k,alpha,A,JA,IA,nnz_A,B,beta,C);
   }
 
 
+  //reference implementation of default_csrmultd, used when MKL is unavailable or the matrices have too many nonzeros for its 32-bit row pointers
+  #define CSR_MULTD_REF(dtype) \
+    if (alpha != this->tmulid || beta != this->tmulid){ \
+      CTF_int::default_scal<dtype>(m*n, beta/alpha, C, 1); \
+    } \
+    CTF_int::muladd_csrmultd<dtype>(m,n,k,A,JA,IA,nnz_A,B,JB,IB,nnz_B,C); \
+    if (alpha != this->tmulid){ \
+      CTF_int::default_scal<dtype>(m*n, alpha, C, 1); \
+    }
+
 #if USE_MKL 
   #define CSR_MULTD_DEF(dtype,is_ord,MKL_name) \
   template<> \
   void CTF::Semiring<dtype,is_ord>::default_csrmultd \
-                 (int            m, \
-                  int            n, \
-                  int            k, \
-                  dtype          alpha, \
-                  dtype const *  A, \
-                  int const *    JA, \
-                  int const *    IA, \
-                  int            nnz_A, \
-                  dtype const *  B, \
-                  int const *    JB, \
-                  int const *    IB, \
-                  int            nnz_B, \
-                  dtype          beta, \
-                  dtype *        C) const { \
+                 (int             m, \
+                  int             n, \
+                  int             k, \
+                  dtype           alpha, \
+                  dtype const *   A, \
+                  int const *     JA, \
+                  int64_t const * IA, \
+                  int64_t         nnz_A, \
+                  dtype const *   B, \
+                  int const *     JB, \
+                  int64_t const * IB, \
+                  int64_t         nnz_B, \
+                  dtype           beta, \
+                  dtype *         C) const { \
     if (alpha == this->taddid){ \
       if (beta != this->tmulid) \
         CTF_int::default_scal<dtype>(m*n, beta, C, 1); \
       return; \
     } \
+    int * iIA = CTF_int::get_int_csr_ptrs(m, IA); \
+    int * iIB = CTF_int::get_int_csr_ptrs(k, IB); \
+    if (iIA == NULL || iIB == NULL){ \
+      if (iIA != NULL) cdealloc(iIA); \
+      if (iIB != NULL) cdealloc(iIB); \
+      CSR_MULTD_REF(dtype); \
+      return; \
+    } \
     char transa = 'N'; \
     if (beta == this->taddid){ \
-      CTF_BLAS::MKL_name(&transa, &m, &k, &n, A, JA, IA, B, JB, IB, C, &m); \
+      CTF_BLAS::MKL_name(&transa, &m, &k, &n, A, JA, iIA, B, JB, iIB, C, &m); \
       if (alpha != this->tmulid) \
         CTF_int::default_scal<dtype>(m*n, alpha, C, 1); \
     } else { \
       dtype * tmp_C_buf = (dtype*)alloc(sizeof(dtype)*m*n); \
-      CTF_BLAS::MKL_name(&transa, &m, &k, &n, A, JA, IA, B, JB, IB, tmp_C_buf, &m); \
+      CTF_BLAS::MKL_name(&transa, &m, &k, &n, A, JA, iIA, B, JB, iIB, tmp_C_buf, &m); \
       if (beta != this->tmulid) \
         CTF_int::default_scal<dtype>(m*n, beta, C, 1); \
       CTF_int::default_axpy<dtype>(m*n, alpha, tmp_C_buf, 1, C, 1); \
       cdealloc(tmp_C_buf); \
     } \
+    cdealloc(iIA); \
+    cdealloc(iIB); \
   }
 #else 
   #define CSR_MULTD_DEF(dtype,is_ord,MKL_name) \
   template<> \
   void CTF::Semiring<dtype,is_ord>::default_csrmultd \
-                 (int           m, \
-                  int           n, \
-                  int           k, \
-                  dtype         alpha, \
-                  dtype const * A, \
-                  int const *   JA, \
-                  int const *   IA, \
-                  int           nnz_A, \
-                  dtype const * B, \
-                  int const *   JB, \
-                  int const *   IB, \
-                  int           nnz_B, \
-                  dtype         beta, \
-                  dtype *       C) const { \
+                 (int             m, \
+                  int             n, \
+                  int             k, \
+                  dtype           alpha, \
+                  dtype const *   A, \
+                  int const *     JA, \
+                  int64_t const * IA, \
+                  int64_t         nnz_A, \
+                  dtype const *   B, \
+                  int const *     JB, \
+                  int64_t const * IB, \
+                  int64_t         nnz_B, \
+                  dtype           beta, \
+                  dtype *         C) const { \
     if (alpha == this->taddid){ \
       if (beta != this->tmulid) \
         CTF_int::default_scal<dtype>(m*n, beta, C, 1); \
       return; \
     } \
-    if (alpha != this->tmulid || beta != this->tmulid){ \
-      CTF_int::default_scal<dtype>(m*n, beta/alpha, C, 1); \
-    } \
-    CTF_int::muladd_csrmultd<dtype>(m,n,k,A,JA,IA,nnz_A,B,JB,IB,nnz_B,C); \
-    if (alpha != this->tmulid){ \
-      CTF_int::default_scal<dtype>(m*n, alpha, C, 1); \
-    } \
+    CSR_MULTD_REF(dtype); \
   } 
 #endif
 
@@ -573,20 +642,37 @@ namespace CTF {
   #define CSR_MULTCSR_DEF(dtype,is_ord,MKL_name) \
   template<> \
   void CTF::Semiring<dtype,is_ord>::default_csrmultcsr \
-                     (int           m, \
-                      int           n, \
-                      int           k, \
-                      dtype         alpha, \
-                      dtype const * A, \
-                      int const *   JA, \
-                      int const *   IA, \
-                      int           nnz_A, \
-                      dtype const * B, \
-                      int const *   JB, \
-                      int const *   IB, \
-                      int           nnz_B, \
-                      dtype         beta, \
-                      char *&       C_CSR) const { \
+                     (int             m, \
+                      int             n, \
+                      int             k, \
+                      dtype           alpha, \
+                      dtype const *   A, \
+                      int const *     JA, \
+                      int64_t const * IA, \
+                      int64_t         nnz_A, \
+                      dtype const *   B, \
+                      int const *     JB, \
+                      int64_t const * IB, \
+                      int64_t         nnz_B, \
+                      dtype           beta, \
+                      char *&         C_CSR) const { \
+    /* the number of products bounds the number of nonzeros in the output, which MKL indexes by 32-bit integers */ \
+    int64_t nprod = 0; \
+    for (int64_t i=0; i<nnz_A; i++){ \
+      nprod += IB[JA[i]]-IB[JA[i]-1]; \
+    } \
+    int * iIA = NULL; \
+    int * iIB = NULL; \
+    if (nprod <= INT_MAX){ \
+      iIA = CTF_int::get_int_csr_ptrs(m, IA); \
+      iIB = CTF_int::get_int_csr_ptrs(k, IB); \
+    } \
+    if (iIA == NULL || iIB == NULL){ \
+      if (iIA != NULL) cdealloc(iIA); \
+      if (iIB != NULL) cdealloc(iIB); \
+      this->gen_csrmultcsr(m,n,k,alpha,A,JA,IA,nnz_A,B,JB,IB,nnz_B,beta,C_CSR); \
+      return; \
+    } \
     char transa = 'N'; \
     CSR_Matrix C_in(C_CSR); \
  \
@@ -595,13 +681,15 @@ namespace CTF {
     int sort = 1;  \
     int req = 1; \
     int info; \
-    CTF_BLAS::MKL_name(&transa, &req, &sort, &m, &k, &n, A, JA, IA, B, JB, IB, NULL, NULL, new_ic, &req, &info); \
+    CTF_BLAS::MKL_name(&transa, &req, &sort, &m, &k, &n, A, JA, iIA, B, JB, iIB, NULL, NULL, new_ic, &req, &info); \
  \
     CSR_Matrix C_add(new_ic[m]-1, m, n, sizeof(dtype)); \
-    memcpy(C_add.IA(), new_ic, (m+1)*sizeof(int)); \
-    cdealloc(new_ic); \
     req = 2; \
-    CTF_BLAS::MKL_name(&transa, &req, &sort, &m, &k, &n, A, JA, IA, B, JB, IB, (dtype*)C_add.vals(), C_add.JA(), C_add.IA(), &req, &info); \
+    CTF_BLAS::MKL_name(&transa, &req, &sort, &m, &k, &n, A, JA, iIA, B, JB, iIB, (dtype*)C_add.vals(), C_add.JA(), new_ic, &req, &info); \
+    C_add.set_IA(new_ic); \
+    cdealloc(new_ic); \
+    cdealloc(iIA); \
+    cdealloc(iIB); \
  \
     if (beta == this->taddid){ \
       C_CSR = C_add.all_data; \
@@ -625,20 +713,20 @@ namespace CTF {
   #define CSR_MULTCSR_DEF(dtype,is_ord,MKL_name) \
   template<> \
   void CTF::Semiring<dtype,is_ord>::default_csrmultcsr \
-                     (int           m, \
-                      int           n, \
-                      int           k, \
-                      dtype         alpha, \
-                      dtype const * A, \
-                      int const *   JA, \
-                      int const *   IA, \
-                      int           nnz_A, \
-                      dtype const * B, \
-                      int const *   JB, \
-                      int const *   IB, \
-                      int           nnz_B, \
-                      dtype         beta, \
-                      char *&       C_CSR) const { \
+                     (int             m, \
+                      int             n, \
+                      int             k, \
+                      dtype           alpha, \
+                      dtype const *   A, \
+                      int const *     JA, \
+                      int64_t const * IA, \
+                      int64_t         nnz_A, \
+                      dtype const *   B, \
+                      int const *     JB, \
+                      int64_t const * IB, \
+                      int64_t         nnz_B, \
+                      dtype           beta, \
+                      char *&         C_CSR) const { \
     this->gen_csrmultcsr(m,n,k,alpha,A,JA,IA,nnz_A,B,JB,IB,nnz_B,beta,C_CSR); \
   }
 #endif
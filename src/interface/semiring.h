@@ -2,7 +2,8 @@
 #define __SEMIRING_H__
 
 #include "functions.h"
-#include "../sparse_formats/csr.h"
+#include "../sparse_formats/spgemm.h"
+#include "../sparse_formats/spmv.h"
 #include <iostream>
 
 using namespace std;
@@ -67,6 +68,182 @@ namespace CTF_int {
   void default_scal< std::complex<double> >
       (int n, std::complex<double> alpha, std::complex<double> * X, int incX);
 
+  /** \brief rows and columns of the register tile of default_gemm */
+  #define DEFAULT_GEMM_MR 4
+  #define DEFAULT_GEMM_NR 4
+  /** \brief cache blocking of blocked_gemm: panels of A are MC-by-KC, of B KC-by-NC */
+  #define DEFAULT_GEMM_MC 128
+  #define DEFAULT_GEMM_KC 256
+  #define DEFAULT_GEMM_NC 2048
+  /** \brief gemm calls with at most this many multiply-adds are not blocked */
+  #define DEFAULT_GEMM_MIN_BLK 512
+
+  /**
+   * \brief add(mul(A[i,p],B[p,j]), C[i,j]) for p=0..kc-1 on an mr-by-nr tile of C,
+   *        given packed slivers of A and B
+   * \param[in] kc number of packed columns of A and rows of B
+   * \param[in] mr number of rows in tile (at most MR)
+   * \param[in] nr number of columns in tile (at most NR)
+   * \param[in] pA sliver of A, element (i,p) at pA[p*MR+i]
+   * \param[in] pB sliver of B, element (p,j) at pB[p*NR+j]
+   * \param[in,out] C tile of C, element (i,j) at C[j*ldc+i]
+   * \param[in] ldc leading dimension of C
+   * \param[in] mul multiplication, dtype_C mul(dtype_A, dtype_B)
+   * \param[in] add accumulation into its second argument, void add(dtype_C, dtype_C&)
+   */
+  template <int MR, int NR, typename dtype_A, typename dtype_B, typename dtype_C, typename mul_t, typename add_t>
+  void blocked_gemm_micro(int             kc,
+                          int             mr,
+                          int             nr,
+                          dtype_A const * pA,
+                          dtype_B const * pB,
+                          dtype_C *       C,
+                          int64_t         ldc,
+                          mul_t           mul,
+                          add_t           add){
+    if (mr == MR && nr == NR){
+      //accumulate into a register tile initialized from C, since add need not have an identity
+      dtype_C acc[MR*NR];
+      for (int j=0; j<NR; j++){
+        for (int i=0; i<MR; i++){
+          acc[j*MR+i] = C[j*ldc+i];
+        }
+      }
+      for (int p=0; p<kc; p++){
+        for (int j=0; j<NR; j++){
+          dtype_B b = pB[p*NR+j];
+#ifdef _OPENMP
+          #pragma omp simd
+#endif
+          for (int i=0; i<MR; i++){
+            add(mul(pA[p*MR+i], b), acc[j*MR+i]);
+          }
+        }
+      }
+      for (int j=0; j<NR; j++){
+        for (int i=0; i<MR; i++){
+          C[j*ldc+i] = acc[j*MR+i];
+        }
+      }
+    } else {
+      for (int j=0; j<nr; j++){
+        for (int i=0; i<mr; i++){
+          dtype_C c = C[j*ldc+i];
+          for (int p=0; p<kc; p++){
+            add(mul(pA[p*MR+i], pB[p*NR+j]), c);
+          }
+          C[j*ldc+i] = c;
+        }
+      }
+    }
+  }
+
+  /**
+   * \brief C[i,j] = add(mul(pack_A(A[i,l]),B[l,j]), C[i,j]) for l=0..k-1, where A is
+   *        m-by-k (k-by-m if tA='T') and B k-by-n (n-by-k if tB='T'), all column-major.
+   *        Blocked for cache with packed panels of A and B (k in ascending order, so each
+   *        C[i,j] is accumulated in the same order as an unblocked loop), and for registers
+   *        with an MR-by-NR micro-kernel. Shared by default_gemm, tropical_gemm, and
+   *        Bivar_Kernel::gemm, which handle alpha/beta and small products themselves
+   * \param[in] pack_A applied to each element of A as it is packed, e.g. scaling by alpha
+   * \param[in] mul multiplication, dtype_C mul(dtype_A, dtype_B)
+   * \param[in] add accumulation into its second argument, void add(dtype_C, dtype_C&)
+   */
+  template <int MR, int NR, typename dtype_A, typename dtype_B, typename dtype_C, typename pack_t, typename mul_t, typename add_t>
+  void blocked_gemm(char            tA,
+                    char            tB,
+                    int             m,
+                    int             n,
+                    int             k,
+                    dtype_A const * A,
+                    dtype_B const * B,
+                    dtype_C *       C,
+                    pack_t          pack_A,
+                    mul_t           mul,
+                    add_t           add){
+    int64_t istride_A, lstride_A, jstride_B, lstride_B;
+    if (tA == 'N' || tA == 'n'){
+      istride_A=1;
+      lstride_A=m;
+    } else {
+      istride_A=k;
+      lstride_A=1;
+    }
+    if (tB == 'N' || tB == 'n'){
+      jstride_B=k;
+      lstride_B=1;
+    } else {
+      jstride_B=1;
+      lstride_B=n;
+    }
+    int kc_max = std::min(k, DEFAULT_GEMM_KC);
+    int mc_max = std::min(m, DEFAULT_GEMM_MC);
+    int nc_max = std::min(n, DEFAULT_GEMM_NC);
+    int mc_pad = ((mc_max+MR-1)/MR)*MR;
+    int nc_pad = ((nc_max+NR-1)/NR)*NR;
+    dtype_A * pA = (dtype_A*)CTF_int::alloc(sizeof(dtype_A)*mc_pad*kc_max);
+    dtype_B * pB = (dtype_B*)CTF_int::alloc(sizeof(dtype_B)*nc_pad*kc_max);
+    for (int jc=0; jc<n; jc+=DEFAULT_GEMM_NC){
+      int nc = std::min(DEFAULT_GEMM_NC, n-jc);
+      int nbr = (nc+NR-1)/NR;
+      for (int pc=0; pc<k; pc+=DEFAULT_GEMM_KC){
+        int kc = std::min(DEFAULT_GEMM_KC, k-pc);
+#ifdef _OPENMP
+        #pragma omp parallel for
+#endif
+        for (int jr=0; jr<nbr; jr++){
+          int nr = std::min(NR, nc-jr*NR);
+          dtype_B * pBs = pB + ((int64_t)jr)*NR*kc;
+          dtype_B const * Bs = B + pc*lstride_B + (jc+jr*NR)*jstride_B;
+          for (int p=0; p<kc; p++){
+            for (int j=0; j<nr; j++){
+              pBs[p*NR+j] = Bs[p*lstride_B+j*jstride_B];
+            }
+          }
+        }
+        for (int ic=0; ic<m; ic+=DEFAULT_GEMM_MC){
+          int mc = std::min(DEFAULT_GEMM_MC, m-ic);
+          int nbr_A = (mc+MR-1)/MR;
+#ifdef _OPENMP
+          #pragma omp parallel for
+#endif
+          for (int ir=0; ir<nbr_A; ir++){
+            int mr = std::min(MR, mc-ir*MR);
+            dtype_A * pAs = pA + ((int64_t)ir)*MR*kc;
+            dtype_A const * As = A + (ic+ir*MR)*istride_A + pc*lstride_A;
+            for (int p=0; p<kc; p++){
+              for (int i=0; i<mr; i++){
+                pAs[p*MR+i] = pack_A(As[i*istride_A+p*lstride_A]);
+              }
+            }
+          }
+#ifdef _OPENMP
+          #pragma omp parallel for collapse(2)
+#endif
+          for (int jr=0; jr<nbr; jr++){
+            for (int ir=0; ir<nbr_A; ir++){
+              blocked_gemm_micro<MR,NR>(kc,
+                                        std::min(MR, mc-ir*MR),
+                                        std::min(NR, nc-jr*NR),
+                                        pA + ((int64_t)ir)*MR*kc,
+                                        pB + ((int64_t)jr)*NR*kc,
+                                        C + ic + ir*MR + ((int64_t)(jc+jr*NR))*m,
+                                        m, mul, add);
+            }
+          }
+        }
+      }
+    }
+    CTF_int::cdealloc(pA);
+    CTF_int::cdealloc(pB);
+  }
+
+  /**
+   * \brief C = beta*C + alpha*A*B for element types without a BLAS, where A is m-by-k
+   *        (k-by-m if tA='T') and B k-by-n (n-by-k if tB='T'), all column-major;
+   *        C is not read if beta is zero. Larger products go through blocked_gemm
+   *        with a DEFAULT_GEMM_MR-by-DEFAULT_GEMM_NR tile, packing A prescaled by alpha
+   */
   template<typename dtype>
   void default_gemm(char          tA,
                     char          tB,
@@ -78,8 +255,7 @@ namespace CTF_int {
                     dtype const * B,
                     dtype         beta,
                     dtype *       C){
-    int i,j,l;
-    int istride_A, lstride_A, jstride_B, lstride_B;
+    int64_t istride_A, lstride_A, jstride_B, lstride_B;
     //TAU_FSTART(default_gemm);
     if (tA == 'N' || tA == 'n'){
       istride_A=1; 
@@ -95,14 +271,37 @@ namespace CTF_int {
       jstride_B=1; 
       lstride_B=n; 
     }
-    for (j=0; j<n; j++){
-      for (i=0; i<m; i++){
-        C[j*m+i] *= beta;
-        for (l=0; l<k; l++){
-          C[j*m+i] += alpha*A[istride_A*i+lstride_A*l]*B[lstride_B*l+jstride_B*j];
+    bool zero_beta = (beta == dtype(0));
+    if (((int64_t)m)*n*k <= DEFAULT_GEMM_MIN_BLK){
+      for (int j=0; j<n; j++){
+        for (int i=0; i<m; i++){
+          dtype c;
+          if (zero_beta) c = dtype(0);
+          else c = C[j*m+i]*beta;
+          for (int l=0; l<k; l++){
+            c += alpha*A[istride_A*i+lstride_A*l]*B[lstride_B*l+jstride_B*j];
+          }
+          C[j*m+i] = c;
+        }
+      }
+      return;
+    }
+    if (zero_beta || !(beta == dtype(1))){
+#ifdef _OPENMP
+      #pragma omp parallel for
+#endif
+      for (int j=0; j<n; j++){
+        for (int i=0; i<m; i++){
+          if (zero_beta) C[((int64_t)j)*m+i] = dtype(0);
+          else C[((int64_t)j)*m+i] *= beta;
         }
       }
     }
+    bool unit_alpha = (alpha == dtype(1));
+    blocked_gemm<DEFAULT_GEMM_MR,DEFAULT_GEMM_NR>(tA, tB, m, n, k, A, B, C,
+      [=](dtype a){ return unit_alpha ? a : alpha*a; },
+      [](dtype a, dtype b){ return a*b; },
+      [](dtype a, dtype & c){ c += a; });
     //TAU_FSTOP(default_gemm);
   }
 
@@ -114,7 +313,7 @@ namespace CTF_int {
 #ifdef USE_OMP
     #pragma omp parallel for
 #endif
-    for (int i=0; i<ngrp; i++){
+    for (int64_t i=0; i<ngrp; i++){
       data_ptrs[i] = ((dtype*)data)+i*grp_sz;
     }
     return data_ptrs;
@@ -134,6 +333,20 @@ namespace CTF_int {
             dtype          beta,
             dtype   *      C);
 
+  template <typename dtype>
+  void gemm_batch_ptrs(
+            char           taA,
+            char           taB,
+            int            l,
+            int            m,
+            int            n,
+            int            k,
+            dtype          alpha,
+            dtype   **     ptrs_A,
+            dtype   **     ptrs_B,
+            dtype          beta,
+            dtype   **     ptrs_C);
+
   template <typename dtype>
   void gemm(char           tA,
             char           tB,
@@ -224,8 +437,11 @@ namespace CTF_int {
         C[i] = C[i]*beta + alpha*A[i]*B[i];
       }
     } else {
-      for (int i=0; i<l; i++){
-        default_gemm<dtype>(taA, taB, m, n, k, alpha, A+i*m*k, B+i*k*n, beta, C+i*m*n);
+      int64_t sz_A = ((int64_t)m)*k;
+      int64_t sz_B = ((int64_t)k)*n;
+      int64_t sz_C = ((int64_t)m)*n;
+      for (int64_t i=0; i<l; i++){
+        default_gemm<dtype>(taA, taB, m, n, k, alpha, A+i*sz_A, B+i*sz_B, beta, C+i*sz_C);
       }
     }
   }
@@ -294,6 +510,49 @@ namespace CTF_int {
     CTF_int::gemm_batch< std::complex<double> >(taA, taB, l, m, n, k, alpha, A, B, beta, C);        
   }             
 
+  /**
+   * \brief batched gemm of matrices given by arrays of pointers via BLAS
+   * \return false if there is no BLAS routine for dtype (nothing is done)
+   */
+  template<typename dtype>
+  bool default_gemm_batch_ptrs
+                   (char     taA,
+                    char     taB,
+                    int      l,
+                    int      m,
+                    int      n,
+                    int      k,
+                    dtype    alpha,
+                    dtype ** A,
+                    dtype ** B,
+                    dtype    beta,
+                    dtype ** C){
+    return false;
+  }
+
+#define DEFAULT_GEMM_BATCH_PTRS(dtype)                                              \
+  template<>                                                                        \
+  inline bool default_gemm_batch_ptrs< dtype >                                      \
+                   (char     taA,                                                   \
+                    char     taB,                                                   \
+                    int      l,                                                     \
+                    int      m,                                                     \
+                    int      n,                                                     \
+                    int      k,                                                     \
+                    dtype    alpha,                                                 \
+                    dtype ** A,                                                     \
+                    dtype ** B,                                                     \
+                    dtype    beta,                                                  \
+                    dtype ** C){                                                    \
+    CTF_int::gemm_batch_ptrs< dtype >(taA, taB, l, m, n, k, alpha, A, B, beta, C);  \
+    return true;                                                                    \
+  }
+  DEFAULT_GEMM_BATCH_PTRS(float)
+  DEFAULT_GEMM_BATCH_PTRS(double)
+  DEFAULT_GEMM_BATCH_PTRS(std::complex<float>)
+  DEFAULT_GEMM_BATCH_PTRS(std::complex<double>)
+#undef DEFAULT_GEMM_BATCH_PTRS
+
   template <typename dtype>
   void default_coomm
                  (int           m,
@@ -339,6 +598,35 @@ namespace CTF_int {
   void default_coomm< std::complex<double> >
      (int,int,int,std::complex<double>,std::complex<double> const *,int const *,int const *,int,std::complex<double> const *,std::complex<double>,std::complex<double> *);
 
+  /**
+   * \brief calls a coordinate-format kernel, which takes a 32-bit number of nonzeros, on chunks of at most max_count nonzeros
+   * \param[in] fcoomm kernel computing C = beta*C + alpha*A*B
+   * \param[in] mulid multiplicative identity, by which C is scaled in all calls after the first
+   * \param[in] max_count largest number of nonzeros per call, lowered only by tests
+   */
+  template <typename dtype>
+  void coomm_chunks(void (*fcoomm)(int,int,int,dtype,dtype const*,int const*,int const*,int,dtype const*,dtype,dtype*),
+                    int           m,
+                    int           n,
+                    int           k,
+                    dtype         alpha,
+                    dtype const * A,
+                    int const *   rows_A,
+                    int const *   cols_A,
+                    int64_t       nnz_A,
+                    dtype const * B,
+                    dtype         beta,
+                    dtype         mulid,
+                    dtype *       C,
+                    int64_t       max_count=max_int_count){
+    int64_t i = 0;
+    do {
+      int nnz_chunk = (int)std::min(nnz_A-i, max_count);
+      fcoomm(m, n, k, alpha, A+i, rows_A+i, cols_A+i, nnz_chunk, B, i == 0 ? beta : mulid, C);
+      i += nnz_chunk;
+    } while (i < nnz_A);
+  }
+
 
 }
 
@@ -583,6 +871,22 @@ namespace CTF {
         }
       }
 
+      void gemm_batch_ptrs(char                 tA,
+                           char                 tB,
+                           int                  l,
+                           int                  m,
+                           int                  n,
+                           int                  k,
+                           char const *         alpha,
+                           char const * const * A,
+                           char const * const * B,
+                           char const *         beta,
+                           char * const *       C) const {
+        if (!is_def || !CTF_int::default_gemm_batch_ptrs<dtype>(tA, tB, l, m, n, k, ((dtype const *)alpha)[0], (dtype**)A, (dtype**)B, ((dtype const *)beta)[0], (dtype**)C)){
+          CTF_int::algstrct::gemm_batch_ptrs(tA, tB, l, m, n, k, alpha, A, B, beta, C);
+        }
+      }
+
       void offload_gemm(char         tA,
                         char         tB,
                         int          m,
@@ -604,7 +908,8 @@ namespace CTF {
 
       void coomm(int m, int n, int k, char const * alpha, char const * A, int const * rows_A, int const * cols_A, int64_t nnz_A, char const * B, char const * beta, char * C, CTF_int::bivar_function const * func) const {
         if (func == NULL && alpha != NULL && fcoomm != NULL){
-          fcoomm(m, n, k, ((dtype const *)alpha)[0], (dtype const *)A, rows_A, cols_A, nnz_A, (dtype const *)B, ((dtype const *)beta)[0], (dtype *)C);
+          //the kernel takes a 32-bit number of nonzeros, so larger blocks are multiplied by chunks of nonzeros
+          CTF_int::coomm_chunks<dtype>(fcoomm, m, n, k, ((dtype const *)alpha)[0], (dtype const *)A, rows_A, cols_A, nnz_A, (dtype const *)B, ((dtype const *)beta)[0], tmulid, (dtype *)C);
           return;
         }
         if (func == NULL && alpha != NULL && this->isequal(beta,mulid())){
@@ -628,18 +933,32 @@ namespace CTF {
       }
 
 
-      void default_csrmm
+      void gen_csrmm
                      (int           m,
                       int           n,
                       int           k,
                       dtype         alpha,
                       dtype const * A,
                       int const *   JA,
-                      int const *   IA,
-                      int           nnz_A,
+                      int64_t const * IA,
+                      int64_t       nnz_A,
                       dtype const * B,
                       dtype         beta,
                       dtype *       C) const {
+        if (n == 1){
+#ifdef _OPENMP
+          #pragma omp parallel for
+#endif
+          for (int row_A=0; row_A<m; row_A++){
+            C[row_A] = this->fmul(beta,C[row_A]);
+          }
+          //sparse matrix times vector, with threads balanced over rows and nonzeros
+          CTF_int::spmv<dtype,dtype,dtype>(m, A, JA, IA, B, C,
+                        [&](dtype a, dtype b){ return this->fmul(a,b); },
+                        [&](dtype & acc, dtype b){ acc = this->fadd(acc,b); },
+                        [&](dtype & c, dtype acc){ c = this->fadd(c,this->fmul(alpha,acc)); });
+          return;
+        }
 #ifdef _OPENMP
         #pragma omp parallel for
 #endif
@@ -650,10 +969,10 @@ namespace CTF {
           for (int col_B=0; col_B<n; col_B++){
             C[col_B*m+row_A] = this->fmul(beta,C[col_B*m+row_A]);
             if (IA[row_A] < IA[row_A+1]){
-              int i_A1 = IA[row_A]-1;
+              int64_t i_A1 = IA[row_A]-1;
               int col_A1 = JA[i_A1]-1;
               dtype tmp = this->fmul(A[i_A1],B[col_B*k+col_A1]);
-              for (int i_A=IA[row_A]; i_A<IA[row_A+1]-1; i_A++){
+              for (int64_t i_A=IA[row_A]; i_A<IA[row_A+1]-1; i_A++){
                 int col_A = JA[i_A]-1;
                 tmp = this->fadd(tmp, this->fmul(A[i_A],B[col_B*k+col_A]));
               }
@@ -663,6 +982,21 @@ namespace CTF {
         }
       }
 
+      void default_csrmm
+                     (int           m,
+                      int           n,
+                      int           k,
+                      dtype         alpha,
+                      dtype const * A,
+                      int const *   JA,
+                      int64_t const * IA,
+                      int64_t       nnz_A,
+                      dtype const * B,
+                      dtype         beta,
+                      dtype *       C) const {
+        this->gen_csrmm(m,n,k,alpha,A,JA,IA,nnz_A,B,beta,C);
+      }
+
 //      void (*fcsrmultd)(int,int,int,dtype const*,int const*,int const*,dtype const*,int const*, int const*,dtype*,int);
 
       /** \brief sparse version of gemm using CSR format for A */
@@ -672,7 +1006,7 @@ namespace CTF {
                  char const * alpha,
                  char const * A,
                  int const *  JA,
-                 int const *  IA,
+                 int64_t const * IA,
                  int64_t      nnz_A,
                  char const * B,
                  char const * beta,
@@ -680,7 +1014,11 @@ namespace CTF {
                  CTF_int::bivar_function const * func) const {
         assert(!this->has_coo_ker);
         assert(func == NULL);
-        this->default_csrmm(m,n,k,((dtype*)alpha)[0],(dtype*)A,JA,IA,nnz_A,(dtype*)B,((dtype*)beta)[0],(dtype*)C);
+        if (is_def){
+          this->default_csrmm(m,n,k,((dtype*)alpha)[0],(dtype*)A,JA,IA,nnz_A,(dtype*)B,((dtype*)beta)[0],(dtype*)C);
+        } else {
+          this->gen_csrmm(m,n,k,((dtype*)alpha)[0],(dtype*)A,JA,IA,nnz_A,(dtype*)B,((dtype*)beta)[0],(dtype*)C);
+        }
       }
 
       void default_csrmultd
@@ -690,12 +1028,12 @@ namespace CTF {
                       dtype         alpha,
                       dtype const * A,
                       int const *   JA,
-                      int const *   IA,
-                      int           nnz_A,
+                      int64_t const * IA,
+                      int64_t       nnz_A,
                       dtype const * B,
                       int const *   JB,
-                      int const *   IB,
-                      int           nnz_B,
+                      int64_t const * IB,
+                      int64_t       nnz_B,
                       dtype         beta,
                       dtype *       C) const {
         
@@ -706,9 +1044,9 @@ namespace CTF {
         #pragma omp parallel for
 #endif
         for (int row_A=0; row_A<m; row_A++){
-          for (int i_A=IA[row_A]-1; i_A<IA[row_A+1]-1; i_A++){
+          for (int64_t i_A=IA[row_A]-1; i_A<IA[row_A+1]-1; i_A++){
             int row_B = JA[i_A]-1; //=col_A
-            for (int i_B=IB[row_B]-1; i_B<IB[row_B+1]-1; i_B++){
+            for (int64_t i_B=IB[row_B]-1; i_B<IB[row_B+1]-1; i_B++){
               int col_B = JB[i_B]-1;
               if (!this->isequal((char const*)&alpha, this->mulid()))
                 this->fadd(C[col_B*m+row_A], this->fmul(alpha,this->fmul(A[i_A],B[i_B])));
@@ -726,97 +1064,21 @@ namespace CTF {
                       dtype         alpha,
                       dtype const * A, // A m by k
                       int const *   JA,
-                      int const *   IA,
-                      int           nnz_A,
+                      int64_t const * IA,
+                      int64_t       nnz_A,
                       dtype const * B, // B k by n
                       int const *   JB,
-                      int const *   IB,
-                      int           nnz_B,
+                      int64_t const * IB,
+                      int64_t       nnz_B,
                       dtype         beta,
-                      char *&       C_CSR) const {
-        int * IC = (int*)CTF_int::alloc(sizeof(int)*(m+1));
-        memset(IC, 0, sizeof(int)*(m+1));
-#ifdef _OPENMP
-        #pragma omp parallel
-        {
-#endif
-          int * has_col = (int*)CTF_int::alloc(sizeof(int)*(n+1)); //n is the num of col of B
-          int nnz = 0;
-#ifdef _OPENMP
-          #pragma omp for schedule(dynamic) // TO DO test other strategies
-#endif         
-          for (int i=0; i<m; i++){
-            memset(has_col, 0, sizeof(int)*(n+1)); 
-            nnz = 0;
-            for (int j=0; j<IA[i+1]-IA[i]; j++){
-              int row_B = JA[IA[i]+j-1]-1;
-              for (int kk=0; kk<IB[row_B+1]-IB[row_B]; kk++){
-                int idx_B = IB[row_B]+kk-1;
-                if (has_col[JB[idx_B]] == 0){
-                  nnz++;
-                  has_col[JB[idx_B]] = 1;
-                }
-              }
-              IC[i+1]=nnz;
-            }
-          }
-          CTF_int::cdealloc(has_col);
-#ifdef _OPENMP
-        } // END PARALLEL 
-#endif 
-        int ic_prev = 1;
-        for(int i=0;i < m+1; i++){
-          ic_prev += IC[i];
-          IC[i] = ic_prev;
-        }
-        CTF_int::CSR_Matrix C(IC[m]-1, m, n, sizeof(dtype));
-        dtype * vC = (dtype*)C.vals();
-        this->set((char *)vC, this->addid(), IC[m]+1);
-        int * JC = C.JA();
-        memcpy(C.IA(), IC, sizeof(int)*(m+1));
-        CTF_int::cdealloc(IC);
-        IC = C.IA();
-#ifdef _OPENMP        
-        #pragma omp parallel
-        {
-#endif      
-          int ins = 0;
-          int *dcol = (int *) CTF_int::alloc(n*sizeof(int));
-          dtype *acc_data = (dtype*)CTF_int::alloc(n*sizeof (dtype));
-#ifdef _OPENMP
-          #pragma omp for
-#endif            
-          for (int i=0; i<m; i++){
-            std::fill(acc_data, acc_data+n, this->taddid); 
-            memset(dcol, 0, sizeof(int)*(n));
-            ins = 0;
-            for (int j=0; j<IA[i+1]-IA[i]; j++){
-              int row_b = JA[IA[i]+j-1]-1; // 1-based
-              int idx_a = IA[i]+j-1;
-              for (int ii = 0; ii < IB[row_b+1]-IB[row_b]; ii++){
-                int col_b = IB[row_b]+ii-1;
-                int col_c = JB[col_b]-1; // 1-based
-                dtype val = fmul(A[idx_a], B[col_b]);
-                if (dcol[col_c] == 0){
-                  dcol[col_c] = JB[col_b];
-                }
-                //acc_data[col_c] += val;
-                acc_data[col_c]= this->fadd(acc_data[col_c], val);
-              }
-            }
-            for(int jj = 0; jj < n; jj++){
-              if (dcol[jj] != 0){
-                JC[IC[i]+ins-1] = dcol[jj];
-                vC[IC[i]+ins-1] = acc_data[jj];
-                ++ins;
-              }
-            }
-          }
-          CTF_int::cdealloc(dcol);
-          CTF_int::cdealloc(acc_data);
-#ifdef _OPENMP
-        } //PRAGMA END
-#endif  
+                      char *&       C_CSR,
+                      int const *   JM=NULL,
+                      int64_t const * IM=NULL,
+                      bool          is_mask_cmp=false) const {
+        CTF_int::CSR_Matrix C(CTF_int::spgemm<dtype,dtype,dtype>(m, n, A, JA, IA, B, JB, IB,
+                                [&](dtype a, dtype b){ return this->fmul(a,b); },
+                                [&](dtype & acc, dtype b){ acc = this->fadd(acc,b); },
+                                JM, IM, is_mask_cmp));
         CTF_int::CSR_Matrix C_in(C_CSR);
         if (!this->isequal((char const *)&alpha, this->mulid())){
           this->scal(C.nnz(), (char const *)&alpha, C.vals(), 1);
@@ -841,15 +1103,15 @@ namespace CTF {
                       dtype         alpha,
                       dtype const * A,
                       int const *   JA,
-                      int const *   IA,
-                      int           nnz_A,
+                      int64_t const * IA,
+                      int64_t       nnz_A,
                       dtype const * B,
                       int const *   JB,
-                      int const *   IB,
-                      int           nnz_B,
+                      int64_t const * IB,
+                      int64_t       nnz_B,
                       dtype         beta,
                       char *&       C_CSR) const {
-        int * IC = (int*)CTF_int::alloc(sizeof(int)*(m+1));
+        int64_t * IC = (int64_t*)CTF_int::alloc(sizeof(int64_t)*(m+1));
         int * has_col = (int*)CTF_int::alloc(sizeof(int)*n);
         IC[0] = 1;
         for (int i=0; i<m; i++){
@@ -864,7 +1126,7 @@ namespace CTF {
         dtype * vC = (dtype*)C.vals();
         this->set((char *)vC, this->addid(), IC[m]-1);
         int * JC = C.JA();
-        memcpy(C.IA(), IC, sizeof(int)*(m+1));
+        memcpy(C.IA(), IC, sizeof(int64_t)*(m+1));
         CTF_int::cdealloc(IC);
         IC = C.IA();
         int64_t * rev_col = (int64_t*)CTF_int::alloc(sizeof(int64_t)*n);
@@ -881,9 +1143,9 @@ namespace CTF {
           }
           for (int j=0; j<IA[i+1]-IA[i]; j++){
             int row_B = JA[IA[i]+j-1]-1;
-            int idx_A = IA[i]+j-1;
+            int64_t idx_A = IA[i]+j-1;
             for (int l=0; l<IB[row_B+1]-IB[row_B]; l++){
-              int idx_B = IB[row_B]+l-1;
+              int64_t idx_B = IB[row_B]+l-1;
               dtype tmp = fmul(A[idx_A],B[idx_B]);
               vC[(rev_col[JB[idx_B]-1])] = this->fadd(vC[(rev_col[JB[idx_B]-1])], tmp);
             }
@@ -915,12 +1177,12 @@ namespace CTF {
                       dtype         alpha,
                       dtype const * A,
                       int const *   JA,
-                      int const *   IA,
-                      int           nnz_A,
+                      int64_t const * IA,
+                      int64_t       nnz_A,
                       dtype const * B,
                       int const *   JB,
-                      int const *   IB,
-                      int           nnz_B,
+                      int64_t const * IB,
+                      int64_t       nnz_B,
                       dtype         beta,
                       char *&       C_CSR) const {
         this->gen_csrmultcsr(m,n,k,alpha,A,JA,IA,nnz_A,B,JB,IB,nnz_B,beta,C_CSR);
@@ -934,11 +1196,11 @@ namespace CTF {
                  char const * alpha,
                  char const * A,
                  int const *  JA,
-                 int const *  IA,
+                 int64_t const * IA,
                  int64_t      nnz_A,
                  char const * B,
                  int const *  JB,
-                 int const *  IB,
+                 int64_t const * IB,
                  int64_t      nnz_B,
                  char const * beta,
                  char *       C) const {
@@ -953,11 +1215,11 @@ namespace CTF {
                  char const * alpha,
                  char const * A,
                  int const *  JA,
-                 int const *  IA,
+                 int64_t const * IA,
                  int64_t      nnz_A,
                  char const * B,
                  int const *  JB,
-                 int const *  IB,
+                 int64_t const * IB,
                  int64_t      nnz_B,
                  char const * beta,
                  char *&      C_CSR) const {
@@ -969,38 +1231,60 @@ namespace CTF {
         }
       }
 
+
+      void masked_csrmultcsr
+                (int          m,
+                 int          n,
+                 int          k,
+                 char const * alpha,
+                 char const * A,
+                 int const *  JA,
+                 int64_t const * IA,
+                 int64_t      nnz_A,
+                 char const * B,
+                 int const *  JB,
+                 int64_t const * IB,
+                 int64_t      nnz_B,
+                 char const * beta,
+                 char *&      C_CSR,
+                 int const *  JM,
+                 int64_t const * IM,
+                 bool         is_mask_cmp) const {
+        this->gen_csrmultcsr(m,n,k,((dtype const*)alpha)[0],(dtype const*)A,JA,IA,nnz_A,(dtype const*)B,JB,IB,nnz_B,((dtype const*)beta)[0],C_CSR,JM,IM,is_mask_cmp);
+      }
+
   };
   /**
    * @}
    */
 
   template <>
-  void CTF::Semiring<float,1>::default_csrmm(int,int,int,float,float const *,int const *,int const *,int,float const *,float,float *) const;
+  void CTF::Semiring<float,1>::default_csrmm(int,int,int,float,float const *,int const *,int64_t const *,int64_t,float const *,float,float *) const;
   template <>
-  void CTF::Semiring<double,1>::default_csrmm(int,int,int,double,double const *,int const *,int const *,int,double const *,double,double *) const;
+  void CTF::Semiring<double,1>::default_csrmm(int,int,int,double,double const *,int const *,int64_t const *,int64_t,double const *,double,double *) const;
   template <>
-  void CTF::Semiring<std::complex<float>,0>::default_csrmm(int,int,int,std::complex<float>,std::complex<float> const *,int const *,int const *,int,std::complex<float> const *,std::complex<float>,std::complex<float> *) const;
+  void CTF::Semiring<std::complex<float>,0>::default_csrmm(int,int,int,std::complex<float>,std::complex<float> const *,int const *,int64_t const *,int64_t,std::complex<float> const *,std::complex<float>,std::complex<float> *) const;
   template <>
-  void CTF::Semiring<std::complex<double>,0>::default_csrmm(int,int,int,std::complex<double>,std::complex<double> const *,int const *,int const *,int,std::complex<double> const *,std::complex<double>,std::complex<double> *) const;
+  void CTF::Semiring<std::complex<double>,0>::default_csrmm(int,int,int,std::complex<double>,std::complex<double> const *,int const *,int64_t const *,int64_t,std::complex<double> const *,std::complex<double>,std::complex<double> *) const;
 
 
   template <>
-  void CTF::Semiring<float,1>::default_csrmultd(int,int,int,float,float const *,int const *,int const *,int,float const *,int const *,int const *,int,float,float *) const;
+  void CTF::Semiring<float,1>::default_csrmultd(int,int,int,float,float const *,int const *,int64_t const *,int64_t,float const *,int const *,int64_t const *,int64_t,float,float *) const;
   template <>
-  void CTF::Semiring<double,1>::default_csrmultd(int,int,int,double,double const *,int const *,int const *,int,double const *,int const *,int const *,int,double,double *) const;
+  void CTF::Semiring<double,1>::default_csrmultd(int,int,int,double,double const *,int const *,int64_t const *,int64_t,double const *,int const *,int64_t const *,int64_t,double,double *) const;
   template <>
-  void CTF::Semiring<std::complex<float>,0>::default_csrmultd(int,int,int,std::complex<float>,std::complex<float> const *,int const *,int const *,int,std::complex<float> const *,int const *,int const *,int,std::complex<float>,std::complex<float> *) const;
+  void CTF::Semiring<std::complex<float>,0>::default_csrmultd(int,int,int,std::complex<float>,std::complex<float> const *,int const *,int64_t const *,int64_t,std::complex<float> const *,int const *,int64_t const *,int64_t,std::complex<float>,std::complex<float> *) const;
   template <>
-  void CTF::Semiring<std::complex<double>,0>::default_csrmultd(int,int,int,std::complex<double>,std::complex<double> const *,int const *,int const *,int,std::complex<double> const *,int const *,int const *,int,std::complex<double>,std::complex<double> *) const;
+  void CTF::Semiring<std::complex<double>,0>::default_csrmultd(int,int,int,std::complex<double>,std::complex<double> const *,int const *,int64_t const *,int64_t,std::complex<double> const *,int const *,int64_t const *,int64_t,std::complex<double>,std::complex<double> *) const;
 
   template <>
-  void CTF::Semiring<float,1>::default_csrmultcsr(int,int,int,float,float const *,int const *,int const *,int,float const *,int const *,int const *,int,float,char *&) const;
+  void CTF::Semiring<float,1>::default_csrmultcsr(int,int,int,float,float const *,int const *,int64_t const *,int64_t,float const *,int const *,int64_t const *,int64_t,float,char *&) const;
   template <>
-  void CTF::Semiring<double,1>::default_csrmultcsr(int,int,int,double,double const *,int const *,int const *,int,double const *,int const *,int const *,int,double,char *&) const;
+  void CTF::Semiring<double,1>::default_csrmultcsr(int,int,int,double,double const *,int const *,int64_t const *,int64_t,double const *,int const *,int64_t const *,int64_t,double,char *&) const;
   template <>
-  void CTF::Semiring<std::complex<float>,0>::default_csrmultcsr(int,int,int,std::complex<float>,std::complex<float> const *,int const *,int const *,int,std::complex<float> const *,int const *,int const *,int,std::complex<float>,char *&) const;
+  void CTF::Semiring<std::complex<float>,0>::default_csrmultcsr(int,int,int,std::complex<float>,std::complex<float> const *,int const *,int64_t const *,int64_t,std::complex<float> const *,int const *,int64_t const *,int64_t,std::complex<float>,char *&) const;
   template <>
-  void CTF::Semiring<std::complex<double>,0>::default_csrmultcsr(int,int,int,std::complex<double>,std::complex<double> const *,int const *,int const *,int,std::complex<double> const *,int const *,int const *,int,std::complex<double>,char *&) const;
+  void CTF::Semiring<std::complex<double>,0>::default_csrmultcsr(int,int,int,std::complex<double>,std::complex<double> const *,int const *,int64_t const *,int64_t,std::complex<double> const *,int const *,int64_t const *,int64_t,std::complex<double>,char *&) const;
 
 
   template<> 
@@ -1022,4 +1306,5 @@ namespace CTF {
   void CTF::Semiring<std::complex<double>,0>::offload_gemm(char,char,int,int,int,char const *,char const *,char const *,char const *,char *) const;
 }
 #include "ring.h"
+#include "tropical.h"
 #endif
@@ -1,6 +1,7 @@
 #include "set.h"
 #include "../shared/blas_symbs.h"
 #include "../shared/util.h"
+#include "../sparse_formats/csr.h"
 
 
 namespace CTF_int {
@@ -66,43 +67,48 @@ namespace CTF_int {
   }
 #endif
 
-  bool try_mkl_coo_to_csr(int64_t nz, int nrow, char * csr_vs, int * csr_ja, int * csr_ia, char const * coo_vs, int const * coo_rs, int const * coo_cs, int el_size){
+  bool try_mkl_coo_to_csr(int64_t nz, int nrow, char * csr_vs, int * csr_ja, int64_t * csr_ia, char const * coo_vs, int const * coo_rs, int const * coo_cs, int el_size){
 #if USE_MKL
+    //MKL uses 32-bit row pointers, so larger matrices are converted by seq_coo_to_csr
+    if (nz > INT_MAX || (el_size != 4 && el_size != 8 && el_size != 16)) return false;
+    int * ia = (int*)alloc(sizeof(int)*(nrow+1));
     switch (el_size){
       case 4:
-        def_coo_to_csr_fl(nz,nrow,(float*)csr_vs,csr_ja,csr_ia,(float*)coo_vs,(int*)coo_rs,(int*)coo_cs,1);
-        return true; 
+        def_coo_to_csr_fl(nz,nrow,(float*)csr_vs,csr_ja,ia,(float*)coo_vs,(int*)coo_rs,(int*)coo_cs,1);
         break;
       case 8:
-        def_coo_to_csr_dbl(nz,nrow,(double*)csr_vs,csr_ja,csr_ia,(double*)coo_vs,(int*)coo_rs,(int*)coo_cs,1);
-        return true; 
+        def_coo_to_csr_dbl(nz,nrow,(double*)csr_vs,csr_ja,ia,(double*)coo_vs,(int*)coo_rs,(int*)coo_cs,1);
         break;
       case 16:
-        def_coo_to_csr_cdbl(nz,nrow,(std::complex<double>*)csr_vs,csr_ja,csr_ia,(std::complex<double>*)coo_vs,(int*)coo_rs,(int*)coo_cs,1);
-        return true; 
+        def_coo_to_csr_cdbl(nz,nrow,(std::complex<double>*)csr_vs,csr_ja,ia,(std::complex<double>*)coo_vs,(int*)coo_rs,(int*)coo_cs,1);
         break;
     } 
+    set_csr_ptrs(nrow, ia, csr_ia);
+    cdealloc(ia);
+    return true;
 #endif
     return false;
   }
 
 
-  bool try_mkl_csr_to_coo(int64_t nz, int nrow, char const * csr_vs, int const * csr_ja, int const * csr_ia, char * coo_vs, int * coo_rs, int * coo_cs, int el_size){
+  bool try_mkl_csr_to_coo(int64_t nz, int nrow, char const * csr_vs, int const * csr_ja, int64_t const * csr_ia, char * coo_vs, int * coo_rs, int * coo_cs, int el_size){
 #if USE_MKL
+    if (el_size != 4 && el_size != 8 && el_size != 16) return false;
+    int * ia = get_int_csr_ptrs(nrow, csr_ia);
+    if (ia == NULL) return false;
     switch (el_size){
       case 4:
-        def_coo_to_csr_fl(nz,nrow,(float*)csr_vs,(int*)csr_ja,(int*)csr_ia,(float*)coo_vs,coo_rs,coo_cs,0);
-        return true; 
+        def_coo_to_csr_fl(nz,nrow,(float*)csr_vs,(int*)csr_ja,ia,(float*)coo_vs,coo_rs,coo_cs,0);
         break;
       case 8:
-        def_coo_to_csr_dbl(nz,nrow,(double*)csr_vs,(int*)csr_ja,(int*)csr_ia,(double*)coo_vs,coo_rs,coo_cs,0);
-        return true; 
+        def_coo_to_csr_dbl(nz,nrow,(double*)csr_vs,(int*)csr_ja,ia,(double*)coo_vs,coo_rs,coo_cs,0);
         break;
       case 16:
-        def_coo_to_csr_cdbl(nz,nrow,(std::complex<double>*)csr_vs,(int*)csr_ja,(int*)csr_ia,(std::complex<double>*)coo_vs,coo_rs,coo_cs,0);
-        return true; 
+        def_coo_to_csr_cdbl(nz,nrow,(std::complex<double>*)csr_vs,(int*)csr_ja,ia,(std::complex<double>*)coo_vs,coo_rs,coo_cs,0);
         break;
     } 
+    cdealloc(ia);
+    return true;
 #endif
     return false;
   }
@@ -9,60 +9,86 @@
 namespace CTF_int {
 
   //does conversion using MKL function if it is available
-  bool try_mkl_coo_to_csr(int64_t nz, int nrow, char * csr_vs, int * csr_ja, int * csr_ia, char const * coo_vs, int const * coo_rs, int const * coo_cs, int el_size);
+  bool try_mkl_coo_to_csr(int64_t nz, int nrow, char * csr_vs, int * csr_ja, int64_t * csr_ia, char const * coo_vs, int const * coo_rs, int const * coo_cs, int el_size);
   
-  bool try_mkl_csr_to_coo(int64_t nz, int nrow, char const * csr_vs, int const * csr_ja, int const * csr_ia, char * coo_vs, int * coo_rs, int * coo_cs, int el_size);
+  bool try_mkl_csr_to_coo(int64_t nz, int nrow, char const * csr_vs, int const * csr_ja, int64_t const * csr_ia, char * coo_vs, int * coo_rs, int * coo_cs, int el_size);
 
-  template <typename dtype>  
-  void seq_coo_to_csr(int64_t nz, int nrow, dtype * csr_vs, int * csr_ja, int * csr_ia, dtype const * coo_vs, int const * coo_rs, int const * coo_cs){
-    int sz = sizeof(dtype);
-    if (sz == 4 || sz == 8 || sz == 16){
-      bool b = try_mkl_coo_to_csr(nz, nrow, (char*)csr_vs, csr_ja, csr_ia, (char const*)coo_vs, coo_rs, coo_cs, sz);
-      if (b) return;
-    }
-    csr_ia[0] = 1;
-#ifdef _OPENMP
-    #pragma omp parallel for
-#endif
-    for (int i=1; i<nrow+1; i++){
-      csr_ia[i] = 0;
-    }
-    for (int64_t i=0; i<nz; i++){
-      csr_ia[coo_rs[i]]++;
-    }
-    for (int i=0; i<nrow; i++){
-      csr_ia[i+1] += csr_ia[i];
-    }
+  /**
+   * \brief sorts the nonzeros of a COO matrix by row and then column into the values and column indices of a CSR matrix
+   * \param[in] nz number of nonzeros
+   * \param[out] csr_vs values of CSR matrix
+   * \param[out] csr_ja column indices of CSR matrix
+   * \param[in,out] perm buffer of nz indices (may alias csr_ja if idx_t is int)
+   * \param[in] coo_vs values of COO matrix
+   * \param[in] coo_rs row indices of COO matrix
+   * \param[in] coo_cs column indices of COO matrix
+   */
+  template <typename idx_t, typename dtype>
+  void sort_coo_to_csr(int64_t nz, dtype * csr_vs, int * csr_ja, idx_t * perm, dtype const * coo_vs, int const * coo_rs, int const * coo_cs){
 #ifdef _OPENMP
     #pragma omp parallel for
 #endif
     for (int64_t i=0; i<nz; i++){
-      csr_ja[i] = i;
+      perm[i] = i;
     }
 
     class comp_ref {
       public:
         int const * a;
         comp_ref(int const * a_){ a = a_; }
-        bool operator()(int u, int v){ 
+        bool operator()(idx_t u, idx_t v){ 
           return a[u] < a[v];
         }
     };
 
     comp_ref crc(coo_cs);
-    std::sort(csr_ja, csr_ja+nz, crc);
+    std::sort(perm, perm+nz, crc);
     comp_ref crr(coo_rs);
-    std::stable_sort(csr_ja, csr_ja+nz, crr);
+    std::stable_sort(perm, perm+nz, crr);
 #ifdef _OPENMP
     #pragma omp parallel for
 #endif
     for (int64_t i=0; i<nz; i++){
-      csr_vs[i] = coo_vs[csr_ja[i]];
-      csr_ja[i] = coo_cs[csr_ja[i]];
+      csr_vs[i] = coo_vs[perm[i]];
+      csr_ja[i] = coo_cs[perm[i]];
     }
   }
+
+  /**
+   * \brief sequential COO to CSR conversion, nonzeros are sorted through a 32-bit permutation when there are at most
+   *        max_count of them (lowered only by tests) and through a 64-bit one otherwise
+   */
   template <typename dtype>  
-  void seq_csr_to_coo(int64_t nz, int nrow, dtype const * csr_vs, int const * csr_ja, int const * csr_ia, dtype * coo_vs, int * coo_rs, int * coo_cs){
+  void seq_coo_to_csr(int64_t nz, int nrow, dtype * csr_vs, int * csr_ja, int64_t * csr_ia, dtype const * coo_vs, int const * coo_rs, int const * coo_cs, int64_t max_count=CTF_int::max_int_count){
+    int sz = sizeof(dtype);
+    if (sz == 4 || sz == 8 || sz == 16){
+      bool b = try_mkl_coo_to_csr(nz, nrow, (char*)csr_vs, csr_ja, csr_ia, (char const*)coo_vs, coo_rs, coo_cs, sz);
+      if (b) return;
+    }
+    csr_ia[0] = 1;
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (int i=1; i<nrow+1; i++){
+      csr_ia[i] = 0;
+    }
+    for (int64_t i=0; i<nz; i++){
+      csr_ia[coo_rs[i]]++;
+    }
+    for (int i=0; i<nrow; i++){
+      csr_ia[i+1] += csr_ia[i];
+    }
+    if (nz <= max_count){
+      //the permutation sorting the nonzeros is built in place of the column indices
+      sort_coo_to_csr<int,dtype>(nz, csr_vs, csr_ja, csr_ja, coo_vs, coo_rs, coo_cs);
+    } else {
+      int64_t * perm = (int64_t*)CTF_int::alloc(sizeof(int64_t)*nz);
+      sort_coo_to_csr<int64_t,dtype>(nz, csr_vs, csr_ja, perm, coo_vs, coo_rs, coo_cs);
+      CTF_int::cdealloc(perm);
+    }
+  }
+  template <typename dtype>  
+  void seq_csr_to_coo(int64_t nz, int nrow, dtype const * csr_vs, int const * csr_ja, int64_t const * csr_ia, dtype * coo_vs, int * coo_rs, int * coo_cs){
     int sz = sizeof(dtype);
     if (sz == 4 || sz == 8 || sz == 16){
       bool b = try_mkl_csr_to_coo(nz, nrow, (char const*)csr_vs, csr_ja, csr_ia, (char*)coo_vs, coo_rs, coo_cs, sz);
@@ -76,12 +102,12 @@ namespace CTF_int {
   }
 
   template <typename dtype>  
-  void def_coo_to_csr(int64_t nz, int nrow, dtype * csr_vs, int * csr_ja, int * csr_ia, dtype const * coo_vs, int const * coo_rs, int const * coo_cs){
+  void def_coo_to_csr(int64_t nz, int nrow, dtype * csr_vs, int * csr_ja, int64_t * csr_ia, dtype const * coo_vs, int const * coo_rs, int const * coo_cs){
     seq_coo_to_csr<dtype>(nz, nrow, csr_vs, csr_ja, csr_ia, coo_vs, coo_rs, coo_cs);
   }
 
   template <typename dtype>  
-  void def_csr_to_coo(int64_t nz, int nrow, dtype const * csr_vs, int const * csr_ja, int const * csr_ia, dtype * coo_vs, int * coo_rs, int * coo_cs){
+  void def_csr_to_coo(int64_t nz, int nrow, dtype const * csr_vs, int const * csr_ja, int64_t const * csr_ia, dtype * coo_vs, int * coo_rs, int * coo_cs){
     seq_csr_to_coo<dtype>(nz, nrow, csr_vs, csr_ja, csr_ia, coo_vs, coo_rs, coo_cs);
   }
 
@@ -282,6 +308,10 @@ namespace CTF {
         return tmdtype;        
       }
 
+      std::type_info const & el_type() const {
+        return typeid(dtype);
+      }
+
       void min(char const * a, 
                char const * b,
                char *       c) const {
@@ -320,6 +350,10 @@ namespace CTF {
         return 0.0;
       }
 
+      void widen(int64_t n, CTF_int::algstrct const * sr_A, char const * a, char * b) const {
+        CTF_int::algstrct::widen(n, sr_A, a, b);
+      }
+
       int64_t cast_to_int(char const * c) const {
         printf("CTF ERROR: int cast not possible for this algebraic structure\n");
         assert(0);
@@ -343,11 +377,11 @@ namespace CTF {
         return true;
       }
 
-      void coo_to_csr(int64_t nz, int nrow, char * csr_vs, int * csr_ja, int * csr_ia, char const * coo_vs, int const * coo_rs, int const * coo_cs) const {
+      void coo_to_csr(int64_t nz, int nrow, char * csr_vs, int * csr_ja, int64_t * csr_ia, char const * coo_vs, int const * coo_rs, int const * coo_cs) const {
         CTF_int::def_coo_to_csr(nz, nrow, (dtype *)csr_vs, csr_ja, csr_ia, (dtype const *) coo_vs, coo_rs, coo_cs);
       }
 
-      void csr_to_coo(int64_t nz, int nrow, char const * csr_vs, int const * csr_ja, int const * csr_ia, char * coo_vs, int * coo_rs, int * coo_cs) const {
+      void csr_to_coo(int64_t nz, int nrow, char const * csr_vs, int const * csr_ja, int64_t const * csr_ia, char * coo_vs, int * coo_rs, int * coo_cs) const {
         CTF_int::def_csr_to_coo(nz, nrow, (dtype const *)csr_vs, csr_ja, csr_ia, (dtype*) coo_vs, coo_rs, coo_cs);
       }
 
@@ -446,6 +480,30 @@ namespace CTF {
     ((std::complex<long double>*)c)[0] = (std::complex<long double>)d;
   }
 
+  template <>  
+  inline void Set<double>::widen(int64_t n, CTF_int::algstrct const * sr_A, char const * a, char * b) const {
+    if (sr_A->mdtype() == MPI_FLOAT){
+#ifdef _OPENMP
+      #pragma omp parallel for if (n > 65536)
+#endif
+      for (int64_t i=0; i<n; i++){
+        ((double*)b)[i] = (double)((float const*)a)[i];
+      }
+    } else CTF_int::algstrct::widen(n, sr_A, a, b);
+  }
+
+  template <>  
+  inline void Set< std::complex<double>,false >::widen(int64_t n, CTF_int::algstrct const * sr_A, char const * a, char * b) const {
+    if (sr_A->mdtype() == MPI_COMPLEX){
+#ifdef _OPENMP
+      #pragma omp parallel for if (n > 65536)
+#endif
+      for (int64_t i=0; i<n; i++){
+        ((std::complex<double>*)b)[i] = (std::complex<double>)((std::complex<float> const*)a)[i];
+      }
+    } else CTF_int::algstrct::widen(n, sr_A, a, b);
+  }
+
   template <>  
   inline double Set<float>::cast_to_double(char const * c) const {
     return (double)(((float*)c)[0]);
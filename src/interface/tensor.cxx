@@ -389,6 +389,12 @@ namespace CTF {
     CTF_int::tensor::set_name(name_);
   }
 
+  template<typename dtype>
+  void Tensor<dtype>::set_csf(bool is_csf_, int const * mode_order) {
+    int ret = CTF_int::tensor::set_csf(is_csf_, mode_order);
+    if (ret != CTF_int::SUCCESS){ printf("CTF ERROR: failed to execute function set_csf\n"); IASSERT(0); return; }
+  }
+
   template<typename dtype>
   void Tensor<dtype>::profile_on() {
     CTF_int::tensor::profile_on();
@@ -878,6 +884,114 @@ namespace CTF {
     ctr.execute();
   }
 
+  template<typename dtype>
+  void Tensor<dtype>::contract(dtype                       alpha,
+                               CTF_int::tensor&            A,
+                               const char *                idx_A,
+                               CTF_int::tensor&            B,
+                               const char *                idx_B,
+                               dtype                       beta,
+                               const char *                idx_C,
+                               Endomorphism<dtype> const & epilogue){
+    if (A.wrld->cdt.cm != wrld->cdt.cm || B.wrld->cdt.cm != wrld->cdt.cm){
+      printf("CTF ERROR: worlds of contracted tensors must match\n");
+      IASSERT(0);
+      return;
+    }
+    CTF_int::contraction ctr 
+      = CTF_int::contraction(&A, idx_A, &B, idx_B, (char const *)&alpha, this, idx_C, (char const *)&beta);
+    ctr.epilogue = &epilogue;
+    ctr.execute();
+  }
+
+  template<typename dtype>
+  template<typename dtype_B>
+  void Tensor<dtype>::contract(dtype                                   alpha,
+                               CTF_int::tensor&                        A,
+                               const char *                            idx_A,
+                               CTF_int::tensor&                        B,
+                               const char *                            idx_B,
+                               dtype                                   beta,
+                               const char *                            idx_C,
+                               Univar_Function<dtype, dtype_B> const & epilogue){
+    Endomorphism<dtype> endo([&](dtype & a){ a = (dtype)epilogue.f(a); });
+    contract(alpha, A, idx_A, B, idx_B, beta, idx_C, endo);
+  }
+
+  template<typename dtype>
+  void Tensor<dtype>::contract(dtype             alpha,
+                               CTF_int::tensor&  A,
+                               const char *      idx_A,
+                               CTF_int::tensor&  B,
+                               const char *      idx_B,
+                               dtype             beta,
+                               const char *      idx_C,
+                               CTF_int::tensor & mask,
+                               bool              is_mask_cmp,
+                               bool              is_mask_valued){
+    if (A.wrld->cdt.cm != wrld->cdt.cm || B.wrld->cdt.cm != wrld->cdt.cm || mask.wrld->cdt.cm != wrld->cdt.cm){
+      printf("CTF ERROR: worlds of contracted tensors must match\n");
+      IASSERT(0);
+      return;
+    }
+    CTF_int::contraction ctr 
+      = CTF_int::contraction(&A, idx_A, &B, idx_B, (char const *)&alpha, this, idx_C, (char const *)&beta);
+    ctr.mask = &mask;
+    ctr.is_mask_cmp = is_mask_cmp;
+    ctr.is_mask_valued = is_mask_valued;
+    ctr.execute();
+  }
+
+  template<typename dtype>
+  void Tensor<dtype>::contract(dtype             alpha,
+                               CTF_int::tensor & A,
+                               const char *      idx_A,
+                               CTF_int::tensor & B,
+                               const char *      idx_B,
+                               dtype             beta,
+                               const char *      idx_C,
+                               int64_t           mem_budget,
+                               int64_t *         mem_pred){
+    if (A.wrld->cdt.cm != wrld->cdt.cm || B.wrld->cdt.cm != wrld->cdt.cm){
+      printf("CTF ERROR: worlds of contracted tensors must match\n");
+      IASSERT(0);
+      return;
+    }
+    CTF_int::contraction ctr 
+      = CTF_int::contraction(&A, idx_A, &B, idx_B, (char const *)&alpha, this, idx_C, (char const *)&beta);
+    ctr.mem_budget = mem_budget;
+    if (mem_pred != NULL){
+      *mem_pred = 0;
+      ctr.mem_pred = mem_pred;
+    }
+    ctr.execute();
+  }
+
+  template<typename dtype>
+  void Tensor<dtype>::contract_batch(int64_t                 num,
+                                     dtype                   alpha,
+                                     Tensor<dtype> * const * A,
+                                     char const *            idx_A,
+                                     Tensor<dtype> * const * B,
+                                     char const *            idx_B,
+                                     dtype                   beta,
+                                     Tensor<dtype> * const * C,
+                                     char const *            idx_C){
+    std::vector<CTF_int::tensor*> tA(A, A+num);
+    std::vector<CTF_int::tensor*> tB(B, B+num);
+    std::vector<CTF_int::tensor*> tC(C, C+num);
+    for (int64_t i=0; i<num; i++){
+      if (A[i]->wrld->cdt.cm != C[i]->wrld->cdt.cm || B[i]->wrld->cdt.cm != C[i]->wrld->cdt.cm){
+        printf("CTF ERROR: worlds of contracted tensors must match\n");
+        IASSERT(0);
+        return;
+      }
+    }
+    if (num <= 0) return;
+    CTF_int::contract_batch(num, &tA[0], idx_A, &tB[0], idx_B, (char const *)&alpha,
+                            &tC[0], idx_C, (char const *)&beta);
+  }
+
 
   template<typename dtype>
   void Tensor<dtype>::sum(dtype            alpha,
@@ -461,6 +461,122 @@ namespace CTF {
                     char const *          idx_C,
                     Bivar_Function<dtype> fseq);
 
+      /**
+       * \brief contracts C[idx_C] = epilogue(beta*C[idx_C] + alpha*A[idx_A]*B[idx_B]),
+       *        applying epilogue to each local block of C right after it is computed
+       *        when possible, rather than in a separate pass over C
+       * \param[in] alpha A*B scaling factor
+       * \param[in] A first operand tensor
+       * \param[in] idx_A indices of A in contraction, e.g. "ik" -> A_{ik}
+       * \param[in] B second operand tensor
+       * \param[in] idx_B indices of B in contraction, e.g. "kj" -> B_{kj}
+       * \param[in] beta C scaling factor
+       * \param[in] idx_C indices of C (this tensor),  e.g. "ij" -> C_{ij}
+       * \param[in] epilogue elementwise function applied to the elements of C[idx_C]
+       */
+      void contract(dtype                       alpha,
+                    CTF_int::tensor &           A,
+                    char const *                idx_A,
+                    CTF_int::tensor &           B,
+                    char const *                idx_B,
+                    dtype                       beta,
+                    char const *                idx_C,
+                    Endomorphism<dtype> const & epilogue);
+
+      /**
+       * \brief contracts C[idx_C] = epilogue(beta*C[idx_C] + alpha*A[idx_A]*B[idx_B]),
+       *        see above, with the epilogue given as a function dtype -> dtype_B,
+       *        whose output is converted back to dtype (a template so that a
+       *        Function passed as fseq above is not ambiguous)
+       */
+      template <typename dtype_B>
+      void contract(dtype                                   alpha,
+                    CTF_int::tensor &                       A,
+                    char const *                            idx_A,
+                    CTF_int::tensor &                       B,
+                    char const *                            idx_B,
+                    dtype                                   beta,
+                    char const *                            idx_C,
+                    Univar_Function<dtype, dtype_B> const & epilogue);
+
+      /**
+       * \brief contracts C[idx_C] = beta*C[idx_C] + mask[idx_C].*(alpha*A[idx_A]*B[idx_B]), computing
+       *        only the entries of alpha*A*B in (or, if is_mask_cmp, not in) the sparsity pattern of mask,
+       *        within the sparse kernels when possible, rather than computing the full product and filtering it
+       * \param[in] alpha A*B scaling factor
+       * \param[in] A first operand tensor
+       * \param[in] idx_A indices of A in contraction, e.g. "ik" -> A_{ik}
+       * \param[in] B second operand tensor
+       * \param[in] idx_B indices of B in contraction, e.g. "kj" -> B_{kj}
+       * \param[in] beta C scaling factor
+       * \param[in] idx_C indices of C (this tensor),  e.g. "ij" -> C_{ij}
+       * \param[in] mask nonsymmetric tensor with the same lengths as C, whose stored entries give its pattern
+       * \param[in] is_mask_cmp whether the entries absent from the pattern of mask are computed
+       * \param[in] is_mask_valued whether entries of mask equal to zero (its additive identity) are absent from its pattern
+       */
+      void contract(dtype             alpha,
+                    CTF_int::tensor & A,
+                    char const *      idx_A,
+                    CTF_int::tensor & B,
+                    char const *      idx_B,
+                    dtype             beta,
+                    char const *      idx_C,
+                    CTF_int::tensor & mask,
+                    bool              is_mask_cmp=false,
+                    bool              is_mask_valued=false);
+
+      /**
+       * \brief contracts C[idx_C] = beta*C[idx_C] + alpha*A[idx_A]*B[idx_B] using the fastest
+       *        mapping whose memory use, in addition to the operands, fits in a given budget,
+       *        which may trade replication of operands for less memory
+       * \param[in] alpha A*B scaling factor
+       * \param[in] A first operand tensor
+       * \param[in] idx_A indices of A in contraction, e.g. "ik" -> A_{ik}
+       * \param[in] B second operand tensor
+       * \param[in] idx_B indices of B in contraction, e.g. "kj" -> B_{kj}
+       * \param[in] beta C scaling factor
+       * \param[in] idx_C indices of C (this tensor),  e.g. "ij" -> C_{ij}
+       * \param[in] mem_budget bytes per process the contraction may use in addition to its operands
+       * \param[out] mem_pred if not NULL, set to the bytes per process the chosen mapping is predicted to use
+       */
+      void contract(dtype             alpha,
+                    CTF_int::tensor & A,
+                    char const *      idx_A,
+                    CTF_int::tensor & B,
+                    char const *      idx_B,
+                    dtype             beta,
+                    char const *      idx_C,
+                    int64_t           mem_budget,
+                    int64_t *         mem_pred=NULL);
+
+      /**
+       * \brief contracts num independent triples of tensors with identical shapes,
+       *          C[i][idx_C] = beta*C[i][idx_C] + alpha*A[i][idx_A]*B[i][idx_B]
+       *        batching only happens if every tensor is dense, nonsymmetric, and
+       *        on a World with a single process (np==1, e.g. one over MPI_COMM_SELF),
+       *        in which case the batch is executed in place by a single batched gemm;
+       *        otherwise, e.g. for distributed tensors, the triples are contracted
+       *        one after another, each reusing the cached mapping of the first
+       * \param[in] num number of contractions
+       * \param[in] alpha A*B scaling factor
+       * \param[in] A first operand tensors
+       * \param[in] idx_A indices of A in contraction, e.g. "ik" -> A_{ik}
+       * \param[in] B second operand tensors
+       * \param[in] idx_B indices of B in contraction, e.g. "kj" -> B_{kj}
+       * \param[in] beta C scaling factor
+       * \param[in] C output tensors
+       * \param[in] idx_C indices of C,  e.g. "ij" -> C_{ij}
+       */
+      static void contract_batch(int64_t                 num,
+                                 dtype                   alpha,
+                                 Tensor<dtype> * const * A,
+                                 char const *            idx_A,
+                                 Tensor<dtype> * const * B,
+                                 char const *            idx_B,
+                                 dtype                   beta,
+                                 Tensor<dtype> * const * C,
+                                 char const *            idx_C);
+
       /**
        * \brief sums B[idx_B] = beta*B[idx_B] + alpha*A[idx_A]
        * \param[in] alpha A scaling factor
@@ -906,6 +1022,17 @@ namespace CTF {
        */
       void set_name(char const * name);
 
+      /**
+       * \brief selects whether the sparse tensor is compressed into CSF (compressed sparse fiber) trees within
+       *        contractions of order three or more in which it is the only sparse operand, rather than matricized;
+       *        the trees are built from the local pairs by the first such contraction and kept with the tensor for the
+       *        next ones, until the tensor is written, scaled, or redistributed, or its mode order changes
+       * \param[in] is_csf whether to use CSF
+       * \param[in] mode_order mode of the tensor stored at each level of the tree from the root,
+       *            by default the modes appearing in the output of each contraction are placed closest to the root
+       */
+      void set_csf(bool is_csf, int const * mode_order=NULL);
+
       /**
        * \brief sets all values in the tensor to val
        */
@@ -955,6 +1082,8 @@ namespace CTF {
 #include "scalar.h"
 #include "matrix.h"
 #include "sparse_tensor.h"
+#include "file_tensor.h"
+#include "multilinear.h"
 
 
 #endif
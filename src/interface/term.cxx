@@ -5,6 +5,11 @@
 #include "../tensor/algstrct.h"
 #include "../summation/summation.h"
 #include "../contraction/contraction.h"
+#include "term_plan.h"
+#include <algorithm>
+
+/** \brief maximum number of operands for which contraction order is chosen by exhaustive search */
+#define MAX_CTR_ORDER_EXH 10
 
 using namespace CTF;
 
@@ -165,6 +170,195 @@ namespace CTF_int {
   }
 
 
+  /**
+   * \brief estimated cost of contracting two operands with index masks
+   *        mask_A and mask_B into an intermediate with index mask mask_C
+   * \param[in] mask_A bitmask of indices of the first operand
+   * \param[in] mask_B bitmask of indices of the second operand
+   * \param[in] dens_A fraction of nonzeros in the first operand
+   * \param[in] dens_B fraction of nonzeros in the second operand
+   * \param[in] lens lengths of each index
+   * \param[in] num_inds number of distinct indices
+   * \return number of multiply-adds scaled by operand density
+   */
+  static double ctr_order_flops(uint64_t       mask_A,
+                                uint64_t       mask_B,
+                                double         dens_A,
+                                double         dens_B,
+                                double const * lens,
+                                int            num_inds){
+    double flops = dens_A*dens_B;
+    for (int i=0; i<num_inds; i++){
+      if (((mask_A | mask_B) >> i) & 1) flops *= lens[i];
+    }
+    return flops;
+  }
+
+  static double ctr_order_size(uint64_t       mask,
+                               double const * lens,
+                               int            num_inds){
+    double sz = 1.;
+    for (int i=0; i<num_inds; i++){
+      if ((mask >> i) & 1) sz *= lens[i];
+    }
+    return sz;
+  }
+
+  /**
+   * \brief emits the pairwise contractions of the optimal tree for subset s
+   * \return position of the operand/intermediate holding the result of s
+   */
+  static int emit_ctr_order(int                                   s,
+                            int                                   n,
+                            std::vector<int> const &              split,
+                            std::vector< std::pair<int,int> > &   seq){
+    if ((s & (s-1)) == 0){
+      int i = 0;
+      while (!((s >> i) & 1)) i++;
+      return i;
+    }
+    int a = emit_ctr_order(split[s], n, split, seq);
+    int b = emit_ctr_order(s ^ split[s], n, split, seq);
+    seq.push_back(std::pair<int,int>(a,b));
+    return n+seq.size()-1;
+  }
+
+  void get_ctr_order(std::vector<Idx_Tensor*> const &    ops,
+                     int                                 num_out_inds,
+                     char const *                        out_inds,
+                     std::vector< std::pair<int,int> > & seq){
+    int n = ops.size();
+    seq.clear();
+    if (n < 2) return;
+
+    std::vector<char> inds;
+    std::vector<double> lens;
+    std::vector<uint64_t> masks(n, 0);
+    std::vector<double> dens(n, 1.);
+    bool fits = true;
+    for (int i=0; i<n && fits; i++){
+      tensor * tsr = ops[i]->parent;
+      for (int j=0; j<tsr->order; j++){
+        int k = std::find(inds.begin(), inds.end(), ops[i]->idx_map[j]) - inds.begin();
+        if (k == (int)inds.size()){
+          if (k == 64){
+            fits = false;
+            break;
+          }
+          inds.push_back(ops[i]->idx_map[j]);
+          lens.push_back((double)tsr->lens[j]);
+        }
+        masks[i] |= ((uint64_t)1) << k;
+      }
+      if (tsr->is_sparse){
+        double dsz = 1.;
+        for (int j=0; j<tsr->order; j++) dsz *= tsr->lens[j];
+        dens[i] = std::min(1., ((double)tsr->nnz_tot)/std::max(dsz, 1.));
+      }
+    }
+    if (!fits){
+      //too many distinct indices, contract in order of appearance from the back
+      seq.push_back(std::pair<int,int>(n-1,n-2));
+      for (int i=n-3; i>=0; i--){
+        seq.push_back(std::pair<int,int>(n+seq.size()-1,i));
+      }
+      return;
+    }
+    int num_inds = inds.size();
+    uint64_t mask_out = 0;
+    for (int j=0; j<num_out_inds; j++){
+      int k = std::find(inds.begin(), inds.end(), out_inds[j]) - inds.begin();
+      if (k < num_inds) mask_out |= ((uint64_t)1) << k;
+    }
+
+    if (n <= MAX_CTR_ORDER_EXH){
+      int ns = 1 << n;
+      //indices kept in the intermediate formed by each subset of operands
+      std::vector<uint64_t> keep(ns, 0);
+      std::vector<double> keep_dens(ns, 1.);
+      for (int s=1; s<ns; s++){
+        uint64_t mask_in = 0, mask_ext = mask_out;
+        for (int i=0; i<n; i++){
+          if ((s >> i) & 1) mask_in |= masks[i];
+          else mask_ext |= masks[i];
+        }
+        keep[s] = mask_in & mask_ext;
+        if ((s & (s-1)) == 0){
+          int i = 0;
+          while (!((s >> i) & 1)) i++;
+          keep[s] = masks[i];
+          keep_dens[s] = dens[i];
+        }
+      }
+      std::vector<double> best_flops(ns, 0.);
+      std::vector<double> best_mem(ns, 0.);
+      std::vector<int> split(ns, 0);
+      for (int s=1; s<ns; s++){
+        if ((s & (s-1)) == 0) continue;
+        bool is_set = false;
+        //enumerate proper subsets containing the lowest operand of s
+        int low = s & (-s);
+        for (int s1=(s-1)&s; s1>0; s1=(s1-1)&s){
+          if (!(s1 & low)) continue;
+          int s2 = s ^ s1;
+          double flops = best_flops[s1] + best_flops[s2]
+                       + ctr_order_flops(keep[s1], keep[s2], keep_dens[s1], keep_dens[s2], &lens[0], num_inds);
+          double mem = best_mem[s1] + best_mem[s2]
+                     + ctr_order_size(keep[s], &lens[0], num_inds);
+          if (!is_set || flops < best_flops[s] ||
+              (flops == best_flops[s] && mem < best_mem[s])){
+            is_set = true;
+            best_flops[s] = flops;
+            best_mem[s] = mem;
+            split[s] = s1;
+          }
+        }
+      }
+      emit_ctr_order(ns-1, n, split, seq);
+    } else {
+      std::vector<int> live;
+      std::vector<uint64_t> live_mask;
+      std::vector<double> live_dens;
+      for (int i=0; i<n; i++){
+        live.push_back(i);
+        live_mask.push_back(masks[i]);
+        live_dens.push_back(dens[i]);
+      }
+      while (live.size() > 1){
+        int nl = live.size();
+        int best_a = -1, best_b = -1;
+        uint64_t best_keep = 0;
+        double best_flops = 0., best_mem = 0.;
+        for (int a=0; a<nl; a++){
+          for (int b=a+1; b<nl; b++){
+            uint64_t mask_ext = mask_out;
+            for (int c=0; c<nl; c++){
+              if (c != a && c != b) mask_ext |= live_mask[c];
+            }
+            uint64_t mask_keep = (live_mask[a] | live_mask[b]) & mask_ext;
+            double flops = ctr_order_flops(live_mask[a], live_mask[b], live_dens[a], live_dens[b], &lens[0], num_inds);
+            double mem = ctr_order_size(mask_keep, &lens[0], num_inds);
+            if (best_a == -1 || flops < best_flops ||
+                (flops == best_flops && mem < best_mem)){
+              best_a = a;
+              best_b = b;
+              best_keep = mask_keep;
+              best_flops = flops;
+              best_mem = mem;
+            }
+          }
+        }
+        seq.push_back(std::pair<int,int>(live[best_a], live[best_b]));
+        live[best_a] = n+seq.size()-1;
+        live_mask[best_a] = best_keep;
+        live_dens[best_a] = 1.;
+        live.erase(live.begin()+best_b);
+        live_mask.erase(live_mask.begin()+best_b);
+        live_dens.erase(live_dens.begin()+best_b);
+      }
+    }
+  }
+
   //general Term functions, see ../../include/ctf.hpp for doxygen comments
 
   /*Term::operator dtype() const {
@@ -405,13 +599,14 @@ namespace CTF_int {
       Idx_Tensor op_A = pop_A->execute();
       Idx_Tensor op_B = pop_B->execute();
       Idx_Tensor * intm = get_full_intm(op_A, op_B);
+      record_term_intm(intm);
       summation s1(op_A.parent, op_A.idx_map, op_A.scale, 
                    intm->parent, intm->idx_map, intm->scale);
-      s1.execute();
+      execute_term_sum(s1);
       //a little sloopy but intm->scale should always be 1 here
       summation s2(op_B.parent, op_B.idx_map, op_B.scale, 
                    intm->parent, intm->idx_map, intm->scale);
-      s2.execute();
+      execute_term_sum(s2);
       tmp_ops.push_back(intm);
       delete pop_A;
       delete pop_B;
@@ -432,7 +627,7 @@ namespace CTF_int {
     }
     Idx_Tensor itsr = tmp_ops.back()->execute();
     summation s(itsr.parent, itsr.idx_map, itsr.scale, output.parent, output.idx_map, output.scale);
-    s.execute();
+    execute_term_sum(s);
   }
 
 
@@ -504,233 +699,229 @@ namespace CTF_int {
   }
 
 
-  void Contract_Term::execute(Idx_Tensor output)const {
-    std::vector< Term* > tmp_ops;
+  /**
+   * \brief evaluates the operands of a product, or estimates the cost of doing so
+   * \param[in] operands terms that are multiplied
+   * \param[in] sr algebraic structure of the product
+   * \param[in,out] tscale scaling factor of the product, multiplied by the scaling factors of the operands
+   * \param[out] ops tensor operands, owning their parents if these are intermediates
+   * \param[in,out] cost if not NULL, the operands are not evaluated and the estimated time of doing so is added to *cost
+   */
+  static void get_ctr_operands(std::vector<Term*> const &  operands,
+                               algstrct const *            sr,
+                               char *&                     tscale,
+                               std::vector<Idx_Tensor*> &  ops,
+                               double *                    cost){
     for (int i=0; i<(int)operands.size(); i++){
-      tmp_ops.push_back(operands[i]->clone());
+      Idx_Tensor op = cost == NULL ? operands[i]->execute() : operands[i]->estimate_time(*cost);
+      sr->safemul(tscale, op.scale, tscale);
+      if (op.parent != NULL){
+        Idx_Tensor * top = new Idx_Tensor(op.parent, op.idx_map);
+        top->is_intm = op.is_intm;
+        op.is_intm = 0;
+        ops.push_back(top);
+      }
     }
-    char * tscale = NULL;
-    sr->safecopy(tscale, this->scale);
-    while (tmp_ops.size() > 2){
-      Term * pop_A = tmp_ops.back();
-      tmp_ops.pop_back();
-      Term * pop_B = tmp_ops.back();
-      tmp_ops.pop_back();
-      Idx_Tensor op_A = pop_A->execute();
-      Idx_Tensor op_B = pop_B->execute();
-      if (op_A.parent == NULL) {
-        sr->safemul(op_A.scale, op_B.scale, op_B.scale);
-        tmp_ops.push_back(op_B.clone());
-      } else if (op_B.parent == NULL) {
-        sr->safemul(op_A.scale, op_B.scale, op_A.scale);
-        tmp_ops.push_back(op_A.clone());
-      } else {
-        std::set<char> uniq_inds;
-        for (int k=0; k<output.parent->order; k++){
-          uniq_inds.insert(output.idx_map[k]);
-        }
-        std::set<Idx_Tensor*, tensor_name_less > inputs;
-        for (int j=0; j<(int)tmp_ops.size(); j++){
-          tmp_ops[j]->get_inputs(&inputs);
-        }
-        for (std::set<Idx_Tensor*>::iterator j=inputs.begin(); j!=inputs.end(); j++){
-          if ((*j)->parent != NULL){
-            for (int k=0; k<(*j)->parent->order; k++){
-              uniq_inds.insert((*j)->idx_map[k]);
-            }
-          }
-        }
-        std::vector<char> arr(uniq_inds.begin(), uniq_inds.end());
-
-        Idx_Tensor * intm = get_full_intm(op_A, op_B, uniq_inds.size(), &(arr[0]));
-        sr->safemul(tscale, op_A.scale, tscale);
-        sr->safemul(tscale, op_B.scale, tscale);
-        contraction c(op_A.parent, op_A.idx_map,
-                      op_B.parent, op_B.idx_map, tscale,
-                      intm->parent, intm->idx_map, intm->scale);
-        c.execute(); 
-        sr->safecopy(tscale, sr->mulid());
-        tmp_ops.push_back(intm);
+  }
+
+  /**
+   * \brief performs the first npair pairwise contractions of the order chosen by get_ctr_order(),
+   *        or estimates their cost; each intermediate keeps the indices that appear in the output
+   *        or in an operand not yet contracted
+   * \param[in,out] ops operands, the contracted ones are deleted and set to NULL and the intermediates appended
+   * \param[in] num_out_inds number of indices of the output
+   * \param[in] out_inds indices of the output
+   * \param[in] npair number of pairwise contractions to perform, at most ops.size()-1
+   * \param[in] sr algebraic structure of the product
+   * \param[in,out] cost if not NULL, the contractions are not executed and their estimated time is added to *cost
+   */
+  static void contract_in_order(std::vector<Idx_Tensor*> & ops,
+                                int                        num_out_inds,
+                                char const *               out_inds,
+                                int                        npair,
+                                algstrct const *           sr,
+                                double *                   cost){
+    std::vector< std::pair<int,int> > seq;
+    get_ctr_order(ops, num_out_inds, out_inds, seq);
+    for (int k=0; k<npair; k++){
+      Idx_Tensor * op_A = ops[seq[k].first];
+      Idx_Tensor * op_B = ops[seq[k].second];
+      ops[seq[k].first] = NULL;
+      ops[seq[k].second] = NULL;
+      //keep indices that appear in the output or in a remaining operand
+      std::set<char> ext_inds(out_inds, out_inds+num_out_inds);
+      for (int j=0; j<(int)ops.size(); j++){
+        if (ops[j] != NULL)
+          ext_inds.insert(ops[j]->idx_map, ops[j]->idx_map+ops[j]->parent->order);
       }
-      delete pop_A;
-      delete pop_B;
-    } 
-    {
-      assert(tmp_ops.size() == 2);
-      Term * pop_B = tmp_ops.back();
-      tmp_ops.pop_back();
-      Term * pop_A = tmp_ops.back();
-      tmp_ops.pop_back();
-      Idx_Tensor op_A = pop_A->execute();
-      Idx_Tensor op_B = pop_B->execute();
-      if (tscale != NULL) cdealloc(tscale);
-      tscale = NULL;
-      sr->safecopy(tscale, this->scale);
-      sr->safemul(tscale, op_A.scale, tscale);
-      sr->safemul(tscale, op_B.scale, tscale);
-
-      if (op_A.parent == NULL && op_B.parent == NULL){
-        assert(0); //FIXME write scalar to whole tensor
-      } else if (op_A.parent == NULL){
-        summation s(op_B.parent, op_B.idx_map, tscale,
-                    output.parent, output.idx_map, output.scale);
-        s.execute();
-      } else if (op_B.parent == NULL){
-        summation s(op_A.parent, op_A.idx_map, tscale,
-                    output.parent, output.idx_map, output.scale);
-        s.execute();
-      } else {
-        contraction c(op_A.parent, op_A.idx_map,
-                      op_B.parent, op_B.idx_map, tscale,
-                      output.parent, output.idx_map, output.scale);
-        c.execute();
+      std::vector<char> arr;
+      for (int j=0; j<op_A->parent->order; j++){
+        if (ext_inds.count(op_A->idx_map[j]) &&
+            std::find(arr.begin(), arr.end(), op_A->idx_map[j]) == arr.end())
+          arr.push_back(op_A->idx_map[j]);
       }
-      if (tscale != NULL) cdealloc(tscale);
-      tscale = NULL;
-      delete pop_A;
-      delete pop_B;
-    } 
+      for (int j=0; j<op_B->parent->order; j++){
+        if (ext_inds.count(op_B->idx_map[j]) &&
+            std::find(arr.begin(), arr.end(), op_B->idx_map[j]) == arr.end())
+          arr.push_back(op_B->idx_map[j]);
+      }
+      Idx_Tensor * intm = get_full_intm(*op_A, *op_B, arr.size(), arr.size() > 0 ? &(arr[0]) : NULL);
+      contraction c(op_A->parent, op_A->idx_map,
+                    op_B->parent, op_B->idx_map, sr->mulid(),
+                    intm->parent, intm->idx_map, intm->scale);
+      if (cost == NULL){
+        record_term_intm(intm);
+        execute_term_ctr(c);
+      } else
+        *cost += c.estimate_time();
+      ops.push_back(intm);
+      delete op_A;
+      delete op_B;
+    }
   }
 
-
-  Idx_Tensor Contract_Term::execute() const {
-    std::vector< Term* > tmp_ops;
-    for (int i=0; i<(int)operands.size(); i++){
-      tmp_ops.push_back(operands[i]->clone());
+  /**
+   * \brief returns the distinct indices of ops in order of appearance
+   */
+  static std::vector<char> get_all_inds(std::vector<Idx_Tensor*> const & ops){
+    std::vector<char> inds;
+    for (int i=0; i<(int)ops.size(); i++){
+      for (int j=0; j<ops[i]->parent->order; j++){
+        if (std::find(inds.begin(), inds.end(), ops[i]->idx_map[j]) == inds.end())
+          inds.push_back(ops[i]->idx_map[j]);
+      }
     }
+    return inds;
+  }
+
+  /**
+   * \brief contracts a product into output in the order chosen by get_ctr_order(),
+   *        or estimates the cost of doing so
+   * \param[in] operands terms that are multiplied
+   * \param[in] sr algebraic structure of the product
+   * \param[in] scale scaling factor of the product
+   * \param[in] output tensor to accumulate the product into
+   * \param[in,out] cost if not NULL, nothing is executed and the estimated time is added to *cost
+   */
+  static void contract_to_output(std::vector<Term*> const & operands,
+                                 algstrct const *           sr,
+                                 char const *               scale,
+                                 Idx_Tensor &               output,
+                                 double *                   cost){
+    std::vector< Idx_Tensor* > ops;
     char * tscale = NULL;
-    sr->safecopy(tscale, this->scale);
-    while (tmp_ops.size() > 1){
-      Term * pop_A = tmp_ops.back();
-      tmp_ops.pop_back();
-      Term * pop_B = tmp_ops.back();
-      tmp_ops.pop_back();
-      Idx_Tensor op_A = pop_A->execute();
-      Idx_Tensor op_B = pop_B->execute();
-      if (op_A.parent == NULL) {
-        sr->safemul(op_B.scale, op_A.scale, op_B.scale);
-        tmp_ops.push_back(op_B.clone());
-      } else if (op_B.parent == NULL) {
-        sr->safemul(op_B.scale, op_A.scale, op_A.scale);
-        tmp_ops.push_back(op_A.clone());
-      } else {
-        Idx_Tensor * intm = get_full_intm(op_A, op_B);
-        sr->safemul(tscale, op_A.scale, tscale);
-        sr->safemul(tscale, op_B.scale, tscale);
-        contraction c(op_A.parent, op_A.idx_map,
-                      op_B.parent, op_B.idx_map, tscale,
-                      intm->parent, intm->idx_map, intm->scale);
-        c.execute(); 
-        sr->safecopy(tscale, sr->mulid());
-        tmp_ops.push_back(intm);
+    sr->safecopy(tscale, scale);
+    //evaluate operands, folding scalars and operand scales into tscale
+    get_ctr_operands(operands, sr, tscale, ops, cost);
+    int n = ops.size();
+    contract_in_order(ops, output.parent->order, output.idx_map, std::max(n-2, 0), sr, cost);
+    Idx_Tensor * op_A = NULL;
+    Idx_Tensor * op_B = NULL;
+    for (int j=0; j<(int)ops.size(); j++){
+      if (ops[j] != NULL){
+        if (op_A == NULL) op_A = ops[j];
+        else op_B = ops[j];
       }
-      delete pop_A;
-      delete pop_B;
-      if (tscale != NULL){
+    }
+    if (op_A == NULL){
+      //all operands are scalars, their product is added to every element of the output
+      Idx_Tensor sc(sr);
+      sr->safecopy(sc.scale, tscale);
+      if (cost == NULL)
+        sc.execute(output);
+      else
+        *cost += sc.estimate_time(output);
+    } else if (op_B == NULL){
+      summation s(op_A->parent, op_A->idx_map, tscale,
+                  output.parent, output.idx_map, output.scale);
+      if (cost == NULL)
+        execute_term_sum(s);
+      else
+        *cost += s.estimate_time();
+    } else {
+      //the scaling factor is of the type of the output for mixed-precision contractions
+      if (tscale != NULL && output.parent->sr->el_size >= sr->el_size && !output.parent->sr->is_same_type(sr)){
+        char * wscale = (char*)alloc(output.parent->sr->el_size);
+        output.parent->sr->widen(1, sr, tscale, wscale);
         cdealloc(tscale);
-        tscale = NULL;
+        tscale = wscale;
       }
-    } 
-    Idx_Tensor rtsr = tmp_ops[0]->execute();
-    delete tmp_ops[0];
-    tmp_ops.clear();
+      contraction c(op_A->parent, op_A->idx_map,
+                    op_B->parent, op_B->idx_map, tscale,
+                    output.parent, output.idx_map, output.scale);
+      if (cost == NULL)
+        execute_term_ctr(c);
+      else
+        *cost += c.estimate_time();
+    }
+    if (tscale != NULL) cdealloc(tscale);
+    tscale = NULL;
+    if (op_A != NULL) delete op_A;
+    if (op_B != NULL) delete op_B;
+  }
+
+  /**
+   * \brief contracts a product into an intermediate that keeps all indices of the operands,
+   *        in the order chosen by get_ctr_order(), or estimates the cost of doing so
+   * \param[in] operands terms that are multiplied
+   * \param[in] sr algebraic structure of the product
+   * \param[in] scale scaling factor of the product
+   * \param[in,out] cost if not NULL, nothing is executed and the estimated time is added to *cost
+   * \return intermediate (or scalar if all operands are scalars) scaled by the product of the scaling factors
+   */
+  static Idx_Tensor contract_to_intm(std::vector<Term*> const & operands,
+                                     algstrct const *           sr,
+                                     char const *               scale,
+                                     double *                   cost){
+    std::vector< Idx_Tensor* > ops;
+    char * tscale = NULL;
+    sr->safecopy(tscale, scale);
+    get_ctr_operands(operands, sr, tscale, ops, cost);
+    int n = ops.size();
+    std::vector<char> inds = get_all_inds(ops);
+    contract_in_order(ops, inds.size(), inds.size() > 0 ? &(inds[0]) : NULL, std::max(n-1, 0), sr, cost);
+    Idx_Tensor * op = NULL;
+    for (int j=0; j<(int)ops.size(); j++){
+      if (ops[j] != NULL) op = ops[j];
+    }
+    Idx_Tensor rtsr(sr);
+    if (op != NULL){
+      //hand the remaining operand, and ownership of its parent if it is an intermediate, to rtsr
+      rtsr.parent  = op->parent;
+      rtsr.idx_map = op->idx_map;
+      rtsr.is_intm = op->is_intm;
+      op->parent   = NULL;
+      op->idx_map  = NULL;
+      op->is_intm  = 0;
+      delete op;
+    }
+    sr->safecopy(rtsr.scale, tscale);
+    if (tscale != NULL) cdealloc(tscale);
     return rtsr;
   }
 
+  void Contract_Term::execute(Idx_Tensor output)const {
+    contract_to_output(operands, sr, this->scale, output, NULL);
+  }
+
+
+  Idx_Tensor Contract_Term::execute() const {
+    return contract_to_intm(operands, sr, this->scale, NULL);
+  }
+
 
   double Contract_Term::estimate_time(Idx_Tensor output)const {
     double cost = 0.0;
-    std::vector< Term* > tmp_ops;
-    for (int i=0; i<(int)operands.size(); i++){
-      tmp_ops.push_back(operands[i]->clone());
-    }
-    while (tmp_ops.size() > 2){
-      Term * pop_A = tmp_ops.back();
-      tmp_ops.pop_back();
-      Term * pop_B = tmp_ops.back();
-      tmp_ops.pop_back();
-      Idx_Tensor op_A = pop_A->estimate_time(cost);
-      Idx_Tensor op_B = pop_B->estimate_time(cost);
-      if (op_A.parent == NULL) {
-        tmp_ops.push_back(op_B.clone());
-      } else if (op_B.parent == NULL) {
-        tmp_ops.push_back(op_A.clone());
-      } else {
-        Idx_Tensor * intm = get_full_intm(op_A, op_B);
-        contraction c(op_A.parent, op_A.idx_map,
-                      op_B.parent, op_B.idx_map, this->scale, 
-                      intm->parent, intm->idx_map, intm->scale);
-        cost += c.estimate_time();
-        tmp_ops.push_back(intm);
-      }
-      delete pop_A;
-      delete pop_B;
-    } 
-    {
-      assert(tmp_ops.size() == 2);
-      Term * pop_A = tmp_ops.back();
-      tmp_ops.pop_back();
-      Term * pop_B = tmp_ops.back();
-      tmp_ops.pop_back();
-      Idx_Tensor op_A = pop_A->estimate_time(cost);
-      Idx_Tensor op_B = pop_B->estimate_time(cost);
-      
-      if (op_A.parent == NULL && op_B.parent == NULL){
-        assert(0); //FIXME write scalar to whole tensor
-      } else if (op_A.parent == NULL){
-        summation s(op_B.parent, op_B.idx_map, this->scale,
-                    output.parent, output.idx_map, output.scale);
-        cost += s.estimate_time();
-      } else if (op_B.parent == NULL){
-        summation s(op_A.parent, op_A.idx_map, this->scale,
-                    output.parent, output.idx_map, output.scale);
-        cost += s.estimate_time();
-      } else {
-        contraction c(op_A.parent, op_A.idx_map,
-                      op_B.parent, op_B.idx_map, this->scale,
-                      output.parent, output.idx_map, output.scale);
-        cost += c.estimate_time();
-      }
-      delete pop_A;
-      delete pop_B;
-    } 
+    contract_to_output(operands, sr, this->scale, output, &cost);
     return cost;
   }
 
 
   Idx_Tensor Contract_Term::estimate_time(double & cost) const {
-    std::vector< Term* > tmp_ops;
-    for (int i=0; i<(int)operands.size(); i++){
-      tmp_ops.push_back(operands[i]->clone());
-    }
-    while (tmp_ops.size() > 1){
-      Term * pop_A = tmp_ops.back();
-      tmp_ops.pop_back();
-      Term * pop_B = tmp_ops.back();
-      tmp_ops.pop_back();
-      Idx_Tensor op_A = pop_A->estimate_time(cost);
-      Idx_Tensor op_B = pop_B->estimate_time(cost);
-      if (op_A.parent == NULL) {
-        tmp_ops.push_back(op_B.clone());
-      } else if (op_B.parent == NULL) {
-        tmp_ops.push_back(op_A.clone());
-      } else {
-        Idx_Tensor * intm = get_full_intm(op_A, op_B);
-        contraction c(op_A.parent, op_A.idx_map,
-                      op_B.parent, op_B.idx_map, this->scale, 
-                      intm->parent, intm->idx_map, intm->scale);
-        cost += c.estimate_time();
-
-        tmp_ops.push_back(intm);
-      }
-      delete pop_A;
-      delete pop_B;
-    } 
-    return tmp_ops[0]->estimate_time(cost);
+    return contract_to_intm(operands, sr, this->scale, &cost);
   }
 
 
-
   void Contract_Term::get_inputs(std::set<Idx_Tensor*, tensor_name_less >* inputs_set) const {
     for (int i=0; i<(int)operands.size(); i++){
       operands[i]->get_inputs(inputs_set);
@@ -311,6 +311,25 @@ namespace CTF_int {
   };
 
 
+  /**
+   * \brief chooses the order in which to contract a product of tensors,
+   *        minimizing the number of multiply-adds (weighted by the density
+   *        of sparse operands) with the size of intermediates as a
+   *        tie-breaker. An exhaustive search over subsets is done for up
+   *        to 10 operands, a greedy pairwise selection
+   *        otherwise.
+   * \param[in] ops tensor operands of the product
+   * \param[in] num_out_inds number of indices of the output
+   * \param[in] out_inds indices of the output
+   * \param[out] seq pairs to contract, entries i<ops.size() refer to ops[i],
+   *             entry ops.size()+k to the intermediate produced by seq[k]
+   */
+  void get_ctr_order(std::vector<CTF::Idx_Tensor*> const & ops,
+                     int                                 num_out_inds,
+                     char const *                        out_inds,
+                     std::vector< std::pair<int,int> > & seq);
+
+
   //FIXME: what if noncommutative?
   inline CTF_int::Contract_Term operator*(double const & d, CTF_int::Term const & tsr){
     return (tsr*d);
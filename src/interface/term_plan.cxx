@@ -0,0 +1,196 @@
+/*Copyright (c) 2013, Edgar Solomonik, all rights reserved.*/
+
+#include "common.h"
+#include "term_plan.h"
+#include "idx_tensor.h"
+#include "../tensor/algstrct.h"
+#include "../tensor/untyped_tensor.h"
+#include "../summation/summation.h"
+#include "../contraction/contraction.h"
+
+using namespace CTF_int;
+
+namespace CTF {
+
+  thread_local Term_Plan * recording_plan = NULL;
+
+  Term_Plan::Term_Plan(){
+    prev_plan    = NULL;
+    is_recording = false;
+  }
+
+  Term_Plan::~Term_Plan(){
+    if (is_recording) end_record();
+    clear();
+  }
+
+  void Term_Plan::record(){
+    assert(!is_recording);
+    prev_plan    = recording_plan;
+    recording_plan  = this;
+    is_recording = true;
+  }
+
+  void Term_Plan::end_record(){
+    assert(is_recording);
+    assert(recording_plan == this);
+    recording_plan  = prev_plan;
+    prev_plan    = NULL;
+    is_recording = false;
+  }
+
+  int Term_Plan::get_num_ops() const {
+    return ops.size();
+  }
+
+  void Term_Plan::clear(){
+    for (int i=0; i<(int)ops.size(); i++){
+      if (ops[i].ctr != NULL) delete ops[i].ctr;
+      if (ops[i].sum != NULL) delete ops[i].sum;
+      if (ops[i].alpha != NULL) cdealloc(ops[i].alpha);
+      if (ops[i].beta != NULL) cdealloc(ops[i].beta);
+    }
+    ops.clear();
+    for (int i=0; i<(int)owned.size(); i++){
+      delete owned[i];
+    }
+    owned.clear();
+  }
+
+  void Term_Plan::add_zero(tensor * tsr){
+    plan_op op;
+    op.type  = PLAN_OP_ZERO;
+    op.tsr   = tsr;
+    op.ctr   = NULL;
+    op.sum   = NULL;
+    op.alpha = NULL;
+    op.beta  = NULL;
+    ops.push_back(op);
+  }
+
+  void Term_Plan::add_intm(tensor * tsr){
+    owned.push_back(tsr);
+    //intermediates start out zero when created on the fly
+    add_zero(tsr);
+  }
+
+  void Term_Plan::add_contraction(contraction const & ctr){
+    plan_op op;
+    op.type  = PLAN_OP_CTR;
+    op.tsr   = NULL;
+    op.sum   = NULL;
+    op.alpha = NULL;
+    op.beta  = NULL;
+    //scaling factors are owned by the terms, so keep copies
+    ctr.C->sr->safecopy(op.alpha, ctr.alpha);
+    ctr.C->sr->safecopy(op.beta, ctr.beta);
+    op.ctr        = new contraction(ctr);
+    op.ctr->alpha = op.alpha;
+    op.ctr->beta  = op.beta;
+    ops.push_back(op);
+  }
+
+  void Term_Plan::add_summation(summation const & sum, bool own_A){
+    plan_op op;
+    op.type  = PLAN_OP_SUM;
+    op.tsr   = NULL;
+    op.ctr   = NULL;
+    op.alpha = NULL;
+    op.beta  = NULL;
+    sum.B->sr->safecopy(op.alpha, sum.alpha);
+    sum.B->sr->safecopy(op.beta, sum.beta);
+    op.sum        = new summation(sum);
+    op.sum->alpha = op.alpha;
+    op.sum->beta  = op.beta;
+    if (own_A){
+      op.sum->A = new tensor(sum.A, 1);
+      owned.push_back(op.sum->A);
+    }
+    ops.push_back(op);
+  }
+
+  /**
+   * \brief looks up the tensor replacing tsr in remap, if any
+   */
+  static tensor * remap_tsr(std::map<tensor*, tensor*> * remap, tensor * tsr){
+    if (remap == NULL) return tsr;
+    std::map<tensor*, tensor*>::iterator it = remap->find(tsr);
+    if (it == remap->end()) return tsr;
+    return it->second;
+  }
+
+  void Term_Plan::execute(std::map<tensor*, tensor*> * remap){
+    assert(!is_recording);
+    //operations issued by the plan itself must not be recorded into another plan
+    Term_Plan * rec_plan = recording_plan;
+    recording_plan = NULL;
+    for (int i=0; i<(int)ops.size(); i++){
+      switch (ops[i].type){
+        case PLAN_OP_ZERO:
+          remap_tsr(remap, ops[i].tsr)->set_zero();
+          break;
+        case PLAN_OP_CTR:
+          if (remap == NULL){
+            ops[i].ctr->execute();
+          } else {
+            contraction ctr(*ops[i].ctr);
+            ctr.A = remap_tsr(remap, ctr.A);
+            ctr.B = remap_tsr(remap, ctr.B);
+            ctr.C = remap_tsr(remap, ctr.C);
+            ctr.execute();
+          }
+          break;
+        case PLAN_OP_SUM:
+          if (remap == NULL){
+            ops[i].sum->execute();
+          } else {
+            summation sum(*ops[i].sum);
+            sum.A = remap_tsr(remap, sum.A);
+            sum.B = remap_tsr(remap, sum.B);
+            sum.execute();
+          }
+          break;
+      }
+    }
+    recording_plan = rec_plan;
+  }
+}
+
+namespace CTF_int {
+  void execute_term_ctr(contraction & ctr){
+    if (CTF::recording_plan == NULL){
+      ctr.execute();
+    } else {
+      CTF::Term_Plan * plan = CTF::recording_plan;
+      plan->add_contraction(ctr);
+      CTF::recording_plan = NULL;
+      ctr.execute();
+      CTF::recording_plan = plan;
+    }
+  }
+
+  void execute_term_sum(summation & sum, bool own_A){
+    if (CTF::recording_plan == NULL){
+      sum.execute();
+    } else {
+      CTF::Term_Plan * plan = CTF::recording_plan;
+      plan->add_summation(sum, own_A);
+      CTF::recording_plan = NULL;
+      sum.execute();
+      CTF::recording_plan = plan;
+    }
+  }
+
+  void execute_term_zero(tensor * tsr){
+    if (CTF::recording_plan != NULL)
+      CTF::recording_plan->add_zero(tsr);
+    tsr->set_zero();
+  }
+
+  void record_term_intm(CTF::Idx_Tensor * intm){
+    if (CTF::recording_plan != NULL && intm->is_intm){
+      CTF::recording_plan->add_intm(intm->parent);
+      intm->is_intm = 0;
+    }
+  }
+}
@@ -0,0 +1,150 @@
+#ifndef __TERM_PLAN_H__
+#define __TERM_PLAN_H__
+
+#include <map>
+#include <vector>
+
+namespace CTF_int {
+  class tensor;
+  class contraction;
+  class summation;
+}
+
+namespace CTF {
+  class Idx_Tensor;
+
+  /**
+   * \addtogroup expression
+   * @{
+   */
+
+  /**
+   * \brief Captures the contractions, summations, and intermediate tensors
+   *        generated by tensor expressions (e.g. C["ij"]=A["ik"]*B["kl"]*D["lj"])
+   *        executed between record() and end_record(). The captured plan can
+   *        then be re-executed, e.g. once per iteration of a solver, after the
+   *        data of the input tensors has changed. Re-execution skips expression
+   *        evaluation, contraction ordering and allocation of intermediates,
+   *        and contraction mappings are retrieved from the mapping cache.
+   *
+   *        Expressions are executed as usual while being recorded. Tensors
+   *        used by recorded expressions (and any custom functions) must
+   *        outlive the plan, and conversion of expressions to scalar values
+   *        should not be done while recording.
+   *
+   *        Intermediate tensors are owned by the plan and keep their data and
+   *        mapping between executions. Intermediates made only to estimate the
+   *        cost of an expression are not recorded. On re-execution, each
+   *        contraction takes its mapping, and for dense contractions its
+   *        contraction tree, from the contraction plan cache, while the local
+   *        buffers of each contraction are allocated by the call. The plan
+   *        being recorded is kept per thread (CTF::recording_plan), so each
+   *        thread records only the expressions it executes.
+   */
+  class Term_Plan {
+    public:
+      /**
+       * \brief creates an empty plan
+       */
+      Term_Plan();
+
+      /**
+       * \brief frees recorded operations and intermediate tensors
+       */
+      ~Term_Plan();
+
+      /**
+       * \brief starts recording all tensor expressions to this plan,
+       *        previously recorded operations are kept
+       */
+      void record();
+
+      /**
+       * \brief stops recording
+       */
+      void end_record();
+
+      /**
+       * \brief executes all recorded operations in the order in which they were recorded
+       * \param[in] remap optional substitution of the tensors the plan was recorded
+       *            with by other tensors of the same shape and type
+       */
+      void execute(std::map<CTF_int::tensor*, CTF_int::tensor*> * remap=NULL);
+
+      /**
+       * \brief number of recorded operations
+       */
+      int get_num_ops() const;
+
+      /**
+       * \brief removes all recorded operations and frees intermediate tensors
+       */
+      void clear();
+
+      /** \brief records an operation, used by expression execution */
+      void add_zero(CTF_int::tensor * tsr);
+      void add_contraction(CTF_int::contraction const & ctr);
+      void add_summation(CTF_int::summation const & sum, bool own_A);
+      void add_intm(CTF_int::tensor * tsr);
+
+    private:
+      enum plan_op_type { PLAN_OP_ZERO, PLAN_OP_CTR, PLAN_OP_SUM };
+      struct plan_op {
+        plan_op_type               type;
+        CTF_int::tensor *          tsr;
+        CTF_int::contraction *     ctr;
+        CTF_int::summation *       sum;
+        char *                     alpha;
+        char *                     beta;
+      };
+      /** \brief recorded operations */
+      std::vector<plan_op> ops;
+      /** \brief tensors owned by the plan (intermediates and scalar operands) */
+      std::vector<CTF_int::tensor*> owned;
+      /** \brief plan that was being recorded when record() was called */
+      Term_Plan * prev_plan;
+      bool is_recording;
+
+      Term_Plan(Term_Plan const & other);
+      Term_Plan & operator=(Term_Plan const & other);
+  };
+
+  /** \brief plan currently being recorded by the calling thread, NULL if none */
+  extern thread_local Term_Plan * recording_plan;
+  /**
+   * @}
+   */
+}
+
+namespace CTF_int {
+  /**
+   * \brief executes a contraction on behalf of a tensor expression, recording
+   *        it if a Term_Plan is being recorded
+   * \param[in] ctr contraction to execute
+   */
+  void execute_term_ctr(contraction & ctr);
+
+  /**
+   * \brief executes a summation on behalf of a tensor expression, recording
+   *        it if a Term_Plan is being recorded
+   * \param[in] sum summation to execute
+   * \param[in] own_A whether sum.A is a temporary that the plan needs to copy
+   */
+  void execute_term_sum(summation & sum, bool own_A=false);
+
+  /**
+   * \brief sets a tensor to zero on behalf of a tensor expression, recording
+   *        it if a Term_Plan is being recorded
+   * \param[in] tsr tensor to zero
+   */
+  void execute_term_zero(tensor * tsr);
+
+  /**
+   * \brief hands ownership of an expression intermediate to the Term_Plan
+   *        being recorded, if any, so that it is reused on re-execution
+   * \param[in,out] intm intermediate whose is_intm flag is cleared if recorded
+   */
+  void record_term_intm(CTF::Idx_Tensor * intm);
+}
+
+#endif
@@ -0,0 +1,318 @@
+#ifndef __TROPICAL_H__
+#define __TROPICAL_H__
+
+#include <limits>
+#include <type_traits>
+
+namespace CTF_int {
+
+  /** \brief rows and columns of the register tile of tropical_gemm */
+  #define TROPICAL_GEMM_MR 8
+  #define TROPICAL_GEMM_NR 4
+
+  /** \brief tropical addition, min(a,b) or max(a,b) if is_max */
+  template <typename dtype, bool is_max>
+  inline dtype tropical_add(dtype a, dtype b){
+    if (is_max) return a < b ? b : a;
+    else        return b < a ? b : a;
+  }
+
+  /**
+   * \brief default tropical additive identity, +/-infinity for floating point
+   *        types and half of the largest/smallest value for integer types
+   */
+  template <typename dtype, bool is_max>
+  dtype tropical_addid(){
+    if (std::numeric_limits<dtype>::has_infinity){
+      if (is_max) return -std::numeric_limits<dtype>::infinity();
+      else        return std::numeric_limits<dtype>::infinity();
+    } else {
+      if (is_max) return std::numeric_limits<dtype>::lowest()/2;
+      else        return std::numeric_limits<dtype>::max()/2;
+    }
+  }
+
+  /**
+   * \brief tropical multiplication, a+b; for integer types the sum is the additive
+   *        identity if either operand or the sum reaches it, and is clamped to the
+   *        range of dtype otherwise, so that it never overflows
+   */
+  template <typename dtype, bool is_max>
+  inline dtype tropical_mul(dtype a, dtype b){
+    if (std::numeric_limits<dtype>::has_infinity) return a+b;
+    dtype addid = tropical_addid<dtype,is_max>();
+    if (is_max ? (a <= addid || b <= addid) : (addid <= a || addid <= b)) return addid;
+    //an operand below (above if is_max) the identity can still take the sum out of range
+    if (b < 0 && a < std::numeric_limits<dtype>::lowest()-b) return std::numeric_limits<dtype>::lowest();
+    if (b > 0 && a > std::numeric_limits<dtype>::max()-b)    return std::numeric_limits<dtype>::max();
+    dtype c = a+b;
+    if (is_max ? c <= addid : addid <= c) return addid;
+    return c;
+  }
+
+  /**
+   * \brief X["i"]=alpha+X["i"]; (tropical scaling), elements equal to the additive
+   *        identity are left unchanged, since for integer types it is a finite sentinel
+   */
+  template <typename dtype, bool is_max>
+  void tropical_scal(int     n,
+                     dtype   alpha,
+                     dtype * X,
+                     int     incX){
+    dtype addid = tropical_addid<dtype,is_max>();
+    if (alpha == addid){
+      for (int64_t i=0; i<n; i++){
+        X[i*incX] = alpha;
+      }
+    } else if (alpha != dtype(0)){
+      for (int64_t i=0; i<n; i++){
+        if (X[i*incX] != addid) X[i*incX] = tropical_mul<dtype,is_max>(X[i*incX], alpha);
+      }
+    }
+  }
+
+  /** \brief Y["i"]=min(Y["i"],alpha+X["i"]); (max if is_max) */
+  template <typename dtype, bool is_max>
+  void tropical_axpy(int           n,
+                     dtype         alpha,
+                     dtype const * X,
+                     int           incX,
+                     dtype *       Y,
+                     int           incY){
+    dtype addid = tropical_addid<dtype,is_max>();
+    if (alpha == addid) return;
+    for (int64_t i=0; i<n; i++){
+      if (X[i*incX] != addid)
+        Y[i*incY] = tropical_add<dtype,is_max>(Y[i*incY], tropical_mul<dtype,is_max>(alpha, X[i*incX]));
+    }
+  }
+
+  /**
+   * \brief C = min(beta+C, alpha+A*B), where (A*B)[i,j] = min_l A[i,l]+B[l,j]
+   *        (max instead of min if is_max), A is m-by-k (k-by-m if tA='T') and
+   *        B k-by-n (n-by-k if tB='T'), all column-major; C is not read if beta
+   *        is the additive identity. Larger products go through blocked_gemm with
+   *        a TROPICAL_GEMM_MR-by-TROPICAL_GEMM_NR tile, packing A shifted by alpha
+   */
+  template <typename dtype, bool is_max>
+  void tropical_gemm(char          tA,
+                     char          tB,
+                     int           m,
+                     int           n,
+                     int           k,
+                     dtype         alpha,
+                     dtype const * A,
+                     dtype const * B,
+                     dtype         beta,
+                     dtype *       C){
+    int64_t istride_A, lstride_A, jstride_B, lstride_B;
+    if (tA == 'N' || tA == 'n'){
+      istride_A=1;
+      lstride_A=m;
+    } else {
+      istride_A=k;
+      lstride_A=1;
+    }
+    if (tB == 'N' || tB == 'n'){
+      jstride_B=k;
+      lstride_B=1;
+    } else {
+      jstride_B=1;
+      lstride_B=n;
+    }
+    dtype addid = tropical_addid<dtype,is_max>();
+    if (beta == addid || beta != dtype(0)){
+#ifdef _OPENMP
+      #pragma omp parallel for
+#endif
+      for (int j=0; j<n; j++){
+        tropical_scal<dtype,is_max>(m, beta, C+((int64_t)j)*m, 1);
+      }
+    }
+    if (alpha == addid || k == 0) return;
+    if (((int64_t)m)*n*k <= DEFAULT_GEMM_MIN_BLK){
+      for (int j=0; j<n; j++){
+        for (int i=0; i<m; i++){
+          dtype c = addid;
+          for (int l=0; l<k; l++){
+            c = tropical_add<dtype,is_max>(c, tropical_mul<dtype,is_max>(A[istride_A*i+lstride_A*l], B[lstride_B*l+jstride_B*j]));
+          }
+          C[j*m+i] = tropical_add<dtype,is_max>(C[j*m+i], tropical_mul<dtype,is_max>(alpha, c));
+        }
+      }
+      return;
+    }
+    blocked_gemm<TROPICAL_GEMM_MR,TROPICAL_GEMM_NR>(tA, tB, m, n, k, A, B, C,
+      [=](dtype a){ return tropical_mul<dtype,is_max>(alpha, a); },
+      [](dtype a, dtype b){ return tropical_mul<dtype,is_max>(a, b); },
+      [](dtype a, dtype & c){ c = tropical_add<dtype,is_max>(a, c); });
+  }
+
+  template <typename dtype, bool is_max>
+  void tropical_gemm_batch(char          tA,
+                           char          tB,
+                           int           l,
+                           int           m,
+                           int           n,
+                           int           k,
+                           dtype         alpha,
+                           dtype const * A,
+                           dtype const * B,
+                           dtype         beta,
+                           dtype *       C){
+    for (int i=0; i<l; i++){
+      tropical_gemm<dtype,is_max>(tA, tB, m, n, k, alpha, A+((int64_t)i)*m*k, B+((int64_t)i)*k*n, beta, C+((int64_t)i)*m*n);
+    }
+  }
+
+  /**
+   * \brief C = min(beta+C, alpha+A*B) with A m-by-k in CSR format (1-based JA and IA),
+   *        B k-by-n and C m-by-n dense and column-major
+   */
+  template <typename dtype, bool is_max>
+  void tropical_csrmm(int           m,
+                      int           n,
+                      int           k,
+                      dtype         alpha,
+                      dtype const * A,
+                      int const *   JA,
+                      int64_t const * IA,
+                      dtype const * B,
+                      dtype         beta,
+                      dtype *       C){
+    dtype addid = tropical_addid<dtype,is_max>();
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (int col_B=0; col_B<n; col_B++){
+      dtype const * B_j = B+((int64_t)col_B)*k;
+      dtype * C_j = C+((int64_t)col_B)*m;
+      tropical_scal<dtype,is_max>(m, beta, C_j, 1);
+      if (alpha == addid) continue;
+      for (int row_A=0; row_A<m; row_A++){
+        dtype c = addid;
+        for (int64_t i_A=IA[row_A]-1; i_A<IA[row_A+1]-1; i_A++){
+          c = tropical_add<dtype,is_max>(c, tropical_mul<dtype,is_max>(A[i_A], B_j[JA[i_A]-1]));
+        }
+        if (IA[row_A] < IA[row_A+1])
+          C_j[row_A] = tropical_add<dtype,is_max>(C_j[row_A], tropical_mul<dtype,is_max>(alpha, c));
+      }
+    }
+  }
+
+  /**
+   * \brief C = min(beta+C, alpha+A*B) with A m-by-k and B k-by-n in CSR format
+   *        (1-based indices) and C m-by-n dense and column-major
+   */
+  template <typename dtype, bool is_max>
+  void tropical_csrmultd(int           m,
+                         int           n,
+                         int           k,
+                         dtype         alpha,
+                         dtype const * A,
+                         int const *   JA,
+                         int64_t const * IA,
+                         dtype const * B,
+                         int const *   JB,
+                         int64_t const * IB,
+                         dtype         beta,
+                         dtype *       C){
+    tropical_scal<dtype,is_max>(((int64_t)m)*n, beta, C, 1);
+    if (alpha == tropical_addid<dtype,is_max>()) return;
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (int row_A=0; row_A<m; row_A++){
+      for (int64_t i_A=IA[row_A]-1; i_A<IA[row_A+1]-1; i_A++){
+        int row_B = JA[i_A]-1;
+        dtype a = tropical_mul<dtype,is_max>(alpha, A[i_A]);
+        for (int64_t i_B=IB[row_B]-1; i_B<IB[row_B+1]-1; i_B++){
+          int64_t idx_C = ((int64_t)(JB[i_B]-1))*m+row_A;
+          C[idx_C] = tropical_add<dtype,is_max>(C[idx_C], tropical_mul<dtype,is_max>(a, B[i_B]));
+        }
+      }
+    }
+  }
+}
+
+namespace CTF {
+  /**
+   * \addtogroup algstrct
+   * @{
+   */
+
+  /**
+   * \brief Tropical semiring over a built-in ordered numeric type, with addition
+   *        min(a,b) (max(a,b) if is_max) and multiplication a+b, as used for
+   *        shortest (longest) path computations. Unlike an equivalent Semiring
+   *        constructed from min/plus functions, contractions use specialized
+   *        dense and sparse kernels, and reductions across processes use MPI_MIN
+   *        (MPI_MAX). The additive identity ("no path") is infinity for floating
+   *        point types and half the largest (smallest) value for integer types,
+   *        see tropical_addid().
+   */
+  template <typename dtype=double, bool is_max=false>
+  class Tropical_Semiring : public Semiring<dtype, true> {
+    public:
+      static_assert(std::is_arithmetic<dtype>::value, "Tropical_Semiring requires a built-in numeric type");
+
+      Tropical_Semiring(Tropical_Semiring const & other) : Semiring<dtype, true>(other) { }
+
+      virtual CTF_int::algstrct * clone() const {
+        return new Tropical_Semiring<dtype, is_max>(*this);
+      }
+
+      Tropical_Semiring()
+        : Semiring<dtype, true>(CTF_int::tropical_addid<dtype,is_max>(),
+                                &CTF_int::tropical_add<dtype,is_max>,
+                                is_max ? MPI_MAX : MPI_MIN,
+                                dtype(0),
+                                &CTF_int::tropical_mul<dtype,is_max>,
+                                &CTF_int::tropical_gemm<dtype,is_max>,
+                                &CTF_int::tropical_axpy<dtype,is_max>,
+                                &CTF_int::tropical_scal<dtype,is_max>,
+                                NULL,
+                                &CTF_int::tropical_gemm_batch<dtype,is_max>) { }
+
+      /** \brief sparse version of gemm using CSR format for A */
+      void csrmm(int                             m,
+                 int                             n,
+                 int                             k,
+                 char const *                    alpha,
+                 char const *                    A,
+                 int const *                     JA,
+                 int64_t const *                 IA,
+                 int64_t                         nnz_A,
+                 char const *                    B,
+                 char const *                    beta,
+                 char *                          C,
+                 CTF_int::bivar_function const * func) const {
+        assert(func == NULL);
+        CTF_int::tropical_csrmm<dtype,is_max>(m, n, k, ((dtype const*)alpha)[0], (dtype const*)A, JA, IA, (dtype const*)B, ((dtype const*)beta)[0], (dtype*)C);
+      }
+
+      /** \brief sparse version of gemm using CSR format for A and B*/
+      void csrmultd(int          m,
+                    int          n,
+                    int          k,
+                    char const * alpha,
+                    char const * A,
+                    int const *  JA,
+                    int64_t const * IA,
+                    int64_t      nnz_A,
+                    char const * B,
+                    int const *  JB,
+                    int64_t const * IB,
+                    int64_t      nnz_B,
+                    char const * beta,
+                    char *       C) const {
+        CTF_int::tropical_csrmultd<dtype,is_max>(m, n, k, ((dtype const*)alpha)[0], (dtype const*)A, JA, IA, (dtype const*)B, JB, IB, ((dtype const*)beta)[0], (dtype*)C);
+      }
+  };
+
+  /**
+   * @}
+   */
+}
+
+#endif
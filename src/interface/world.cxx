@@ -5,6 +5,7 @@
 #include "../shared/util.h"
 #include "../shared/memcontrol.h"
 #include "../shared/offload.h"
+#include "../tensor/algstrct.h"
 
 extern "C"
 {
@@ -66,6 +67,10 @@ namespace CTF {
 #endif
     //ASSERT(0);
     this->init(comm, other.phys_topology->order, other.phys_topology->lens, 0, NULL);
+    //keep the settings of other rather than the defaults set by init
+    mem_budget  = other.mem_budget;
+    autotune    = other.autotune;
+    tuning_file = other.tuning_file;
 /*    cdt         = other.cdt;
     rank        = other.rank;
     np          = other.np;
@@ -80,11 +85,14 @@ namespace CTF {
   World::World(char const * emptystring){}
 
   World::~World(){
+    invalidate_ctr_plan_cache(this);
     if (!is_copy && this != &universe){
       for (int i=0; i<(int)topovec.size(); i++){
         delete topovec[i];
       }
       delete phys_topology;
+      //communicators split by the CSR reduction over the communicator of the world are not freed with it
+      free_csr_red_comms(this->cdt.cm);
       if (this->cdt.cm == MPI_COMM_WORLD){
         ASSERT(universe_exists);
         universe_exists = false;
@@ -239,6 +247,11 @@ namespace CTF {
       if (rank == 0)
         VPRINTF(1,"Total amount of memory available to process 0 is %ld\n", proc_bytes_available());
     } 
+    mem_budget = -1;
+    char * autotune_str = getenv("CTF_AUTOTUNE");
+    autotune = autotune_str == NULL ? 0 : std::max(0, atoi(autotune_str));
+    char * tuning_file_str = getenv("CTF_TUNING_FILE");
+    tuning_file = tuning_file_str == NULL ? "" : tuning_file_str;
     initialized = 1;
     if (comm == MPI_COMM_WORLD){
       if (!universe_exists){
@@ -37,6 +37,20 @@ namespace CTF {
                                0x5555555555555555, 17,
                                0x71d67fffeda60000, 37,
                                0xfff7eee000000000, 43, 6364136223846793005> glob_wrld_rng;
+      /** \brief bytes per process that each contraction on this world may use in addition to its
+                 operands (for redistribution, replication, and intermediate buffers), the mapping
+                 search picks the fastest mapping within this budget, -1 (default) if limited only
+                 by the available memory */
+      int64_t mem_budget;
+      /** \brief number of mappings with the least predicted execution time that are timed on the
+                 first contraction of each signature, the fastest of which is then used for all
+                 contractions of that signature, 0 (default) disables autotuning, set initially
+                 by the CTF_AUTOTUNE environment variable */
+      int autotune;
+      /** \brief file from which mappings chosen by autotuning in earlier runs are read, and to
+                 which newly chosen mappings are appended, none if empty (default), set initially
+                 by the CTF_TUNING_FILE environment variable */
+      std::string tuning_file;
 
 
 
@@ -141,6 +155,29 @@ namespace CTF {
   };
 
   World & get_universe();
+
+  /**
+   * \brief retrieves the number of contractions whose mapping was reused from
+   *        (hits) or had to be searched for and added to (misses) the plan cache
+   * \param[out] hits number of contractions that reused a cached mapping
+   * \param[out] misses number of contractions that performed a mapping search
+   */
+  void get_ctr_plan_cache_stats(int64_t & hits, int64_t & misses);
+
+  /**
+   * \brief retrieves the load imbalance of the operands of the last sparse contraction,
+   *        i.e. the largest number of nonzeros held by a process over the average
+   * \param[out] imb_A imbalance of the first operand, 1 if it is dense
+   * \param[out] imb_B imbalance of the second operand, 1 if it is dense
+   */
+  void get_sparse_ctr_imbalance(double & imb_A, double & imb_B);
+
+  /**
+   * \brief drops cached contraction mappings, forcing the next contraction
+   *        of each signature to search for a mapping anew
+   * \param[in] wrld world whose cached mappings should be dropped, all worlds if NULL
+   */
+  void invalidate_ctr_plan_cache(World const * wrld=NULL);
   /**
    * @}
    */
@@ -353,6 +353,8 @@ namespace CTF_int {
       }
     }
 
+    //the values are changed in place, so CSF trees built from them are dropped
+    A->clear_csf();
     PairIterator pi(A->sr, A->data);
     // if applying custom function, apply immediately on reduced form
     if (!has_rep_idx){
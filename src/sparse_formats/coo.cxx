@@ -1,5 +1,6 @@
 #include "coo.h"
 #include "csr.h"
+#include "dcsr.h"
 #include "../shared/util.h"
 #include "../contraction/ctr_comm.h"
 
@@ -23,7 +24,8 @@ namespace CTF_int {
     int64_t nnz = csr.nnz(); 
     int64_t v_sz = csr.val_size(); 
     int const * csr_ja = csr.JA();
-    int const * csr_ia = csr.IA();
+    CSR_IA64 cia(csr);
+    int64_t const * csr_ia = cia.ptr;
     char const * csr_vs = csr.vals();
 
     int64_t size = get_coo_size(nnz, v_sz);
@@ -38,6 +40,23 @@ namespace CTF_int {
     sr->csr_to_coo(nnz, csr.nrow(), csr_vs, csr_ja, csr_ia, vs, coo_rs, coo_cs);
   }
 
+  COO_Matrix::COO_Matrix(DCSR_Matrix const & dcsr, algstrct const * sr){
+    int64_t nnz = dcsr.nnz(); 
+    int64_t v_sz = dcsr.val_size(); 
+
+    int64_t size = get_coo_size(nnz, v_sz);
+    all_data = (char*)alloc(size);
+    ((int64_t*)all_data)[0] = nnz;
+    ((int64_t*)all_data)[1] = v_sz;
+    
+    int * coo_rs = rows();
+    sr->csr_to_coo(nnz, dcsr.nnz_row(), dcsr.vals(), dcsr.JA(), dcsr.IA(), vals(), coo_rs, cols());
+    int const * dcsr_rows = dcsr.row_inds();
+    for (int64_t i=0; i<nnz; i++){
+      coo_rs[i] = dcsr_rows[coo_rs[i]-1];
+    }
+  }
+
   int64_t COO_Matrix::nnz() const {
     return ((int64_t*)all_data)[0];
   }
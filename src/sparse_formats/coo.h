@@ -6,6 +6,7 @@
 namespace CTF_int {
 
   class CSR_Matrix;
+  class DCSR_Matrix;
   class bivar_function;
 
   int64_t get_coo_size(int64_t nnz, int val_size);
@@ -36,6 +37,13 @@ namespace CTF_int {
        */
       COO_Matrix(CSR_Matrix const & csr, algstrct const * sr);
 
+      /** 
+       * \brief constructor that constructs serialized COO Matrix from a DCSR_Matrix
+       * \param[in] dcsr a matrix in DCSR format
+       * \param[in] sr algebraic structure
+       */
+      COO_Matrix(DCSR_Matrix const & dcsr, algstrct const * sr);
+
       /** \brief retrieves number of nonzeros out of all_data */
       int64_t nnz() const;
 
@@ -0,0 +1,427 @@
+#include "csf.h"
+#include "../contraction/ctr_comm.h"
+#include "../shared/util.h"
+#include <algorithm>
+
+#define ALIGN CSR_ALIGN
+
+namespace CTF_int {
+  /** \brief offset of the values of a serialized CSF tensor */
+  static int64_t get_csf_vals_offset(int order){
+    int64_t offset = (3+order)*sizeof(int64_t) + 2*order*sizeof(int);
+    if (offset % ALIGN != 0) offset += ALIGN-(offset%ALIGN);
+    return offset;
+  }
+
+  /** \brief offset of the pointers of level lvl (or, if lvl=order-1, of the first index array) of a serialized CSF tensor */
+  static int64_t get_csf_fptr_offset(int order, int64_t const * nfib, int val_size, int lvl){
+    int64_t offset = get_csf_vals_offset(order);
+    offset += nfib[order-1]*val_size;
+    if (offset % ALIGN != 0) offset += ALIGN-(offset%ALIGN);
+    for (int l=0; l<lvl; l++){
+      offset += (nfib[l]+1)*sizeof(int64_t);
+      if (offset % ALIGN != 0) offset += ALIGN-(offset%ALIGN);
+    }
+    return offset;
+  }
+
+  /** \brief offset of the indices of level lvl of a serialized CSF tensor */
+  static int64_t get_csf_fids_offset(int order, int64_t const * nfib, int val_size, int lvl){
+    int64_t offset = get_csf_fptr_offset(order, nfib, val_size, order-1);
+    for (int l=0; l<lvl; l++){
+      offset += nfib[l]*sizeof(int);
+      if (offset % ALIGN != 0) offset += ALIGN-(offset%ALIGN);
+    }
+    return offset;
+  }
+
+  int64_t get_csf_size(int order, int64_t const * nfib, int val_size){
+    return get_csf_fids_offset(order, nfib, val_size, order);
+  }
+
+  CSF_Tensor::CSF_Tensor(char * all_data_){
+    ASSERT(ALIGN >= 16);
+    all_data = all_data_;
+  }
+
+  CSF_Tensor::CSF_Tensor(int64_t nnz, int order, int const * lens, int const * mode_order, char const * pairs, algstrct const * sr){
+    ASSERT(ALIGN >= 16);
+    ASSERT(order > 0);
+    int mo[order];
+    bool is_natural = true;
+    for (int l=0; l<order; l++){
+      mo[l] = mode_order == NULL ? order-1-l : mode_order[l];
+      if (mo[l] != order-1-l) is_natural = false;
+    }
+    int64_t lda[order];
+    lda[0] = 1;
+    for (int i=1; i<order; i++){
+      lda[i] = lda[i-1]*lens[i-1];
+    }
+    ConstPairIterator pi(sr, pairs);
+    //if the modes are not stored in order of significance in the key, the pairs are visited by increasing key with permuted modes
+    std::pair<int64_t,int64_t> * perm = NULL;
+    if (!is_natural){
+      int64_t plda[order];
+      plda[order-1] = 1;
+      for (int l=order-2; l>=0; l--){
+        plda[l] = plda[l+1]*lens[mo[l+1]];
+      }
+      perm = (std::pair<int64_t,int64_t>*)alloc(sizeof(std::pair<int64_t,int64_t>)*std::max(nnz,(int64_t)1));
+#ifdef _OPENMP
+      #pragma omp parallel for
+#endif
+      for (int64_t i=0; i<nnz; i++){
+        int64_t k = pi[i].k();
+        int64_t pk = 0;
+        for (int l=0; l<order; l++){
+          pk += ((k/lda[mo[l]])%lens[mo[l]])*plda[l];
+        }
+        perm[i] = std::pair<int64_t,int64_t>(pk, i);
+      }
+      std::sort(perm, perm+nnz);
+    }
+
+    //a nonzero starts a new node at each level from the first at which its index differs from that of the previous nonzero
+    int64_t nfib[order];
+    std::fill(nfib, nfib+order, 0);
+    int prev[order];
+    for (int64_t t=0; t<nnz; t++){
+      int64_t k = pi[perm == NULL ? t : perm[t].second].k();
+      bool is_new = (t == 0);
+      for (int l=0; l<order; l++){
+        int idx = (k/lda[mo[l]])%lens[mo[l]];
+        if (is_new || idx != prev[l]){
+          is_new = true;
+          nfib[l]++;
+          prev[l] = idx;
+        }
+      }
+    }
+
+    int v_sz = sr->el_size;
+    all_data = (char*)alloc(get_csf_size(order, nfib, v_sz));
+    ((int64_t*)all_data)[0] = nnz;
+    ((int64_t*)all_data)[1] = v_sz;
+    ((int64_t*)all_data)[2] = order;
+    memcpy(((int64_t*)all_data)+3, nfib, order*sizeof(int64_t));
+    memcpy(this->lens(), lens, order*sizeof(int));
+    memcpy(this->mode_order(), mo, order*sizeof(int));
+
+    char * vs = vals();
+    int64_t * fps[order];
+    int * fis[order];
+    for (int l=0; l<order; l++){
+      if (l < order-1) fps[l] = fptr(l);
+      fis[l] = fids(l);
+    }
+    int64_t cnt[order];
+    std::fill(cnt, cnt+order, 0);
+    for (int64_t t=0; t<nnz; t++){
+      int64_t i = perm == NULL ? t : perm[t].second;
+      int64_t k = pi[i].k();
+      bool is_new = (t == 0);
+      for (int l=0; l<order; l++){
+        int idx = (k/lda[mo[l]])%lens[mo[l]];
+        if (is_new || idx != prev[l]){
+          is_new = true;
+          fis[l][cnt[l]] = idx;
+          if (l < order-1) fps[l][cnt[l]] = cnt[l+1];
+          cnt[l]++;
+          prev[l] = idx;
+        }
+      }
+      memcpy(vs+t*v_sz, pi[i].d(), v_sz);
+    }
+    for (int l=0; l<order-1; l++){
+      fps[l][nfib[l]] = nfib[l+1];
+    }
+    if (perm != NULL) cdealloc(perm);
+  }
+
+  int64_t CSF_Tensor::nnz() const {
+    return ((int64_t*)all_data)[0];
+  }
+
+  int CSF_Tensor::val_size() const {
+    return ((int64_t*)all_data)[1];
+  }
+
+  int CSF_Tensor::order() const {
+    return ((int64_t*)all_data)[2];
+  }
+
+  int64_t CSF_Tensor::nfib(int lvl) const {
+    return ((int64_t*)all_data)[3+lvl];
+  }
+
+  int64_t CSF_Tensor::size() const {
+    return get_csf_size(order(), ((int64_t*)all_data)+3, val_size());
+  }
+
+  int * CSF_Tensor::lens() const {
+    return (int*)(all_data + (3+order())*sizeof(int64_t));
+  }
+
+  int * CSF_Tensor::mode_order() const {
+    return (int*)(all_data + (3+order())*sizeof(int64_t) + order()*sizeof(int));
+  }
+
+  char * CSF_Tensor::vals() const {
+    return all_data + get_csf_vals_offset(order());
+  }
+
+  int64_t * CSF_Tensor::fptr(int lvl) const {
+    ASSERT(lvl < order()-1);
+    return (int64_t*)(all_data + get_csf_fptr_offset(order(), ((int64_t*)all_data)+3, val_size(), lvl));
+  }
+
+  int * CSF_Tensor::fids(int lvl) const {
+    return (int*)(all_data + get_csf_fids_offset(order(), ((int64_t*)all_data)+3, val_size(), lvl));
+  }
+
+  void CSF_Tensor::get_pairs(char * pairs, algstrct const * sr) const {
+    int ord = order();
+    int const * lns = lens();
+    int const * mo = mode_order();
+    int64_t lda[ord];
+    lda[0] = 1;
+    for (int i=1; i<ord; i++){
+      lda[i] = lda[i-1]*lns[i-1];
+    }
+    int64_t const * fps[ord];
+    int const * fis[ord];
+    for (int l=0; l<ord; l++){
+      if (l < ord-1) fps[l] = fptr(l);
+      fis[l] = fids(l);
+    }
+    int64_t n = nnz();
+    int v_sz = val_size();
+    char const * vs = vals();
+    PairIterator pi(sr, pairs);
+    //each level is walked in order along with its parent, so that the key of each node is that of its parent plus its index
+    int64_t * keys = (int64_t*)alloc(sizeof(int64_t)*std::max(n,(int64_t)1));
+    int64_t * pkeys = (int64_t*)alloc(sizeof(int64_t)*std::max(n,(int64_t)1));
+    for (int64_t f=0; f<nfib(0); f++){
+      keys[f] = fis[0][f]*lda[mo[0]];
+    }
+    for (int l=1; l<ord; l++){
+      std::swap(keys, pkeys);
+#ifdef _OPENMP
+      #pragma omp parallel for
+#endif
+      for (int64_t p=0; p<nfib(l-1); p++){
+        for (int64_t f=fps[l-1][p]; f<fps[l-1][p+1]; f++){
+          keys[f] = pkeys[p] + fis[l][f]*lda[mo[l]];
+        }
+      }
+    }
+    for (int64_t i=0; i<n; i++){
+      pi[i].write_key(keys[i]);
+      pi[i].write_val(vs+i*v_sz);
+    }
+    cdealloc(keys);
+    cdealloc(pkeys);
+    bool is_natural = true;
+    for (int l=0; l<ord; l++){
+      if (mo[l] != ord-1-l) is_natural = false;
+    }
+    if (!is_natural) pi.sort(n);
+  }
+
+  void CSF_Tensor::print(algstrct const * sr){
+    int ord = order();
+    int const * mo = mode_order();
+    printf("CSF tensor of order %d with %ld nonzeros, modes stored in order",ord,nnz());
+    for (int l=0; l<ord; l++){
+      printf(" %d",mo[l]);
+    }
+    printf("\n");
+    for (int l=0; l<ord; l++){
+      printf("level %d has %ld fibers\n",l,nfib(l));
+    }
+    char * pairs = (char*)alloc(sr->pair_size()*std::max(nnz(),(int64_t)1));
+    get_pairs(pairs, sr);
+    ConstPairIterator pi(sr, pairs);
+    for (int64_t i=0; i<nnz(); i++){
+      printf("[%ld] ",pi[i].k());
+      sr->print(pi[i].d());
+      printf("\n");
+    }
+    cdealloc(pairs);
+  }
+
+  /** \brief arguments of the traversal of the fibers of a CSF tensor by CSF_Tensor::csfctr */
+  struct csfctr_args {
+    int                    order_A;
+    int64_t const * const* fptr_A;
+    int const * const *    fids_A;
+    char const *           vals_A;
+    int64_t const *        lda_B_lvl;
+    int64_t const *        lda_C_lvl;
+    int64_t                nfree;
+    int64_t const *        offs_B_free;
+    int64_t const *        offs_C_free;
+    char const *           alpha;
+    char const *           B;
+    char *                 C;
+    algstrct const *       sr_A;
+    algstrct const *       sr_B;
+    algstrct const *       sr_C;
+    bivar_function const * func;
+  };
+
+  /** \brief accumulates the contributions of the subtree of node f at level lvl, given the offsets of its ancestors into B and C */
+  static void csfctr_rec(csfctr_args const & a, int lvl, int64_t f, int64_t off_B, int64_t off_C){
+    off_B += a.fids_A[lvl][f]*a.lda_B_lvl[lvl];
+    off_C += a.fids_A[lvl][f]*a.lda_C_lvl[lvl];
+    if (lvl < a.order_A-1){
+      for (int64_t g=a.fptr_A[lvl][f]; g<a.fptr_A[lvl][f+1]; g++){
+        csfctr_rec(a, lvl+1, g, off_B, off_C);
+      }
+      return;
+    }
+    int el_B = a.sr_B->el_size;
+    int el_C = a.sr_C->el_size;
+    char const * val = a.vals_A + f*a.sr_A->el_size;
+    if (a.func == NULL){
+      char val_alpha[el_C];
+      if (a.alpha != NULL && !a.sr_C->isequal(a.alpha, a.sr_C->mulid()))
+        a.sr_C->mul(val, a.alpha, val_alpha);
+      else
+        memcpy(val_alpha, val, el_C);
+      for (int64_t i=0; i<a.nfree; i++){
+        char tmp[el_C];
+        a.sr_C->mul(val_alpha, a.B+(off_B+a.offs_B_free[i])*el_B, tmp);
+        a.sr_C->add(tmp, a.C+(off_C+a.offs_C_free[i])*el_C, a.C+(off_C+a.offs_C_free[i])*el_C);
+      }
+    } else {
+      for (int64_t i=0; i<a.nfree; i++){
+        a.func->acc_f(val, a.B+(off_B+a.offs_B_free[i])*el_B, a.C+(off_C+a.offs_C_free[i])*el_C, a.sr_C);
+      }
+    }
+  }
+
+  void CSF_Tensor::csfctr(char const *           alpha,
+                          char const *           A,
+                          algstrct const *       sr_A,
+                          int const *            idx_map_A,
+                          char const *           B,
+                          algstrct const *       sr_B,
+                          int                    order_B,
+                          int const *            edge_len_B,
+                          int const *            idx_map_B,
+                          char *                 C,
+                          algstrct const *       sr_C,
+                          int                    order_C,
+                          int const *            edge_len_C,
+                          int const *            idx_map_C,
+                          bivar_function const * func){
+    TAU_FSTART(csfctr);
+    CSF_Tensor cA((char*)A);
+    int order_A = cA.order();
+    int const * mo = cA.mode_order();
+    ASSERT(func != NULL || sr_A->el_size == sr_C->el_size);
+    ASSERT(func == NULL || alpha == NULL || sr_C->isequal(alpha, sr_C->mulid()));
+    if (cA.nnz() == 0){
+      TAU_FSTOP(csfctr);
+      return;
+    }
+
+    int idx_max = 0;
+    for (int i=0; i<order_A; i++) idx_max = std::max(idx_max, idx_map_A[i]+1);
+    for (int i=0; i<order_B; i++) idx_max = std::max(idx_max, idx_map_B[i]+1);
+    for (int i=0; i<order_C; i++) idx_max = std::max(idx_max, idx_map_C[i]+1);
+    //stride in B and C of each index, 0 if absent
+    int64_t lda_B[idx_max], lda_C[idx_max];
+    int len[idx_max];
+    bool in_A[idx_max];
+    std::fill(lda_B, lda_B+idx_max, 0);
+    std::fill(lda_C, lda_C+idx_max, 0);
+    std::fill(len, len+idx_max, 1);
+    std::fill(in_A, in_A+idx_max, false);
+    int64_t lda = 1;
+    for (int i=0; i<order_B; i++){
+      lda_B[idx_map_B[i]] = lda;
+      len[idx_map_B[i]] = edge_len_B[i];
+      lda *= edge_len_B[i];
+    }
+    lda = 1;
+    for (int i=0; i<order_C; i++){
+      lda_C[idx_map_C[i]] = lda;
+      len[idx_map_C[i]] = edge_len_C[i];
+      lda *= edge_len_C[i];
+    }
+    for (int i=0; i<order_A; i++) in_A[idx_map_A[i]] = true;
+
+    int64_t lda_B_lvl[order_A], lda_C_lvl[order_A];
+    for (int l=0; l<order_A; l++){
+      lda_B_lvl[l] = lda_B[idx_map_A[mo[l]]];
+      lda_C_lvl[l] = lda_C[idx_map_A[mo[l]]];
+    }
+
+    //offsets into B and C of all combinations of the indices absent from A, iterated over at each leaf
+    int64_t nfree = 1;
+    for (int i=0; i<idx_max; i++){
+      if (!in_A[i]) nfree *= len[i];
+    }
+    int64_t * offs_B_free = (int64_t*)alloc(sizeof(int64_t)*nfree);
+    int64_t * offs_C_free = (int64_t*)alloc(sizeof(int64_t)*nfree);
+    offs_B_free[0] = 0;
+    offs_C_free[0] = 0;
+    int64_t nf = 1;
+    for (int i=0; i<idx_max; i++){
+      if (in_A[i]) continue;
+      for (int j=1; j<len[i]; j++){
+        for (int64_t f=0; f<nf; f++){
+          offs_B_free[j*nf+f] = offs_B_free[f] + j*lda_B[i];
+          offs_C_free[j*nf+f] = offs_C_free[f] + j*lda_C[i];
+        }
+      }
+      nf *= len[i];
+    }
+
+    int64_t const * fps[order_A];
+    int const * fis[order_A];
+    for (int l=0; l<order_A; l++){
+      if (l < order_A-1) fps[l] = cA.fptr(l);
+      fis[l] = cA.fids(l);
+    }
+    csfctr_args args;
+    args.order_A     = order_A;
+    args.fptr_A      = fps;
+    args.fids_A      = fis;
+    args.vals_A      = cA.vals();
+    args.lda_B_lvl   = lda_B_lvl;
+    args.lda_C_lvl   = lda_C_lvl;
+    args.nfree       = nfree;
+    args.offs_B_free = offs_B_free;
+    args.offs_C_free = offs_C_free;
+    args.alpha       = alpha;
+    args.B           = B;
+    args.C           = C;
+    args.sr_A        = sr_A;
+    args.sr_B        = sr_B;
+    args.sr_C        = sr_C;
+    args.func        = func;
+
+    int64_t nroot = cA.nfib(0);
+    //distinct root fibers update disjoint parts of C only if the root index is an index of C
+    if (lda_C_lvl[0] != 0){
+#ifdef _OPENMP
+      #pragma omp parallel for schedule(dynamic)
+#endif
+      for (int64_t f=0; f<nroot; f++){
+        csfctr_rec(args, 0, f, 0, 0);
+      }
+    } else {
+      for (int64_t f=0; f<nroot; f++){
+        csfctr_rec(args, 0, f, 0, 0);
+      }
+    }
+    CTF_FLOPS_ADD(2*cA.nnz()*nfree);
+    cdealloc(offs_B_free);
+    cdealloc(offs_C_free);
+    TAU_FSTOP(csfctr);
+  }
+}
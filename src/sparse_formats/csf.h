@@ -0,0 +1,134 @@
+#ifndef __CSF_H__
+#define __CSF_H__
+
+#include "../tensor/algstrct.h"
+#include "csr.h"
+
+namespace CTF_int {
+
+  class bivar_function;
+
+  /**
+   * \brief computes the size of a serialized CSF tensor
+   * \param[in] order number of modes of the tensor
+   * \param[in] nfib number of nodes at each level of the fiber tree (nfib[order-1] is the number of nonzeros)
+   * \param[in] val_size size of each tensor entry
+   */
+  int64_t get_csf_size(int order, int64_t const * nfib, int val_size);
+
+  /**
+   * \brief abstraction for a serialized sparse tensor stored in compressed-sparse-fiber (CSF) layout,
+   *        a tree whose level l holds the distinct indices in mode mode_order()[l] of each fiber of the levels above,
+   *        so that indices shared by many nonzeros are stored and traversed once,
+   *        level pointers are 64-bit while the indices (bounded by the edge lengths) are 32-bit and start from 0
+   */
+  class CSF_Tensor{
+    public:
+      /** \brief serialized buffer containing all info, index, and values related to the tensor */
+      char * all_data;
+
+      /** \brief constructor given serialized CSF tensor */
+      CSF_Tensor(char * all_data);
+
+      CSF_Tensor(){ all_data=NULL; }
+
+      CSF_Tensor(CSF_Tensor const & other){ all_data=other.all_data; }
+
+      /**
+       * \brief constructor given the (key, value) pairs of a sparse tensor sorted by key, allocates all_data
+       * \param[in] nnz number of pairs
+       * \param[in] order number of modes of the tensor
+       * \param[in] lens edge lengths of the tensor, with which the keys are formed
+       * \param[in] mode_order mode stored at each level of the tree from the root, if NULL modes are stored
+       *            from the most to the least significant in the key, which requires no reordering of the pairs
+       * \param[in] pairs (key, value) pairs
+       * \param[in] sr algebraic structure of the values
+       */
+      CSF_Tensor(int64_t nnz, int order, int const * lens, int const * mode_order, char const * pairs, algstrct const * sr);
+
+      /** \brief retrieves number of nonzeros out of all_data */
+      int64_t nnz() const;
+
+      /** \brief retrieves buffer size out of all_data */
+      int64_t size() const;
+
+      /** \brief retrieves number of modes out of all_data */
+      int order() const;
+
+      /** \brief retrieves tensor entry size out of all_data */
+      int val_size() const;
+
+      /** \brief retrieves number of nodes at level lvl of the tree */
+      int64_t nfib(int lvl) const;
+
+      /** \brief retrieves edge lengths of the tensor (of size order()) */
+      int * lens() const;
+
+      /** \brief retrieves mode stored at each level of the tree (of size order()) */
+      int * mode_order() const;
+
+      /** \brief retrieves array of values of the leaves out of all_data */
+      char * vals() const;
+
+      /**
+       * \brief retrieves the pointers of level lvl < order()-1, the children of node f are the
+       *        nodes fptr(lvl)[f] to fptr(lvl)[f+1]-1 at level lvl+1 (of size nfib(lvl)+1)
+       */
+      int64_t * fptr(int lvl) const;
+
+      /** \brief retrieves the index in mode mode_order()[lvl] of each node at level lvl (of size nfib(lvl)) */
+      int * fids(int lvl) const;
+
+      /**
+       * \brief writes out the (key, value) pairs of the tensor, sorted by key
+       * \param[out] pairs preallocated buffer of nnz() pairs
+       * \param[in] sr algebraic structure of the values
+       */
+      void get_pairs(char * pairs, algstrct const * sr) const;
+
+      /**
+       * \brief outputs tensor data to stdout, intended for debugging
+       * \param[in] sr algebraic structure allowing print
+       */
+      void print(algstrct const * sr);
+
+      /**
+       * \brief computes C = C + func(alpha*A*B) where A is a CSF_Tensor, while B and C are dense and nonsymmetric,
+       *        by traversing the fibers of A, so that the offsets into B and C are computed once per node;
+       *        the indices of B and C absent from A are iterated over innermost, and if the root mode of A
+       *        is an index of C, the root fibers are processed by different threads
+       * \param[in] alpha scaling factor for A*B
+       * \param[in] A serialized CSF tensor
+       * \param[in] sr_A algebraic structure of A
+       * \param[in] idx_map_A index of each mode of A
+       * \param[in] B dense tensor
+       * \param[in] sr_B algebraic structure of B
+       * \param[in] order_B number of modes of B
+       * \param[in] edge_len_B edge lengths of B
+       * \param[in] idx_map_B index of each mode of B
+       * \param[in,out] C dense tensor
+       * \param[in] sr_C algebraic structure of C
+       * \param[in] order_C number of modes of C
+       * \param[in] edge_len_C edge lengths of C
+       * \param[in] idx_map_C index of each mode of C
+       * \param[in] func bivariate function applied to pairs of entries of A and B, or NULL for multiplication
+       */
+      static void csfctr(char const *           alpha,
+                         char const *           A,
+                         algstrct const *       sr_A,
+                         int const *            idx_map_A,
+                         char const *           B,
+                         algstrct const *       sr_B,
+                         int                    order_B,
+                         int const *            edge_len_B,
+                         int const *            idx_map_B,
+                         char *                 C,
+                         algstrct const *       sr_C,
+                         int                    order_C,
+                         int const *            edge_len_C,
+                         int const *            idx_map_C,
+                         bivar_function const * func);
+  };
+}
+
+#endif
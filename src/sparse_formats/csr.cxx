@@ -2,38 +2,82 @@
 #include "../contraction/ctr_comm.h"
 #include "../shared/util.h"
 
-#define ALIGN 256
+#define ALIGN CSR_ALIGN
 
 namespace CTF_int {
-  int64_t get_csr_size(int64_t nnz, int nrow_, int val_size){
-    int offset = 4*sizeof(int64_t);
+  int get_csr_ia_size(int64_t nnz){
+    //the last row pointer is nnz+1
+    return nnz < INT_MAX ? sizeof(int) : sizeof(int64_t);
+  }
+
+  int64_t get_csr_size(int64_t nnz, int nrow_, int val_size, int ia_size){
+    if (ia_size == 0) ia_size = get_csr_ia_size(nnz);
+    int64_t offset = 5*sizeof(int64_t);
     if (offset % ALIGN != 0) offset += ALIGN-(offset%ALIGN);
     offset += nnz*val_size;
     if (offset % ALIGN != 0) offset += ALIGN-(offset%ALIGN);
-    offset += (nrow_+1)*sizeof(int);
+    offset += (nrow_+1)*ia_size;
     if (offset % ALIGN != 0) offset += ALIGN-(offset%ALIGN);
     offset += sizeof(int)*nnz;
     if (offset % ALIGN != 0) offset += ALIGN-(offset%ALIGN);
     return offset;
   }
 
-  CSR_Matrix::CSR_Matrix(int64_t nnz, int nrow_, int ncol, int el_size){
-    ASSERT(ALIGN >= 16);
-    int64_t size = get_csr_size(nnz, nrow_, el_size);
-    all_data = (char*)alloc(size);
+  int * get_int_csr_ptrs(int nrow, int64_t const * IA){
+    if (IA[nrow]-1 > INT_MAX) return NULL;
+    int * iIA = (int*)alloc(sizeof(int)*(nrow+1));
+#ifdef USE_OMP
+    #pragma omp parallel for
+#endif
+    for (int i=0; i<nrow+1; i++){
+      iIA[i] = (int)IA[i];
+    }
+    return iIA;
+  }
+
+  void set_csr_ptrs(int nrow, int const * iIA, int64_t * IA){
+#ifdef USE_OMP
+    #pragma omp parallel for
+#endif
+    for (int i=0; i<nrow+1; i++){
+      IA[i] = iIA[i];
+    }
+  }
+
+  void get_csr_unit_counts(int s, int64_t const * szs, int64_t const * displs, int * cnts, int * offs){
+    for (int i=0; i<s; i++){
+      ASSERT(szs[i] % CSR_ALIGN == 0 && displs[i] % CSR_ALIGN == 0);
+      if ((displs[i]+szs[i])/CSR_ALIGN > INT_MAX){
+        printf("CTF ERROR: sparse reduction message of %ld bytes is too large\n", displs[i]+szs[i]);
+        ASSERT(0);
+      }
+      cnts[i] = szs[i]/CSR_ALIGN;
+      offs[i] = displs[i]/CSR_ALIGN;
+    }
+  }
+
+  static void set_csr_header(char * all_data, int64_t nnz, int64_t val_size, int nrow, int ncol, int ia_size){
     ((int64_t*)all_data)[0] = nnz;
-    ((int64_t*)all_data)[1] = el_size;
-    ((int64_t*)all_data)[2] = (int64_t)nrow_;
+    ((int64_t*)all_data)[1] = val_size;
+    ((int64_t*)all_data)[2] = (int64_t)nrow;
     ((int64_t*)all_data)[3] = ncol;
+    ((int64_t*)all_data)[4] = ia_size == 0 ? get_csr_ia_size(nnz) : ia_size;
+  }
+
+  CSR_Matrix::CSR_Matrix(int64_t nnz, int nrow_, int ncol, int el_size, int ia_size){
+    ASSERT(ALIGN >= 5*sizeof(int64_t));
+    int64_t size = get_csr_size(nnz, nrow_, el_size, ia_size);
+    all_data = (char*)alloc(size);
+    set_csr_header(all_data, nnz, el_size, nrow_, ncol, ia_size);
   }
 
   CSR_Matrix::CSR_Matrix(char * all_data_){
-    ASSERT(ALIGN >= 16);
+    ASSERT(ALIGN >= 5*sizeof(int64_t));
     all_data = all_data_;
   }
 
   CSR_Matrix::CSR_Matrix(COO_Matrix const & coom, int nrow_, int ncol, algstrct const * sr, char * data){
-    ASSERT(ALIGN >= 16);
+    ASSERT(ALIGN >= 5*sizeof(int64_t));
     int64_t nz = coom.nnz(); 
     int64_t v_sz = coom.val_size(); 
     int const * coo_rs = coom.rows();
@@ -45,19 +89,19 @@ namespace CTF_int {
       all_data = (char*)alloc(size);
     else
       all_data = data;
-    ((int64_t*)all_data)[0] = nz;
-    ((int64_t*)all_data)[1] = v_sz;
-    ((int64_t*)all_data)[2] = (int64_t)nrow_;
-    ((int64_t*)all_data)[3] = ncol;
+    set_csr_header(all_data, nz, v_sz, nrow_, ncol, 0);
 
     char * csr_vs = vals();
     int * csr_ja = JA();
-    int * csr_ia = IA();
-
-    //memcpy(csr_vs, vs, nz*v_sz);
-    //memset(csr_ja
+    //the conversion produces 64-bit row pointers, which are narrowed if the matrix stores 32-bit ones
+    int64_t * csr_ia = IA64();
+    if (csr_ia == NULL) csr_ia = (int64_t*)alloc(sizeof(int64_t)*(nrow_+1));
 
     sr->coo_to_csr(nz, nrow_, csr_vs, csr_ja, csr_ia, vs, coo_rs, coo_cs);
+    if (csr_ia != IA64()){
+      set_IA(csr_ia);
+      cdealloc(csr_ia);
+    }
 /*    for (int i=0; i<nrow_; i++){
       printf("csr_ja[%d] = %d\n",i,csr_ja[i]);
     }
@@ -77,7 +121,11 @@ namespace CTF_int {
 
 
   int64_t CSR_Matrix::size() const {
-    return get_csr_size(nnz(),nrow(),val_size());
+    return get_csr_size(nnz(),nrow(),val_size(),ia_size());
+  }
+
+  int CSR_Matrix::ia_size() const {
+    return ((int64_t*)all_data)[4];
   }
   
   int CSR_Matrix::nrow() const {
@@ -89,35 +137,66 @@ namespace CTF_int {
   }
   
   char * CSR_Matrix::vals() const {
-    int offset = 4*sizeof(int64_t);
+    int64_t offset = 5*sizeof(int64_t);
     if (offset % ALIGN != 0) offset += ALIGN-(offset%ALIGN);
     return all_data + offset;
   }
 
-  int * CSR_Matrix::IA() const {
-    int64_t n = this->nnz();
-    int v_sz = this->val_size();
-
-    int offset = 4*sizeof(int64_t);
-    if (offset % ALIGN != 0) offset += ALIGN-(offset%ALIGN);
-    offset += n*v_sz;
+  /** \brief retrieves the row pointers, of the width given by ia_size(), out of all_data */
+  static char * get_csr_ia(CSR_Matrix const & A){
+    int64_t offset = A.vals()-A.all_data + A.nnz()*A.val_size();
     if (offset % ALIGN != 0) offset += ALIGN-(offset%ALIGN);
+    return A.all_data + offset;
+  }
 
-    return (int*)(all_data + offset);
+  int * CSR_Matrix::IA32() const {
+    return ia_size() == sizeof(int) ? (int*)get_csr_ia(*this) : NULL;
+  }
+
+  int64_t * CSR_Matrix::IA64() const {
+    return ia_size() == sizeof(int64_t) ? (int64_t*)get_csr_ia(*this) : NULL;
+  }
+
+  void CSR_Matrix::set_IA(int64_t const * IA){
+    int nr = nrow();
+    if (ia_size() == sizeof(int64_t)){
+      memcpy(IA64(), IA, sizeof(int64_t)*(nr+1));
+    } else {
+      int * ia = IA32();
+#ifdef USE_OMP
+      #pragma omp parallel for
+#endif
+      for (int i=0; i<nr+1; i++){
+        ia[i] = (int)IA[i];
+      }
+    }
+  }
+
+  void CSR_Matrix::set_IA(int const * IA){
+    if (ia_size() == sizeof(int))
+      memcpy(IA32(), IA, sizeof(int)*(nrow()+1));
+    else
+      set_csr_ptrs(nrow(), IA, IA64());
+  }
+
+  CSR_IA64::CSR_IA64(CSR_Matrix const & A){
+    copy = NULL;
+    if (A.ia_size() == sizeof(int64_t)){
+      ptr = A.IA64();
+    } else {
+      copy = (int64_t*)alloc(sizeof(int64_t)*(A.nrow()+1));
+      set_csr_ptrs(A.nrow(), A.IA32(), copy);
+      ptr = copy;
+    }
+  }
+
+  CSR_IA64::~CSR_IA64(){
+    if (copy != NULL) cdealloc(copy);
   } 
 
   int * CSR_Matrix::JA() const {
-    int64_t n = this->nnz();
-    int64_t nr = this->nrow();
-    int v_sz = this->val_size();
-
-    int offset = 4*sizeof(int64_t);
+    int64_t offset = get_csr_ia(*this)-all_data + (((int64_t)nrow())+1)*ia_size();
     if (offset % ALIGN != 0) offset += ALIGN-(offset%ALIGN);
-    offset += n*v_sz;
-    if (offset % ALIGN != 0) offset += ALIGN-(offset%ALIGN);
-    offset += (nr+1)*sizeof(int);
-    if (offset % ALIGN != 0) offset += ALIGN-(offset%ALIGN);
-    //return (int*)(all_data + n*v_sz+(nr+1)*sizeof(int)+3*sizeof(int64_t));
     return (int*)(all_data + offset);
   } 
 
@@ -130,7 +209,8 @@ namespace CTF_int {
       CSR_Matrix cA((char*)A);
       int64_t nz = cA.nnz(); 
       int const * ja = cA.JA();
-      int const * ia = cA.IA();
+      CSR_IA64 cia(cA);
+      int64_t const * ia = cia.ptr;
       char const * vs = cA.vals();
       if (func != NULL){
         assert(sr_C->isequal(beta, sr_C->mulid()));
@@ -154,12 +234,14 @@ namespace CTF_int {
       CSR_Matrix cA((char*)A);
       int64_t nzA = cA.nnz(); 
       int const * jA = cA.JA();
-      int const * iA = cA.IA();
+      CSR_IA64 ciA(cA);
+      int64_t const * iA = ciA.ptr;
       char const * vsA = cA.vals();
       CSR_Matrix cB((char*)B);
       int64_t nzB = cB.nnz(); 
       int const * jB = cB.JA();
-      int const * iB = cB.IA();
+      CSR_IA64 ciB(cB);
+      int64_t const * iB = ciB.ptr;
       char const * vsB = cB.vals();
       if (func != NULL){
         assert(sr_C->isequal(beta, sr_C->mulid()));
@@ -175,7 +257,7 @@ namespace CTF_int {
 
   }
 
-  void CSR_Matrix::csrmultcsr(char const * A, algstrct const * sr_A, int m, int n, int k, char const * alpha, char const * B, algstrct const * sr_B, char const * beta, char *& C, algstrct const * sr_C, bivar_function const * func, bool do_offload){
+  void CSR_Matrix::csrmultcsr(char const * A, algstrct const * sr_A, int m, int n, int k, char const * alpha, char const * B, algstrct const * sr_B, char const * beta, char *& C, algstrct const * sr_C, bivar_function const * func, bool do_offload, char const * M, bool is_mask_cmp){
     if (func != NULL && func->has_off_gemm && do_offload){
       assert(0);
       assert(sr_C->isequal(beta, sr_C->mulid()));
@@ -184,22 +266,34 @@ namespace CTF_int {
       CSR_Matrix cA((char*)A);
       int64_t nzA = cA.nnz(); 
       int const * jA = cA.JA();
-      int const * iA = cA.IA();
+      CSR_IA64 ciA(cA);
+      int64_t const * iA = ciA.ptr;
       char const * vsA = cA.vals();
       CSR_Matrix cB((char*)B);
       int64_t nzB = cB.nnz(); 
       int const * jB = cB.JA();
-      int const * iB = cB.IA();
+      CSR_IA64 ciB(cB);
+      int64_t const * iB = ciB.ptr;
       char const * vsB = cB.vals();
       if (func != NULL){
         assert(sr_C->isequal(beta, sr_C->mulid()));
         assert(alpha == NULL || sr_C->isequal(alpha, sr_C->mulid()));
-        func->ccsrmultcsr(m,n,k,vsA,jA,iA,nzA,vsB,jB,iB,nzB,C,sr_C);
+        if (M != NULL){
+          CSR_Matrix cM((char*)M);
+          CSR_IA64 ciM(cM);
+          func->cmasked_csrmultcsr(m,n,k,vsA,jA,iA,nzA,vsB,jB,iB,nzB,C,sr_C,cM.JA(),ciM.ptr,is_mask_cmp);
+        } else
+          func->ccsrmultcsr(m,n,k,vsA,jA,iA,nzA,vsB,jB,iB,nzB,C,sr_C);
       } else {
         ASSERT(sr_B->el_size == sr_A->el_size);
         ASSERT(sr_C->el_size == sr_A->el_size);
         assert(!do_offload);
-        sr_C->csrmultcsr(m,n,k,alpha,vsA,jA,iA,nzA,vsB,jB,iB,nzB,beta,C);
+        if (M != NULL){
+          CSR_Matrix cM((char*)M);
+          CSR_IA64 ciM(cM);
+          sr_C->masked_csrmultcsr(m,n,k,alpha,vsA,jA,iA,nzA,vsB,jB,iB,nzB,beta,C,cM.JA(),ciM.ptr,is_mask_cmp);
+        } else
+          sr_C->csrmultcsr(m,n,k,alpha,vsA,jA,iA,nzA,vsB,jB,iB,nzB,beta,C);
       }
     }
 
@@ -207,11 +301,13 @@ namespace CTF_int {
   }
 
   void CSR_Matrix::partition(int s, char ** parts_buffer, CSR_Matrix ** parts){
-    int part_nnz[s], part_nrows[s];
+    int64_t part_nnz[s];
+    int part_nrows[s];
     int m = nrow();
     int v_sz = val_size();
     char * org_vals = vals();
-    int * org_ia = IA();
+    CSR_IA64 cia(*this);
+    int64_t const * org_ia = cia.ptr;
     int * org_ja = JA();
     for (int i=0; i<s; i++){
       part_nnz[i] = 0;
@@ -227,23 +323,22 @@ namespace CTF_int {
     }
     alloc_ptr(tot_sz, (void**)parts_buffer);
     char * part_data = *parts_buffer;
+    int64_t * pia = (int64_t*)alloc(sizeof(int64_t)*(m/s+2));
     for (int i=0; i<s; i++){
-      ((int64_t*)part_data)[0] = part_nnz[i];
-      ((int64_t*)part_data)[1] = v_sz;
-      ((int64_t*)part_data)[2] = part_nrows[i];
-      ((int64_t*)part_data)[3] = ncol();
+      set_csr_header(part_data, part_nnz[i], v_sz, part_nrows[i], ncol(), 0);
       parts[i] = new CSR_Matrix(part_data);
       char * pvals = parts[i]->vals();
       int * pja = parts[i]->JA();
-      int * pia = parts[i]->IA();
       pia[0] = 1;
       for (int j=i, k=0; j<m; j+=s, k++){
         memcpy(pvals+(pia[k]-1)*v_sz, org_vals+(org_ia[j]-1)*v_sz, (org_ia[j+1]-org_ia[j])*v_sz);
         memcpy(pja+(pia[k]-1), org_ja+(org_ia[j]-1), (org_ia[j+1]-org_ia[j])*sizeof(int));
         pia[k+1] = pia[k]+org_ia[j+1]-org_ia[j];
       }
+      parts[i]->set_IA(pia);
       part_data += get_csr_size(part_nnz[i], part_nrows[i], v_sz);
     }
+    cdealloc(pia);
   }
       
   CSR_Matrix::CSR_Matrix(char * const * smnds, int s){
@@ -257,22 +352,23 @@ namespace CTF_int {
     int64_t v_sz = csrs[0]->val_size();
     int64_t tot_ncol = csrs[0]->ncol();
     all_data = (char*)alloc(get_csr_size(tot_nnz, tot_nrow, v_sz));
-    ((int64_t*)all_data)[0] = tot_nnz;
-    ((int64_t*)all_data)[1] = v_sz;
-    ((int64_t*)all_data)[2] = tot_nrow;
-    ((int64_t*)all_data)[3] = tot_ncol;
+    set_csr_header(all_data, tot_nnz, v_sz, tot_nrow, tot_ncol, 0);
     
     char * csr_vs = vals();
     int * csr_ja = JA();
-    int * csr_ia = IA();
+    int64_t * csr_ia = (int64_t*)alloc(sizeof(int64_t)*(tot_nrow+1));
+    CSR_IA64 * cpias[s];
+    for (int i=0; i<s; i++){
+      cpias[i] = new CSR_IA64(*csrs[i]);
+    }
 
     csr_ia[0] = 1;
 
     for (int i=0; i<tot_nrow; i++){
       int ipart = i%s;
       int const * pja = csrs[ipart]->JA();
-      int const * pia = csrs[ipart]->IA();
-      int i_nnz = pia[i/s+1]-pia[i/s];
+      int64_t const * pia = cpias[ipart]->ptr;
+      int64_t i_nnz = pia[i/s+1]-pia[i/s];
       memcpy(csr_vs+(csr_ia[i]-1)*v_sz,
              csrs[ipart]->vals()+(pia[i/s]-1)*v_sz,
              i_nnz*v_sz);
@@ -281,7 +377,10 @@ namespace CTF_int {
              i_nnz*sizeof(int));
       csr_ia[i+1] = csr_ia[i]+i_nnz;
     }
+    set_IA(csr_ia);
+    cdealloc(csr_ia);
     for (int i=0; i<s; i++){
+      delete cpias[i];
       delete csrs[i];
     }
   }
@@ -289,7 +388,8 @@ namespace CTF_int {
   void CSR_Matrix::print(algstrct const * sr){
     char * csr_vs = vals();
     int * csr_ja = JA();
-    int * csr_ia = IA();
+    CSR_IA64 cia(*this);
+    int64_t const * csr_ia = cia.ptr;
     int irow= 0;
     int v_sz = val_size();
     int64_t nz = nnz();
@@ -305,15 +405,15 @@ namespace CTF_int {
 
   void CSR_Matrix::compute_has_col(
                       int const * JA,
-                      int const * IA,
+                      int64_t const * IA,
                       int const * JB,
-                      int const * IB,
+                      int64_t const * IB,
                       int         i,
                       int *       has_col){
     for (int j=0; j<IA[i+1]-IA[i]; j++){
       int row_B = JA[IA[i]+j-1]-1;
       for (int k=0; k<IB[row_B+1]-IB[row_B]; k++){
-        int idx_B = IB[row_B]+k-1;
+        int64_t idx_B = IB[row_B]+k-1;
         has_col[JB[idx_B]-1] = 1;
       }
     }
@@ -328,14 +428,16 @@ namespace CTF_int {
 
     char const * vA = A.vals();
     int const * JA = A.JA();
-    int const * IA = A.IA();
+    CSR_IA64 cIA(A);
+    int64_t const * IA = cIA.ptr;
     int nrow = A.nrow();
     char const * vB = B.vals();
     int const * JB = B.JA();
-    int const * IB = B.IA();
+    CSR_IA64 cIB(B);
+    int64_t const * IB = cIB.ptr;
     ASSERT(nrow == B.nrow());
     int ncol = std::max(A.ncol(),B.ncol());
-    int * IC = (int*)alloc(sizeof(int)*(nrow+1));
+    int64_t * IC = (int64_t*)alloc(sizeof(int64_t)*(nrow+1));
     int * has_col = (int*)alloc(sizeof(int)*ncol);
     IC[0] = 1;
     for (int i=0; i<nrow; i++){
@@ -354,9 +456,7 @@ namespace CTF_int {
     CSR_Matrix C(IC[nrow]-1, nrow, ncol, el_size);
     char * vC = C.vals();
     int * JC = C.JA();
-    memcpy(C.IA(), IC, sizeof(int)*(nrow+1));
-    cdealloc(IC);
-    IC = C.IA();
+    C.set_IA(IC);
     int64_t * rev_col = (int64_t*)alloc(sizeof(int64_t)*ncol);
     for (int i=0; i<nrow; i++){
       memset(has_col, 0, sizeof(int)*ncol);
@@ -370,25 +470,25 @@ namespace CTF_int {
       for (int j=0; j<ncol; j++){
         if (has_col[j]){
           JC[IC[i]+vs-1] = j+1;
-          //FIXME:: overflow?
           rev_col[j] = (IC[i]+vs-1)*el_size;
           vs++;
         }
       }
       memset(has_col, 0, sizeof(int)*ncol);
       for (int j=0; j<IA[i+1]-IA[i]; j++){
-        int idx_A = IA[i]+j-1;
+        int64_t idx_A = IA[i]+j-1;
         memcpy(vC+rev_col[JA[idx_A]-1],vA+idx_A*el_size,el_size);
         has_col[JA[idx_A]-1] = 1;
       }
       for (int j=0; j<IB[i+1]-IB[i]; j++){
-        int idx_B = IB[i]+j-1;
+        int64_t idx_B = IB[i]+j-1;
         if (has_col[JB[idx_B]-1])
           adder->accum(vB+idx_B*el_size,vC+rev_col[JB[idx_B]-1]);
         else
           memcpy(vC+rev_col[JB[idx_B]-1],vB+idx_B*el_size,el_size);
       }
     }
+    cdealloc(IC);
     cdealloc(has_col);
     cdealloc(rev_col);
  /*   printf("nnz C is %ld\n", C.nnz());
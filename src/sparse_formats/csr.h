@@ -4,28 +4,73 @@
 #include "../tensor/algstrct.h"
 #include "coo.h"
 
+/** \brief alignment in bytes of the arrays of a serialized CSR matrix, the size of which is a multiple of it */
+#define CSR_ALIGN 256
+
 namespace CTF_int {
 
   class bivar_function;
 
+  /**
+   * \brief size in bytes of each row pointer of a CSR matrix with nnz nonzeros, 4 (int) if the
+   *        row pointers fit in an int and 8 (int64_t) otherwise
+   * \param[in] nnz number of nonzeros in matrix
+   */
+  int get_csr_ia_size(int64_t nnz);
+
   /**
    * \brief computes the size of a serialized CSR matrix 
    * \param[in] nnz number of nonzeros in matrix
    * \param[in] nrow number of rows in matrix
    * \param[in] val_size size of each matrix entry
+   * \param[in] ia_size size of each row pointer, get_csr_ia_size(nnz) by default
+   */
+  int64_t get_csr_size(int64_t nnz, int nrow, int val_size, int ia_size=0);
+
+  /**
+   * \brief copies the (64-bit) row pointers of a CSR matrix to 32-bit integers, for use by kernels
+   *        with 32-bit indices (e.g. MKL)
+   * \param[in] nrow number of rows in matrix
+   * \param[in] IA prefix sum of number of nonzeros for each row (of size nrow+1)
+   * \return newly allocated 32-bit copy of IA, or NULL if the number of nonzeros is too large to be indexed by 32-bit integers
+   */
+  int * get_int_csr_ptrs(int nrow, int64_t const * IA);
+
+  /**
+   * \brief copies 32-bit row pointers of a CSR matrix (e.g. produced by MKL) to 64-bit row pointers
+   * \param[in] nrow number of rows in matrix
+   * \param[in] iIA 32-bit prefix sum of number of nonzeros for each row (of size nrow+1)
+   * \param[out] IA 64-bit prefix sum of number of nonzeros for each row (of size nrow+1)
+   */
+  void set_csr_ptrs(int nrow, int const * iIA, int64_t * IA);
+
+  /**
+   * \brief converts byte sizes and displacements of serialized CSR matrices to counts of CSR_ALIGN-byte units,
+   *        so that messages of more than INT_MAX bytes can be sent with int counts
+   * \param[in] s number of matrices
+   * \param[in] szs sizes in bytes of the matrices (multiples of CSR_ALIGN)
+   * \param[in] displs displacements in bytes of the matrices (multiples of CSR_ALIGN)
+   * \param[out] cnts sizes in units of CSR_ALIGN bytes
+   * \param[out] offs displacements in units of CSR_ALIGN bytes
    */
-  int64_t get_csr_size(int64_t nnz, int nrow, int val_size);
+  void get_csr_unit_counts(int s, int64_t const * szs, int64_t const * displs, int * cnts, int * offs);
 
   /**
-   * \brief abstraction for a serialized sparse matrix stored in column-sparse-row (CSR) layout
+   * \brief abstraction for a serialized sparse matrix stored in column-sparse-row (CSR) layout,
+   *        the row pointers are stored as 32-bit integers unless the matrix has too many nonzeros,
+   *        in which case they are 64-bit (see get_csr_ia_size()), while the column indices
+   *        (bounded by the number of columns) are 32-bit
    */
   class CSR_Matrix{
     public:
       /** \brief serialized buffer containing all info, index, and values related to matrix */
       char * all_data;
       
-      /** \brief constructor allocates all_data */
-      CSR_Matrix(int64_t nnz, int nrow, int ncol, int el_size);
+      /**
+       * \brief constructor allocates all_data
+       * \param[in] ia_size size of each row pointer, get_csr_ia_size(nnz) by default
+       */
+      CSR_Matrix(int64_t nnz, int nrow, int ncol, int el_size, int ia_size=0);
 
       /** \brief constructor given serialized CSR matrix */
       CSR_Matrix(char * all_data);
@@ -55,8 +100,18 @@ namespace CTF_int {
       /** \brief retrieves array of values out of all_data */
       char * vals() const;
 
-      /** \brief retrieves prefix sum of number of nonzeros for each row (of size nrow()+1) out of all_data */
-      int * IA() const;
+      /** \brief retrieves size in bytes of each row pointer (4 or 8) out of all_data */
+      int ia_size() const;
+
+      /** \brief retrieves prefix sum of number of nonzeros for each row (of size nrow()+1) if stored as 32-bit integers, NULL otherwise */
+      int * IA32() const;
+
+      /** \brief retrieves prefix sum of number of nonzeros for each row (of size nrow()+1) if stored as 64-bit integers, NULL otherwise */
+      int64_t * IA64() const;
+
+      /** \brief sets the prefix sum of number of nonzeros for each row (of size nrow()+1), converting it to the stored width */
+      void set_IA(int64_t const * IA);
+      void set_IA(int const * IA);
 
       /** \brief retrieves column indices of each value in vals stored in sorted form by row */
       int * JA() const;
@@ -88,21 +143,44 @@ namespace CTF_int {
       static void csrmultd(char const * A, algstrct const * sr_A, int m, int n, int k, char const * alpha, char const * B, algstrct const * sr_B, char const * beta, char * C, algstrct const * sr_C, bivar_function const * func, bool do_offload);
 
       /**
-       * \brief computes C = beta*C + func(alpha*A*B) where A, B, and C are CSR_Matrices, while C is dense
+       * \brief computes C = beta*C + func(alpha*A*B) where A, B, and C are CSR_Matrices, while C is dense,
+       *        if M is not NULL, only entries of alpha*A*B in (or, if is_mask_cmp, not in) the sparsity pattern of the CSR_Matrix M are computed
        */
-      static void csrmultcsr(char const * A, algstrct const * sr_A, int m, int n, int k, char const * alpha, char const * B, algstrct const * sr_B, char const * beta, char *& C, algstrct const * sr_C, bivar_function const * func, bool do_offload);
+      static void csrmultcsr(char const * A, algstrct const * sr_A, int m, int n, int k, char const * alpha, char const * B, algstrct const * sr_B, char const * beta, char *& C, algstrct const * sr_C, bivar_function const * func, bool do_offload, char const * M=NULL, bool is_mask_cmp=false);
 
       static void compute_has_col(
 
                       int const * JA,
-                      int const * IA,
+                      int64_t const * IA,
                       int const * JB,
-                      int const * IB,
+                      int64_t const * IB,
                       int         i,
                       int *       has_col);
       
       static char * csr_add(char * cA, char * cB, accumulatable const * adder);
   };
+
+  /**
+   * \brief row pointers of a CSR matrix as 64-bit integers, as taken by the sparse kernels,
+   *        pointing to those of the matrix if it stores 64-bit row pointers and to a widened
+   *        copy, freed by the destructor, otherwise
+   */
+  class CSR_IA64 {
+    public:
+      /** \brief prefix sum of number of nonzeros for each row (of size nrow()+1) */
+      int64_t const * ptr;
+
+      CSR_IA64(CSR_Matrix const & A);
+
+      ~CSR_IA64();
+
+    private:
+      /** \brief widened copy of the row pointers, NULL if the matrix stores 64-bit row pointers */
+      int64_t * copy;
+
+      CSR_IA64(CSR_IA64 const & other);
+      CSR_IA64 & operator=(CSR_IA64 const & other);
+  };
 }
 
 #endif
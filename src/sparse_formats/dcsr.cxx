@@ -0,0 +1,404 @@
+#include "dcsr.h"
+#include "../contraction/ctr_comm.h"
+#include "../shared/util.h"
+#include <algorithm>
+
+#define ALIGN CSR_ALIGN
+
+namespace CTF_int {
+  int64_t get_dcsr_size(int64_t nnz, int nnz_row, int val_size){
+    int64_t offset = get_csr_size(nnz, nnz_row, val_size, sizeof(int64_t));
+    offset += sizeof(int)*nnz_row;
+    if (offset % ALIGN != 0) offset += ALIGN-(offset%ALIGN);
+    return offset;
+  }
+
+  static void set_dcsr_header(char * all_data, int64_t nnz, int64_t val_size, int nrow, int ncol, int nnz_row){
+    ((int64_t*)all_data)[0] = nnz;
+    ((int64_t*)all_data)[1] = val_size;
+    ((int64_t*)all_data)[2] = (int64_t)nrow;
+    ((int64_t*)all_data)[3] = ncol;
+    ((int64_t*)all_data)[4] = nnz_row;
+  }
+
+  DCSR_Matrix::DCSR_Matrix(int64_t nnz, int nnz_row, int nrow, int ncol, int el_size){
+    ASSERT(ALIGN >= 5*sizeof(int64_t));
+    all_data = (char*)alloc(get_dcsr_size(nnz, nnz_row, el_size));
+    set_dcsr_header(all_data, nnz, el_size, nrow, ncol, nnz_row);
+  }
+
+  DCSR_Matrix::DCSR_Matrix(char * all_data_){
+    ASSERT(ALIGN >= 5*sizeof(int64_t));
+    all_data = all_data_;
+  }
+
+  DCSR_Matrix::DCSR_Matrix(COO_Matrix const & coom, int nrow, int ncol, algstrct const * sr, char * data){
+    ASSERT(ALIGN >= 5*sizeof(int64_t));
+    int64_t nz = coom.nnz();
+    int64_t v_sz = coom.val_size();
+    int const * coo_rs = coom.rows();
+
+    //collect the nonempty rows and renumber them consecutively, so that the conversion is independent of nrow
+    int * rs = (int*)alloc(sizeof(int)*nz);
+    memcpy(rs, coo_rs, sizeof(int)*nz);
+    std::sort(rs, rs+nz);
+    int nnz_row = std::unique(rs, rs+nz)-rs;
+
+    if (data == NULL)
+      all_data = (char*)alloc(get_dcsr_size(nz, nnz_row, v_sz));
+    else
+      all_data = data;
+    set_dcsr_header(all_data, nz, v_sz, nrow, ncol, nnz_row);
+    memcpy(row_inds(), rs, sizeof(int)*nnz_row);
+
+    int * cmp_rs = rs;
+    int const * dcsr_rows = row_inds();
+#ifdef USE_OMP
+    #pragma omp parallel for
+#endif
+    for (int64_t i=0; i<nz; i++){
+      cmp_rs[i] = std::lower_bound(dcsr_rows, dcsr_rows+nnz_row, coo_rs[i])-dcsr_rows+1;
+    }
+    sr->coo_to_csr(nz, nnz_row, vals(), JA(), IA(), coom.vals(), cmp_rs, coom.cols());
+    cdealloc(rs);
+  }
+
+  DCSR_Matrix::DCSR_Matrix(CSR_Matrix const & csrm, char * data){
+    ASSERT(ALIGN >= 5*sizeof(int64_t));
+    int64_t nz = csrm.nnz();
+    int v_sz = csrm.val_size();
+    int nrow_ = csrm.nrow();
+    CSR_IA64 cia(csrm);
+    int64_t const * csr_ia = cia.ptr;
+    int nnz_row = 0;
+    for (int i=0; i<nrow_; i++){
+      if (csr_ia[i+1] > csr_ia[i]) nnz_row++;
+    }
+    if (data == NULL)
+      all_data = (char*)alloc(get_dcsr_size(nz, nnz_row, v_sz));
+    else
+      all_data = data;
+    set_dcsr_header(all_data, nz, v_sz, nrow_, csrm.ncol(), nnz_row);
+    memcpy(vals(), csrm.vals(), nz*v_sz);
+    memcpy(JA(), csrm.JA(), nz*sizeof(int));
+    int64_t * ia = IA();
+    int * rows = row_inds();
+    ia[0] = 1;
+    for (int i=0, j=0; i<nrow_; i++){
+      if (csr_ia[i+1] > csr_ia[i]){
+        rows[j] = i+1;
+        ia[j+1] = csr_ia[i+1];
+        j++;
+      }
+    }
+  }
+
+  int64_t DCSR_Matrix::nnz() const {
+    return ((int64_t*)all_data)[0];
+  }
+
+  int DCSR_Matrix::val_size() const {
+    return ((int64_t*)all_data)[1];
+  }
+
+  int64_t DCSR_Matrix::size() const {
+    return get_dcsr_size(nnz(),nnz_row(),val_size());
+  }
+
+  int DCSR_Matrix::nrow() const {
+    return ((int64_t*)all_data)[2];
+  }
+
+  int DCSR_Matrix::ncol() const {
+    return ((int64_t*)all_data)[3];
+  }
+
+  int DCSR_Matrix::nnz_row() const {
+    return ((int64_t*)all_data)[4];
+  }
+
+  //the layout up to JA is that of a CSR matrix with nnz_row() rows, followed by the row indices
+  char * DCSR_Matrix::vals() const {
+    return all_data + ALIGN;
+  }
+
+  int64_t * DCSR_Matrix::IA() const {
+    int64_t offset = ALIGN + nnz()*val_size();
+    if (offset % ALIGN != 0) offset += ALIGN-(offset%ALIGN);
+    return (int64_t*)(all_data + offset);
+  }
+
+  int * DCSR_Matrix::JA() const {
+    int64_t offset = ((char*)IA()-all_data) + (nnz_row()+1)*sizeof(int64_t);
+    if (offset % ALIGN != 0) offset += ALIGN-(offset%ALIGN);
+    return (int*)(all_data + offset);
+  }
+
+  int * DCSR_Matrix::row_inds() const {
+    return (int*)(all_data + get_csr_size(nnz(), nnz_row(), val_size(), sizeof(int64_t)));
+  }
+
+  char * DCSR_Matrix::to_csr() const {
+    int64_t nz = nnz();
+    int v_sz = val_size();
+    int nrow_ = nrow();
+    int nnz_row_ = nnz_row();
+    CSR_Matrix csrm(nz, nrow_, ncol(), v_sz);
+    memcpy(csrm.vals(), vals(), nz*v_sz);
+    memcpy(csrm.JA(), JA(), nz*sizeof(int));
+    int64_t * csr_ia = (int64_t*)alloc(sizeof(int64_t)*(nrow_+1));
+    int64_t const * ia = IA();
+    int const * rows = row_inds();
+    csr_ia[0] = 1;
+    for (int i=0, j=0; i<nrow_; i++){
+      if (j < nnz_row_ && rows[j] == i+1){
+        csr_ia[i+1] = ia[j+1];
+        j++;
+      } else
+        csr_ia[i+1] = csr_ia[i];
+    }
+    csrm.set_IA(csr_ia);
+    cdealloc(csr_ia);
+    return csrm.all_data;
+  }
+
+  void DCSR_Matrix::print(algstrct const * sr){
+    char * dcsr_vs = vals();
+    int * dcsr_ja = JA();
+    int64_t * dcsr_ia = IA();
+    int * rows = row_inds();
+    int irow = 0;
+    int v_sz = val_size();
+    int64_t nz = nnz();
+    printf("DCSR Matrix has %ld nonzeros %d rows (%d nonempty) %d cols\n", nz, nrow(), nnz_row(), ncol());
+    for (int64_t i=0; i<nz; i++){
+      while (i>=dcsr_ia[irow+1]-1) irow++;
+      printf("[%d,%d] ",rows[irow]-1,dcsr_ja[i]);
+      sr->print(dcsr_vs+v_sz*i);
+      printf("\n");
+    }
+  }
+
+  /**
+   * \brief scales dense C by beta, as done by the CSR kernels before accumulating into C
+   */
+  static void scal_dense_C(int64_t sz_C, char const * beta, char * C, algstrct const * sr_C){
+    if (!sr_C->isequal(beta, sr_C->mulid())){
+      if (sr_C->isequal(beta, sr_C->addid()))
+        sr_C->set(C, sr_C->addid(), sz_C);
+      else
+        sr_C->scal(sz_C, beta, C, 1);
+    }
+  }
+
+  /**
+   * \brief accumulates the dense nnz_row-by-n product of the nonempty rows of A into the m-by-n C
+   */
+  static void accum_dense_rows(int m, int n, int nnz_row, int const * rows, char const * buf, char * C, algstrct const * sr_C){
+    int el_size = sr_C->el_size;
+#ifdef USE_OMP
+    #pragma omp parallel for
+#endif
+    for (int j=0; j<n; j++){
+      for (int r=0; r<nnz_row; r++){
+        char * c = C+(((int64_t)j)*m+rows[r]-1)*el_size;
+        sr_C->add(buf+(((int64_t)j)*nnz_row+r)*el_size, c, c);
+      }
+    }
+  }
+
+  void DCSR_Matrix::dcsrmm(char const * A, algstrct const * sr_A, int m, int n, int k, char const * alpha, char const * B, algstrct const * sr_B, char const * beta, char * C, algstrct const * sr_C, bivar_function const * func, bool do_offload){
+    assert(!do_offload);
+    DCSR_Matrix cA((char*)A);
+    int nnz_row = cA.nnz_row();
+    scal_dense_C(((int64_t)m)*n, beta, C, sr_C);
+    if (nnz_row == 0) return;
+    //multiply the nonempty rows of A by B into a buffer, then add them to C
+    char * buf = (char*)alloc(((int64_t)nnz_row)*n*sr_C->el_size);
+    sr_C->set(buf, sr_C->addid(), ((int64_t)nnz_row)*n);
+    if (func != NULL){
+      assert(alpha == NULL || sr_C->isequal(alpha, sr_C->mulid()));
+      func->ccsrmm(nnz_row,n,k,cA.vals(),cA.JA(),cA.IA(),cA.nnz(),B,buf,sr_C);
+    } else {
+      ASSERT(sr_B->el_size == sr_A->el_size);
+      ASSERT(sr_C->el_size == sr_A->el_size);
+      sr_C->csrmm(nnz_row,n,k,alpha,cA.vals(),cA.JA(),cA.IA(),cA.nnz(),B,sr_C->mulid(),buf,func);
+    }
+    accum_dense_rows(m, n, nnz_row, cA.row_inds(), buf, C, sr_C);
+    cdealloc(buf);
+  }
+
+  void DCSR_Matrix::dcsrmultd(char const * A, algstrct const * sr_A, int m, int n, int k, char const * alpha, char const * B, algstrct const * sr_B, char const * beta, char * C, algstrct const * sr_C, bivar_function const * func, bool do_offload){
+    assert(!do_offload);
+    DCSR_Matrix cA((char*)A);
+    CSR_Matrix cB((char*)B);
+    CSR_IA64 cIB(cB);
+    int nnz_row = cA.nnz_row();
+    scal_dense_C(((int64_t)m)*n, beta, C, sr_C);
+    if (nnz_row == 0) return;
+    char * buf = (char*)alloc(((int64_t)nnz_row)*n*sr_C->el_size);
+    sr_C->set(buf, sr_C->addid(), ((int64_t)nnz_row)*n);
+    if (func != NULL){
+      assert(alpha == NULL || sr_C->isequal(alpha, sr_C->mulid()));
+      func->ccsrmultd(nnz_row,n,k,cA.vals(),cA.JA(),cA.IA(),cA.nnz(),cB.vals(),cB.JA(),cIB.ptr,cB.nnz(),buf,sr_C);
+    } else {
+      ASSERT(sr_B->el_size == sr_A->el_size);
+      ASSERT(sr_C->el_size == sr_A->el_size);
+      sr_C->csrmultd(nnz_row,n,k,alpha,cA.vals(),cA.JA(),cA.IA(),cA.nnz(),cB.vals(),cB.JA(),cIB.ptr,cB.nnz(),sr_C->mulid(),buf);
+    }
+    accum_dense_rows(m, n, nnz_row, cA.row_inds(), buf, C, sr_C);
+    cdealloc(buf);
+  }
+
+  /**
+   * \brief computes C = beta*C + P, where C is an m-row CSR matrix and P a DCSR matrix of the same shape,
+   *        merging entries only in the nonempty rows of P and copying the other rows of C in bulk;
+   *        merged columns are found by sorting and binary search, so no work or memory is
+   *        proportional to the number of columns
+   * \param[in] C serialized CSR matrix, its values are scaled by beta in place
+   * \param[in] beta scaling factor of C
+   * \param[in] P DCSR matrix with the same number of rows and columns as C
+   * \param[in] sr_C algebraic structure of C and P
+   * \return serialized CSR matrix, allocated by this function, with columns sorted within merged rows
+   */
+  static char * accum_dcsr_rows(char * C, char const * beta, DCSR_Matrix const & P, algstrct const * sr_C){
+    CSR_Matrix cC(C);
+    int el_size = sr_C->el_size;
+    int m = cC.nrow();
+    int ncol = std::max(cC.ncol(), P.ncol());
+    if (!sr_C->isequal(beta, sr_C->mulid()))
+      sr_C->scal(cC.nnz(), beta, cC.vals(), 1);
+    CSR_IA64 cIC(cC);
+    int64_t const * IC = cIC.ptr;
+    int const * JC = cC.JA();
+    char const * vC = cC.vals();
+    int nnz_row = P.nnz_row();
+    int const * rows = P.row_inds();
+    int64_t const * IP = P.IA();
+    int const * JP = P.JA();
+    char const * vP = P.vals();
+
+    //sorted union of the columns of C and P in each nonempty row of P
+    int64_t * IU = (int64_t*)alloc(sizeof(int64_t)*(nnz_row+1));
+    int * JU = (int*)alloc(sizeof(int)*std::max((int64_t)1, P.nnz()+cC.nnz()));
+    IU[0] = 0;
+    for (int r=0; r<nnz_row; r++){
+      int i = rows[r]-1;
+      int64_t nu = IU[r];
+      memcpy(JU+nu, JC+IC[i]-1, sizeof(int)*(IC[i+1]-IC[i]));
+      nu += IC[i+1]-IC[i];
+      memcpy(JU+nu, JP+IP[r]-1, sizeof(int)*(IP[r+1]-IP[r]));
+      nu += IP[r+1]-IP[r];
+      std::sort(JU+IU[r], JU+nu);
+      IU[r+1] = std::unique(JU+IU[r], JU+nu)-JU;
+    }
+
+    int64_t nnz_new = cC.nnz() + IU[nnz_row];
+    for (int r=0; r<nnz_row; r++){
+      int i = rows[r]-1;
+      nnz_new -= IC[i+1]-IC[i];
+    }
+    CSR_Matrix cN(nnz_new, m, ncol, el_size);
+    int64_t * IN = (int64_t*)alloc(sizeof(int64_t)*(m+1));
+    int * JN = cN.JA();
+    char * vN = cN.vals();
+    IN[0] = 1;
+    int i_st = 0;
+    for (int r=0; r<=nnz_row; r++){
+      //rows of C before the next nonempty row of P are copied as a block
+      int i_end = r<nnz_row ? rows[r]-1 : m;
+      if (i_end > i_st){
+        int64_t nz_blk = IC[i_end]-IC[i_st];
+        memcpy(JN+IN[i_st]-1, JC+IC[i_st]-1, sizeof(int)*nz_blk);
+        memcpy(vN+(IN[i_st]-1)*el_size, vC+(IC[i_st]-1)*el_size, nz_blk*el_size);
+        for (int i=i_st; i<i_end; i++){
+          IN[i+1] = IN[i] + IC[i+1]-IC[i];
+        }
+      }
+      if (r == nnz_row) break;
+      int i = i_end;
+      int64_t st = IN[i]-1;
+      int64_t nu = IU[r+1]-IU[r];
+      memcpy(JN+st, JU+IU[r], sizeof(int)*nu);
+      sr_C->set(vN+st*el_size, sr_C->addid(), nu);
+      for (int64_t j=IC[i]-1; j<IC[i+1]-1; j++){
+        char * v = vN+(std::lower_bound(JN+st, JN+st+nu, JC[j])-JN)*el_size;
+        sr_C->add(vC+j*el_size, v, v);
+      }
+      for (int64_t j=IP[r]-1; j<IP[r+1]-1; j++){
+        char * v = vN+(std::lower_bound(JN+st, JN+st+nu, JP[j])-JN)*el_size;
+        sr_C->add(vP+j*el_size, v, v);
+      }
+      IN[i+1] = IN[i] + nu;
+      i_st = i+1;
+    }
+    cN.set_IA(IN);
+    cdealloc(IN);
+    cdealloc(IU);
+    cdealloc(JU);
+    return cN.all_data;
+  }
+
+  void DCSR_Matrix::dcsrmultcsr(char const * A, algstrct const * sr_A, int m, int n, int k, char const * alpha, char const * B, algstrct const * sr_B, char const * beta, char *& C, algstrct const * sr_C, bivar_function const * func, bool do_offload, char const * M, bool is_mask_cmp){
+    assert(!do_offload);
+    DCSR_Matrix cA((char*)A);
+    CSR_Matrix cB((char*)B);
+    CSR_IA64 cIB(cB);
+    //gather the rows of the mask corresponding to the nonempty rows of A
+    int * JM = NULL;
+    int64_t * IM = NULL;
+    if (M != NULL){
+      CSR_Matrix cM((char*)M);
+      int const * rows_A = cA.row_inds();
+      CSR_IA64 cIM(cM);
+      int64_t const * IM_full = cIM.ptr;
+      IM = (int64_t*)alloc(sizeof(int64_t)*(cA.nnz_row()+1));
+      IM[0] = 1;
+      for (int i=0; i<cA.nnz_row(); i++){
+        IM[i+1] = IM[i] + IM_full[rows_A[i]] - IM_full[rows_A[i]-1];
+      }
+      JM = (int*)alloc(sizeof(int)*std::max((int64_t)1,IM[cA.nnz_row()]-1));
+      for (int i=0; i<cA.nnz_row(); i++){
+        memcpy(JM+IM[i]-1, cM.JA()+IM_full[rows_A[i]-1]-1, sizeof(int)*(IM[i+1]-IM[i]));
+      }
+    }
+    //multiply the nonempty rows of A by B, which yields the nonempty rows of the product
+    char * cmp_C = NULL;
+    if (func != NULL){
+      assert(alpha == NULL || sr_C->isequal(alpha, sr_C->mulid()));
+      if (M != NULL)
+        func->cmasked_csrmultcsr(cA.nnz_row(),n,k,cA.vals(),cA.JA(),cA.IA(),cA.nnz(),cB.vals(),cB.JA(),cIB.ptr,cB.nnz(),cmp_C,sr_C,JM,IM,is_mask_cmp);
+      else
+        func->ccsrmultcsr(cA.nnz_row(),n,k,cA.vals(),cA.JA(),cA.IA(),cA.nnz(),cB.vals(),cB.JA(),cIB.ptr,cB.nnz(),cmp_C,sr_C);
+    } else {
+      ASSERT(sr_B->el_size == sr_A->el_size);
+      ASSERT(sr_C->el_size == sr_A->el_size);
+      if (M != NULL)
+        sr_C->masked_csrmultcsr(cA.nnz_row(),n,k,alpha,cA.vals(),cA.JA(),cA.IA(),cA.nnz(),cB.vals(),cB.JA(),cIB.ptr,cB.nnz(),sr_C->addid(),cmp_C,JM,IM,is_mask_cmp);
+      else
+        sr_C->csrmultcsr(cA.nnz_row(),n,k,alpha,cA.vals(),cA.JA(),cA.IA(),cA.nnz(),cB.vals(),cB.JA(),cIB.ptr,cB.nnz(),sr_C->addid(),cmp_C);
+    }
+    if (M != NULL){
+      cdealloc(JM);
+      cdealloc(IM);
+    }
+    CSR_Matrix cmp_csr(cmp_C);
+    DCSR_Matrix dC(cmp_csr);
+    ((int64_t*)dC.all_data)[2] = m;
+    int * rows = dC.row_inds();
+    int const * rows_A = cA.row_inds();
+    for (int i=0; i<dC.nnz_row(); i++){
+      rows[i] = rows_A[rows[i]-1];
+    }
+    cdealloc(cmp_C);
+
+    //the product stays in DCSR layout until it is merged into C, which is in CSR layout
+    if (C == NULL || CSR_Matrix(C).nnz() == 0 || sr_C->isequal(beta, sr_C->addid())){
+      C = dC.to_csr();
+    } else {
+      char * ans = accum_dcsr_rows(C, beta, dC, sr_C);
+      C = ans;
+    }
+    cdealloc(dC.all_data);
+  }
+}
@@ -0,0 +1,109 @@
+#ifndef __DCSR_H__
+#define __DCSR_H__
+
+#include "../tensor/algstrct.h"
+#include "coo.h"
+#include "csr.h"
+
+/** \brief matrices with fewer than nrow/DCSR_ROW_FRAC nonzeros are hypersparse and stored in DCSR rather than CSR layout */
+#define DCSR_ROW_FRAC 4
+
+namespace CTF_int {
+
+  class bivar_function;
+
+  /**
+   * \brief computes the size of a serialized DCSR matrix
+   * \param[in] nnz number of nonzeros in matrix
+   * \param[in] nnz_row number of nonempty rows in matrix
+   * \param[in] val_size size of each matrix entry
+   */
+  int64_t get_dcsr_size(int64_t nnz, int nnz_row, int val_size);
+
+  /**
+   * \brief abstraction for a serialized sparse matrix stored in doubly-compressed-sparse-row (DCSR) layout,
+   *        which is a CSR matrix of only the nonempty rows along with the index of each such row,
+   *        so that its size and the cost of traversing it do not depend on the number of rows
+   */
+  class DCSR_Matrix{
+    public:
+      /** \brief serialized buffer containing all info, index, and values related to matrix */
+      char * all_data;
+
+      /** \brief constructor allocates all_data */
+      DCSR_Matrix(int64_t nnz, int nnz_row, int nrow, int ncol, int el_size);
+
+      /** \brief constructor given serialized DCSR matrix */
+      DCSR_Matrix(char * all_data);
+
+      DCSR_Matrix(){ all_data=NULL; }
+
+      DCSR_Matrix(DCSR_Matrix const & other){ all_data=other.all_data; }
+
+      /** \brief constructor given coordinate format (COO) matrix, does not traverse the rows */
+      DCSR_Matrix(COO_Matrix const & coom, int nrow, int ncol, algstrct const * sr, char * data=NULL);
+
+      /** \brief constructor given CSR matrix */
+      DCSR_Matrix(CSR_Matrix const & csrm, char * data=NULL);
+
+      /** \brief retrieves number of nonzeros out of all_data */
+      int64_t nnz() const;
+
+      /** \brief retrieves buffer size out of all_data */
+      int64_t size() const;
+
+      /** \brief retrieves number of rows out of all_data */
+      int nrow() const;
+
+      /** \brief retrieves number of nonempty rows out of all_data */
+      int nnz_row() const;
+
+      /** \brief retrieves number of columns out of all_data */
+      int ncol() const;
+
+      /** \brief retrieves matrix entry size out of all_data */
+      int val_size() const;
+
+      /** \brief retrieves array of values out of all_data */
+      char * vals() const;
+
+      /** \brief retrieves prefix sum of number of nonzeros for each nonempty row (of size nnz_row()+1) out of all_data */
+      int64_t * IA() const;
+
+      /** \brief retrieves column indices of each value in vals stored in sorted form by row */
+      int * JA() const;
+
+      /** \brief retrieves the index (starting from 1, as IA and JA) of each nonempty row (of size nnz_row()) */
+      int * row_inds() const;
+
+      /**
+       * \brief converts to a CSR matrix with nrow() rows
+       * \return serialized CSR matrix, allocated by this function
+       */
+      char * to_csr() const;
+
+      /**
+       * \brief outputs matrix data to stdout, intended for debugging
+       * \param[in] sr algebraic structure allowing print
+       */
+      void print(algstrct const * sr);
+
+      /**
+       * \brief computes C = beta*C + func(alpha*A*B) where A is a DCSR_Matrix, while B and C are dense
+       */
+      static void dcsrmm(char const * A, algstrct const * sr_A, int m, int n, int k, char const * alpha, char const * B, algstrct const * sr_B, char const * beta, char * C, algstrct const * sr_C, bivar_function const * func, bool do_offload);
+
+      /**
+       * \brief computes C = beta*C + func(alpha*A*B) where A is a DCSR_Matrix, B is a CSR_Matrix, while C is dense
+       */
+      static void dcsrmultd(char const * A, algstrct const * sr_A, int m, int n, int k, char const * alpha, char const * B, algstrct const * sr_B, char const * beta, char * C, algstrct const * sr_C, bivar_function const * func, bool do_offload);
+
+      /**
+       * \brief computes C = beta*C + func(alpha*A*B) where A is a DCSR_Matrix, while B and C are CSR_Matrices,
+       *        if M is not NULL, only entries of alpha*A*B in (or, if is_mask_cmp, not in) the sparsity pattern of the CSR_Matrix M are computed
+       */
+      static void dcsrmultcsr(char const * A, algstrct const * sr_A, int m, int n, int k, char const * alpha, char const * B, algstrct const * sr_B, char const * beta, char *& C, algstrct const * sr_C, bivar_function const * func, bool do_offload, char const * M=NULL, bool is_mask_cmp=false);
+  };
+}
+
+#endif
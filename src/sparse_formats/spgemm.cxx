@@ -0,0 +1,122 @@
+#include "spgemm.h"
+#include "../shared/util.h"
+
+namespace CTF_int {
+  int spgemm_num_threads(){
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+  }
+
+  char * spgemm_symbolic(int             m,
+                         int             n,
+                         int const *     JA,
+                         int64_t const * IA,
+                         int const *     JB,
+                         int64_t const * IB,
+                         int             el_size,
+                         int             ntd,
+                         int64_t *       flops,
+                         int *           row_part,
+                         int const *     JM,
+                         int64_t const * IM,
+                         bool            is_mask_cmp){
+    flops[0] = 0;
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (int i=0; i<m; i++){
+      int64_t flop = 0;
+      //rows with an empty mask are not computed
+      if (JM == NULL || is_mask_cmp || IM[i+1] > IM[i]){
+        for (int64_t j=IA[i]-1; j<IA[i+1]-1; j++){
+          flop += IB[JA[j]]-IB[JA[j]-1];
+        }
+      }
+      flops[i+1] = flop;
+    }
+    for (int i=0; i<m; i++){
+      flops[i+1] += flops[i];
+    }
+    //assign contiguous ranges of rows to threads so that each thread does about as many multiplications
+    row_part[0] = 0;
+    for (int t=1; t<ntd; t++){
+      row_part[t] = std::lower_bound(flops, flops+m+1, (flops[m]*t)/ntd) - flops;
+      row_part[t] = std::max(row_part[t-1], std::min(row_part[t], m));
+    }
+    row_part[ntd] = m;
+
+    int64_t * IC = (int64_t*)alloc(sizeof(int64_t)*(m+1));
+    IC[0] = 0;
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(ntd)
+#endif
+    {
+      int tid = 0, nthreads = 1;
+#ifdef _OPENMP
+      tid = omp_get_thread_num();
+      nthreads = omp_get_num_threads();
+#endif
+      for (int t=tid; t<ntd; t+=nthreads){
+        int64_t max_hsz = 0;
+        bool need_dense = false;
+        for (int i=row_part[t]; i<row_part[t+1]; i++){
+          int64_t flop = flops[i+1]-flops[i];
+          if (spgemm_use_hash(flop, n)) max_hsz = std::max(max_hsz, spgemm_hash_size(flop));
+          else need_dense = true;
+        }
+        int * hkeys = NULL;
+        int * dmark = NULL;
+        if (max_hsz > 0)
+          hkeys = (int*)alloc(sizeof(int)*max_hsz);
+        if (need_dense){
+          dmark = (int*)alloc(sizeof(int)*n);
+          std::fill(dmark, dmark+n, -1);
+        }
+        for (int i=row_part[t]; i<row_part[t+1]; i++){
+          int64_t flop = flops[i+1]-flops[i];
+          int64_t nnz = 0;
+          if (flop > 0 && spgemm_use_hash(flop, n)){
+            int64_t hmask = spgemm_hash_size(flop)-1;
+            std::fill(hkeys, hkeys+hmask+1, -1);
+            for (int64_t j=IA[i]-1; j<IA[i+1]-1; j++){
+              int row_B = JA[j]-1;
+              for (int64_t l=IB[row_B]-1; l<IB[row_B+1]-1; l++){
+                if (!spgemm_in_mask(JM, IM, i, JB[l]-1, is_mask_cmp)) continue;
+                int64_t h = spgemm_hash_slot(hkeys, hmask, JB[l]-1);
+                if (hkeys[h] == -1){
+                  hkeys[h] = JB[l]-1;
+                  nnz++;
+                }
+              }
+            }
+          } else if (flop > 0){
+            for (int64_t j=IA[i]-1; j<IA[i+1]-1; j++){
+              int row_B = JA[j]-1;
+              for (int64_t l=IB[row_B]-1; l<IB[row_B+1]-1; l++){
+                if (!spgemm_in_mask(JM, IM, i, JB[l]-1, is_mask_cmp)) continue;
+                if (dmark[JB[l]-1] != i){
+                  dmark[JB[l]-1] = i;
+                  nnz++;
+                }
+              }
+            }
+          }
+          IC[i+1] = nnz;
+        }
+        if (hkeys != NULL) cdealloc(hkeys);
+        if (dmark != NULL) cdealloc(dmark);
+      }
+    }
+    IC[0] = 1;
+    for (int i=0; i<m; i++){
+      IC[i+1] += IC[i];
+    }
+    CSR_Matrix C(IC[m]-1, m, n, el_size);
+    C.set_IA(IC);
+    cdealloc(IC);
+    return C.all_data;
+  }
+}
@@ -0,0 +1,247 @@
+#ifndef __SPGEMM_H__
+#define __SPGEMM_H__
+
+#include "csr.h"
+#include <algorithm>
+#include <new>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/** \brief rows of a sparse matrix product with fewer than ncol/SPGEMM_HASH_FRAC multiplications are accumulated in a hash table rather than in a dense array */
+#define SPGEMM_HASH_FRAC 16
+
+/** \brief multiplier used to hash column indices in sparse matrix products */
+#define SPGEMM_HASH_SCAL 107
+
+namespace CTF_int {
+
+  /**
+   * \brief whether a row of a sparse matrix product should be accumulated in a hash table
+   * \param[in] flop number of multiplications contributing to the row
+   * \param[in] n number of columns of the product
+   */
+  inline bool spgemm_use_hash(int64_t flop, int n){
+    return flop*SPGEMM_HASH_FRAC < (int64_t)n;
+  }
+
+  /**
+   * \brief size (a power of two at least twice the number of multiplications) of the hash table for a row of a sparse matrix product
+   * \param[in] flop number of multiplications contributing to the row
+   */
+  inline int64_t spgemm_hash_size(int64_t flop){
+    int64_t hsz = 8;
+    while (hsz < 2*flop) hsz *= 2;
+    return hsz;
+  }
+
+  /**
+   * \brief finds the slot of a column in the open-addressing (linear probing) hash table of a row
+   * \param[in] hkeys hash table of column indices, -1 for empty slots
+   * \param[in] hmask size of the hash table minus one
+   * \param[in] col column index to look for
+   * \return slot containing col or the empty slot at which col should be inserted
+   */
+  inline int64_t spgemm_hash_slot(int const * hkeys, int64_t hmask, int col){
+    int64_t h = ((int64_t)col*SPGEMM_HASH_SCAL) & hmask;
+    while (hkeys[h] != -1 && hkeys[h] != col) h = (h+1) & hmask;
+    return h;
+  }
+
+  /**
+   * \brief whether an entry of a sparse matrix product is computed given an output mask
+   * \param[in] JM column indices of the mask, sorted within each row, or NULL if there is no mask
+   * \param[in] IM row pointers of the mask
+   * \param[in] row row of the entry
+   * \param[in] col column of the entry (starting from 0)
+   * \param[in] is_mask_cmp whether entries absent from, rather than present in, the mask are computed
+   */
+  inline bool spgemm_in_mask(int const * JM, int64_t const * IM, int row, int col, bool is_mask_cmp){
+    if (JM == NULL) return true;
+    return std::binary_search(JM+IM[row]-1, JM+IM[row+1]-1, col+1) != is_mask_cmp;
+  }
+
+  /**
+   * \brief number of threads used by spgemm()
+   */
+  int spgemm_num_threads();
+
+  /**
+   * \brief symbolic phase of the row-wise (Gustavson) product C=A*B of CSR matrices,
+   *        which counts the nonzeros of each row of C and allocates C exactly
+   * \param[in] m number of rows of A and C
+   * \param[in] n number of columns of B and C
+   * \param[in] JA column indices of A
+   * \param[in] IA row pointers of A
+   * \param[in] JB column indices of B
+   * \param[in] IB row pointers of B
+   * \param[in] el_size size of each entry of C
+   * \param[in] ntd number of threads
+   * \param[out] flops prefix sum of number of multiplications for each row of C (of size m+1)
+   * \param[out] row_part rows row_part[t] to row_part[t+1]-1 are assigned to thread t,
+   *             so that each thread performs about as many multiplications (of size ntd+1)
+   * \param[in] JM column indices of the CSR mask of C, if not NULL only entries of C in (or, if is_mask_cmp, not in) the mask are computed
+   * \param[in] IM row pointers of the CSR mask of C
+   * \param[in] is_mask_cmp whether the complement of the mask is used
+   * \return serialized CSR matrix C with row pointers and space for column indices and values, allocated by this function
+   */
+  char * spgemm_symbolic(int             m,
+                         int             n,
+                         int const *     JA,
+                         int64_t const * IA,
+                         int const *     JB,
+                         int64_t const * IB,
+                         int             el_size,
+                         int             ntd,
+                         int64_t *       flops,
+                         int *           row_part,
+                         int const *     JM=NULL,
+                         int64_t const * IM=NULL,
+                         bool            is_mask_cmp=false);
+
+  /**
+   * \brief computes C=A*B for CSR matrices A and B by row-wise (Gustavson) multithreaded sparse matrix multiplication,
+   *        with a symbolic phase that allocates C exactly and a numeric phase that accumulates each row of C in
+   *        either a hash table or a dense array, depending on the number of multiplications contributing to the row
+   * \param[in] m number of rows of A and C
+   * \param[in] n number of columns of B and C
+   * \param[in] A values of A
+   * \param[in] JA column indices of A
+   * \param[in] IA row pointers of A
+   * \param[in] B values of B
+   * \param[in] JB column indices of B
+   * \param[in] IB row pointers of B
+   * \param[in] fmul function computing an entry of C from a pair of entries of A and B
+   * \param[in] facc function facc(acc, val) accumulating val into acc
+   * \param[in] JM column indices of the CSR mask of C, if not NULL only entries of C in (or, if is_mask_cmp, not in) the mask are computed
+   * \param[in] IM row pointers of the CSR mask of C
+   * \param[in] is_mask_cmp whether the complement of the mask is used
+   * \return serialized CSR matrix C with sorted column indices, allocated by this function
+   */
+  template <typename dtype_A, typename dtype_B, typename dtype_C, typename fmul_t, typename facc_t>
+  char * spgemm(int             m,
+                int             n,
+                dtype_A const * A,
+                int const *     JA,
+                int64_t const * IA,
+                dtype_B const * B,
+                int const *     JB,
+                int64_t const * IB,
+                fmul_t          fmul,
+                facc_t          facc,
+                int const *     JM=NULL,
+                int64_t const * IM=NULL,
+                bool            is_mask_cmp=false){
+    int ntd = spgemm_num_threads();
+    int64_t * flops = (int64_t*)alloc(sizeof(int64_t)*(m+1));
+    int * row_part = (int*)alloc(sizeof(int)*(ntd+1));
+    CSR_Matrix C(spgemm_symbolic(m, n, JA, IA, JB, IB, sizeof(dtype_C), ntd, flops, row_part, JM, IM, is_mask_cmp));
+    dtype_C * vC = (dtype_C*)C.vals();
+    int * JC = C.JA();
+    CSR_IA64 cIC(C);
+    int64_t const * IC = cIC.ptr;
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(ntd)
+#endif
+    {
+      int tid = 0, nthreads = 1;
+#ifdef _OPENMP
+      tid = omp_get_thread_num();
+      nthreads = omp_get_num_threads();
+#endif
+      for (int t=tid; t<ntd; t+=nthreads){
+        int64_t max_hsz = 0;
+        bool need_dense = false;
+        for (int i=row_part[t]; i<row_part[t+1]; i++){
+          int64_t flop = flops[i+1]-flops[i];
+          if (spgemm_use_hash(flop, n)) max_hsz = std::max(max_hsz, spgemm_hash_size(flop));
+          else need_dense = true;
+        }
+        int * hkeys = NULL;
+        dtype_C * hvals = NULL;
+        int * dmark = NULL;
+        dtype_C * dvals = NULL;
+        //accumulators are constructed in place (default-initialized, so free for built-in types),
+        //since dtype_C may have a nontrivial assignment
+        if (max_hsz > 0){
+          hkeys = (int*)alloc(sizeof(int)*max_hsz);
+          hvals = (dtype_C*)alloc(sizeof(dtype_C)*max_hsz);
+          for (int64_t h=0; h<max_hsz; h++) new (hvals+h) dtype_C;
+        }
+        if (need_dense){
+          dmark = (int*)alloc(sizeof(int)*n);
+          std::fill(dmark, dmark+n, -1);
+          dvals = (dtype_C*)alloc(sizeof(dtype_C)*n);
+          for (int col=0; col<n; col++) new (dvals+col) dtype_C;
+        }
+        for (int i=row_part[t]; i<row_part[t+1]; i++){
+          int64_t off = IC[i]-1;
+          if (IC[i+1] == IC[i]) continue;
+          int64_t flop = flops[i+1]-flops[i];
+          int nc = 0;
+          if (spgemm_use_hash(flop, n)){
+            int64_t hmask = spgemm_hash_size(flop)-1;
+            std::fill(hkeys, hkeys+hmask+1, -1);
+            for (int64_t j=IA[i]-1; j<IA[i+1]-1; j++){
+              int row_B = JA[j]-1;
+              for (int64_t l=IB[row_B]-1; l<IB[row_B+1]-1; l++){
+                int col = JB[l]-1;
+                if (!spgemm_in_mask(JM, IM, i, col, is_mask_cmp)) continue;
+                int64_t h = spgemm_hash_slot(hkeys, hmask, col);
+                if (hkeys[h] == -1){
+                  hkeys[h] = col;
+                  hvals[h] = fmul(A[j],B[l]);
+                  JC[off+nc] = col+1;
+                  nc++;
+                } else
+                  facc(hvals[h], fmul(A[j],B[l]));
+              }
+            }
+            std::sort(JC+off, JC+off+nc);
+            for (int p=0; p<nc; p++){
+              new (vC+off+p) dtype_C(hvals[spgemm_hash_slot(hkeys, hmask, JC[off+p]-1)]);
+            }
+          } else {
+            for (int64_t j=IA[i]-1; j<IA[i+1]-1; j++){
+              int row_B = JA[j]-1;
+              for (int64_t l=IB[row_B]-1; l<IB[row_B+1]-1; l++){
+                int col = JB[l]-1;
+                if (!spgemm_in_mask(JM, IM, i, col, is_mask_cmp)) continue;
+                if (dmark[col] != i){
+                  dmark[col] = i;
+                  dvals[col] = fmul(A[j],B[l]);
+                  nc++;
+                } else
+                  facc(dvals[col], fmul(A[j],B[l]));
+              }
+            }
+            //dense rows are gathered by a scan of the marker array rather than by sorting
+            int p = 0;
+            for (int col=0; col<n && p<nc; col++){
+              if (dmark[col] == i){
+                JC[off+p] = col+1;
+                new (vC+off+p) dtype_C(dvals[col]);
+                p++;
+              }
+            }
+          }
+        }
+        if (hkeys != NULL){
+          for (int64_t h=0; h<max_hsz; h++) hvals[h].~dtype_C();
+          cdealloc(hkeys);
+          cdealloc(hvals);
+        }
+        if (dmark != NULL){
+          for (int col=0; col<n; col++) dvals[col].~dtype_C();
+          cdealloc(dmark);
+          cdealloc(dvals);
+        }
+      }
+    }
+    cdealloc(flops);
+    cdealloc(row_part);
+    return C.all_data;
+  }
+}
+
+#endif
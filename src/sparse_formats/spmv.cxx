@@ -0,0 +1,42 @@
+#include "spmv.h"
+#include "../shared/util.h"
+
+namespace CTF_int {
+  int spmv_num_threads(){
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+  }
+
+  void spmv_merge_path_search(int             m,
+                              int64_t const * IA,
+                              int64_t         nnz,
+                              int64_t         diag,
+                              int *           row,
+                              int64_t *       nz){
+    int64_t lo = std::max((int64_t)0, diag-nnz);
+    int64_t hi = std::min(diag, (int64_t)m);
+    //the end of row i precedes nonzero j on the merge path if IA[i+1]-1 <= j
+    while (lo < hi){
+      int64_t mid = (lo+hi)/2;
+      if (IA[mid+1]-1 <= diag-mid-1) lo = mid+1;
+      else hi = mid;
+    }
+    *row = (int)lo;
+    *nz = diag-lo;
+  }
+
+  void spmv_partition(int             m,
+                      int64_t const * IA,
+                      int             ntd,
+                      int *           row_part,
+                      int64_t *       nz_part){
+    int64_t nnz = IA[m]-1;
+    int64_t len = m+nnz;
+    for (int t=0; t<=ntd; t++){
+      spmv_merge_path_search(m, IA, nnz, (len*t)/ntd, row_part+t, nz_part+t);
+    }
+  }
+}
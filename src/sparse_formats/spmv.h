@@ -0,0 +1,120 @@
+#ifndef __SPMV_H__
+#define __SPMV_H__
+
+#include "csr.h"
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace CTF_int {
+
+  /**
+   * \brief finds where a diagonal of the merge path of a CSR matrix crosses the path, i.e. the row
+   *        and nonzero at which a thread starting diag steps into the merge of row ends and nonzeros begins
+   * \param[in] m number of rows
+   * \param[in] IA row pointers (starting from 1)
+   * \param[in] nnz number of nonzeros
+   * \param[in] diag diagonal of the merge path, between 0 and m+nnz
+   * \param[out] row first row not yet finished at diag
+   * \param[out] nz first nonzero not yet consumed at diag
+   */
+  void spmv_merge_path_search(int             m,
+                              int64_t const * IA,
+                              int64_t         nnz,
+                              int64_t         diag,
+                              int *           row,
+                              int64_t *       nz);
+
+  /**
+   * \brief splits the merge path of a CSR matrix into ntd parts with as many rows plus nonzeros each
+   * \param[in] m number of rows
+   * \param[in] IA row pointers (starting from 1)
+   * \param[in] ntd number of parts
+   * \param[out] row_part first row of each part (of size ntd+1)
+   * \param[out] nz_part first nonzero of each part (of size ntd+1)
+   */
+  void spmv_partition(int             m,
+                      int64_t const * IA,
+                      int             ntd,
+                      int *           row_part,
+                      int64_t *       nz_part);
+
+  /**
+   * \brief number of threads used by spmv()
+   */
+  int spmv_num_threads();
+
+  /**
+   * \brief accumulates the product of a CSR matrix A and a dense vector x into y, with merge-path partitioning,
+   *        which gives each thread as many rows plus nonzeros, so that rows of very different lengths do not
+   *        starve threads; rows split between threads are combined after the parallel region
+   * \param[in] m number of rows of A and y
+   * \param[in] A values of A
+   * \param[in] JA column indices of A
+   * \param[in] IA row pointers of A
+   * \param[in] x dense vector
+   * \param[in,out] y dense vector, y[i] is updated only if row i of A has nonzeros
+   * \param[in] fmul function computing a contribution to y from a pair of entries of A and x
+   * \param[in] facc function facc(acc, val) accumulating val into the partial sum acc of a row
+   * \param[in] fout function fout(y_i, acc) accumulating the partial sum acc of a row into y_i
+   */
+  template <typename dtype_A, typename dtype_B, typename dtype_C, typename fmul_t, typename facc_t, typename fout_t>
+  void spmv(int             m,
+            dtype_A const * A,
+            int const *     JA,
+            int64_t const * IA,
+            dtype_B const * x,
+            dtype_C *       y,
+            fmul_t          fmul,
+            facc_t          facc,
+            fout_t          fout){
+    if (m == 0 || IA[m] == IA[0]) return;
+    int ntd = spmv_num_threads();
+    int * row_part = (int*)alloc(sizeof(int)*(ntd+1));
+    int64_t * nz_part = (int64_t*)alloc(sizeof(int64_t)*(ntd+1));
+    spmv_partition(m, IA, ntd, row_part, nz_part);
+    //partial sum of the row each thread stops within, which the next threads finish
+    dtype_C * carry = (dtype_C*)alloc(sizeof(dtype_C)*ntd);
+    bool * has_carry = (bool*)alloc(sizeof(bool)*ntd);
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(ntd)
+#endif
+    {
+      int tid = 0, nthreads = 1;
+#ifdef _OPENMP
+      tid = omp_get_thread_num();
+      nthreads = omp_get_num_threads();
+#endif
+      for (int t=tid; t<ntd; t+=nthreads){
+        int row = row_part[t];
+        int64_t nz = nz_part[t];
+        for (; row<row_part[t+1]; row++){
+          if (nz < IA[row+1]-1){
+            dtype_C acc = fmul(A[nz],x[JA[nz]-1]);
+            for (nz++; nz<IA[row+1]-1; nz++){
+              facc(acc, fmul(A[nz],x[JA[nz]-1]));
+            }
+            fout(y[row], acc);
+          }
+        }
+        has_carry[t] = nz < nz_part[t+1];
+        if (has_carry[t]){
+          carry[t] = fmul(A[nz],x[JA[nz]-1]);
+          for (nz++; nz<nz_part[t+1]; nz++){
+            facc(carry[t], fmul(A[nz],x[JA[nz]-1]));
+          }
+        }
+      }
+    }
+    for (int t=0; t<ntd; t++){
+      if (has_carry[t]) fout(y[row_part[t+1]], carry[t]);
+    }
+    cdealloc(carry);
+    cdealloc(has_carry);
+    cdealloc(row_part);
+    cdealloc(nz_part);
+  }
+}
+
+#endif
@@ -1,6 +1,11 @@
 #include "spr_seq_sum.h"
 #include "../shared/iter_tsr.h"
 #include "../shared/util.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define SPSPSUM_MIN_PAIRS_PER_THREAD 4096
 
 namespace CTF_int{
   template<int idim>
@@ -162,10 +167,191 @@ namespace CTF_int{
     assert(0);
   }
 
+  /**
+   * \brief key of the ww-th pair of A when each pair of A is replicated map_pfx times
+   */
+  static inline int64_t spspsum_key_A(ConstPairIterator const & prs_A, int64_t ww, int64_t map_pfx){
+    return prs_A[ww/map_pfx].k()*map_pfx+ww%map_pfx;
+  }
+
+  /**
+   * \brief merges the pairs ww_st,...,ww_end-1 of the replicated A with the pairs t_st,...,t_end-1 of B,
+   *        which must together hold all pairs with keys in some range, or only counts the resulting pairs
+   * \param[in] sr_A algstrct defining data type of A
+   * \param[in] prs_A pairs of A
+   * \param[in] ww_st first pair of the replicated A
+   * \param[in] ww_end end of the pairs of the replicated A
+   * \param[in] beta scaling factor for data of B
+   * \param[in] sr_B algstrct defining data type of B and the output
+   * \param[in] prs_B pairs of B
+   * \param[in] t_st first pair of B
+   * \param[in] t_end end of the pairs of B
+   * \param[in] alpha scaling factor for data of A
+   * \param[in] func NULL or pointer to a function to apply elementwise
+   * \param[in] map_pfx how many times each element of A should be replicated
+   * \param[in] prs_new where to write the resulting pairs, or NULL to only count them
+   * \return number of resulting pairs
+   */
+  static int64_t spspsum_range(algstrct const *        sr_A,
+                               ConstPairIterator       prs_A,
+                               int64_t                 ww_st,
+                               int64_t                 ww_end,
+                               char const *            beta,
+                               algstrct const *        sr_B,
+                               ConstPairIterator       prs_B,
+                               int64_t                 t_st,
+                               int64_t                 t_end,
+                               char const *            alpha,
+                               univar_function const * func,
+                               int64_t                 map_pfx,
+                               PairIterator *          prs_new){
+    bool is_acc = (func != NULL && func->is_accumulator());
+    int64_t n = 0;
+    int64_t t = t_st;
+    int64_t ww = ww_st;
+    while (t < t_end || ww < ww_end){
+      int64_t w = ww/map_pfx;
+      int64_t k_A = ww < ww_end ? spspsum_key_A(prs_A, ww, map_pfx) : -1;
+      if (ww == ww_end || (t < t_end && prs_B[t].k() < k_A)){
+        if (prs_new != NULL){
+          memcpy((*prs_new)[n].ptr, prs_B[t].ptr, sr_B->pair_size());
+          if (beta != NULL)
+            sr_B->mul(prs_B[t].d(), beta, (*prs_new)[n].d());
+        }
+        t++;
+        n++;
+        continue;
+      }
+      bool is_match = (t < t_end && prs_B[t].k() == k_A);
+      // an accumulator only updates existing values, so new keys of A are dropped along with their repeats
+      if (!is_match && is_acc){
+        ww++;
+        while (map_pfx == 1 && ww < ww_end && prs_A[ww].k() == k_A) ww++;
+        continue;
+      }
+      if (prs_new != NULL){
+        PairIterator pn = (*prs_new)[n];
+        char a[sr_A->el_size];
+        if (alpha != NULL){
+          sr_A->mul(prs_A[w].d(), alpha, a);
+        } else {
+          prs_A[w].read_val(a);
+        }
+        ((int64_t*)pn.ptr)[0] = k_A;
+        if (is_match){
+          char b[sr_B->el_size];
+          if (beta != NULL){
+            sr_B->mul(prs_B[t].d(), beta, b);
+          } else {
+            prs_B[t].read_val(b);
+          }
+          if (func == NULL){
+            sr_B->add(a, b, b);
+          } else {
+            func->acc_f(a, b, sr_B);
+          }
+          pn.write_val(b);
+        } else {
+          if (func == NULL){
+            pn.write_val(a);
+          } else {
+            func->apply_f(a, pn.d());
+          }
+        }
+      }
+      if (is_match) t++;
+      ww++;
+      // accumulate any repeated key writes
+      while (map_pfx == 1 && ww < ww_end && prs_A[ww].k() == k_A){
+        if (prs_new != NULL){
+          PairIterator pn = (*prs_new)[n];
+          char a[sr_A->el_size];
+          if (alpha != NULL){
+            sr_A->mul(prs_A[ww].d(), alpha, a);
+          } else {
+            prs_A[ww].read_val(a);
+          }
+          if (func == NULL)
+            sr_B->add(pn.d(), a, pn.d());
+          else
+            func->acc_f(a, pn.d(), sr_B);
+        }
+        ww++;
+      }
+      n++;
+    }
+    return n;
+  }
+
+  /**
+   * \brief finds the first pair of the replicated A with key no smaller than key
+   */
+  static int64_t spspsum_lower_bound_A(ConstPairIterator prs_A, int64_t nww, int64_t map_pfx, int64_t key){
+    int64_t lo = 0, hi = nww;
+    while (lo < hi){
+      int64_t mid = lo + (hi-lo)/2;
+      if (spspsum_key_A(prs_A, mid, map_pfx) < key) lo = mid+1;
+      else hi = mid;
+    }
+    return lo;
+  }
+
+  /**
+   * \brief finds the first pair of B with key no smaller than key
+   */
+  static int64_t spspsum_lower_bound_B(ConstPairIterator prs_B, int64_t nB, int64_t key){
+    int64_t lo = 0, hi = nB;
+    while (lo < hi){
+      int64_t mid = lo + (hi-lo)/2;
+      if (prs_B[mid].k() < key) lo = mid+1;
+      else hi = mid;
+    }
+    return lo;
+  }
+
+  /**
+   * \brief splits the merge of the replicated A and B at diagonal diag of the merge path,
+   *        moved back to the first pair with the key at which the path is cut, so that
+   *        pairs with equal keys are never split
+   * \param[out] ww_part first pair of the replicated A after the split
+   * \param[out] t_part first pair of B after the split
+   */
+  static void spspsum_merge_path_search(ConstPairIterator prs_A,
+                                        int64_t           nww,
+                                        int64_t           map_pfx,
+                                        ConstPairIterator prs_B,
+                                        int64_t           nB,
+                                        int64_t           diag,
+                                        int64_t *         ww_part,
+                                        int64_t *         t_part){
+    int64_t lo = std::max((int64_t)0, diag-nB);
+    int64_t hi = std::min(diag, nww);
+    while (lo < hi){
+      int64_t mid = lo + (hi-lo)/2;
+      if (spspsum_key_A(prs_A, mid, map_pfx) < prs_B[diag-mid-1].k()) lo = mid+1;
+      else hi = mid;
+    }
+    int64_t ww = lo;
+    int64_t t = diag-lo;
+    if (ww == nww && t == nB){
+      *ww_part = nww;
+      *t_part = nB;
+      return;
+    }
+    int64_t key;
+    if (ww == nww) key = prs_B[t].k();
+    else if (t == nB) key = spspsum_key_A(prs_A, ww, map_pfx);
+    else key = std::min(prs_B[t].k(), spspsum_key_A(prs_A, ww, map_pfx));
+    *ww_part = spspsum_lower_bound_A(prs_A, nww, map_pfx, key);
+    *t_part = spspsum_lower_bound_B(prs_B, nB, key);
+  }
+
   /**
    * \brief As pairs in a sparse A set to the 
    *         sparse set of elements defining the tensor,
-   *         resulting in a set of size between nB and nB+nA
+   *         resulting in a set of size between nB and nB+nA.
+   *         The merge path of A and B is split evenly among threads, which count
+   *         their output pairs, then write them at offsets given by a prefix sum of the counts
    * \param[in] sr_A algstrct defining data type of array
    * \param[in] nA number of elements in sparse tensor
    * \param[in] prs_A pairs of the sparse tensor
@@ -194,132 +380,48 @@ namespace CTF_int{
                int64_t                 map_pfx){
 
     TAU_FSTART(spA_spB_seq_sum);
-    // determine how many unique keys there are in prs_tsr and prs_Write
-    nnew = nB;
-    bool is_acc = (func != NULL && func->is_accumulator());
+    int64_t nww = nA*map_pfx;
+#ifdef _OPENMP
+    int ntd = omp_get_max_threads();
+#else
+    int ntd = 1;
+#endif
+    //give each thread enough pairs to amortize the partitioning
+    ntd = (int)std::max((int64_t)1, std::min((int64_t)ntd, (nww+nB)/SPSPSUM_MIN_PAIRS_PER_THREAD));
+    int64_t ww_part[ntd+1], t_part[ntd+1], n_part[ntd+1];
+    ww_part[0] = 0;
+    t_part[0] = 0;
+    ww_part[ntd] = nww;
+    t_part[ntd] = nB;
+    n_part[0] = 0;
     TAU_FSTART(spA_spB_seq_sum_pre);
-    for (int64_t t=0,ww=0; ww<nA*map_pfx; ww++){
-      while (ww<nA*map_pfx){
-        int64_t w = ww/map_pfx;
-        int64_t mw = ww%map_pfx;
-        if (t<nB && prs_B[t].k() < prs_A[w].k()*map_pfx+mw)
-          t++;
-        else if (t<nB && prs_B[t].k() == prs_A[w].k()*map_pfx+mw){
-          t++;
-          ww++;
-        } else {
-          //ASSERT(map_pfx == 1);
-          if (!is_acc && (map_pfx != 1 || ww==0 || prs_A[ww-1].k() != prs_A[ww].k()))
-            nnew++;
-          ww++; w=ww;
-        }
-      }
+#ifdef _OPENMP
+    #pragma omp parallel for num_threads(ntd)
+#endif
+    for (int i=1; i<ntd; i++){
+      spspsum_merge_path_search(prs_A, nww, map_pfx, prs_B, nB, ((nww+nB)*i)/ntd, ww_part+i, t_part+i);
     }
+#ifdef _OPENMP
+    #pragma omp parallel for num_threads(ntd)
+#endif
+    for (int i=0; i<ntd; i++){
+      n_part[i+1] = spspsum_range(sr_A, prs_A, ww_part[i], ww_part[i+1], beta, sr_B, prs_B, t_part[i], t_part[i+1], alpha, func, map_pfx, NULL);
+    }
+    for (int i=0; i<ntd; i++){
+      n_part[i+1] += n_part[i];
+    }
+    nnew = n_part[ntd];
     TAU_FSTOP(spA_spB_seq_sum_pre);
-//    printf("nB = %ld nA = %ld nnew = %ld\n",nB,nA,nnew); 
     alloc_ptr(sr_B->pair_size()*nnew, (void**)&pprs_new);
     PairIterator prs_new(sr_B, pprs_new);
-    // each for loop computes one new value of prs_new 
-    //    (multiple writes may contribute to it), 
-    //    t, w, and n are incremented within
-    // only incrementing r allows multiple writes of the same val
-    int64_t n=0;
-    for (int64_t t=0,ww=0; n<nnew; n++){
-      /*if (n>0){ 
-        printf("n=%ld\n",n-1);
-        sr_A->print(prs_new[n-1].d());
-      }*/
-      int64_t w = ww/map_pfx;
-      int64_t mw = ww%map_pfx;
-      bool skip = 0;
-      if (t<nB && (w==nA || prs_B[t].k() < prs_A[w].k()*map_pfx+mw)){
-        memcpy(prs_new[n].ptr, prs_B[t].ptr, sr_B->pair_size());
-        if (beta != NULL)
-          sr_B->mul(prs_B[t].d(), beta, prs_new[n].d());
-        t++;
-      } else {
-        /*if (t<nB)
-          printf("%ld %ld\n",prs_B[t].k(), prs_A[w].k()*map_pfx+mw);*/
-        if (t>=nB || prs_B[t].k() > prs_A[w].k()*map_pfx+mw){
-          if (func == NULL){
-            if (map_pfx == 1){
-              memcpy(prs_new[n].ptr, prs_A[w].ptr, sr_A->pair_size());
-            } else {
-              ((int64_t*)prs_new[n].ptr)[0] = prs_A[w].k()*map_pfx+mw; 
-              prs_new[n].write_val(prs_A[w].d());
-            }
-            if (alpha != NULL)
-              sr_A->mul(prs_new[n].d(), alpha, prs_new[n].d());
-          } else {
-            //((int64_t*)prs_new[n].ptr)[0] = prs_A[w].k();
-            if (!is_acc){
-              ((int64_t*)prs_new[n].ptr)[0] = prs_A[w].k()*map_pfx+mw; 
-              if (alpha != NULL){
-                char a[sr_A->el_size];
-                sr_A->mul(prs_A[w].d(), alpha, a);
-                //if (sr_B->addid() != NULL){
-                 // prs_new[n].write_val(sr_B->addid());
-                  func->apply_f(a, prs_new[n].d());
-               // } else {
-
-                //}
-              } else {
-             //   prs_new[n].write_val(sr_B->addid());
-                func->apply_f(prs_A[w].d(), prs_new[n].d());
-              }
-            } else { n--; skip=1; }
-          }
-          ww++;
-        } else {
-          char a[sr_A->el_size];
-          char b[sr_B->el_size];
-          if (alpha != NULL){
-            sr_A->mul(prs_A[w].d(), alpha, a);
-          } else {
-            prs_A[w].read_val(a);
-          }
-          if (beta != NULL){
-            sr_B->mul(prs_B[t].d(), beta, b);
-          } else {
-            prs_B[t].read_val(b);
-          }
-          if (func == NULL){ 
-            sr_B->add(a, b, b);
-          } else {
-            func->acc_f(a, b, sr_B);
-          }
-          prs_new[n].write_val(b);
-          ((int64_t*)(prs_new[n].ptr))[0] = prs_B[t].k();
-          t++;
-          ww++;
-        }
-        // accumulate any repeated key writes
-        while (map_pfx == 1 && ww > 0 && ww<nA && prs_A[ww].k() == prs_A[ww-1].k()){
-          if (!skip){
-            if (alpha != NULL){
-              char a[sr_A->el_size];
-              sr_A->mul(prs_A[ww].d(), alpha, a);
-              if (func == NULL)
-                sr_B->add(prs_new[n].d(), a, prs_new[n].d());
-              else
-                func->acc_f(a, prs_new[n].d(), sr_B);
-            } else {
-              if (func == NULL)
-                sr_B->add(prs_new[n].d(), prs_A[ww].d(), prs_new[n].d());
-              else
-                func->acc_f(prs_A[ww].d(), prs_new[n].d(), sr_B);
-            }
-          }
-          ww++; w=ww;
-        }
-      }
-      /*if (n>=0){
-        printf("%ldth value is ", n);
-        sr_B->print(prs_new[n].d());
-        printf(" with key %ld\n",prs_new[n].k());
-      }*/
+#ifdef _OPENMP
+    #pragma omp parallel for num_threads(ntd)
+#endif
+    for (int i=0; i<ntd; i++){
+      PairIterator prs_new_i = prs_new[n_part[i]];
+      int64_t n = spspsum_range(sr_A, prs_A, ww_part[i], ww_part[i+1], beta, sr_B, prs_B, t_part[i], t_part[i+1], alpha, func, map_pfx, &prs_new_i);
+      ASSERT(n == n_part[i+1]-n_part[i]);
     }
-    ASSERT(n==nnew);
     TAU_FSTOP(spA_spB_seq_sum);
   }
 
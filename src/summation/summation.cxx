@@ -1039,6 +1039,7 @@ namespace CTF_int {
         }
         B->nnz_loc = tnsr_B->nnz_loc;
         B->nnz_tot = tnsr_B->nnz_tot;
+        B->clear_csf();
       } 
       B->data = tnsr_B->data;
     } else B->unfold();
@@ -4,10 +4,16 @@
 #include "untyped_tensor.h"
 #include "algstrct.h"
 #include "../sparse_formats/csr.h"
+#include <map>
 
 using namespace std;
 
 namespace CTF_int {
+  /** \brief depth of the panels of A and B widened at a time by gemm_batch_widen */
+  #ifndef WIDEN_GEMM_KC
+  #define WIDEN_GEMM_KC 256
+  #endif
+
   LinModel<3> csrred_mdl(csrred_mdl_init,"csrred_mdl");
   LinModel<3> csrred_mdl_cst(csrred_mdl_cst_init,"csrred_mdl_cst");
 
@@ -29,6 +35,16 @@ namespace CTF_int {
     assert(0);
     return MPI_CHAR;
   }
+
+  std::type_info const & algstrct::el_type() const {
+    return typeid(void);
+  }
+
+  bool algstrct::is_same_type(algstrct const * other) const {
+    if (el_size != other->el_size) return false;
+    if (el_type() == typeid(void) || other->el_type() == typeid(void)) return true;
+    return el_type() == other->el_type();
+  }
   
   
 
@@ -131,6 +147,16 @@ namespace CTF_int {
     assert(0);
   }
 
+  void algstrct::widen(int64_t n, algstrct const * sr_A, char const * a, char * b) const {
+    if (is_same_type(sr_A)){
+      memcpy(b, a, n*el_size);
+      return;
+    }
+    for (int64_t i=0; i<n; i++){
+      cast_double(sr_A->cast_to_double(a+i*sr_A->el_size), b+i*el_size);
+    }
+  }
+
   void algstrct::scal(int          n,
                       char const * alpha,
                       char       * X,
@@ -175,6 +201,76 @@ namespace CTF_int {
     ASSERT(0);
   }
 
+  void algstrct::gemm_batch_ptrs(char                 tA,
+                                 char                 tB,
+                                 int                  l,
+                                 int                  m,
+                                 int                  n,
+                                 int                  k,
+                                 char const *         alpha,
+                                 char const * const * A,
+                                 char const * const * B,
+                                 char const *         beta,
+                                 char * const *       C)  const {
+    for (int i=0; i<l; i++){
+      gemm(tA, tB, m, n, k, alpha, A[i], B[i], beta, C[i]);
+    }
+  }
+
+
+  void algstrct::gemm_batch_widen(char             tA,
+                                  char             tB,
+                                  int              l,
+                                  int              m,
+                                  int              n,
+                                  int              k,
+                                  char const *     alpha,
+                                  algstrct const * sr_A,
+                                  char const *     A,
+                                  algstrct const * sr_B,
+                                  char const *     B,
+                                  char const *     beta,
+                                  char *           C)  const {
+    int64_t sz_A = ((int64_t)m)*k*sr_A->el_size;
+    int64_t sz_B = ((int64_t)k)*n*sr_B->el_size;
+    int64_t sz_C = ((int64_t)m)*n*el_size;
+    if (k == 0){
+      for (int i=0; i<l; i++){
+        if (!isequal(beta, mulid())) scal(m*n, beta, C+i*sz_C, 1);
+      }
+      return;
+    }
+    int kc = std::min(k, WIDEN_GEMM_KC);
+    char * wA = (char*)alloc(((int64_t)m)*kc*el_size);
+    char * wB = (char*)alloc(((int64_t)kc)*n*el_size);
+    for (int i=0; i<l; i++){
+      char const * iA = A + i*sz_A;
+      char const * iB = B + i*sz_B;
+      char * iC = C + i*sz_C;
+      for (int k0=0; k0<k; k0+=kc){
+        int kb = std::min(kc, k-k0);
+        //widen columns k0:k0+kb of op(A) into an m-by-kb (or kb-by-m if transposed) panel
+        if (tA == 'N' || tA == 'n'){
+          widen(((int64_t)m)*kb, sr_A, iA+((int64_t)k0)*m*sr_A->el_size, wA);
+        } else {
+          for (int j=0; j<m; j++){
+            widen(kb, sr_A, iA+(((int64_t)j)*k+k0)*sr_A->el_size, wA+((int64_t)j)*kb*el_size);
+          }
+        }
+        //widen rows k0:k0+kb of op(B) into a kb-by-n (or n-by-kb if transposed) panel
+        if (tB == 'N' || tB == 'n'){
+          for (int j=0; j<n; j++){
+            widen(kb, sr_B, iB+(((int64_t)j)*k+k0)*sr_B->el_size, wB+((int64_t)j)*kb*el_size);
+          }
+        } else {
+          widen(((int64_t)n)*kb, sr_B, iB+((int64_t)k0)*n*sr_B->el_size, wB);
+        }
+        gemm(tA, tB, m, n, kb, alpha, wA, wB, k0 == 0 ? beta : mulid(), iC);
+      }
+    }
+    cdealloc(wA);
+    cdealloc(wB);
+  }
 
    void algstrct::gemm(char         tA,
                        char         tB,
@@ -219,163 +315,297 @@ namespace CTF_int {
     return iseq;
   }
 
-  void algstrct::coo_to_csr(int64_t nz, int nrow, char * csr_vs, int * csr_cs, int * csr_rs, char const * coo_vs, int const * coo_rs, int const * coo_cs) const {
+  void algstrct::coo_to_csr(int64_t nz, int nrow, char * csr_vs, int * csr_cs, int64_t * csr_rs, char const * coo_vs, int const * coo_rs, int const * coo_cs) const {
     printf("CTF ERROR: cannot convert elements of this algebraic structure to CSR\n");
     ASSERT(0);
   }
       
-  void algstrct::csr_to_coo(int64_t nz, int nrow, char const * csr_vs, int const * csr_ja, int const * csr_ia, char * coo_vs, int * coo_rs, int * coo_cs) const {
+  void algstrct::csr_to_coo(int64_t nz, int nrow, char const * csr_vs, int const * csr_ja, int64_t const * csr_ia, char * coo_vs, int * coo_rs, int * coo_cs) const {
     printf("CTF ERROR: cannot convert elements of this algebraic structure to CSR\n");
     ASSERT(0);
   }
 
 
-//  void algstrct::csr_add(int64_t m, int64_t n, char const * a, int const * ja, int const * ia, char const * b, int const * jb, int const * ib, char *& c, int *& jc, int *& ic){
+//  void algstrct::csr_add(int64_t m, int64_t n, char const * a, int const * ja, int64_t const * ia, char const * b, int const * jb, int64_t const * ib, char *& c, int *& jc, int *& ic){
   char * algstrct::csr_add(char * cA, char * cB) const {
 
     return CTF_int::CSR_Matrix::csr_add(cA, cB, this);
   }
   
-  char * algstrct::csr_reduce(char * cA, int root, MPI_Comm cm) const {
+  /**
+   * \brief communicators of a level of the CSR reduction with radix s: scm connects the s processes that
+   *        exchange row blocks of their matrices, rcm the processes that go on to reduce the same row block
+   */
+  struct csr_red_comms {
+    MPI_Comm scm;
+    MPI_Comm rcm;
+  };
+
+  /** \brief MPI attribute key under which the communicators of the CSR reduction are cached on each communicator */
+  static int csr_red_keyval = MPI_KEYVAL_INVALID;
+
+  /**
+   * \brief frees the cached communicators of the CSR reduction when the communicator they were split from is freed
+   *        or the attribute is deleted by free_csr_red_comms
+   */
+  static int csr_red_comms_free(MPI_Comm cm, int keyval, void * attr, void * extra){
+    std::map<int, csr_red_comms> * cache = (std::map<int, csr_red_comms>*)attr;
+    for (std::map<int, csr_red_comms>::iterator it=cache->begin(); it!=cache->end(); it++){
+      MPI_Comm_free(&it->second.scm);
+      MPI_Comm_free(&it->second.rcm);
+    }
+    delete cache;
+    return MPI_SUCCESS;
+  }
+
+  void free_csr_red_comms(MPI_Comm cm){
+    int is_finalized;
+    MPI_Finalized(&is_finalized);
+    if (csr_red_keyval == MPI_KEYVAL_INVALID || is_finalized) return;
+    void * cache;
+    int flag;
+    MPI_Comm_get_attr(cm, csr_red_keyval, &cache, &flag);
+    if (flag) MPI_Comm_delete_attr(cm, csr_red_keyval);
+  }
+
+  /**
+   * \brief retrieves the communicators of a level of the CSR reduction with radix s over cm, splitting
+   *        cm only the first time, so that repeated reductions over a CommData do not split communicators
+   * \param[in] cm communicator of the level
+   * \param[in] r rank in cm
+   * \param[in] s radix of the level
+   * \param[out] scm communicator of the processes exchanging row blocks
+   * \param[out] rcm communicator of the processes reducing the same row block at the next level
+   */
+  static void get_csr_red_comms(MPI_Comm cm, int r, int s, MPI_Comm * scm, MPI_Comm * rcm){
+    if (csr_red_keyval == MPI_KEYVAL_INVALID)
+      MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, csr_red_comms_free, &csr_red_keyval, NULL);
+    std::map<int, csr_red_comms> * cache;
+    int flag;
+    MPI_Comm_get_attr(cm, csr_red_keyval, &cache, &flag);
+    if (!flag){
+      cache = new std::map<int, csr_red_comms>();
+      MPI_Comm_set_attr(cm, csr_red_keyval, cache);
+    }
+    std::map<int, csr_red_comms>::iterator it = cache->find(s);
+    if (it == cache->end()){
+      csr_red_comms cms;
+      MPI_Comm_split(cm, r/s, r%s, &cms.scm);
+      MPI_Comm_split(cm, r%s, r/s, &cms.rcm);
+      it = cache->insert(std::pair<int, csr_red_comms>(s, cms)).first;
+    }
+    *scm = it->second.scm;
+    *rcm = it->second.rcm;
+  }
+
+  /**
+   * \brief estimates the time of the CSR reduction over p processes of matrices of msg_sz bytes,
+   *        in which each level of radix s exchanges all but one of s row blocks among s processes,
+   *        and finds the radix of the first level that minimizes it
+   * \param[in] p number of processes
+   * \param[in] msg_sz largest size of a matrix to reduce
+   * \param[in,out] memo estimated time and best first radix for numbers of processes already considered
+   * \return estimated time
+   */
+  static double est_csr_red_radix(int p, int64_t msg_sz, std::map<int, std::pair<double,int> > & memo){
+    if (p == 1) return 0.;
+    std::map<int, std::pair<double,int> >::iterator it = memo.find(p);
+    if (it != memo.end()) return it->second.first;
+    double best_t = -1.;
+    int best_s = p;
+    for (int s=2; s<=p; s++){
+      if (p % s != 0) continue;
+      CommData scdt(0, 0, s);
+      double t = scdt.estimate_alltoallv_time((msg_sz/s)*(s-1)) + est_csr_red_radix(p/s, msg_sz, memo);
+      if (best_t < 0. || t < best_t){
+        best_t = t;
+        best_s = s;
+      }
+    }
+    memo[p] = std::pair<double,int>(best_t, best_s);
+    return best_t;
+  }
+
+  /**
+   * \brief reduces the CSR matrices cA over cm with the radices of each level given by radix,
+   *        returning the sum on root and NULL elsewhere
+   */
+  static char * csr_reduce_rec(algstrct const * sr, char * cA, int root, MPI_Comm cm, int const * radix, MPI_Datatype csr_unit){
     int r, p;
     MPI_Comm_rank(cm, &r);
     MPI_Comm_size(cm, &p);
     if (p==1) return cA;
-    TAU_FSTART(csr_reduce);
-    int s = 2;
-    double t_st = MPI_Wtime();
-    while (p%s != 0) s++;
-    int sr = r%s;
+    int s = radix[0];
+    ASSERT(p%s == 0);
+    int sr_ = r%s;
     MPI_Comm scm;
     MPI_Comm rcm;
-    MPI_Comm_split(cm, r/s, sr, &scm);
-    MPI_Comm_split(cm, sr, r/s, &rcm);
-    
+    get_csr_red_comms(cm, r, s, &scm, &rcm);
+
     CSR_Matrix A(cA);
-    int64_t sz_A = A.size();
     char * parts_buffer; 
     CSR_Matrix ** parts = (CSR_Matrix**)alloc(sizeof(CSR_Matrix*)*s);
     A.partition(s, &parts_buffer, parts);
-    //MPI_Request reqs[2*(s-1)];
-    int rcv_szs[s];
-    int snd_szs[s];
+    int64_t rcv_szs[s];
+    int64_t snd_szs[s];
     int64_t tot_buf_size = 0;
     for (int i=0; i<s; i++){
-      if (i==sr) snd_szs[i] = 0;
+      rcv_szs[i] = 0;
+      if (i==sr_) snd_szs[i] = 0;
       else snd_szs[i] = parts[i]->size();
-      tot_buf_size += snd_szs[i];
+      tot_buf_size += parts[i]->size();
     }
 
-    MPI_Alltoall(snd_szs, 1, MPI_INT, rcv_szs, 1, MPI_INT, scm);
+    MPI_Alltoall(snd_szs, 1, MPI_INT64_T, rcv_szs, 1, MPI_INT64_T, scm);
     int64_t tot_rcv_sz = 0;
     for (int i=0; i<s; i++){
-      //printf("i=%d/%d,rcv_szs[i]=%d\n",i,s,rcv_szs[i]);
       tot_rcv_sz += rcv_szs[i];
     }
     char * rcv_buf = (char*)alloc(tot_rcv_sz);
   
     char * smnds[s];
-    int rcv_displs[s];
-    int snd_displs[s];
-    rcv_displs[0] = 0;
+    int64_t rcv_displs[s];
+    int64_t snd_displs[s];
     for (int i=0; i<s; i++){
       if (i>0) rcv_displs[i] = rcv_szs[i-1]+rcv_displs[i-1];
+      else rcv_displs[i] = 0;
       snd_displs[i] = parts[i]->all_data - parts[0]->all_data;
-      if (i==sr) smnds[i] = parts[i]->all_data;
+      if (i==sr_) smnds[i] = parts[i]->all_data;
       else smnds[i] = rcv_buf + rcv_displs[i];
-//      printf("parts[%d].all_data = %p\n",i,parts[i]->all_data);
-  //    printf("snd_dipls[%d] = %d\n", i, snd_displs[i]);
-//      printf("rcv_dipls[%d] = %d\n", i, rcv_displs[i]);
     }
-    MPI_Alltoallv(parts[0]->all_data, snd_szs, snd_displs, MPI_CHAR, rcv_buf, rcv_szs, rcv_displs, MPI_CHAR, scm);
+    int snd_cnts[s], snd_offs[s], rcv_cnts[s], rcv_offs[s];
+    for (int i=0; i<s; i++){
+      snd_cnts[i] = 0;
+      snd_offs[i] = 0;
+      rcv_cnts[i] = 0;
+      rcv_offs[i] = 0;
+    }
+    get_csr_unit_counts(s, snd_szs, snd_displs, snd_cnts, snd_offs);
+    get_csr_unit_counts(s, rcv_szs, rcv_displs, rcv_cnts, rcv_offs);
+    //row blocks are exchanged point-to-point, so that the sums below start as soon as their operands arrive
+    MPI_Request rcv_reqs[s], snd_reqs[s];
+    for (int i=0; i<s; i++){
+      rcv_reqs[i] = MPI_REQUEST_NULL;
+      snd_reqs[i] = MPI_REQUEST_NULL;
+    }
+    for (int j=1; j<s; j++){
+      int i = (sr_+j)%s;
+      MPI_Irecv(rcv_buf+rcv_displs[i], rcv_cnts[i], csr_unit, i, 0, scm, rcv_reqs+i);
+    }
+    for (int j=1; j<s; j++){
+      int i = (sr_+s-j)%s;
+      MPI_Isend(parts[0]->all_data+snd_displs[i], snd_cnts[i], csr_unit, i, 0, scm, snd_reqs+i);
+    }
     for (int i=0; i<s; i++){
       delete parts[i]; //does not actually free buffer space
     }
     cdealloc(parts);
-    /*  smnds[i] = (char*)alloc(rcv_szs[i]);
-      int sbw = (r/phase - i + s-1)%s;
-      int rbw = sbw + (r/(phase*s))*s + (r%phase);
-      int rfw = sfw + (r/(phase*s))*s + (r%phase);
-      char * rcv_data = (char*)alloc(rcv_szs[i]);
-      smnds[i] = rcv_data;
-      MPI_Isend(parts[sfw], snd_szs[i], MPI_CHAR, rfw, s+i, cm, reqs+i);
-      MPI_Irecv(rcv_data, rcv_szs[i], MPI_CHAR, rbw, s+i, cm, reqs+s-1+i);
-    }
-    MPI_Status stats[2*(s-1)];
-    MPI_Waitall(2*(s-1), reqs, stats);
-    for (int i=1; i<s; i++){
-      int sfw = (r/phase + i + s-1)%s;
-      cdealloc(parts[sfw]);
-    }
-    cdealloc(parts);*/
     for (int z=1; z<s; z<<=1){
       for (int i=0; i<s-z; i+=2*z){
-        char * csr_new = csr_add(smnds[i], smnds[i+z]);
+        MPI_Wait(rcv_reqs+i, MPI_STATUS_IGNORE);
+        MPI_Wait(rcv_reqs+i+z, MPI_STATUS_IGNORE);
+        char * csr_new = sr->csr_add(smnds[i], smnds[i+z]);
         if ((smnds[i] < parts_buffer || 
-             smnds[i] > parts_buffer+tot_buf_size) &&
+             smnds[i] >= parts_buffer+tot_buf_size) &&
             (smnds[i] < rcv_buf || 
-             smnds[i] > rcv_buf+tot_rcv_sz))
+             smnds[i] >= rcv_buf+tot_rcv_sz))
           cdealloc(smnds[i]);
         if ((smnds[i+z] < parts_buffer || 
-             smnds[i+z] > parts_buffer+tot_buf_size) &&
+             smnds[i+z] >= parts_buffer+tot_buf_size) &&
             (smnds[i+z] < rcv_buf || 
-             smnds[i+z] > rcv_buf+tot_rcv_sz))
+             smnds[i+z] >= rcv_buf+tot_rcv_sz))
           cdealloc(smnds[i+z]);
         smnds[i] = csr_new;
       }
     }
+    MPI_Waitall(s, snd_reqs, MPI_STATUSES_IGNORE);
     cdealloc(parts_buffer); //dealloc all parts
     cdealloc(rcv_buf);
-    TAU_FSTOP(csr_reduce);
-    char * red_sum = csr_reduce(smnds[0], root/s, rcm);
-    TAU_FSTART(csr_reduce);
+    char * red_sum = csr_reduce_rec(sr, smnds[0], root/s, rcm, radix+1, csr_unit);
     if (smnds[0] != red_sum) cdealloc(smnds[0]);
     if (r/s == root/s){
-      CSR_Matrix cf(red_sum);
-      int sz = cf.size();
+      int64_t sz = 0;
       int sroot = root%s;
-      int cb_sizes[s];
-      if (sroot == sr) sz = 0;
-      MPI_Gather(&sz, 1, MPI_INT, cb_sizes, 1, MPI_INT, sroot, scm);
+      if (sroot != sr_) sz = CSR_Matrix(red_sum).size();
+      //the counts and displacements are only meaningful on sroot, but are set everywhere
+      int64_t cb_sizes[s];
+      int64_t cb_displs[s];
+      int cb_cnts[s], cb_offs[s];
+      for (int i=0; i<s; i++){
+        cb_sizes[i] = 0;
+        cb_displs[i] = 0;
+        cb_cnts[i] = 0;
+        cb_offs[i] = 0;
+      }
+      MPI_Gather(&sz, 1, MPI_INT64_T, cb_sizes, 1, MPI_INT64_T, sroot, scm);
       int64_t tot_cb_size = 0;
-      int cb_displs[s];
-      if (sr == sroot){
+      if (sr_ == sroot){
         for (int i=0; i<s; i++){
           cb_displs[i] = tot_cb_size;
           tot_cb_size += cb_sizes[i];
         }
+        get_csr_unit_counts(s, cb_sizes, cb_displs, cb_cnts, cb_offs);
       }
       char * cb_bufs = (char*)alloc(tot_cb_size);
-      MPI_Gatherv(red_sum, sz, MPI_CHAR, cb_bufs, cb_sizes, cb_displs, MPI_CHAR, sroot, scm);
-      MPI_Comm_free(&scm);
-      MPI_Comm_free(&rcm);
-      if (sr == sroot){
+      MPI_Gatherv(red_sum, sz/CSR_ALIGN, csr_unit, cb_bufs, cb_cnts, cb_offs, csr_unit, sroot, scm);
+      if (sr_ == sroot){
         for (int i=0; i<s; i++){
           smnds[i] = cb_bufs + cb_displs[i];
-          if (i==sr) smnds[i] = red_sum;
+          if (i==sr_) smnds[i] = red_sum;
         }
         CSR_Matrix out(smnds, s);
         cdealloc(red_sum);
         cdealloc(cb_bufs);
-        double t_end = MPI_Wtime() - t_st;
-        double tps[] = {t_end, 1.0, log2((double)p), (double)sz_A};
-        csrred_mdl.observe(tps);
-        TAU_FSTOP(csr_reduce);
         return out.all_data;
       } else {
         cdealloc(red_sum);
         cdealloc(cb_bufs);
-        TAU_FSTOP(csr_reduce);
         return NULL;
       }
     } else {
-      MPI_Comm_free(&scm);
-      MPI_Comm_free(&rcm);
-      TAU_FSTOP(csr_reduce);
       return NULL;
     }
   }
 
+  char * algstrct::csr_reduce(char * cA, int root, MPI_Comm cm) const {
+    int r, p;
+    MPI_Comm_rank(cm, &r);
+    MPI_Comm_size(cm, &p);
+    if (p==1) return cA;
+    TAU_FSTART(csr_reduce);
+    double t_st = MPI_Wtime();
+    int64_t sz_A = CSR_Matrix(cA).size();
+    //the radix of each level is chosen by root for the largest matrix and broadcast, since the estimates
+    //depend on the performance models of each process, and all processes must split cm the same way
+    int64_t max_sz_A;
+    MPI_Allreduce(&sz_A, &max_sz_A, 1, MPI_INT64_T, MPI_MAX, cm);
+    int radix[64];
+    int nlvl = 0;
+    if (r == root){
+      std::map<int, std::pair<double,int> > memo;
+      est_csr_red_radix(p, max_sz_A, memo);
+      for (int q=p; q>1; q/=radix[nlvl-1]){
+        radix[nlvl++] = memo[q].second;
+      }
+    }
+    MPI_Bcast(&nlvl, 1, MPI_INT, root, cm);
+    MPI_Bcast(radix, nlvl, MPI_INT, root, cm);
+    //the sizes of serialized CSR matrices are multiples of CSR_ALIGN, so they are sent in units of CSR_ALIGN bytes,
+    //which keeps the counts and displacements of matrices larger than 2 GB within the range of int
+    MPI_Datatype csr_unit;
+    MPI_Type_contiguous(CSR_ALIGN, MPI_CHAR, &csr_unit);
+    MPI_Type_commit(&csr_unit);
+    char * red_sum = csr_reduce_rec(this, cA, root, cm, radix, csr_unit);
+    MPI_Type_free(&csr_unit);
+    if (r == root){
+      double t_end = MPI_Wtime() - t_st;
+      double tps[] = {t_end, 1.0, log2((double)p), (double)sz_A};
+      csrred_mdl.observe(tps);
+    }
+    TAU_FSTOP(csr_reduce);
+    return red_sum;
+  }
+
   double algstrct::estimate_csr_red_time(int64_t msg_sz, CommData const * cdt) const {
 
     double ps[] = {1.0, log2((double)cdt->np), (double)msg_sz};
@@ -550,7 +780,7 @@ namespace CTF_int {
     ASSERT(0);
   }
 
-  void algstrct::csrmm(int m, int n, int k, char const * alpha, char const * A, int const * JA, int const * IA, int64_t nnz_A, char const * B, char const * beta, char * C, bivar_function const * func) const {
+  void algstrct::csrmm(int m, int n, int k, char const * alpha, char const * A, int const * JA, int64_t const * IA, int64_t nnz_A, char const * B, char const * beta, char * C, bivar_function const * func) const {
     printf("CTF ERROR: csrmm not present for this algebraic structure\n");
     ASSERT(0);
   }
@@ -562,11 +792,11 @@ namespace CTF_int {
                  char const * alpha,
                  char const * A,
                  int const *  JA,
-                 int const *  IA,
+                 int64_t const * IA,
                  int64_t      nnz_A,
                  char const * B,
                  int const *  JB,
-                 int const *  IB,
+                 int64_t const * IB,
                  int64_t      nnz_B,
                  char const * beta,
                  char *       C) const {
@@ -581,11 +811,11 @@ namespace CTF_int {
                  char const * alpha,
                  char const * A,
                  int const *  JA,
-                 int const *  IA,
+                 int64_t const * IA,
                  int64_t      nnz_A,
                  char const * B,
                  int const *  JB,
-                 int const *  IB,
+                 int64_t const * IB,
                  int64_t      nnz_B,
                  char const * beta,
                  char *&      C_CSR) const {
@@ -593,6 +823,29 @@ namespace CTF_int {
     printf("CTF ERROR: csrmultcsr not present for this algebraic structure\n");
     ASSERT(0);
   }
+
+  void algstrct::masked_csrmultcsr
+                (int          m,
+                 int          n,
+                 int          k,
+                 char const * alpha,
+                 char const * A,
+                 int const *  JA,
+                 int64_t const * IA,
+                 int64_t      nnz_A,
+                 char const * B,
+                 int const *  JB,
+                 int64_t const * IB,
+                 int64_t      nnz_B,
+                 char const * beta,
+                 char *&      C_CSR,
+                 int const *  JM,
+                 int64_t const * IM,
+                 bool         is_mask_cmp) const {
+
+    printf("CTF ERROR: masked csrmultcsr not present for this algebraic structure\n");
+    ASSERT(0);
+  }
       
   ConstPairIterator::ConstPairIterator(PairIterator const & pi){
     sr=pi.sr; ptr=pi.ptr; 
@@ -719,7 +972,167 @@ namespace CTF_int {
     }
   };
 
+  /** \brief number of pairs below which PairIterator::sort uses std::sort rather than a radix sort */
+  #ifndef PAIR_RADIX_SORT_MIN
+  #define PAIR_RADIX_SORT_MIN 2048
+  #endif
+  /** \brief minimum number of pairs handled by each thread of the radix sort */
+  #ifndef PAIR_RADIX_SORT_MIN_PER_THREAD
+  #define PAIR_RADIX_SORT_MIN_PER_THREAD 32768
+  #endif
+  /** \brief number of bits of the key sorted by each pass of the radix sort */
+  #define PAIR_RADIX_BITS 11
+
+  /**
+   * \brief key of pair with the sign bit flipped, so that unsigned order matches signed order
+   * \param[in] p pair
+   */
+  static inline uint64_t pair_radix_key(char const * p){
+    int64_t k;
+    memcpy(&k, p, sizeof(int64_t));
+    return ((uint64_t)k) ^ (((uint64_t)1)<<63);
+  }
+
+  /**
+   * \brief stable LSD radix sort of pairs by key, PAIR_RADIX_BITS bits per pass, skipping digits in which all keys agree,
+   *        each thread counting and then scattering a contiguous block of the pairs
+   * \param[in,out] pairs n pairs of size psz
+   * \param[in] n number of pairs
+   * \param[in] rt_psz size of each pair, used if ps is zero
+   * \return false if the pairs were already sorted and have not been moved
+   */
+  template <int ps>
+  static bool radix_sort_pairs(char * pairs, int64_t n, int64_t rt_psz){
+    int64_t const psz = ps > 0 ? ps : rt_psz;
+    int nt = 1;
+#ifdef USE_OMP
+    if (!omp_in_parallel())
+      nt = std::max(1, (int)std::min((int64_t)omp_get_max_threads(), n/PAIR_RADIX_SORT_MIN_PER_THREAD));
+#endif
+    //bits in which some key differs from the first, and whether the pairs are already sorted
+    uint64_t const k0 = pair_radix_key(pairs);
+    uint64_t diff = 0;
+    int unsorted = 0;
+#ifdef USE_OMP
+    #pragma omp parallel for num_threads(nt) if(nt>1) reduction(|:diff,unsorted)
+#endif
+    for (int64_t i=1; i<n; i++){
+      uint64_t k = pair_radix_key(pairs+i*psz);
+      diff |= k ^ k0;
+      unsorted |= k < pair_radix_key(pairs+(i-1)*psz);
+    }
+    if (!unsorted) return false;
+
+    char * src = pairs;
+    char * dst = (char*)alloc(psz*n);
+    int const nd = 1<<PAIR_RADIX_BITS;
+    uint64_t const msk = nd-1;
+    int64_t * cnts = (int64_t*)alloc(sizeof(int64_t)*nd*nt);
+    for (int sh=0; sh<64; sh+=PAIR_RADIX_BITS){
+      if (((diff>>sh) & msk) == 0) continue;
+#ifdef USE_OMP
+      #pragma omp parallel num_threads(nt) if(nt>1)
+#endif
+      {
+        int tid = 0, ntd = 1;
+#ifdef USE_OMP
+        tid = omp_get_thread_num();
+        ntd = omp_get_num_threads();
+#endif
+        int64_t st = (n*tid)/ntd;
+        int64_t end = (n*(tid+1))/ntd;
+        int64_t * cnt = cnts + nd*tid;
+        std::fill(cnt, cnt+nd, 0);
+        for (int64_t i=st; i<end; i++){
+          cnt[(pair_radix_key(src+i*psz)>>sh) & msk]++;
+        }
+#ifdef USE_OMP
+        #pragma omp barrier
+        #pragma omp single
+#endif
+        {
+          //threads write each digit after all pairs with that digit in preceding blocks
+          int64_t off = 0;
+          for (int d=0; d<nd; d++){
+            for (int t=0; t<ntd; t++){
+              int64_t c = cnts[nd*t+d];
+              cnts[nd*t+d] = off;
+              off += c;
+            }
+          }
+        }
+        for (int64_t i=st; i<end; i++){
+          char const * p = src+i*psz;
+          int64_t & o = cnt[(pair_radix_key(p)>>sh) & msk];
+          memcpy(dst+o*psz, p, psz);
+          o++;
+        }
+      }
+      std::swap(src, dst);
+    }
+    if (src != pairs){
+#ifdef USE_OMP
+      #pragma omp parallel for num_threads(nt) if(nt>1)
+#endif
+      for (int t=0; t<nt; t++){
+        int64_t st = (n*t)/nt;
+        int64_t end = (n*(t+1))/nt;
+        memcpy(pairs+st*psz, src+st*psz, (end-st)*psz);
+      }
+      dst = src;
+    }
+    cdealloc(dst);
+    cdealloc(cnts);
+    return true;
+  }
+
   void PairIterator::sort(int64_t n){
+    if (n >= PAIR_RADIX_SORT_MIN){
+      //fixed pair sizes of common algebraic structures let the compiler inline the copies
+      switch (sr->pair_size()){
+        case 12:
+          radix_sort_pairs<12>(ptr, n, 12);
+          break;
+        case 16:
+          radix_sort_pairs<16>(ptr, n, 16);
+          break;
+        case 24:
+          radix_sort_pairs<24>(ptr, n, 24);
+          break;
+        default: {
+          int64_t psz = sr->pair_size();
+          if (psz <= 24){
+            radix_sort_pairs<0>(ptr, n, psz);
+            break;
+          }
+          //larger pairs are sorted by moving keys and offsets, then gathered once
+          CompPtrPair * kp = (CompPtrPair*)alloc(sizeof(CompPtrPair)*n);
+#ifdef USE_OMP
+          #pragma omp parallel for if(!omp_in_parallel())
+#endif
+          for (int64_t i=0; i<n; i++){
+            memcpy(&kp[i].key, ptr+i*psz, sizeof(int64_t));
+            kp[i].idx = i;
+          }
+          if (!radix_sort_pairs<sizeof(CompPtrPair)>((char*)kp, n, sizeof(CompPtrPair))){
+            cdealloc(kp);
+            break;
+          }
+          char * buf = (char*)alloc(psz*n);
+          memcpy(buf, ptr, psz*n);
+#ifdef USE_OMP
+          #pragma omp parallel for if(!omp_in_parallel())
+#endif
+          for (int64_t i=0; i<n; i++){
+            memcpy(ptr+i*psz, buf+kp[i].idx*psz, psz);
+          }
+          cdealloc(buf);
+          cdealloc(kp);
+          break;
+        }
+      }
+      return;
+    }
     switch (sr->el_size){
       case 1:
         ASSERT(sizeof(BoolPair)==sr->pair_size());
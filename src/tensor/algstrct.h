@@ -72,6 +72,16 @@ namespace CTF_int {
 
       /** \brief MPI datatype */
       virtual MPI_Datatype mdtype() const;
+
+      /** \brief C++ type of the elements, typeid(void) if not known */
+      virtual std::type_info const & el_type() const;
+
+      /**
+       * \brief whether elements of other are stored in the same type as elements of
+       *        this algstrct, compared by el_type() if both know it, else by el_size
+       * \param[in] other algebraic structure to compare to
+       */
+      bool is_same_type(algstrct const * other) const;
       
       /** \brief MPI datatype for pairs */
 //      MPI_Datatype pair_mdtype();
@@ -137,6 +147,16 @@ namespace CTF_int {
       /** \brief return (double)*c */
       virtual double cast_to_double(char const * c) const;
 
+      /**
+       * \brief converts n elements of the type of sr_A to this type, e.g. float to double,
+       *        by default via cast_to_double and cast_double
+       * \param[in] n number of elements
+       * \param[in] sr_A algebraic structure of the elements of a
+       * \param[in] a elements to convert
+       * \param[out] b n elements of this type
+       */
+      virtual void widen(int64_t n, algstrct const * sr_A, char const * a, char * b) const;
+
       /** \brief prints the value */
       virtual void print(char const * a, FILE * fp=stdout) const;
 
@@ -179,6 +199,43 @@ namespace CTF_int {
                               char const * beta,
                               char *       C)  const;
 
+      /**
+       * \brief beta*C[l]["ij"]=alpha*A[l]^tA["ik"]*B[l]^tB["kj"] for l matrices
+       *        addressed by arrays of pointers rather than stored contiguously,
+       *        by default one gemm per matrix
+       */
+      virtual void gemm_batch_ptrs(char                 tA,
+                                   char                 tB,
+                                   int                  l,
+                                   int                  m,
+                                   int                  n,
+                                   int                  k,
+                                   char const *         alpha,
+                                   char const * const * A,
+                                   char const * const * B,
+                                   char const *         beta,
+                                   char * const *       C)  const;
+
+      /**
+       * \brief beta*C["ijl"]=alpha*A^tA["ikl"]*B^tB["kjl"], where A and B are stored
+       *        in the (narrower) types of sr_A and sr_B and C, alpha, and beta are of
+       *        this type. A and B are widened one panel of the k index at a time
+       *        and multiplied by gemm, so the full operands are never converted.
+       */
+      virtual void gemm_batch_widen(char             tA,
+                                    char             tB,
+                                    int              l,
+                                    int              m,
+                                    int              n,
+                                    int              k,
+                                    char const *     alpha,
+                                    algstrct const * sr_A,
+                                    char const *     A,
+                                    algstrct const * sr_B,
+                                    char const *     B,
+                                    char const *     beta,
+                                    char *           C)  const;
+
       virtual void offload_gemm(char         tA,
                                 char         tB,
                                 int          m,
@@ -213,7 +270,7 @@ namespace CTF_int {
                          char const *           alpha,
                          char const *           A,
                          int const *            JA,
-                         int const *            IA,
+                         int64_t const *        IA,
                          int64_t                nnz_A,
                          char const *           B,
                          char const *           beta,
@@ -228,11 +285,11 @@ namespace CTF_int {
                  char const * alpha,
                  char const * A,
                  int const *  JA,
-                 int const *  IA,
+                 int64_t const * IA,
                  int64_t      nnz_A,
                  char const * B,
                  int const *  JB,
-                 int const *  IB,
+                 int64_t const * IB,
                  int64_t      nnz_B,
                  char const * beta,
                  char *       C) const;
@@ -243,28 +300,56 @@ namespace CTF_int {
                  char const * alpha,
                  char const * A,
                  int const *  JA,
-                 int const *  IA,
+                 int64_t const * IA,
                  int64_t      nnz_A,
                  char const * B,
                  int const *  JB,
-                 int const *  IB,
+                 int64_t const * IB,
                  int64_t      nnz_B,
                  char const * beta,
                  char *&      C_CSR) const;
 
+      /**
+       * \brief csrmultcsr computing only the entries of C in (or, if is_mask_cmp, not in) the
+       *        sparsity pattern of a mask given by the CSR column indices JM and row pointers IM
+       */
+      virtual void masked_csrmultcsr
+                (int          m,
+                 int          n,
+                 int          k,
+                 char const * alpha,
+                 char const * A,
+                 int const *  JA,
+                 int64_t const * IA,
+                 int64_t      nnz_A,
+                 char const * B,
+                 int const *  JB,
+                 int64_t const * IB,
+                 int64_t      nnz_B,
+                 char const * beta,
+                 char *&      C_CSR,
+                 int const *  JM,
+                 int64_t const * IM,
+                 bool         is_mask_cmp) const;
+
       /** \brief returns true if algstrct elements a and b are equal */
       virtual bool isequal(char const * a, char const * b) const;
 
       /** \brief converts coordinate sparse matrix layout to CSR layout */
-      virtual void coo_to_csr(int64_t nz, int nrow, char * csr_vs, int * csr_cs, int * csr_rs, char const * coo_vs, int const * coo_rs, int const * coo_cs) const;
+      virtual void coo_to_csr(int64_t nz, int nrow, char * csr_vs, int * csr_cs, int64_t * csr_rs, char const * coo_vs, int const * coo_rs, int const * coo_cs) const;
       
       /** \brief converts CSR sparse matrix layout to coordinate (COO) layout */
-      virtual void csr_to_coo(int64_t nz, int nrow, char const * csr_vs, int const * csr_ja, int const * csr_ia, char * coo_vs, int * coo_rs, int * coo_cs) const;
+      virtual void csr_to_coo(int64_t nz, int nrow, char const * csr_vs, int const * csr_ja, int64_t const * csr_ia, char * coo_vs, int * coo_rs, int * coo_cs) const;
 
       /** \brief adds CSR matrices A (stored in cA) and B (stored in cB) to create matric C (pointer to all_data returned), C data allocated internally */
       virtual char * csr_add(char * cA, char * cB) const;
 
-      /** \brief reduces CSR matrices stored in cA on each processor in cm and returns result on processor root */
+      /**
+       * \brief reduces CSR matrices stored in cA on each processor in cm and returns result on processor root,
+       *        by levels that each exchange row blocks among a group of processes and add them, with the group sizes
+       *        chosen by the performance model for the size of the largest matrix, and the communicators
+       *        of the levels cached on cm
+       */
       virtual char * csr_reduce(char * cA, int root, MPI_Comm cm) const;
     
       /** estimate time in seconds necessary for CSR reduction with input of size msg_sz */
@@ -386,6 +471,13 @@ namespace CTF_int {
    */
   void depin(algstrct const * sr, int order, int const * lens, int const * divisor, int nvirt, int const * virt_dim, int const * phys_rank, char * X, int64_t & new_nnz_B, int64_t * nnz_blk, char *& new_B, bool check_padding);
 
+  /**
+   * \brief frees the communicators of the CSR reduction cached on cm, which is needed for communicators
+   *        that CTF does not free itself, such as MPI_COMM_WORLD
+   * \param[in] cm communicator
+   */
+  void free_csr_red_comms(MPI_Comm cm);
+
   class PairIterator {
     public:
       algstrct const * sr;
@@ -450,7 +542,10 @@ namespace CTF_int {
       void write_key(int64_t key);
 
       /**
-       * \brief sorts set of pairs using std::sort 
+       * \brief sorts set of pairs by key, using std::sort for fewer than PAIR_RADIX_SORT_MIN pairs and
+       *        otherwise a stable least-significant-digit radix sort over the bytes of the keys
+       *        (threaded with OpenMP unless called from within a parallel region)
+       * \param[in] n number of pairs
        */
       void sort(int64_t n);
       
@@ -0,0 +1,364 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+#include "../interface/common.h"
+#include "../interface/timer.h"
+#include "../contraction/contraction.h"
+#include "untyped_file_tensor.h"
+#include "../shared/util.h"
+#include "../shared/memcontrol.h"
+
+using namespace CTF;
+
+namespace CTF_int {
+
+  file_tensor::file_tensor(algstrct const * sr_,
+                           int              order_,
+                           int const *      lens_,
+                           World *          wrld_,
+                           char const *     filename,
+                           int64_t          offset_){
+    sr          = sr_->clone();
+    order       = order_;
+    lens        = (int*)alloc(sizeof(int)*order);
+    memcpy(lens, lens_, sizeof(int)*order);
+    wrld        = wrld_;
+    offset      = offset_;
+    slab_stride = 1;
+    for (int i=0; i<order-1; i++){
+      slab_stride *= lens[i];
+    }
+    MPI_File_open(wrld->comm, filename, MPI_MODE_RDWR | MPI_MODE_CREATE, MPI_INFO_NULL, &file);
+  }
+
+  file_tensor::~file_tensor(){
+    MPI_File_close(&file);
+    cdealloc(lens);
+    delete sr;
+  }
+
+  void file_tensor::write(tensor * A){
+    ASSERT(A->order == order);
+    A->write_dense_to_file(file, offset);
+  }
+
+  void file_tensor::read(tensor * A){
+    ASSERT(A->order == order);
+    A->read_dense_from_file(file, offset);
+  }
+
+  tensor * file_tensor::alloc_slab(int len){
+    int slab_lens[order];
+    int nsym[order];
+    memcpy(slab_lens, lens, sizeof(int)*(order-1));
+    slab_lens[order-1] = len;
+    std::fill(nsym, nsym+order, NS);
+    return new tensor(sr, order, slab_lens, nsym, wrld, 1, NULL, 0);
+  }
+
+  void file_tensor::read_slab(int64_t st, tensor * slab){
+    slab->read_dense_from_file(file, offset + st*slab_stride*sr->el_size);
+  }
+
+  void file_tensor::write_slab(int64_t st, tensor * slab){
+    slab->write_dense_to_file(file, offset + st*slab_stride*sr->el_size);
+  }
+
+  void file_tensor::begin_read_slab(int64_t st, int len, slab_request & rq){
+    //same partitioning of the slab among processes as in read_dense_from_file()
+    int64_t tot_els = slab_stride*len;
+    int64_t chnk_sz = tot_els/wrld->np;
+    rq.st         = st;
+    rq.len        = len;
+    rq.my_chnk_sz = chnk_sz;
+    if (wrld->rank < tot_els%wrld->np) rq.my_chnk_sz++;
+    rq.my_chnk_st = chnk_sz*wrld->rank + std::min((int64_t)wrld->rank, tot_els%wrld->np);
+    rq.pairs      = (char*)alloc(sr->pair_size()*rq.my_chnk_sz);
+    char * pairs_tail = rq.pairs + sizeof(int64_t)*rq.my_chnk_sz;
+    MPI_Offset off = offset + (st*slab_stride + rq.my_chnk_st)*sr->el_size;
+    //MPI counts are int, so larger chunks are read in several pieces
+    rq.reqs.clear();
+    for (int64_t i=0; i<rq.my_chnk_sz; i+=max_int_count){
+      MPI_Request req;
+      MPI_File_iread_at(file, off + i*sr->el_size, pairs_tail + i*sr->el_size,
+                        (int)std::min(rq.my_chnk_sz-i, max_int_count), sr->mdtype(), &req);
+      rq.reqs.push_back(req);
+    }
+  }
+
+  tensor * file_tensor::end_read_slab(slab_request & rq){
+    MPI_Waitall((int)rq.reqs.size(), rq.reqs.data(), MPI_STATUSES_IGNORE);
+    rq.reqs.clear();
+    char * pairs_tail = rq.pairs + sizeof(int64_t)*rq.my_chnk_sz;
+    PairIterator pi(sr, rq.pairs);
+    for (int64_t i=0; i<rq.my_chnk_sz; i++){
+      char val[sr->el_size];
+      memcpy(val, pairs_tail+i*sr->el_size, sr->el_size);
+      pi[i].write_key(rq.my_chnk_st+i);
+      pi[i].write_val(val);
+    }
+    tensor * slab = alloc_slab(rq.len);
+    slab->write(rq.my_chnk_sz, sr->mulid(), sr->addid(), rq.pairs);
+    cdealloc(rq.pairs);
+    rq.st = -1;
+    return slab;
+  }
+
+  /**
+   * \brief estimates the memory per process needed by an out-of-core contraction with given tile sizes
+   * \param[in] ops operands A, B, C
+   * \param[in] tmap for each mode of each operand, the tiled index it corresponds to or -1
+   * \param[in] tsz tile size of each tiled index
+   * \return bytes per process
+   */
+  static int64_t ooc_tile_mem(file_tensor * const *    ops,
+                              std::vector<int> const * tmap,
+                              std::vector<int> const & tsz){
+    int64_t tot = 0;
+    for (int o=0; o<3; o++){
+      int64_t slab_sz = 1;
+      int64_t sub_sz = 1;
+      bool has_sub = false;
+      for (int i=0; i<ops[o]->order; i++){
+        if (i == ops[o]->order-1){
+          slab_sz *= tsz[tmap[o][i]];
+          sub_sz  *= tsz[tmap[o][i]];
+        } else {
+          slab_sz *= ops[o]->lens[i];
+          if (tmap[o][i] >= 0){
+            sub_sz  *= tsz[tmap[o][i]];
+            has_sub  = true;
+          } else
+            sub_sz  *= ops[o]->lens[i];
+        }
+      }
+      //slabs of A and B are double buffered to prefetch the next ones, and read via pair buffers
+      tot += (o < 2 ? 2 : 1)*slab_sz*ops[o]->sr->pair_size();
+      //the contraction of the tiles needs about twice the memory of its operands
+      if (has_sub)
+        tot += 3*sub_sz*ops[o]->sr->el_size;
+      else
+        tot += 2*slab_sz*ops[o]->sr->el_size;
+    }
+    return tot/ops[2]->wrld->np;
+  }
+
+  int file_tensor::contract(char const *  alpha,
+                            file_tensor * A,
+                            char const *  idx_A,
+                            file_tensor * B,
+                            char const *  idx_B,
+                            char const *  beta,
+                            char const *  idx_C,
+                            int64_t       max_memory){
+    file_tensor * ops[3] = {A, B, this};
+    char const * idx[3] = {idx_A, idx_B, idx_C};
+    if (A == this || B == this){
+      if (wrld->rank == 0)
+        printf("CTF ERROR: output of out-of-core contraction must be stored in a different file than the operands\n");
+      return ERROR;
+    }
+    //the tiled indices are the last index of each operand
+    std::vector<char> tidx;
+    std::vector<int> tlen;
+    int ilast[3];
+    for (int o=0; o<3; o++){
+      if (ops[o]->order == 0 || ops[o]->wrld != wrld || !ops[o]->sr->is_same_type(sr)){
+        if (wrld->rank == 0)
+          printf("CTF ERROR: out-of-core contraction requires operands of nonzero order, of the same type, and on the same world\n");
+        return ERROR;
+      }
+      for (int i=0; i<ops[o]->order; i++){
+        for (int j=0; j<i; j++){
+          if (idx[o][i] == idx[o][j]){
+            if (wrld->rank == 0)
+              printf("CTF ERROR: out-of-core contraction does not support repeated indices within an operand\n");
+            return ERROR;
+          }
+        }
+        for (int p=0; p<o; p++){
+          for (int j=0; j<ops[p]->order; j++){
+            if (idx[o][i] == idx[p][j] && ops[o]->lens[i] != ops[p]->lens[j]){
+              if (wrld->rank == 0)
+                printf("CTF ERROR: out-of-core contraction index %c has inconsistent edge lengths\n", idx[o][i]);
+              return ERROR;
+            }
+          }
+        }
+      }
+      char c = idx[o][ops[o]->order-1];
+      ilast[o] = std::find(tidx.begin(), tidx.end(), c) - tidx.begin();
+      if (ilast[o] == (int)tidx.size()){
+        tidx.push_back(c);
+        tlen.push_back(ops[o]->lens[ops[o]->order-1]);
+      }
+    }
+    int nt = tidx.size();
+    std::vector<int> tmap[3];
+    for (int o=0; o<3; o++){
+      for (int i=0; i<ops[o]->order; i++){
+        int t = std::find(tidx.begin(), tidx.end(), idx[o][i]) - tidx.begin();
+        tmap[o].push_back(t < nt ? t : -1);
+      }
+    }
+    bool has_sub[3];
+    for (int o=0; o<3; o++){
+      has_sub[o] = false;
+      for (int i=0; i<ops[o]->order-1; i++){
+        if (tmap[o][i] >= 0) has_sub[o] = true;
+      }
+    }
+    //tiles along indices not in C accumulate into the same part of C
+    std::vector<bool> is_in_C(nt, false);
+    for (int i=0; i<order; i++){
+      if (tmap[2][i] >= 0) is_in_C[tmap[2][i]] = true;
+    }
+
+    //halve the largest tile until the tiles fit in memory
+    int64_t mem = max_memory >= 0 ? max_memory : proc_bytes_available();
+    std::vector<int> tsz(tlen);
+    while (ooc_tile_mem(ops, tmap, tsz) > mem){
+      int imax = -1;
+      for (int t=0; t<nt; t++){
+        if (tsz[t] > 1 && (imax == -1 || tsz[t] > tsz[imax])) imax = t;
+      }
+      if (imax == -1){
+        if (wrld->rank == 0)
+          printf("CTF ERROR: out-of-core contraction tiles do not fit in %ld bytes per process\n", mem);
+        return ERROR;
+      }
+      tsz[imax] = (tsz[imax]+1)/2;
+    }
+    std::vector<int> ntile(nt);
+    for (int t=0; t<nt; t++){
+      ntile[t] = (tlen[t]+tsz[t]-1)/tsz[t];
+    }
+  #if DEBUG >= 1
+    if (wrld->rank == 0){
+      printf("Out-of-core contraction tiles:");
+      for (int t=0; t<nt; t++) printf(" %c: %d of %d", tidx[t], ntile[t], tsz[t]);
+      printf("\n");
+    }
+  #endif
+
+    //enumerate tiles with the tile of the last index of C outermost, so that each slab of C is loaded once
+    std::vector<int> tord;
+    tord.push_back(ilast[2]);
+    for (int t=0; t<nt; t++){
+      if (t != ilast[2]) tord.push_back(t);
+    }
+    std::vector< std::vector<int> > steps;
+    std::vector<int> ti(nt, 0);
+    bool done = false;
+    while (!done){
+      steps.push_back(ti);
+      done = true;
+      for (int j=nt-1; j>=0; j--){
+        ti[tord[j]]++;
+        if (ti[tord[j]] < ntile[tord[j]]){
+          done = false;
+          break;
+        }
+        ti[tord[j]] = 0;
+      }
+    }
+
+    TAU_FSTART(ooc_contract);
+    bool is_beta_zero = sr->isequal(beta, sr->addid());
+    tensor * slab[3] = {NULL, NULL, NULL};
+    int64_t slab_st[3] = {-1, -1, -1};
+    slab_request rq[2];
+    rq[0].st = -1;
+    rq[1].st = -1;
+    int nsym[MAX_ORD];
+    std::fill(nsym, nsym+MAX_ORD, NS);
+    for (int s=0; s<(int)steps.size(); s++){
+      std::vector<int> const & st = steps[s];
+      //slab of C, written back once all contributions to it are accumulated
+      int tc = ilast[2];
+      int64_t cst = ((int64_t)st[tc])*tsz[tc];
+      if (slab_st[2] != cst){
+        if (slab[2] != NULL){
+          write_slab(slab_st[2], slab[2]);
+          delete slab[2];
+        }
+        slab[2] = alloc_slab(std::min((int64_t)tsz[tc], tlen[tc]-cst));
+        if (!is_beta_zero) read_slab(cst, slab[2]);
+        slab_st[2] = cst;
+      }
+      //slabs of A and B, which may have been prefetched during the previous step
+      for (int o=0; o<2; o++){
+        int t = ilast[o];
+        int64_t ost = ((int64_t)st[t])*tsz[t];
+        if (slab_st[o] != ost){
+          if (slab[o] != NULL) delete slab[o];
+          if (rq[o].st == ost){
+            slab[o] = ops[o]->end_read_slab(rq[o]);
+          } else {
+            if (rq[o].st != -1) delete ops[o]->end_read_slab(rq[o]);
+            slab[o] = ops[o]->alloc_slab(std::min((int64_t)tsz[t], tlen[t]-ost));
+            ops[o]->read_slab(ost, slab[o]);
+          }
+          slab_st[o] = ost;
+        }
+      }
+      if (s+1 < (int)steps.size()){
+        for (int o=0; o<2; o++){
+          int t = ilast[o];
+          int64_t nst = ((int64_t)steps[s+1][t])*tsz[t];
+          if (nst != slab_st[o] && rq[o].st == -1)
+            ops[o]->begin_read_slab(nst, std::min((int64_t)tsz[t], tlen[t]-nst), rq[o]);
+        }
+      }
+
+      //tiles of the slabs along tiled indices that are not the last index of the operand
+      tensor * tile[3];
+      int offs[3][MAX_ORD];
+      int ends[3][MAX_ORD];
+      int zeros[MAX_ORD];
+      std::fill(zeros, zeros+MAX_ORD, 0);
+      for (int o=0; o<3; o++){
+        if (!has_sub[o]){
+          tile[o] = slab[o];
+          continue;
+        }
+        int tile_lens[MAX_ORD];
+        for (int i=0; i<ops[o]->order; i++){
+          int t = tmap[o][i];
+          if (i == ops[o]->order-1 || t < 0){
+            offs[o][i] = 0;
+            ends[o][i] = slab[o]->lens[i];
+          } else {
+            offs[o][i] = st[t]*tsz[t];
+            ends[o][i] = std::min(offs[o][i]+tsz[t], tlen[t]);
+          }
+          tile_lens[i] = ends[o][i]-offs[o][i];
+        }
+        tile[o] = new tensor(sr, ops[o]->order, tile_lens, nsym, wrld, 1, NULL, 0);
+        tile[o]->slice(zeros, tile_lens, sr->addid(), slab[o], offs[o], ends[o], sr->mulid());
+      }
+
+      //C is scaled by beta at the first contribution to each of its tiles
+      bool is_first = true;
+      for (int t=0; t<nt; t++){
+        if (!is_in_C[t] && st[t] != 0) is_first = false;
+      }
+      contraction ctr(tile[0], idx_A, tile[1], idx_B, alpha, tile[2], idx_C, is_first ? beta : sr->mulid());
+      ctr.execute();
+
+      if (has_sub[2])
+        slab[2]->slice(offs[2], ends[2], sr->addid(), tile[2], zeros, tile[2]->lens, sr->mulid());
+      for (int o=0; o<3; o++){
+        if (has_sub[o]) delete tile[o];
+      }
+    }
+    write_slab(slab_st[2], slab[2]);
+    for (int o=0; o<3; o++){
+      delete slab[o];
+    }
+    for (int o=0; o<2; o++){
+      if (rq[o].st != -1) delete ops[o]->end_read_slab(rq[o]);
+    }
+    TAU_FSTOP(ooc_contract);
+    return SUCCESS;
+  }
+}
@@ -0,0 +1,153 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+#ifndef __UNTYPED_FILE_TENSOR_H__
+#define __UNTYPED_FILE_TENSOR_H__
+
+#include "untyped_tensor.h"
+
+namespace CTF_int {
+
+  /**
+   * \brief nonblocking read of a slab of a file_tensor, started by file_tensor::begin_read_slab()
+   *        and completed by file_tensor::end_read_slab()
+   */
+  struct slab_request {
+    /** \brief first index of the slab along the last mode, -1 if no read is pending */
+    int64_t     st;
+    /** \brief length of the slab along the last mode */
+    int         len;
+    /** \brief first element of the slab read by this process */
+    int64_t     my_chnk_st;
+    /** \brief number of elements of the slab read by this process */
+    int64_t     my_chnk_sz;
+    /** \brief pair buffer, the file data is read into its tail */
+    char *      pairs;
+    /** \brief one request per read of at most INT_MAX elements */
+    std::vector<MPI_Request> reqs;
+  };
+
+  /**
+   * \brief internal tensor stored densely in a binary file (nonsymmetric, in the element
+   *        order of tensor::write_dense_to_file()), which is accessed in slabs, i.e. ranges
+   *        of its last mode, each of which is contiguous in the file
+   */
+  class file_tensor {
+    public:
+      /** \brief algebraic structure of the elements */
+      algstrct * sr;
+      /** \brief number of modes */
+      int order;
+      /** \brief edge lengths */
+      int * lens;
+      /** \brief distributed context, all of whose processes access the file */
+      CTF::World * wrld;
+      /** \brief file, opened collectively on wrld->comm */
+      MPI_File file;
+      /** \brief displacement in bytes of the first element in the file */
+      int64_t offset;
+      /** \brief number of elements in a slab of length one */
+      int64_t slab_stride;
+
+      /**
+       * \brief opens (creating if necessary) a file to store a tensor
+       * \param[in] sr defines the tensor arithmetic for this tensor
+       * \param[in] order number of dimensions of tensor
+       * \param[in] lens edge lengths of tensor
+       * \param[in] wrld a distributed context for the tensor to live in
+       * \param[in] filename name of file, the same on all processes
+       * \param[in] offset displacement in bytes at which the tensor starts in the file
+       */
+      file_tensor(algstrct const * sr,
+                  int              order,
+                  int const *      lens,
+                  CTF::World *     wrld,
+                  char const *     filename,
+                  int64_t          offset=0);
+
+      /**
+       * \brief closes the file
+       */
+      ~file_tensor();
+
+      /**
+       * \brief writes all data of a tensor with the same edge lengths to the file
+       * \param[in] A tensor to store
+       */
+      void write(tensor * A);
+
+      /**
+       * \brief reads all data of the file into a tensor with the same edge lengths
+       * \param[in,out] A tensor to overwrite
+       */
+      void read(tensor * A);
+
+      /**
+       * \brief allocates a nonsymmetric dense tensor of the shape of a slab
+       * \param[in] len length of the slab along the last mode
+       * \return tensor with edge lengths lens[0],...,lens[order-2],len
+       */
+      tensor * alloc_slab(int len);
+
+      /**
+       * \brief reads a slab from the file
+       * \param[in] st first index of the slab along the last mode
+       * \param[in,out] slab tensor created by alloc_slab(), which is overwritten
+       */
+      void read_slab(int64_t st, tensor * slab);
+
+      /**
+       * \brief writes a slab to the file
+       * \param[in] st first index of the slab along the last mode
+       * \param[in] slab tensor created by alloc_slab()
+       */
+      void write_slab(int64_t st, tensor * slab);
+
+      /**
+       * \brief starts a nonblocking read of a slab, so that it can be overlapped with computation
+       * \param[in] st first index of the slab along the last mode
+       * \param[in] len length of the slab along the last mode
+       * \param[out] rq handle of the read
+       */
+      void begin_read_slab(int64_t st, int len, slab_request & rq);
+
+      /**
+       * \brief completes a read started by begin_read_slab()
+       * \param[in,out] rq handle of the read, rq.st is set to -1
+       * \return slab tensor created by alloc_slab(rq.len) containing the data
+       */
+      tensor * end_read_slab(slab_request & rq);
+
+      /**
+       * \brief out-of-core contraction this[idx_C] = beta*this[idx_C] + alpha*A[idx_A]*B[idx_B],
+       *        which streams slabs of A, B, and this tensor through memory, so that at any time
+       *        only tiles of the operands are held in memory. The tiled indices are the last
+       *        index of each operand. The tile sizes are the largest (in powers of two) for which
+       *        the tiles and the buffers used to prefetch the next tiles of A and B fit
+       *        in max_memory. Each index may appear at most once in each operand.
+       * \param[in] alpha scaling factor of A*B
+       * \param[in] A first operand
+       * \param[in] idx_A indices of A
+       * \param[in] B second operand
+       * \param[in] idx_B indices of B
+       * \param[in] beta scaling factor of this tensor
+       * \param[in] idx_C indices of this tensor
+       * \param[in] max_memory bytes per process available for tiles, if less than zero
+       *            proc_bytes_available() is used
+       * \return SUCCESS or ERROR
+       */
+      int contract(char const *  alpha,
+                   file_tensor * A,
+                   char const *  idx_A,
+                   file_tensor * B,
+                   char const *  idx_B,
+                   char const *  beta,
+                   char const *  idx_C,
+                   int64_t       max_memory=-1);
+
+    private:
+      file_tensor(file_tensor const & other);
+      file_tensor & operator=(file_tensor const & other);
+  };
+}
+
+#endif
@@ -8,6 +8,8 @@
 #include "../shared/util.h"
 #include "../shared/memcontrol.h"
 #include "../redistribution/sparse_rw.h"
+#include "../sparse_formats/dcsr.h"
+#include "../sparse_formats/csf.h"
 #include "../redistribution/pad.h"
 #include "../redistribution/nosym_transp.h"
 #include "../redistribution/redist.h"
@@ -61,6 +63,8 @@ namespace CTF_int {
         if (has_home && !is_home) cdealloc(home_buffer);
       }
       if (is_sparse) cdealloc(nnz_blk);
+      if (csf_mode_order != NULL) cdealloc(csf_mode_order);
+      clear_csf();
       order = -1;
       delete sr;
       cdealloc(name);
@@ -138,6 +142,7 @@ namespace CTF_int {
     cdealloc(nname);
 
     this->has_zero_edge_len = other->has_zero_edge_len;
+    this->set_csf(other->is_csf, other->csf_mode_order);
 
     if (copy) {
       copy_tensor_data(other);
@@ -321,7 +326,12 @@ namespace CTF_int {
     this->nnz_tot           = 0;
     this->nnz_blk           = NULL;
     this->is_csr            = false;
+    this->is_dcsr           = false;
     this->nrow_idx          = -1;
+    this->is_csf            = false;
+    this->csf_mode_order    = NULL;
+    this->csf_data          = NULL;
+    this->csf_blk_sz        = NULL;
     this->left_home_transp  = 0;
 //    this->nnz_loc_max       = 0;
     this->registered_alloc_size = 0;
@@ -439,6 +449,53 @@ namespace CTF_int {
     return npe;
   }
 
+  int64_t * tensor::calc_nnz_hist() const {
+    int np = wrld->np;
+    int64_t * loc_hist = (int64_t*)alloc(sizeof(int64_t)*order*np);
+    int64_t * nnz_hist = (int64_t*)alloc(sizeof(int64_t)*order*np);
+    std::fill(loc_hist, loc_hist+order*np, 0);
+    int64_t lda[order];
+    for (int i=0; i<order; i++){
+      if (i == 0) lda[i] = 1;
+      else lda[i] = lda[i-1]*lens[i-1];
+    }
+    if (is_sparse && !is_folded){
+      ConstPairIterator pi(sr, data);
+      for (int64_t j=0; j<nnz_loc; j++){
+        int64_t k = pi[j].k();
+        for (int i=0; i<order; i++){
+          loc_hist[i*np+((k/lda[i])%lens[i])%np]++;
+        }
+      }
+    }
+    wrld->cdt.allred(loc_hist, nnz_hist, order*np, MPI_INT64_T, MPI_SUM);
+    cdealloc(loc_hist);
+    return nnz_hist;
+  }
+
+  double tensor::est_nnz_imbalance(int64_t const * nnz_hist) const {
+    int np = wrld->np;
+    double imb = 1.;
+    for (int i=0; i<order; i++){
+      //processes along the mode hold indices of the same residue modulo the physical phase, which divides np
+      int phys_phase = edge_map[i].calc_phys_phase();
+      if (phys_phase <= 1 || np % phys_phase != 0) continue;
+      int64_t nnz_mode = 0;
+      int64_t max_nnz = 0;
+      for (int r=0; r<phys_phase; r++){
+        int64_t nnz_r = 0;
+        for (int q=r; q<np; q+=phys_phase){
+          nnz_r += nnz_hist[i*np+q];
+        }
+        nnz_mode += nnz_r;
+        max_nnz = std::max(max_nnz, nnz_r);
+      }
+      if (nnz_mode > 0)
+        imb *= ((double)max_nnz*phys_phase)/nnz_mode;
+    }
+    return imb;
+  }
+
 
   void tensor::set_padding(){
     int j, pad, i;
@@ -682,6 +739,37 @@ namespace CTF_int {
     return name;
   }
 
+  int tensor::set_csf(bool is_csf_, int const * mode_order){
+    clear_csf();
+    if (csf_mode_order != NULL){
+      cdealloc(csf_mode_order);
+      csf_mode_order = NULL;
+    }
+    is_csf = false;
+    if (!is_csf_) return SUCCESS;
+    if (!is_sparse){
+      printf("CTF ERROR: CSF layout may only be used for sparse tensors\n");
+      return ERROR;
+    }
+    if (mode_order != NULL){
+      int * seen = (int*)alloc(sizeof(int)*order);
+      std::fill(seen, seen+order, 0);
+      for (int i=0; i<order; i++){
+        if (mode_order[i] < 0 || mode_order[i] >= order || seen[mode_order[i]]){
+          printf("CTF ERROR: CSF mode order must be a permutation of the modes of the tensor\n");
+          cdealloc(seen);
+          return ERROR;
+        }
+        seen[mode_order[i]] = 1;
+      }
+      cdealloc(seen);
+      csf_mode_order = (int*)alloc(sizeof(int)*order);
+      memcpy(csf_mode_order, mode_order, sizeof(int)*order);
+    }
+    is_csf = true;
+    return SUCCESS;
+  }
+
   void tensor::profile_on(){
     profile = true;
   }
@@ -2057,6 +2145,7 @@ namespace CTF_int {
 
   void tensor::pull_alias(tensor const * other){
     if (other->is_data_aliased){
+      this->clear_csf();
       this->topo = other->topo;
       copy_mapping(other->order, other->edge_map,
                    this->edge_map);
@@ -2071,6 +2160,7 @@ namespace CTF_int {
   void tensor::clear_mapping(){
     int j;
     mapping * map;
+    clear_csf();
     for (j=0; j<this->order; j++){
       map = this->edge_map + j;
       map->clear();
@@ -2091,6 +2181,7 @@ namespace CTF_int {
     char * shuffled_data_corr;
   #endif
 
+    clear_csf();
     distribution new_dist = distribution(this);
     if (is_sparse) can_block_shuffle = 0;
     else {
@@ -2551,6 +2642,7 @@ namespace CTF_int {
 
   void tensor::addinv(){
     if (is_sparse){
+      clear_csf();
       PairIterator pi(sr,data);
 #ifdef USE_OMP
       #pragma omp parallel for
@@ -2584,6 +2676,7 @@ namespace CTF_int {
   }
 
   void tensor::set_new_nnz_glb(int64_t const * nnz_blk_){
+    clear_csf();
     if (is_sparse){
       nnz_loc = 0;
       for (int i=0; i<calc_nvirt(); i++){
@@ -2595,7 +2688,7 @@ namespace CTF_int {
     }
   }
 
-  void tensor::spmatricize(int m, int n, int nrow_idx, bool csr){
+  void tensor::spmatricize(int m, int n, int nrow_idx, bool csr, bool allow_dcsr){
     ASSERT(is_sparse);
 
 #ifdef PROFILE
@@ -2606,9 +2699,14 @@ namespace CTF_int {
     int64_t new_sz_A = 0;
     this->rec_tsr->is_sparse = 1;
     int nvirt_A = calc_nvirt();
+    //hypersparse blocks would be dominated by the row pointers of CSR, so only their nonempty rows are stored,
+    //blocks are exchanged among processes, so the choice depends only on global quantities
+    bool dcsr = csr && allow_dcsr && this->nnz_tot*DCSR_ROW_FRAC < ((int64_t)m)*nvirt_A*calc_npe();
     this->rec_tsr->nnz_blk = (int64_t*)alloc(nvirt_A*sizeof(int64_t));
     for (int i=0; i<nvirt_A; i++){
-      if (csr)
+      if (dcsr)
+        this->rec_tsr->nnz_blk[i] = get_dcsr_size(this->nnz_blk[i], std::min(this->nnz_blk[i], (int64_t)m), this->sr->el_size);
+      else if (csr)
         this->rec_tsr->nnz_blk[i] = get_csr_size(this->nnz_blk[i], m, this->sr->el_size);
       else
         this->rec_tsr->nnz_blk[i] = get_coo_size(this->nnz_blk[i], this->sr->el_size);
@@ -2623,7 +2721,12 @@ namespace CTF_int {
     char * data_ptr_out = this->rec_tsr->data;
     char const * data_ptr_in = this->data;
     for (int i=0; i<nvirt_A; i++){
-      if (csr){
+      if (dcsr){
+        COO_Matrix cm(this->nnz_blk[i], this->sr);
+        cm.set_data(this->nnz_blk[i], this->order, this->lens, this->inner_ordering, nrow_idx, data_ptr_in, this->sr, phase);
+        DCSR_Matrix cs(cm, m, n, this->sr, data_ptr_out);
+        cdealloc(cm.all_data);
+      } else if (csr){
         COO_Matrix cm(this->nnz_blk[i], this->sr);
         cm.set_data(this->nnz_blk[i], this->order, this->lens, this->inner_ordering, nrow_idx, data_ptr_in, this->sr, phase);
         CSR_Matrix cs(cm, m, n, this->sr, data_ptr_out);
@@ -2636,6 +2739,7 @@ namespace CTF_int {
       data_ptr_out += this->rec_tsr->nnz_blk[i];
     }
     this->is_csr = csr;
+    this->is_dcsr = dcsr;
     this->nrow_idx = nrow_idx;
 #ifdef PROFILE
 //        double t_end = MPI_Wtime();
@@ -2671,7 +2775,10 @@ namespace CTF_int {
     int nvirt = calc_nvirt();
     for (int i=0; i<nvirt; i++){
       if (this->rec_tsr->nnz_blk[i]>0){
-        if (csr){
+        if (csr && is_dcsr){
+          DCSR_Matrix cA(this->rec_tsr->data+offset);
+          new_sz += cA.nnz()*sr->pair_size();
+        } else if (csr){
           CSR_Matrix cA(this->rec_tsr->data+offset);
           new_sz += cA.nnz()*sr->pair_size();
         } else {
@@ -2694,7 +2801,13 @@ namespace CTF_int {
     char const * data_ptr_in = this->rec_tsr->data;
     for (int i=0; i<nvirt; i++){
       if (this->rec_tsr->nnz_blk[i]>0){
-        if (csr){
+        if (csr && is_dcsr){
+          DCSR_Matrix cs((char*)data_ptr_in);
+          COO_Matrix cm(cs, this->sr);
+          cm.get_data(cs.nnz(), this->order, this->lens, this->inner_ordering, nrow_idx, data_ptr_out, this->sr, phase, phase_rank);
+          this->nnz_blk[i] = cm.nnz();
+          cdealloc(cm.all_data);
+        } else if (csr){
           CSR_Matrix cs((char*)data_ptr_in);
           COO_Matrix cm(cs, this->sr);
           cm.get_data(cs.nnz(), this->order, this->lens, this->inner_ordering, nrow_idx, data_ptr_out, this->sr, phase, phase_rank);
@@ -2722,6 +2835,7 @@ namespace CTF_int {
     }
     set_new_nnz_glb(this->nnz_blk);
     this->rec_tsr->is_csr = csr;
+    this->is_dcsr = false;
 
 #ifdef PROFILE
 //        double t_end = MPI_Wtime();
@@ -2730,6 +2844,63 @@ namespace CTF_int {
 #endif
   }
 
+  void tensor::build_csf(int const * mode_order){
+    ASSERT(is_sparse);
+    if (csf_data != NULL){
+      if (memcmp(CSF_Tensor(csf_data).mode_order(), mode_order, sizeof(int)*order) == 0) return;
+      clear_csf();
+    }
+    TAU_FSTART(build_csf);
+    int nvirt = calc_nvirt();
+    int phase[order];
+    int blk_lens[order];
+    for (int i=0; i<order; i++){
+      phase[i] = edge_map[i].calc_phase();
+      blk_lens[i] = pad_edge_len[i]/phase[i];
+    }
+    char * trees[nvirt];
+    int64_t tot_sz = 0;
+    csf_blk_sz = (int64_t*)alloc(nvirt*sizeof(int64_t));
+    char const * data_ptr_in = data;
+    for (int i=0; i<nvirt; i++){
+      //keys are taken to the coordinates of the block, as done by spctr_pin_keys for pairs
+      char * pairs = (char*)alloc(std::max(nnz_blk[i], (int64_t)1)*sr->pair_size());
+      memcpy(pairs, data_ptr_in, nnz_blk[i]*sr->pair_size());
+      ConstPairIterator(sr, data_ptr_in).pin(nnz_blk[i], order, lens, phase, PairIterator(sr, pairs));
+      CSF_Tensor ct(nnz_blk[i], order, blk_lens, mode_order, pairs, sr);
+      cdealloc(pairs);
+      trees[i] = ct.all_data;
+      csf_blk_sz[i] = ct.size();
+      tot_sz += csf_blk_sz[i];
+      data_ptr_in += nnz_blk[i]*sr->pair_size();
+    }
+    csf_data = (char*)alloc(tot_sz);
+    char * data_ptr_out = csf_data;
+    for (int i=0; i<nvirt; i++){
+      memcpy(data_ptr_out, trees[i], csf_blk_sz[i]);
+      cdealloc(trees[i]);
+      data_ptr_out += csf_blk_sz[i];
+    }
+    TAU_FSTOP(build_csf);
+  }
+
+  void tensor::clear_csf(){
+    if (csf_data != NULL){
+      cdealloc(csf_data);
+      cdealloc(csf_blk_sz);
+      csf_data = NULL;
+      csf_blk_sz = NULL;
+    }
+  }
+
+  void tensor::take_csf(tensor * other){
+    clear_csf();
+    csf_data = other->csf_data;
+    csf_blk_sz = other->csf_blk_sz;
+    other->csf_data = NULL;
+    other->csf_blk_sz = NULL;
+  }
+
   void tensor::leave_home_with_buffer(){
 #ifdef HOME_CONTRACT
     if (this->has_home){
@@ -2765,8 +2936,11 @@ namespace CTF_int {
       int nsym[order];
       std::fill(nsym, nsym+order, NS);
       tensor t_dns(sr, order, lens, nsym, wrld);
-      t_dns["ij"] = (*this)["ij"];
-      t_dns.write_dense_to_file(file);
+      int idx[order];
+      for (int i=0; i<order; i++) idx[i] = i;
+      summation ts(this, idx, sr->mulid(), &t_dns, idx, sr->addid());
+      ts.execute();
+      t_dns.write_dense_to_file(file, offset);
     } else {
       int64_t tot_els = packed_size(order, lens, sym);
       int64_t chnk_sz = tot_els/wrld->np;
@@ -2790,7 +2964,11 @@ namespace CTF_int {
 
       MPI_Status stat;
       MPI_Offset off = my_chnk_st*sr->el_size+offset;
-      MPI_File_write_at(file, off, my_pairs, my_chnk_sz, sr->mdtype(), &stat);
+      //MPI counts are int, so larger chunks are written in several pieces
+      for (int64_t i=0; i<my_chnk_sz; i+=max_int_count){
+        MPI_File_write_at(file, off + i*sr->el_size, my_pairs + i*sr->el_size,
+                          (int)std::min(my_chnk_sz-i, max_int_count), sr->mdtype(), &stat);
+      }
       cdealloc(my_pairs);
     }
   }
@@ -2804,8 +2982,10 @@ namespace CTF_int {
       int nsym[order];
       std::fill(nsym, nsym+order, NS);
       tensor t_dns(sr, order, lens, nsym, wrld);
-      t_dns.read_dense_from_file(file);
-      summation ts(&t_dns, "ij", sr->mulid(), this, "ij", sr->addid());
+      t_dns.read_dense_from_file(file, offset);
+      int idx[order];
+      for (int i=0; i<order; i++) idx[i] = i;
+      summation ts(&t_dns, idx, sr->mulid(), this, idx, sr->addid());
       ts.sum_tensors(true); //does not symmetrize
 //      this->["ij"] = t_dns["ij"];
       if (is_sparse) this->sparsify();
@@ -2821,7 +3001,10 @@ namespace CTF_int {
       char * my_pairs_tail = my_pairs + sizeof(int64_t)*my_chnk_sz;
       MPI_Status stat;
       MPI_Offset off = my_chnk_st*sr->el_size+offset;
-      MPI_File_read_at(file, off, my_pairs_tail, my_chnk_sz, sr->mdtype(), &stat);
+      for (int64_t i=0; i<my_chnk_sz; i+=max_int_count){
+        MPI_File_read_at(file, off + i*sr->el_size, my_pairs_tail + i*sr->el_size,
+                         (int)std::min(my_chnk_sz-i, max_int_count), sr->mdtype(), &stat);
+      }
 
       PairIterator pi(sr, my_pairs);
       for (int64_t i=0; i<my_chnk_sz; i++){
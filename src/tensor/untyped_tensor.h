@@ -131,8 +131,19 @@ namespace CTF_int {
       bool is_sparse;
       /** \brief whether CSR or COO if folded */
       bool is_csr;
+      /** \brief whether the CSR layout is doubly compressed (DCSR), storing only nonempty rows */
+      bool is_dcsr;
       /** \brief how many modes are folded into matricized row */
       int nrow_idx;
+      /** \brief whether local blocks are compressed into CSF trees when the tensor is the sparse operand of a contraction with dense tensors */
+      bool is_csf;
+      /** \brief mode stored at each level of the CSF trees from the root, NULL if chosen for each contraction */
+      int * csf_mode_order;
+      /** \brief CSF trees of the local blocks (in the coordinates of each block), kept from the contraction that built them
+                 until the pairs or their distribution change, NULL if none are kept */
+      char * csf_data;
+      /** \brief size in bytes of the CSF tree of each local block, NULL if csf_data is NULL */
+      int64_t * csf_blk_sz;
       /** \brief number of local nonzero elements */
       int64_t nnz_loc;
       /** \brief maximum number of local nonzero elements over all procs*/
@@ -243,6 +254,22 @@ namespace CTF_int {
        */
       int64_t calc_npe() const;
 
+      /**
+       * \brief counts the nonzeros of a sparse tensor by the residue of their index in each
+       *        mode modulo the number of processes, which determines how many nonzeros
+       *        each process holds in any mapping of the tensor (collective)
+       * \return array of order*wrld->np counts, the count of residue r in mode i is at i*wrld->np+r
+       */
+      int64_t * calc_nnz_hist() const;
+
+      /**
+       * \brief estimates the ratio of the largest number of nonzeros held by a process to the
+       *        average in the current mapping, assuming the modes of the nonzeros are independent
+       * \param[in] nnz_hist nonzero counts computed by calc_nnz_hist()
+       * \return estimated imbalance, at least 1
+       */
+      double est_nnz_imbalance(int64_t const * nnz_hist) const;
+
 
       /**
        * \brief sets padding and local size of a tensor given a mapping
@@ -298,6 +325,16 @@ namespace CTF_int {
       /** \brief turn off profiling */
       void profile_off();
 
+      /**
+       * \brief selects whether the tensor is stored in compressed-sparse-fiber (CSF) layout within contractions
+       *        in which it is the only sparse operand, instead of being matricized into CSR/COO
+       * \param[in] is_csf whether to use CSF
+       * \param[in] mode_order permutation giving the mode of the tensor stored at each level of the tree from the root,
+       *            if NULL the modes appearing in the output are placed closest to the root
+       * \return SUCCESS, or ERROR if the tensor is not sparse or mode_order is not a permutation
+       */
+      int set_csf(bool is_csf, int const * mode_order=NULL);
+
 
       /**
        * \brief get raw data pointer without copy WARNING: includes padding
@@ -688,8 +725,9 @@ namespace CTF_int {
        * \param[in] n number of columns in matrix
        * \param[in] nrow_idx number of indices to fold into column
        * \param[in] csr whether to do csr (1) or coo (0) layout
+       * \param[in] allow_dcsr whether a csr layout may be doubly compressed (DCSR) if the blocks are hypersparse
        */
-      void spmatricize(int m, int n, int nrow_idx, bool csr);
+      void spmatricize(int m, int n, int nrow_idx, bool csr, bool allow_dcsr=false);
 
       /**
        * \brief transposes back local data from sparse matrix format to key-value pair format
@@ -698,6 +736,23 @@ namespace CTF_int {
        */
       void despmatricize(int nrow_idx, bool csr);
 
+      /**
+       * \brief compresses the local blocks into CSF trees (csf_data), unless trees with the same mode order are kept
+       * \param[in] mode_order mode of the tensor stored at each level of the trees from the root
+       */
+      void build_csf(int const * mode_order);
+
+      /**
+       * \brief drops the CSF trees of the local blocks, called whenever the pairs or their distribution change
+       */
+      void clear_csf();
+
+      /**
+       * \brief takes over the CSF trees of other, which must have the same pairs and distribution
+       * \param[in,out] other tensor whose trees are taken
+       */
+      void take_csf(tensor * other);
+
       /**
        * \brief degister home buffer
        */
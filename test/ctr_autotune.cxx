@@ -0,0 +1,134 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup ctr_autotune ctr_autotune
+  * @{
+  * \brief Contractions with mappings chosen by timing the fastest predicted mappings
+  */
+#include <ctf.hpp>
+
+using namespace CTF;
+
+/**
+ * \brief counts the lines of a file on the first process of dw
+ */
+int64_t count_lines(char const * filename, World & dw){
+  int64_t nl = 0;
+  if (dw.rank == 0){
+    FILE * f = fopen(filename, "r");
+    if (f != NULL){
+      int c;
+      while ((c = fgetc(f)) != EOF){
+        if (c == '\n') nl++;
+      }
+      fclose(f);
+    }
+  }
+  MPI_Bcast(&nl, 1, MPI_INT64_T, 0, dw.comm);
+  return nl;
+}
+
+int ctr_autotune(int     n,
+                 World & dw){
+  int rank;
+  bool pass = true;
+  char const * filename = "ctr_autotune.tune";
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  int shapeN4[] = {NS,NS,NS,NS};
+  int sizeN4[] = {n,n+1,n,n+1};
+  Tensor<> A(4, sizeN4, shapeN4, dw);
+  Tensor<> B(4, sizeN4, shapeN4, dw);
+  Tensor<> C(4, sizeN4, shapeN4, dw);
+  Tensor<> C_ref(4, sizeN4, shapeN4, dw);
+  A.fill_random(-1.,1.);
+  B.fill_random(-1.,1.);
+  C.fill_random(-1.,1.);
+  C_ref["ijkl"] = C["ijkl"];
+  C_ref["ijkl"] += A["ijmn"]*B["mnkl"];
+
+  if (rank == 0) remove(filename);
+  MPI_Barrier(dw.comm);
+  int autotune = dw.autotune;
+  std::string tuning_file = dw.tuning_file;
+  dw.autotune = 3;
+  dw.tuning_file = filename;
+  invalidate_ctr_plan_cache(&dw);
+
+  //the first contraction is tuned, the operands must not be changed by the timed runs
+  C["ijkl"] += A["ijmn"]*B["mnkl"];
+  C_ref["ijkl"] -= C["ijkl"];
+  pass = pass && C_ref.norm2() <= 1.E-10*n*n;
+  int64_t nl = count_lines(filename, dw);
+  pass = pass && nl >= 1;
+
+  //the tuned mapping is reused without tuning again
+  invalidate_ctr_plan_cache(&dw);
+  C_ref["ijkl"] = C["ijkl"];
+  C_ref["ijkl"] += A["ijmn"]*B["mnkl"];
+  C["ijkl"] += A["ijmn"]*B["mnkl"];
+  C_ref["ijkl"] -= C["ijkl"];
+  pass = pass && C_ref.norm2() <= 1.E-10*n*n;
+  pass = pass && count_lines(filename, dw) == nl;
+
+  dw.autotune = autotune;
+  dw.tuning_file = tuning_file;
+  invalidate_ctr_plan_cache(&dw);
+  if (rank == 0) remove(filename);
+
+  if (pass){
+    if (rank == 0)
+      printf("{ C[\"ijkl\"] += A[\"ijmn\"]*B[\"mnkl\"] with autotuned mapping } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ C[\"ijkl\"] += A[\"ijmn\"]*B[\"mnkl\"] with autotuned mapping } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing autotuned contraction mappings with n = %d:\n",n);
+    }
+    ctr_autotune(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
@@ -0,0 +1,145 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup ctr_batch ctr_batch
+  * @{
+  * \brief Batched contraction of many small tensors with identical shapes
+  */
+#include <ctf.hpp>
+
+using namespace CTF;
+
+/**
+ * \brief checks Tensor::contract_batch, or with idx_form the contract_batch
+ *        of indexed tensors (C[i] += A[i]*B[i]), against individual contractions
+ */
+int check_ctr_batch(int          nbatch,
+                    World &      w,
+                    int          m,
+                    int          n,
+                    int          k,
+                    char const * idx_A,
+                    char const * idx_B,
+                    char const * idx_C,
+                    bool         idx_form=false){
+  std::vector< Tensor<>* > A, B, C, C_ref;
+  std::vector<Idx_Tensor> iA, iB, iC;
+  double alpha = idx_form ? 1. : 1.5;
+  double beta = idx_form ? 1. : .5;
+  int pass = 1;
+  for (int i=0; i<nbatch; i++){
+    int lA[2], lB[2], lC[2];
+    // lengths from index names: i->m, j->n, k->k
+    char const * idx[3] = {idx_A, idx_B, idx_C};
+    int * lns[3] = {lA, lB, lC};
+    for (int t=0; t<3; t++){
+      for (int d=0; d<2; d++){
+        lns[t][d] = idx[t][d] == 'i' ? m : (idx[t][d] == 'j' ? n : k);
+      }
+    }
+    A.push_back(new Matrix<>(lA[0], lA[1], NS, w));
+    B.push_back(new Matrix<>(lB[0], lB[1], NS, w));
+    C.push_back(new Matrix<>(lC[0], lC[1], NS, w));
+    C_ref.push_back(new Matrix<>(lC[0], lC[1], NS, w));
+    A[i]->fill_random(-1.,1.);
+    B[i]->fill_random(-1.,1.);
+    C[i]->fill_random(-1.,1.);
+    (*C_ref[i])[idx_C] = (*C[i])[idx_C];
+    C_ref[i]->contract(alpha, *A[i], idx_A, *B[i], idx_B, beta, idx_C);
+    iA.push_back((*A[i])[idx_A]);
+    iB.push_back((*B[i])[idx_B]);
+    iC.push_back((*C[i])[idx_C]);
+  }
+  if (idx_form)
+    contract_batch(nbatch, &iA[0], &iB[0], &iC[0]);
+  else
+    Tensor<>::contract_batch(nbatch, alpha, &A[0], idx_A, &B[0], idx_B, beta, &C[0], idx_C);
+  iA.clear();
+  iB.clear();
+  iC.clear();
+  for (int i=0; i<nbatch; i++){
+    (*C_ref[i])[idx_C] -= (*C[i])[idx_C];
+    if (C_ref[i]->norm2() > 1.E-10*m*n) pass = 0;
+    delete A[i];
+    delete B[i];
+    delete C[i];
+    delete C_ref[i];
+  }
+  return pass;
+}
+
+int ctr_batch(int     n,
+              World & dw){
+  int rank, pass;
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  srand48(29*rank);
+  World sw(MPI_COMM_SELF);
+
+  // local tensors, executed by gemm_batch
+  pass = check_ctr_batch(16, sw, n, n+1, n+2, "ik", "kj", "ij");
+  pass = pass && check_ctr_batch(16, sw, n, n+1, n+2, "ki", "jk", "ij");
+  pass = pass && check_ctr_batch(16, sw, n, n+1, n+2, "ik", "kj", "ji");
+  pass = pass && check_ctr_batch(16, sw, n, n+1, n+2, "ik", "kj", "ij", true);
+  // distributed tensors and non-gemm index patterns, contracted one by one
+  pass = pass && check_ctr_batch(3, dw, n, n+1, n+2, "ik", "kj", "ij");
+  pass = pass && check_ctr_batch(3, sw, n, n, n, "ik", "ik", "ik");
+  pass = pass && check_ctr_batch(3, dw, n, n+1, n+2, "ik", "kj", "ij", true);
+
+  MPI_Allreduce(MPI_IN_PLACE, &pass, 1, MPI_INT, MPI_MIN, dw.comm);
+  if (pass){
+    if (rank == 0)
+      printf("{ C[i][\"ij\"] = A[i][\"ik\"]*B[i][\"kj\"] for a batch of i } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ C[i][\"ij\"] = A[i][\"ik\"]*B[i][\"kj\"] for a batch of i } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing batched contraction with n = %d:\n",n);
+    }
+    ctr_batch(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
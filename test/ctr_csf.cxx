@@ -0,0 +1,147 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup ctr_csf ctr_csf
+  * @{
+  * \brief Contractions of sparse tensors stored in CSF layout with dense tensors, against dense contractions
+  */
+#include <ctf.hpp>
+
+using namespace CTF;
+
+int ctr_csf(int     n,
+            World & dw){
+  int rank;
+  bool pass = true;
+  int r = 3;
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  int lens_T[] = {n, n+1, n+2};
+  Tensor<> T(3, true, lens_T, dw);
+  T.fill_sp_random(-1., 1., .2);
+  Tensor<> T_d(3, lens_T, dw);
+  T_d["ijk"] = T["ijk"];
+  T.set_csf(true);
+
+  //order-three sparse tensor times matrix, with the modes indexing C at the root of the tree
+  Matrix<> B(n+1, r, dw);
+  B.fill_random(-1., 1.);
+  int lens_C[] = {n, n+2, r};
+  Tensor<> C(3, lens_C, dw);
+  C.fill_random(-1., 1.);
+  Tensor<> C_d(C);
+  C["ikr"] += 2.*T["ijk"]*B["jr"];
+  C_d["ikr"] += 2.*T_d["ijk"]*B["jr"];
+  Tensor<> diff(3, lens_C, dw);
+  diff["ikr"] = C["ikr"] - C_d["ikr"];
+  pass = pass && diff.norm2() < 1.E-6;
+
+  //the trees are kept for the next contraction and dropped once the tensor is modified
+  int is_kept = T.csf_data != NULL;
+  C["ikr"] += T["ijk"]*B["jr"];
+  C_d["ikr"] += T_d["ijk"]*B["jr"];
+  is_kept = is_kept && T.csf_data != NULL;
+  T["ijk"] = 3.*T["ijk"];
+  T_d["ijk"] = 3.*T_d["ijk"];
+  is_kept = is_kept && T.csf_data == NULL;
+  MPI_Allreduce(MPI_IN_PLACE, &is_kept, 1, MPI_INT, MPI_MIN, dw.comm);
+  pass = pass && is_kept;
+  C["ikr"] += T["ijk"]*B["jr"];
+  C_d["ikr"] += T_d["ijk"]*B["jr"];
+  diff["ikr"] = C["ikr"] - C_d["ikr"];
+  pass = pass && diff.norm2() < 1.E-6;
+
+  //contraction over two modes with a user-specified mode order
+  int mo[] = {0, 2, 1};
+  T.set_csf(true, mo);
+  int lens_M[] = {n+1, n+2, r};
+  Tensor<> M(3, lens_M, dw);
+  M.fill_random(-1., 1.);
+  Matrix<> D(n, r, dw);
+  Matrix<> D_d(n, r, dw);
+  D["ir"] = T["ijk"]*M["jkr"];
+  D_d["ir"] = T_d["ijk"]*M["jkr"];
+  D_d["ir"] -= D["ir"];
+  pass = pass && D_d.norm2() < 1.E-6;
+
+  //bivar_function applied to a sparse tensor in CSF layout and a matrix
+  T.set_csf(true);
+  Function<> f([](double a, double b){ return a*b+a; });
+  C["ikr"] += f(T["ijk"],B["jr"]);
+  C_d["ikr"] += f(T_d["ijk"],B["jr"]);
+  diff["ikr"] = C["ikr"] - C_d["ikr"];
+  pass = pass && diff.norm2() < 1.E-6;
+
+  //order-four sparse tensor with an index shared by all operands
+  int lens_U[] = {n, n+1, 2, n};
+  Tensor<> U(4, true, lens_U, dw);
+  U.fill_sp_random(-1., 1., .1);
+  Tensor<> U_d(4, lens_U, dw);
+  U_d["ijkl"] = U["ijkl"];
+  U.set_csf(true);
+  Matrix<> E(n+1, n, dw);
+  E.fill_random(-1., 1.);
+  int lens_F[] = {n, 2, n};
+  Tensor<> F(3, lens_F, dw);
+  Tensor<> F_d(3, lens_F, dw);
+  F["ikl"] = U["ijkl"]*E["jl"];
+  F_d["ikl"] = U_d["ijkl"]*E["jl"];
+  F_d["ikl"] -= F["ikl"];
+  pass = pass && F_d.norm2() < 1.E-6;
+
+  if (pass){
+    if (rank == 0)
+      printf("{ C[\"ikr\"] = T[\"ijk\"]*B[\"jr\"] with T in CSF layout } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ C[\"ikr\"] = T[\"ijk\"]*B[\"jr\"] with T in CSF layout } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing sparse tensor contractions in CSF layout with n = %d:\n",n);
+    }
+    ctr_csf(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
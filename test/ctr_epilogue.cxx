@@ -0,0 +1,138 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup ctr_epilogue ctr_epilogue
+  * @{
+  * \brief Contractions with an elementwise epilogue against a contraction followed by a separate transform
+  */
+#include <ctf.hpp>
+
+using namespace CTF;
+
+int ctr_epilogue(int     n,
+                 World & dw){
+  int rank;
+  bool pass = true;
+  int m = n*n+3;
+  int k = 2*n+5;
+  int l = n+2;
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  Endomorphism<> relu([](double & a){ a = a > 0. ? a : 0.; });
+  Univar_Function<> leaky([](double a){ return a > 0. ? a : .1*a; });
+
+  Matrix<> A(m, k, dw);
+  Matrix<> B(k, l, dw);
+  Matrix<> C(m, l, dw);
+  A.fill_random(-1., 1.);
+  B.fill_random(-1., 1.);
+  C.fill_random(-1., 1.);
+
+  //dense matrix product with beta = 0 and beta != 0
+  Matrix<> C_f(C);
+  Matrix<> C_r(C);
+  Matrix<> diff(m, l, dw);
+  C_f.contract(1., A, "ik", B, "kj", 0., "ij", relu);
+  C_r["ij"] = A["ik"]*B["kj"];
+  relu(C_r["ij"]);
+  diff["ij"] = C_f["ij"] - C_r["ij"];
+  pass = pass && diff.norm2() < 1.E-6;
+
+  C_f.contract(2., A, "ik", B, "kj", .5, "ij", leaky);
+  C_r["ij"] = .5*C_r["ij"];
+  C_r["ij"] += 2.*A["ik"]*B["kj"];
+  C_r["ij"] = leaky(C_r["ij"]);
+  diff["ij"] = C_f["ij"] - C_r["ij"];
+  pass = pass && diff.norm2() < 1.E-6;
+
+  //order three output with an index shared by all operands
+  int lens_T[] = {m, l, k};
+  Tensor<> T(3, lens_T, dw);
+  Tensor<> T_f(3, lens_T, dw);
+  Tensor<> T_r(3, lens_T, dw);
+  T.fill_random(-1., 1.);
+  T_f.contract(1., T, "ijk", B, "kj", 0., "ijk", relu);
+  T_r["ijk"] = T["ijk"]*B["kj"];
+  relu(T_r["ijk"]);
+  T_r["ijk"] -= T_f["ijk"];
+  pass = pass && T_r.norm2() < 1.E-6;
+
+  //symmetric output
+  int lens_S[] = {m, m};
+  int sym_S[] = {SY, NS};
+  Tensor<> S_f(2, lens_S, sym_S, dw);
+  Tensor<> S_r(2, lens_S, sym_S, dw);
+  S_f.contract(1., A, "ik", A, "jk", 0., "ij", relu);
+  S_r["ij"] = A["ik"]*A["jk"];
+  relu(S_r["ij"]);
+  S_r["ij"] -= S_f["ij"];
+  pass = pass && S_r.norm2() < 1.E-6;
+
+  //sparse first operand
+  Matrix<> A_sp(m, k, SP, dw);
+  A_sp["ij"] = A["ij"];
+  A_sp.sparsify([](double a){ return a > .5; });
+  C_f["ij"] = C["ij"];
+  C_r["ij"] = C["ij"];
+  C_f.contract(1., A_sp, "ik", B, "kj", 1., "ij", relu);
+  C_r["ij"] += A_sp["ik"]*B["kj"];
+  relu(C_r["ij"]);
+  diff["ij"] = C_f["ij"] - C_r["ij"];
+  pass = pass && diff.norm2() < 1.E-6;
+
+  if (pass){
+    if (rank == 0)
+      printf("{ C[\"ij\"] = f(A[\"ik\"]*B[\"kj\"]) with fused epilogue } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ C[\"ij\"] = f(A[\"ik\"]*B[\"kj\"]) with fused epilogue } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing contractions with elementwise epilogue with n = %d:\n",n);
+    }
+    ctr_epilogue(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
@@ -0,0 +1,152 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup ctr_hypersparse ctr_hypersparse
+  * @{
+  * \brief Contractions of hypersparse matrices, which have far fewer nonzeros than rows, against dense contractions
+  */
+#include <ctf.hpp>
+
+using namespace CTF;
+
+/**
+ * \brief writes a few nonzeros to scattered rows of a sparse and a dense matrix
+ */
+void hypersparse_fill(Matrix<> & A, Matrix<> & A_d, int nnz, int seed){
+  int rank;
+  MPI_Comm_rank(A.wrld->comm, &rank);
+  std::vector<int64_t> inds;
+  std::vector<double> vals;
+  if (rank == 0){
+    for (int i=0; i<nnz; i++){
+      int64_t row = (((int64_t)i)*7919+seed*13)%A.nrow;
+      int64_t col = (((int64_t)i)*31+seed)%A.ncol;
+      inds.push_back(row+col*A.nrow);
+      vals.push_back(1.+(i%5)*.5);
+    }
+  }
+  A.write(inds.size(), inds.data(), vals.data());
+  A_d.write(inds.size(), inds.data(), vals.data());
+}
+
+int ctr_hypersparse(int     n,
+                    World & dw){
+  int rank;
+  bool pass = true;
+  int m = 64*n*n+3;
+  int k = n*n+1;
+  int l = n+2;
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  Matrix<> A(m, k, SP, dw);
+  Matrix<> A_d(m, k, dw);
+  hypersparse_fill(A, A_d, 2*n, 1);
+  Matrix<> B(k, l, SP, dw);
+  Matrix<> B_d(k, l, dw);
+  hypersparse_fill(B, B_d, k, 2);
+
+  //sparse times sparse into dense, with scaling of the output
+  Matrix<> C(m, l, dw);
+  Matrix<> C_d(m, l, dw);
+  C.fill_random(-1., 1.);
+  C_d["ij"] = C["ij"];
+  C["ij"] += 2.*A["ik"]*B["kj"];
+  C_d["ij"] += 2.*A_d["ik"]*B_d["kj"];
+  C_d["ij"] -= C["ij"];
+  pass = pass && C_d.norm2() < 1.E-6;
+
+  //sparse times sparse into sparse, accumulating into existing nonzeros
+  Matrix<> S(m, l, SP, dw);
+  S["ij"] = A["ik"]*B["kj"];
+  S["ij"] += A["ik"]*B["kj"];
+  C_d["ij"] = 2.*A_d["ik"]*B_d["kj"];
+  C["ij"] = S["ij"];
+  C_d["ij"] -= C["ij"];
+  pass = pass && C_d.norm2() < 1.E-6;
+
+  //sparse times sparse into sparse, with nonzeros of the output in other rows and scaling of the output
+  Matrix<> E(m, l, SP, dw);
+  Matrix<> E_d(m, l, dw);
+  hypersparse_fill(E, E_d, 3*n, 3);
+  E.contract(2., A, "ik", B, "kj", .5, "ij");
+  E_d.contract(2., A_d, "ik", B_d, "kj", .5, "ij");
+  E.contract(1., A, "ik", B, "kj", 1., "ij");
+  E_d.contract(1., A_d, "ik", B_d, "kj", 1., "ij");
+  C["ij"] = E["ij"];
+  E_d["ij"] -= C["ij"];
+  pass = pass && E_d.norm2() < 1.E-6;
+
+  //sparse times dense over a semiring without a coordinate-format kernel
+  Semiring<> mt(0., [](double a, double b){ return std::max(a,b); }, MPI_MAX,
+                1., [](double a, double b){ return a*b; });
+  Matrix<> A_mt(m, k, SP, dw, mt);
+  Matrix<> A_d_mt(m, k, dw, mt);
+  A_mt["ij"] = A["ij"];
+  A_d_mt["ij"] = A_d["ij"];
+  Matrix<> B_mt(k, l, dw, mt);
+  B_mt["ij"] = B_d["ij"];
+  Matrix<> C_mt(m, l, dw, mt);
+  Matrix<> C_d_mt(m, l, dw, mt);
+  C_mt["ij"] = A_mt["ik"]*B_mt["kj"];
+  C_d_mt["ij"] = A_d_mt["ik"]*B_mt["kj"];
+  C["ij"] = C_mt["ij"];
+  C_d["ij"] = C_d_mt["ij"];
+  C_d["ij"] -= C["ij"];
+  pass = pass && C_d.norm2() < 1.E-6;
+
+  if (pass){
+    if (rank == 0)
+      printf("{ C[\"ij\"] = A[\"ik\"]*B[\"kj\"] with hypersparse A } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ C[\"ij\"] = A[\"ik\"]*B[\"kj\"] with hypersparse A } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing contractions of hypersparse matrices with n = %d:\n",n);
+    }
+    ctr_hypersparse(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
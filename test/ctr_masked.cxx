@@ -0,0 +1,156 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup ctr_masked ctr_masked
+  * @{
+  * \brief Sparse contractions restricted to the pattern of a mask, against full products filtered by the mask
+  */
+#include <ctf.hpp>
+
+using namespace CTF;
+
+int ctr_masked(int     n,
+               World & dw){
+  int rank;
+  bool pass = true;
+  int m = 8*n;
+  int k = 4*n;
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  Matrix<> A(m, k, SP, dw);
+  A.fill_sp_random(1., 2., .2);
+  Matrix<> B(k, m, SP, dw);
+  B.fill_sp_random(1., 2., .2);
+  //structural mask and its pattern as ones
+  Matrix<> M(m, m, SP, dw);
+  M.fill_sp_random(1., 2., .1);
+  Matrix<> P_M(m, m, SP, dw);
+  P_M["ij"] = Function<>([](double a){ return 1.; })(M["ij"]);
+
+  //full product and mask pattern held densely, so that the references are dense Hadamard products
+  Matrix<> P(m, m, dw);
+  P["ij"] = A["ik"]*B["kj"];
+  Matrix<> P_d(m, m, dw);
+  P_d["ij"] = P_M["ij"];
+  Matrix<> R(m, m, dw);
+  Matrix<> C(m, m, dw);
+
+  //triangle-counting style: only the entries of the product in the mask
+  Matrix<> S(m, m, SP, dw);
+  S.contract(1., A, "ik", B, "kj", 0., "ij", M);
+  C["ij"] = S["ij"];
+  R["ij"] = P["ij"]*P_d["ij"];
+  R["ij"] -= C["ij"];
+  pass = pass && S.nnz_tot <= M.nnz_tot && R.norm2() < 1.E-6;
+
+  //complement mask: only the entries of the product outside the mask
+  Matrix<> S_c(m, m, SP, dw);
+  S_c.contract(1., A, "ik", B, "kj", 0., "ij", M, true);
+  C["ij"] = S_c["ij"];
+  R["ij"] = P["ij"];
+  R["ij"] -= P["ij"]*P_d["ij"];
+  R["ij"] -= C["ij"];
+  pass = pass && R.norm2() < 1.E-6;
+
+  //valued dense mask of zeros and ones, into a sparse output with existing nonzeros
+  Matrix<> V(m, m, dw);
+  V["ij"] = P_M["ij"];
+  Matrix<> S_v(m, m, SP, dw);
+  S_v["ij"] = A["ik"]*A["jk"];
+  Matrix<> R_v(m, m, dw);
+  R_v["ij"] = 2.*S_v["ij"];
+  S_v.contract(3., A, "ik", B, "kj", 2., "ij", V, false, true);
+  C["ij"] = S_v["ij"];
+  R_v["ij"] += 3.*P["ij"]*P_d["ij"];
+  R_v["ij"] -= C["ij"];
+  pass = pass && R_v.norm2() < 1.E-6;
+
+  //dense output, whose entries outside the mask are only scaled
+  Matrix<> D(m, m, dw);
+  D.fill_random(0., 1.);
+  R["ij"] = .5*D["ij"];
+  D.contract(1., A, "ik", B, "kj", .5, "ij", M);
+  R["ij"] += P["ij"]*P_d["ij"];
+  R["ij"] -= D["ij"];
+  pass = pass && R.norm2() < 1.E-6;
+
+  //output with few rows and columns and a long contracted index, which is reduced over processes, so that
+  //the mask is applied after the contraction rather than within the local kernels
+  int l = 64*n;
+  Matrix<> A_r(n, l, SP, dw);
+  A_r.fill_sp_random(1., 2., .3);
+  Matrix<> B_r(l, n, SP, dw);
+  B_r.fill_sp_random(1., 2., .3);
+  Matrix<> M_r(n, n, SP, dw);
+  M_r.fill_sp_random(1., 2., .3);
+  Matrix<> S_r(n, n, SP, dw);
+  S_r.fill_sp_random(1., 2., .5);
+  Matrix<> R_r(n, n, dw);
+  R_r["ij"] = .5*S_r["ij"];
+  Matrix<> P_r(n, n, dw);
+  P_r["ij"] = Function<>([](double a){ return 1.; })(M_r["ij"]);
+  Matrix<> F_r(n, n, dw);
+  F_r["ij"] = A_r["ik"]*B_r["kj"];
+  R_r["ij"] += P_r["ij"]*F_r["ij"];
+  S_r.contract(1., A_r, "ik", B_r, "kj", .5, "ij", M_r);
+  Matrix<> C_r(n, n, dw);
+  C_r["ij"] = S_r["ij"];
+  R_r["ij"] -= C_r["ij"];
+  pass = pass && R_r.norm2() < 1.E-6;
+
+  if (pass){
+    if (rank == 0)
+      printf("{ S[\"ij\"] = M[\"ij\"].*(A[\"ik\"]*B[\"kj\"]) with structural, complement, and valued masks } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ S[\"ij\"] = M[\"ij\"].*(A[\"ik\"]*B[\"kj\"]) with structural, complement, and valued masks } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing masked sparse contractions with n = %d:\n",n);
+    }
+    ctr_masked(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
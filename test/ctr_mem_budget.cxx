@@ -0,0 +1,107 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup ctr_mem_budget ctr_mem_budget
+  * @{
+  * \brief Contractions under per-contraction and per-World memory budgets
+  */
+#include <ctf.hpp>
+
+using namespace CTF;
+
+int ctr_mem_budget(int     n,
+                   World & dw){
+  int rank;
+  bool pass = true;
+  int m = n*n+3;
+  int k = 2*n*n+5;
+  int l = n*n+1;
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  Matrix<> A(m, k, dw);
+  Matrix<> B(k, l, dw);
+  Matrix<> C(m, l, dw);
+  Matrix<> C_r(m, l, dw);
+  A.fill_random(-1., 1.);
+  B.fill_random(-1., 1.);
+  C_r["ij"] = A["ik"]*B["kj"];
+
+  //predicted memory of the mapping chosen without a budget
+  int64_t mem_free, mem_bgt;
+  C.contract(1., A, "ik", B, "kj", 0., "ij", -1, &mem_free);
+  C["ij"] -= C_r["ij"];
+  pass = pass && mem_free >= 0 && C.norm2() < 1.E-6;
+
+  //a mapping within the budget is chosen
+  C.contract(1., A, "ik", B, "kj", 0., "ij", mem_free+1, &mem_bgt);
+  C["ij"] -= C_r["ij"];
+  pass = pass && mem_bgt <= mem_free && C.norm2() < 1.E-6;
+
+  //the budget of the World applies to expressions
+  dw.mem_budget = mem_free+1;
+  C["ij"] = A["ik"]*B["kj"];
+  {
+    //copies of the World keep its budget
+    World cw(dw);
+    pass = pass && cw.mem_budget == dw.mem_budget;
+  }
+  dw.mem_budget = -1;
+  C["ij"] -= C_r["ij"];
+  pass = pass && C.norm2() < 1.E-6;
+
+  if (pass){
+    if (rank == 0)
+      printf("{ C[\"ij\"] = A[\"ik\"]*B[\"kj\"] within memory budget } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ C[\"ij\"] = A[\"ik\"]*B[\"kj\"] within memory budget } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing contractions within memory budgets with n = %d:\n",n);
+    }
+    ctr_mem_budget(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
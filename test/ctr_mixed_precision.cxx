@@ -0,0 +1,156 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup ctr_mixed_precision ctr_mixed_precision
+  * @{
+  * \brief Contractions of float tensors accumulated into double tensors against double contractions,
+  *        and of int tensors into float tensors
+  */
+#include <ctf.hpp>
+
+using namespace CTF;
+
+/**
+ * \brief fills a float tensor with random values and writes the same values to a double tensor
+ */
+void mixed_fill(Tensor<float> & A, Tensor<double> & A_d){
+  int64_t npair;
+  int64_t * inds;
+  float * vals;
+  A.fill_random(-1.f, 1.f);
+  A.read_local(&npair, &inds, &vals);
+  double * vals_d = (double*)malloc(sizeof(double)*npair);
+  for (int64_t i=0; i<npair; i++){
+    vals_d[i] = (double)vals[i];
+  }
+  A_d.write(npair, inds, vals_d);
+  free(inds);
+  free(vals);
+  free(vals_d);
+}
+
+int ctr_mixed_precision(int     n,
+                        World & dw){
+  int rank;
+  bool pass = true;
+  int m = n*n+3;
+  int k = 2*n*n+5;
+  int l = n+2;
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  Matrix<float> A(m, k, dw);
+  Matrix<float> AT(k, m, dw);
+  Matrix<float> B(k, l, dw);
+  Matrix<double> A_d(m, k, dw);
+  Matrix<double> AT_d(k, m, dw);
+  Matrix<double> B_d(k, l, dw);
+  mixed_fill(A, A_d);
+  mixed_fill(AT, AT_d);
+  mixed_fill(B, B_d);
+
+  Matrix<double> C(m, l, dw);
+  Matrix<double> C_d(m, l, dw);
+  C.fill_random(-1., 1.);
+  C_d["ij"] = C["ij"];
+
+  //through the tensor interface, with differences far below those of accumulation in float
+  C.contract(2., A, "ik", B, "kj", .5, "ij");
+  C_d.contract(2., A_d, "ik", B_d, "kj", .5, "ij");
+  C_d["ij"] -= C["ij"];
+  pass = pass && C_d.norm2() < 1.E-9;
+
+  //through expressions, including a float scaling factor
+  C["ij"] = A["ik"]*B["kj"];
+  C["ij"] += .5*AT["ki"]*B["kj"];
+  C_d["ij"] = A_d["ik"]*B_d["kj"];
+  C_d["ij"] += .5*AT_d["ki"]*B_d["kj"];
+  C_d["ij"] -= C["ij"];
+  pass = pass && C_d.norm2() < 1.E-9;
+
+  //order three operands with an index shared by all operands
+  int lens_T[] = {m, k, l};
+  Tensor<float> T(3, lens_T, dw);
+  Tensor<double> T_d(3, lens_T, dw);
+  mixed_fill(T, T_d);
+  int lens_U[] = {m, l, l};
+  Tensor<double> U(3, lens_U, dw);
+  Tensor<double> U_d(3, lens_U, dw);
+  U["ijl"] = T["ikl"]*B["kj"];
+  U_d["ijl"] = T_d["ikl"]*B_d["kj"];
+  U_d["ijl"] -= U["ijl"];
+  pass = pass && U_d.norm2() < 1.E-9;
+
+  //int operands into a float output of the same size are converted, not copied
+  Matrix<int> I(m, k, dw);
+  Matrix<int> J(k, l, dw);
+  Matrix<float> I_f(m, k, dw);
+  Matrix<float> J_f(k, l, dw);
+  I_f.fill_random(-4.f, 4.f);
+  J_f.fill_random(-4.f, 4.f);
+  I["ik"] = Function<float,int>([](float a){ return (int)a; })(I_f["ik"]);
+  J["kj"] = Function<float,int>([](float a){ return (int)a; })(J_f["kj"]);
+  I_f["ik"] = Function<int,float>([](int a){ return (float)a; })(I["ik"]);
+  J_f["kj"] = Function<int,float>([](int a){ return (float)a; })(J["kj"]);
+  Matrix<float> F(m, l, dw);
+  Matrix<float> F_f(m, l, dw);
+  F["ij"] = I["ik"]*J["kj"];
+  F_f["ij"] = I_f["ik"]*J_f["kj"];
+  F["ij"] -= F_f["ij"];
+  pass = pass && F.norm2() == 0.f;
+
+  if (pass){
+    if (rank == 0)
+      printf("{ C<double>[\"ij\"] = A<float>[\"ik\"]*B<float>[\"kj\"] } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ C<double>[\"ij\"] = A<float>[\"ik\"]*B<float>[\"kj\"] } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing mixed-precision contractions with n = %d:\n",n);
+    }
+    ctr_mixed_precision(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
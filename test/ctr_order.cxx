@@ -0,0 +1,151 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup ctr_order ctr_order
+  * @{
+  * \brief Products of more than two tensors, contracted in a cost-based order
+  */
+#include <ctf.hpp>
+
+using namespace CTF;
+
+/**
+ * \brief returns whether contraction p of a chosen order is of operands a and b, in either order
+ */
+bool ctr_order_is_pair(std::pair<int,int> const & p, int a, int b){
+  return (p.first == a && p.second == b) || (p.first == b && p.second == a);
+}
+
+int ctr_order(int     n,
+              World & dw){
+  int rank, pass;
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  int m = 2;
+  Matrix<> A(n, m, NS, dw);
+  Matrix<> B(m, n, NS, dw);
+  Matrix<> C(n, n, NS, dw);
+  Matrix<> S(n, n, SP, dw);
+  Vector<> v(n, dw);
+  Matrix<> D(n, n, NS, dw);
+  Matrix<> D_ref(n, n, NS, dw);
+  Matrix<> T(n, n, NS, dw);
+  Matrix<> T2(n, n, NS, dw);
+
+  srand48(17*rank);
+  A.fill_random(-1.,1.);
+  B.fill_random(-1.,1.);
+  C.fill_random(-1.,1.);
+  v.fill_random(-1.,1.);
+  S.fill_sp_random(-1.,1.,.2);
+
+  // best order contracts A with B last, rather than forming C*S*B first
+  D["ij"] = 2.0*C["ia"]*S["ab"]*A["bk"]*B["kj"];
+
+  T["bj"] = A["bk"]*B["kj"];
+  T2["aj"] = S["ab"]*T["bj"];
+  D_ref["ij"] = 2.0*C["ia"]*T2["aj"];
+
+  D_ref["ij"] -= D["ij"];
+  pass = D_ref.norm2() <= 1.E-10*n*n;
+
+  // the order itself: S*A first, then C with the intermediate, and B last
+  {
+    Idx_Tensor iC(&C, "ia");
+    Idx_Tensor iS(&S, "ab");
+    Idx_Tensor iA(&A, "bk");
+    Idx_Tensor iB(&B, "kj");
+    std::vector<Idx_Tensor*> ops;
+    ops.push_back(&iC);
+    ops.push_back(&iS);
+    ops.push_back(&iA);
+    ops.push_back(&iB);
+    std::vector< std::pair<int,int> > seq;
+    CTF_int::get_ctr_order(ops, 2, "ij", seq);
+    if (seq.size() != 3 ||
+        !ctr_order_is_pair(seq[0], 1, 2) ||
+        !ctr_order_is_pair(seq[1], 0, 4) ||
+        !ctr_order_is_pair(seq[2], 5, 3)) pass = 0;
+  }
+
+  // a product that is part of a sum is formed as an intermediate in the same order
+  D["ij"] = C["ia"]*S["ab"]*A["bk"]*B["kj"] + C["ij"];
+  D_ref["ij"] = C["ia"]*T2["aj"];
+  D_ref["ij"] += C["ij"];
+  D_ref["ij"] -= D["ij"];
+  if (D_ref.norm2() > 1.E-10*n*n) pass = 0;
+
+  // index i shared by three operands and kept through intermediates
+  Vector<> w(n, dw);
+  Vector<> w_ref(n, dw);
+  w["i"] = v["i"]*C["ij"]*v["j"]*A["ik"]*B["kl"]*v["l"];
+
+  Vector<> x(n, dw);
+  Vector<> y(m, dw);
+  Vector<> z(n, dw);
+  Vector<> z2(n, dw);
+  y["k"] = B["kl"]*v["l"];
+  x["i"] = C["ij"]*v["j"];
+  z["i"] = A["ik"]*y["k"];
+  z2["i"] = z["i"]*x["i"];
+  w_ref["i"] = z2["i"]*v["i"];
+
+  w_ref["i"] -= w["i"];
+  if (w_ref.norm2() > 1.E-10*n) pass = 0;
+
+  if (pass){
+    if (rank == 0)
+      printf("{ D[\"ij\"] = C[\"ia\"]*S[\"ab\"]*A[\"bk\"]*B[\"kj\"] } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ D[\"ij\"] = C[\"ia\"]*S[\"ab\"]*A[\"bk\"]*B[\"kj\"] } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing multi-operand contraction ordering with n = %d:\n",n);
+    }
+    ctr_order(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
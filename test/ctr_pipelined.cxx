@@ -0,0 +1,200 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup ctr_pipelined ctr_pipelined
+  * @{
+  * \brief 2D contraction steps with panel broadcasts overlapped with the local contractions,
+  *        run on panels of A and B distributed over all processes
+  */
+#include <ctf.hpp>
+#include "../src/contraction/ctr_2d_general.h"
+
+using namespace CTF;
+
+/**
+ * \brief local kernel of the test, C = beta*C + A*B with A m-by-k, B k-by-n, C m-by-n, all column-major
+ */
+class ctr_pipelined_gemm : public CTF_int::ctr {
+  public:
+    int m, n, k;
+
+    void run(char * A, char * B, char * C){
+      double b = ((double const*)this->beta)[0];
+      double * a_ = (double*)A;
+      double * b_ = (double*)B;
+      double * c_ = (double*)C;
+      for (int j=0; j<n; j++){
+        for (int i=0; i<m; i++){
+          double c = b*c_[i+j*m];
+          for (int l=0; l<k; l++){
+            c += a_[i+l*m]*b_[l+j*k];
+          }
+          c_[i+j*m] = c;
+        }
+      }
+    }
+
+    ctr_pipelined_gemm(CTF_int::contraction const * c, int m_, int n_, int k_) : CTF_int::ctr(c) {
+      m = m_;
+      n = n_;
+      k = k_;
+    }
+};
+
+/** \brief value of A(i,l), B(l,j), or C, selected by s, used by the test */
+double ctr_pipelined_val(int i, int j, int s){
+  return sin(.37*i+.11*j+s);
+}
+
+/**
+ * \brief contracts panels of nb columns of A and nb rows of B, where panel ib is owned by process
+ *        ib%np, through a ctr_2d_general step that broadcasts both and checks C on every process,
+ *        with the panel broadcasts double-buffered if pipeline
+ */
+bool ctr_pipelined_step(int m, int n, int nb, int npanel, bool pipeline, World & dw){
+  int np = dw.np;
+  int rank = dw.rank;
+  int k = nb*npanel*np;
+
+  //only the scalars and algebraic structures of the contraction are used by the tree
+  Matrix<> dA(1, 1, dw);
+  Matrix<> dB(1, 1, dw);
+  Matrix<> dC(1, 1, dw);
+  double alpha = 1.;
+  double beta = .5;
+  CTF_int::contraction c(&dA, "ik", &dB, "kj", (char const*)&alpha, &dC, "ij", (char const*)&beta);
+
+  CTF_int::ctr_2d_general * g = new CTF_int::ctr_2d_general(&c);
+  g->edge_len      = npanel*np;
+  g->move_A        = 1;
+  g->cdt_A         = &dw.cdt;
+  g->ctr_lda_A     = 1;
+  g->ctr_sub_lda_A = ((int64_t)m)*nb;
+  g->move_B        = 1;
+  g->cdt_B         = &dw.cdt;
+  g->ctr_lda_B     = 1;
+  g->ctr_sub_lda_B = ((int64_t)nb)*n;
+  g->move_C        = 0;
+  g->cdt_C         = NULL;
+  g->ctr_lda_C     = 0;
+  g->ctr_sub_lda_C = 0;
+#ifdef OFFLOAD
+  g->alloc_host_buf = false;
+#endif
+  g->rec_ctr = new ctr_pipelined_gemm(&c, m, n, nb);
+  //the second panel buffers are counted only if the broadcasts are double-buffered
+  g->pipeline = true;
+  int64_t mem_db = g->mem_fp();
+  g->pipeline = false;
+  int64_t mem_sb = g->mem_fp();
+  bool pass = g->edge_len == 1 || mem_db-mem_sb == (int64_t)sizeof(double)*(m*nb+nb*n);
+  g->pipeline = pipeline;
+  //a single step (on one process) is run without pipelining
+  pass = pass && (g->edge_len == 1 || g->is_pipelined() == pipeline);
+
+  //local panels ib = rank, rank+np, ..., each stored contiguously
+  double * A = (double*)malloc(sizeof(double)*m*nb*npanel);
+  double * B = (double*)malloc(sizeof(double)*nb*n*npanel);
+  double * C = (double*)malloc(sizeof(double)*m*n);
+  for (int p=0; p<npanel; p++){
+    int ib = p*np+rank;
+    for (int l=0; l<nb; l++){
+      for (int i=0; i<m; i++){
+        A[p*m*nb+i+l*m] = ctr_pipelined_val(i, ib*nb+l, 0);
+      }
+      for (int j=0; j<n; j++){
+        B[p*nb*n+l+j*nb] = ctr_pipelined_val(ib*nb+l, j, 1);
+      }
+    }
+  }
+  for (int i=0; i<m*n; i++){
+    C[i] = ctr_pipelined_val(i, 0, 2);
+  }
+
+  g->run((char*)A, (char*)B, (char*)C);
+
+  for (int j=0; j<n; j++){
+    for (int i=0; i<m; i++){
+      double c_ref = beta*ctr_pipelined_val(i+j*m, 0, 2);
+      for (int l=0; l<k; l++){
+        c_ref += ctr_pipelined_val(i, l, 0)*ctr_pipelined_val(l, j, 1);
+      }
+      if (fabs(C[i+j*m]-c_ref) > 1.E-10*(1.+fabs(c_ref))) pass = false;
+    }
+  }
+  free(A);
+  free(B);
+  free(C);
+  delete g;
+  return pass;
+}
+
+int ctr_pipelined(int     n,
+                  World & dw){
+  int rank, pass;
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  //one panel per process, broadcast directly from the operands
+  pass = ctr_pipelined_step(n, n+1, 2, 1, true, dw);
+  //several panels per process, copied into the double buffers before being broadcast
+  pass = pass && ctr_pipelined_step(n+2, n, 3, 3, true, dw);
+  //the same steps with single buffers, as when the second buffers do not fit in memory
+  pass = pass && ctr_pipelined_step(n+2, n, 3, 3, false, dw);
+
+  MPI_Allreduce(MPI_IN_PLACE, &pass, 1, MPI_INT, MPI_MIN, dw.comm);
+  if (pass){
+    if (rank == 0)
+      printf("{ C[\"ij\"] = .5*C[\"ij\"] + A[\"ik\"]*B[\"kj\"] with pipelined panel broadcasts } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ C[\"ij\"] = .5*C[\"ij\"] + A[\"ik\"]*B[\"kj\"] with pipelined panel broadcasts } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing pipelined 2D contraction with n = %d:\n",n);
+    }
+    ctr_pipelined(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
@@ -0,0 +1,122 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup ctr_plan_cache ctr_plan_cache
+  * @{
+  * \brief Reuse of contraction mappings across repeated contractions
+  */
+#include <ctf.hpp>
+
+using namespace CTF;
+
+int ctr_plan_cache(int     n,
+                   World & dw){
+  int rank, pass;
+  int64_t hits_0, misses_0, hits_1, misses_1, hits_2, misses_2;
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  int shapeN4[] = {NS,NS,NS,NS};
+  int sizeN4[] = {n,n,n,n};
+
+  Tensor<> A(4, sizeN4, shapeN4, dw);
+  Tensor<> B(4, sizeN4, shapeN4, dw);
+  Tensor<> C(4, sizeN4, shapeN4, dw);
+  Tensor<> C_ref(4, sizeN4, shapeN4, dw);
+
+  srand48(13*rank);
+  A.fill_random(-1.,1.);
+  B.fill_random(-1.,1.);
+
+  C["ijkl"] = A["ijmn"]*B["mnkl"];
+  get_ctr_plan_cache_stats(hits_0, misses_0);
+  for (int it=0; it<3; it++){
+    C["ijkl"] = A["ijmn"]*B["mnkl"];
+  }
+  get_ctr_plan_cache_stats(hits_1, misses_1);
+  pass = (hits_1 - hits_0 >= 3);
+
+  invalidate_ctr_plan_cache(&dw);
+  C_ref["ijkl"] = A["ijmn"]*B["mnkl"];
+  get_ctr_plan_cache_stats(hits_2, misses_2);
+  pass = pass && (misses_2 > misses_1);
+
+  //a hit with other scalars reuses the cached contraction tree, rebound to the new scalars
+  Tensor<> C2(4, sizeN4, shapeN4, dw);
+  C2.fill_random(-1.,1.);
+  Tensor<> C2_ref(C2);
+  C2["ijkl"] += 2.*A["ijmn"]*B["mnkl"];
+  C2_ref["ijkl"] += 2.*C_ref["ijkl"];
+  C2_ref["ijkl"] -= C2["ijkl"];
+  if (C2_ref.norm2() > 1.E-10*n*n) pass = 0;
+
+  C_ref["ijkl"] -= C["ijkl"];
+  if (C_ref.norm2() > 1.E-10*n*n) pass = 0;
+
+  //a contraction of the same shape over another type of the same size does not reuse the plan
+  int64_t hits_3, misses_3, hits_4, misses_4;
+  Tensor<float> Af(4, sizeN4, shapeN4, dw);
+  Tensor<float> Cf(4, sizeN4, shapeN4, dw);
+  Tensor<int> Ai(4, sizeN4, shapeN4, dw);
+  Tensor<int> Ci(4, sizeN4, shapeN4, dw);
+  Cf["ijkl"] = Af["ijmn"]*Af["mnkl"];
+  get_ctr_plan_cache_stats(hits_3, misses_3);
+  Ci["ijkl"] = Ai["ijmn"]*Ai["mnkl"];
+  get_ctr_plan_cache_stats(hits_4, misses_4);
+  pass = pass && (misses_4 > misses_3) && (hits_4 == hits_3);
+
+  if (pass){
+    if (rank == 0)
+      printf("{ C[\"ijkl\"] = A[\"ijmn\"]*B[\"mnkl\"] reuses cached mapping } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ C[\"ijkl\"] = A[\"ijmn\"]*B[\"mnkl\"] reuses cached mapping } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing contraction plan cache with n = %d:\n",n);
+    }
+    ctr_plan_cache(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
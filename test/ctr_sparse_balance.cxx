@@ -0,0 +1,119 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup ctr_sparse_balance ctr_sparse_balance
+  * @{
+  * \brief Contractions of sparse matrices with skewed nonzero distributions against dense contractions
+  */
+#include <ctf.hpp>
+
+using namespace CTF;
+
+int ctr_sparse_balance(int     n,
+                       World & dw){
+  int rank, np;
+  bool pass = true;
+  int m = n*n+3;
+  int k = 2*n*n+5;
+  int l = n+2;
+
+  MPI_Comm_rank(dw.comm, &rank);
+  MPI_Comm_size(dw.comm, &np);
+
+  //row i of A has about k/(i+1) nonzeros, all in the rows of every fourth index
+  Matrix<> A(m, k, SP, dw);
+  Matrix<> A_d(m, k, dw);
+  std::vector<int64_t> inds;
+  std::vector<double> vals;
+  if (rank == 0){
+    for (int i=0; i<m; i+=4){
+      for (int j=0; j<std::max(1,k/(i+1)); j++){
+        inds.push_back(i+((int64_t)j)*m);
+        vals.push_back(1./(i+j+1));
+      }
+    }
+  }
+  A.write(inds.size(), inds.data(), vals.data());
+  A_d.write(inds.size(), inds.data(), vals.data());
+
+  Matrix<> B(k, l, dw);
+  B.fill_random(-1.,1.);
+
+  Matrix<> C(m, l, dw);
+  Matrix<> C_d(m, l, dw);
+  C["ij"] = A["ik"]*B["kj"];
+  double imb_A, imb_B;
+  get_sparse_ctr_imbalance(imb_A, imb_B);
+  pass = pass && imb_A >= 1.-1.E-10 && imb_A <= np+1.E-10 && imb_B == 1.;
+  if (np == 1) pass = pass && imb_A <= 1.+1.E-10;
+  C_d["ij"] = A_d["ik"]*B["kj"];
+  C_d["ij"] -= C["ij"];
+  pass = pass && C_d.norm2() <= 1.E-10*C.norm2();
+
+  //both operands sparse and skewed in the contracted index
+  Matrix<> AT(k, m, SP, dw);
+  AT["ji"] = A["ij"];
+  Matrix<> D(m, m, dw);
+  Matrix<> D_d(m, m, dw);
+  D["ij"] = A["ik"]*AT["kj"];
+  get_sparse_ctr_imbalance(imb_A, imb_B);
+  pass = pass && imb_A >= 1.-1.E-10 && imb_B >= 1.-1.E-10 && imb_B <= np+1.E-10;
+  D_d["ij"] = A_d["ik"]*A_d["jk"];
+  D_d["ij"] -= D["ij"];
+  pass = pass && D_d.norm2() <= 1.E-10*D.norm2();
+
+  if (pass){
+    if (rank == 0)
+      printf("{ C[\"ij\"] = A[\"ik\"]*B[\"kj\"] with skewed sparse A } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ C[\"ij\"] = A[\"ik\"]*B[\"kj\"] with skewed sparse A } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing load-balanced sparse contractions with n = %d:\n",n);
+    }
+    ctr_sparse_balance(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
@@ -0,0 +1,105 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup ctr_sym_packed ctr_sym_packed
+  * @{
+  * \brief Contractions into packed symmetric tensors against nonsymmetric contractions
+  */
+#include <ctf.hpp>
+
+using namespace CTF;
+
+int ctr_sym_packed(int     n,
+                   World & dw){
+  int rank;
+  bool pass = true;
+  int m = 4*n*n+1;
+  int k = n+1;
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  Matrix<> A(m, k, dw);
+  Matrix<> AT(k, m, dw);
+  A.fill_random(-1., 1.);
+  AT["ki"] = A["ik"];
+
+  Matrix<> C(m, m, SY, dw);
+  Matrix<> T(m, m, dw);
+  Matrix<> diff(m, m, dw);
+  C["ij"] = A["ik"]*A["jk"];
+  T["ij"] = A["ik"]*A["jk"];
+  diff["ij"] = C["ij"] - T["ij"];
+  pass = pass && diff.norm2() < 1.E-6;
+
+  //transposed operands and scaling factors
+  C.contract(2., AT, "ki", AT, "kj", .5, "ij");
+  T["ij"] = .5*T["ij"];
+  T["ij"] += 2.*A["ik"]*A["jk"];
+  diff["ij"] = C["ij"] - T["ij"];
+  pass = pass && diff.norm2() < 1.E-6;
+
+  //symmetric pair with a lesser edge length than a tile
+  Matrix<> S(n+1, k, dw);
+  S.fill_random(-1., 1.);
+  Matrix<> CS(n+1, n+1, SY, dw);
+  Matrix<> TS(n+1, n+1, dw);
+  CS["ij"] = S["ik"]*S["jk"];
+  TS["ij"] = S["ik"]*S["jk"];
+  TS["ij"] -= CS["ij"];
+  pass = pass && TS.norm2() < 1.E-6;
+
+  if (pass){
+    if (rank == 0)
+      printf("{ C[\"(ij)\"] = A[\"ik\"]*A[\"jk\"] with packed symmetric C } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ C[\"(ij)\"] = A[\"ik\"]*A[\"jk\"] with packed symmetric C } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing contractions into packed symmetric tensors with n = %d:\n",n);
+    }
+    ctr_sym_packed(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
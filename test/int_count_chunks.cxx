@@ -0,0 +1,277 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup int_count_chunks int_count_chunks
+  * @{
+  * \brief Paths taken when element counts do not fit in an int (chunked coomm kernel calls and broadcasts,
+  *        the 64-bit COO-to-CSR sort, CSR blocks with 64-bit row pointers, CSR messages counted in
+  *        CSR_ALIGN-byte units), exercised by passing a small limit in place of CTF_int::max_int_count
+  */
+#include <ctf.hpp>
+#include "../src/sparse_formats/csr.h"
+
+using namespace CTF;
+
+/** \brief number of calls to int_count_chunks_coomm and largest number of nonzeros passed to it */
+int64_t int_count_chunks_ncall = 0;
+int64_t int_count_chunks_max_nnz = 0;
+
+/**
+ * \brief checks that two CSR blocks hold the same matrix, whatever the width of their row pointers
+ */
+bool int_count_chunks_csr_eq(CTF_int::CSR_Matrix const & A, CTF_int::CSR_Matrix const & B){
+  if (A.nnz() != B.nnz() || A.nrow() != B.nrow() || A.ncol() != B.ncol()) return false;
+  CTF_int::CSR_IA64 iA(A);
+  CTF_int::CSR_IA64 iB(B);
+  return memcmp(iA.ptr, iB.ptr, sizeof(int64_t)*(A.nrow()+1)) == 0 &&
+         memcmp(A.JA(), B.JA(), sizeof(int)*A.nnz()) == 0 &&
+         memcmp(A.vals(), B.vals(), sizeof(double)*A.nnz()) == 0;
+}
+
+double int_count_chunks_add(double a, double b){
+  return a+b;
+}
+
+double int_count_chunks_mul(double a, double b){
+  return a*b;
+}
+
+/**
+ * \brief coordinate-format kernel of the test, C = beta*C + alpha*A*B, which records the chunks it is given
+ */
+void int_count_chunks_coomm(int m, int n, int k, double alpha, double const * A, int const * rows_A, int const * cols_A,
+                            int nnz_A, double const * B, double beta, double * C){
+  int_count_chunks_ncall++;
+  int_count_chunks_max_nnz = std::max(int_count_chunks_max_nnz, (int64_t)nnz_A);
+  CTF_int::default_coomm<double>(m, n, k, alpha, A, rows_A, cols_A, nnz_A, B, beta, C);
+}
+
+int int_count_chunks(int     n,
+                     World & dw){
+  int rank, pass;
+  int64_t lim = 7;
+
+  MPI_Comm_rank(dw.comm, &rank);
+  pass = 1;
+
+  //coomm kernel calls on more than lim nonzeros get chunks of at most lim nonzeros and match a single call
+  int m = 2*n+1;
+  int k = 3*n+2;
+  int64_t nnz_A = 4*lim+2;
+  double * vA = (double*)malloc(sizeof(double)*nnz_A);
+  int * rA = (int*)malloc(sizeof(int)*nnz_A);
+  int * cA = (int*)malloc(sizeof(int)*nnz_A);
+  double * B = (double*)malloc(sizeof(double)*k*n);
+  double * C[2];
+  srand48(dw.rank+3);
+  for (int64_t i=0; i<nnz_A; i++){
+    vA[i] = drand48();
+    rA[i] = (int)(i*7 % m) + 1;
+    cA[i] = (int)(i*5 % k) + 1;
+  }
+  for (int i=0; i<k*n; i++){
+    B[i] = drand48();
+  }
+  for (int t=0; t<2; t++){
+    C[t] = (double*)malloc(sizeof(double)*m*n);
+    for (int i=0; i<m*n; i++){
+      C[t][i] = (double)i;
+    }
+    int_count_chunks_ncall = 0;
+    int_count_chunks_max_nnz = 0;
+    CTF_int::coomm_chunks<double>(&int_count_chunks_coomm, m, n, k, 1.5, vA, rA, cA, nnz_A, B, .5, 1., C[t],
+                                  t == 0 ? lim : CTF_int::max_int_count);
+    if (int_count_chunks_ncall != (t == 0 ? 5 : 1) ||
+        int_count_chunks_max_nnz != (t == 0 ? lim : nnz_A)) pass = 0;
+  }
+  for (int i=0; i<m*n; i++){
+    if (std::abs(C[0][i]-C[1][i]) > 1.E-10*(std::abs(C[1][i])+1.)) pass = 0;
+  }
+  free(vA);
+  free(rA);
+  free(cA);
+  free(B);
+  free(C[0]);
+  free(C[1]);
+
+  //sparse-times-dense contraction with a user coomm kernel goes through the same chunked calls
+  Semiring<double> s(0., &int_count_chunks_add, MPI_SUM, 1., &int_count_chunks_mul,
+                     NULL, NULL, NULL, &int_count_chunks_coomm);
+  Matrix<double> sA(4*n, 4*n, SP, dw, s);
+  Matrix<double> sB(4*n, n, dw, s);
+  Matrix<double> sC(4*n, n, dw, s);
+  sA.fill_sp_random(0., 1., .3);
+  sB.fill_random(0., 1.);
+  sC.fill_random(0., 1.);
+  Matrix<> dA(4*n, 4*n, dw);
+  Matrix<> dC(4*n, n, dw);
+  dA["ij"] = sA["ij"];
+  dC["ij"] = sC["ij"];
+  int_count_chunks_ncall = 0;
+  sC["ij"] += sA["ik"]*sB["kj"];
+  dC["ij"] += dA["ik"]*sB["kj"];
+  Matrix<> rC(4*n, n, dw);
+  rC["ij"] = sC["ij"];
+  dC["ij"] -= rC["ij"];
+  if (dC.norm2() > 1.E-10*(rC.norm2()+1.)) pass = 0;
+  int64_t ncall = int_count_chunks_ncall;
+  MPI_Allreduce(MPI_IN_PLACE, &ncall, 1, MPI_INT64_T, MPI_SUM, dw.comm);
+  if (ncall < 1) pass = 0;
+
+  //COO to CSR conversion of more than lim nonzeros, sorted through 64-bit permutations
+  int nrow = 2*n+1;
+  int64_t nz = 5*lim+3;
+  double * coo_vs = (double*)malloc(sizeof(double)*nz);
+  int * coo_rs = (int*)malloc(sizeof(int)*nz);
+  int * coo_cs = (int*)malloc(sizeof(int)*nz);
+  for (int64_t i=0; i<nz; i++){
+    coo_vs[i] = (double)i;
+    coo_rs[i] = (int)((nz-i)*5 % nrow) + 1;
+    coo_cs[i] = (int)((i*3) % 11) + 1;
+  }
+  double * csr_vs[2];
+  int * csr_ja[2];
+  int64_t * csr_ia[2];
+  for (int t=0; t<2; t++){
+    csr_vs[t] = (double*)malloc(sizeof(double)*nz);
+    csr_ja[t] = (int*)malloc(sizeof(int)*nz);
+    csr_ia[t] = (int64_t*)malloc(sizeof(int64_t)*(nrow+1));
+    CTF_int::seq_coo_to_csr<double>(nz, nrow, csr_vs[t], csr_ja[t], csr_ia[t], coo_vs, coo_rs, coo_cs,
+                                    t == 0 ? lim : CTF_int::max_int_count);
+  }
+  if (memcmp(csr_vs[0], csr_vs[1], sizeof(double)*nz) != 0 ||
+      memcmp(csr_ja[0], csr_ja[1], sizeof(int)*nz) != 0 ||
+      memcmp(csr_ia[0], csr_ia[1], sizeof(int64_t)*(nrow+1)) != 0) pass = 0;
+  for (int r=0; r<nrow; r++){
+    for (int64_t i=csr_ia[0][r]; i<csr_ia[0][r+1]-1; i++){
+      if (csr_ja[0][i-1] > csr_ja[0][i]) pass = 0;
+    }
+  }
+
+  //CSR blocks with 32-bit (as chosen for blocks of fewer than INT_MAX nonzeros) and 64-bit row pointers,
+  //the latter used for larger blocks, give the same results when added, partitioned, and merged
+  {
+    CTF_int::CSR_Matrix csr[2];
+    for (int t=0; t<2; t++){
+      csr[t] = CTF_int::CSR_Matrix(nz, nrow, 11, sizeof(double), t == 0 ? sizeof(int) : sizeof(int64_t));
+      if (csr[t].ia_size() != (t == 0 ? (int)sizeof(int) : (int)sizeof(int64_t))) pass = 0;
+      csr[t].set_IA(csr_ia[0]);
+      memcpy(csr[t].JA(), csr_ja[0], sizeof(int)*nz);
+      memcpy(csr[t].vals(), csr_vs[0], sizeof(double)*nz);
+    }
+    if (!int_count_chunks_csr_eq(csr[0], csr[1])) pass = 0;
+    Semiring<double> sd;
+    char * sums[3];
+    sums[0] = sd.csr_add(csr[0].all_data, csr[0].all_data);
+    sums[1] = sd.csr_add(csr[1].all_data, csr[1].all_data);
+    sums[2] = sd.csr_add(csr[0].all_data, csr[1].all_data);
+    for (int t=1; t<3; t++){
+      if (!int_count_chunks_csr_eq(CTF_int::CSR_Matrix(sums[0]), CTF_int::CSR_Matrix(sums[t]))) pass = 0;
+    }
+    for (int t=0; t<3; t++){
+      CTF_int::cdealloc(sums[t]);
+    }
+    for (int t=0; t<2; t++){
+      char * parts_buffer;
+      CTF_int::CSR_Matrix * parts[3];
+      csr[t].partition(3, &parts_buffer, parts);
+      char * part_data[3];
+      for (int p=0; p<3; p++){
+        part_data[p] = parts[p]->all_data;
+      }
+      CTF_int::CSR_Matrix merged(part_data, 3);
+      if (!int_count_chunks_csr_eq(csr[t], merged)) pass = 0;
+      for (int p=0; p<3; p++){
+        delete parts[p];
+      }
+      CTF_int::cdealloc(parts_buffer);
+      CTF_int::cdealloc(merged.all_data);
+      CTF_int::cdealloc(csr[t].all_data);
+    }
+  }
+  for (int t=0; t<2; t++){
+    free(csr_vs[t]);
+    free(csr_ja[t]);
+    free(csr_ia[t]);
+  }
+  free(coo_vs);
+  free(coo_rs);
+  free(coo_cs);
+
+  //broadcast of more than lim elements, sent in pieces
+  int64_t nb = 6*lim+1;
+  int64_t * buf = (int64_t*)malloc(sizeof(int64_t)*nb);
+  for (int64_t i=0; i<nb; i++){
+    buf[i] = dw.rank == 0 ? i*i : -1;
+  }
+  dw.cdt.bcast(buf, nb, MPI_INT64_T, 0, lim);
+  for (int64_t i=0; i<nb; i++){
+    if (buf[i] != i*i) pass = 0;
+  }
+  free(buf);
+
+  //CSR messages of more than INT_MAX bytes are counted in CSR_ALIGN-byte units
+  int64_t szs[] = {((int64_t)5)<<30, CSR_ALIGN, ((int64_t)3)<<31};
+  int64_t displs[] = {0, ((int64_t)5)<<30, (((int64_t)5)<<30) + CSR_ALIGN};
+  int cnts[3], offs[3];
+  CTF_int::get_csr_unit_counts(3, szs, displs, cnts, offs);
+  for (int i=0; i<3; i++){
+    if ((int64_t)cnts[i]*CSR_ALIGN != szs[i] || (int64_t)offs[i]*CSR_ALIGN != displs[i]) pass = 0;
+  }
+
+  MPI_Allreduce(MPI_IN_PLACE, &pass, 1, MPI_INT, MPI_MIN, dw.comm);
+  if (pass){
+    if (rank == 0)
+      printf("{ coomm, COO-to-CSR, CSR row pointers, and broadcasts with counts above the int limit } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ coomm, COO-to-CSR, CSR row pointers, and broadcasts with counts above the int limit } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing element counts above the int limit with n = %d:\n",n);
+    }
+    int_count_chunks(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
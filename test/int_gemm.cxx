@@ -0,0 +1,135 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup int_gemm int_gemm
+  * @{
+  * \brief Matrix multiplication over integers, which uses the generic (non-BLAS) gemm
+  */
+#include <ctf.hpp>
+
+using namespace CTF;
+
+/**
+ * \brief sets each element of a matrix to a small integer determined by its global index
+ */
+template <typename dtype>
+void int_gemm_fill(Matrix<dtype> & M, int seed){
+  int64_t npair;
+  int64_t * inds;
+  dtype * vals;
+  M.read_local(&npair, &inds, &vals);
+  for (int64_t i=0; i<npair; i++){
+    vals[i] = (dtype)(((inds[i]+seed)*7919)%11 - 5);
+  }
+  M.write(npair, inds, vals);
+  free(inds);
+  free(vals);
+}
+
+int int_gemm(int     n,
+             World & dw){
+  int rank, pass;
+  int m = n*n+3;
+  int k = 2*n*n+5;
+  int l = n*n+1;
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  Matrix<int64_t> A(m, k, dw);
+  Matrix<int64_t> AT(k, m, dw);
+  Matrix<int64_t> B(k, l, dw);
+  Matrix<int64_t> BT(l, k, dw);
+  Matrix<int64_t> C(m, l, dw);
+  Matrix<int64_t> CT(m, l, dw);
+  Matrix<> A_d(m, k, dw);
+  Matrix<> B_d(k, l, dw);
+  Matrix<> C_d(m, l, dw);
+
+  int_gemm_fill(A, 1);
+  int_gemm_fill(B, 2);
+  int_gemm_fill(C, 3);
+  int_gemm_fill(A_d, 1);
+  int_gemm_fill(B_d, 2);
+  int_gemm_fill(C_d, 3);
+  AT["ki"] = A["ik"];
+  BT["jk"] = B["kj"];
+
+  C["ij"] += ((int64_t)3)*A["ik"]*B["kj"];
+  CT["ij"] = AT["ki"]*BT["jk"];
+  CT["ij"] += ((int64_t)2)*AT["ki"]*BT["jk"];
+  C_d["ij"] += 3.*A_d["ik"]*B_d["kj"];
+
+  int64_t npair;
+  int64_t * vals_C;
+  int64_t * vals_CT;
+  double * vals_C_d;
+  C.read_all(&npair, &vals_C);
+  CT.read_all(&npair, &vals_CT);
+  C_d.read_all(&npair, &vals_C_d);
+
+  //contraction of int64_t tensors must produce exactly the integer results computed in double
+  pass = 1;
+  for (int64_t i=0; i<((int64_t)m)*l; i++){
+    int64_t c_ij = vals_C[i];
+    int64_t c_d_ij = (int64_t)vals_C_d[i];
+    if (c_ij != c_d_ij || vals_CT[i] != c_ij - (int64_t)(((i+3)*7919)%11 - 5)) pass = 0;
+  }
+  free(vals_C);
+  free(vals_CT);
+  free(vals_C_d);
+
+  if (pass){
+    if (rank == 0)
+      printf("{ C[\"ij\"] += 3*A[\"ik\"]*B[\"kj\"] over int64_t } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ C[\"ij\"] += 3*A[\"ik\"]*B[\"kj\"] over int64_t } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing integer matrix multiplication with n = %d:\n",n);
+    }
+    int_gemm(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
@@ -0,0 +1,171 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup mttkrp mttkrp
+  * @{
+  * \brief Fused MTTKRP of dense and sparse tensors against contraction expressions
+  */
+#include <ctf.hpp>
+
+using namespace CTF;
+
+/**
+ * \brief checks MTTKRP along each mode of T against the expression with pairwise contractions,
+ *        both over the algebraic structure of T, with input matrices filled from [lo,1)
+ */
+bool mttkrp_check(Tensor<> & T, Matrix<> ** mats, char const * idx_T, double lo=-1.){
+  int order = T.order;
+  bool pass = true;
+  Tensor<> * mat_list[order];
+  for (int j=0; j<order; j++) mat_list[j] = mats[j];
+  for (int mode=0; mode<order; mode++){
+    Matrix<> M(*mats[mode]);
+    MTTKRP<double>(&T, mat_list, mode);
+    char idx_M[] = {idx_T[mode], 'r', '\0'};
+    if (order == 3){
+      int j = (mode+1)%3, k = (mode+2)%3;
+      char idx_j[] = {idx_T[j], 'r', '\0'};
+      char idx_k[] = {idx_T[k], 'r', '\0'};
+      M[idx_M] = T[idx_T]*(*mats[j])[idx_j]*(*mats[k])[idx_k];
+    } else {
+      int j = (mode+1)%4, k = (mode+2)%4, l = (mode+3)%4;
+      char idx_j[] = {idx_T[j], 'r', '\0'};
+      char idx_k[] = {idx_T[k], 'r', '\0'};
+      char idx_l[] = {idx_T[l], 'r', '\0'};
+      M[idx_M] = T[idx_T]*(*mats[j])[idx_j]*(*mats[k])[idx_k]*(*mats[l])[idx_l];
+    }
+    //compared over the default ring, since the structure of T need not have an additive inverse
+    Matrix<> dM(M.nrow, M.ncol, *M.wrld);
+    Matrix<> dO(M.nrow, M.ncol, *M.wrld);
+    dM[idx_M] = M[idx_M];
+    dO[idx_M] = (*mats[mode])[idx_M];
+    dM[idx_M] -= dO[idx_M];
+    pass = pass && dM.norm2() <= 1.E-10*(dO.norm2() + 1.);
+    //restore a random input matrix for the next mode
+    mats[mode]->fill_random(lo, 1.);
+  }
+  return pass;
+}
+
+int mttkrp(int     n,
+           World & dw){
+  int rank;
+  bool pass = true;
+  int r = 4;
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  int lens[] = {n, n+1, n+2, 3};
+  Matrix<> * mats[4];
+  for (int j=0; j<4; j++){
+    mats[j] = new Matrix<>(lens[j], r, dw);
+    mats[j]->fill_random(-1., 1.);
+  }
+
+  Tensor<> T(3, lens, dw);
+  T.fill_random(-1., 1.);
+  pass = pass && mttkrp_check(T, mats, "ijk");
+
+  Tensor<> S(3, true, lens, dw);
+  S.fill_sp_random(-1., 1., .1);
+  pass = pass && mttkrp_check(S, mats, "ijk");
+
+  Tensor<> U(4, true, lens, dw);
+  U.fill_sp_random(-1., 1., .05);
+  pass = pass && mttkrp_check(U, mats, "ijkl");
+
+  //reads and accumulations split into calls of at most 3 entries per process, with a different number of entries on each
+  int64_t nv = (rank%3)*5 + 2;
+  int64_t inds[nv];
+  double vals[nv], lvals[nv];
+  for (int64_t i=0; i<nv; i++){
+    inds[i] = (i*7 + rank)%(lens[0]*r);
+  }
+  CTF_int::mttkrp_rw_chunks<double>(mats[0], nv, inds, vals, 'r');
+  CTF_int::mttkrp_rw_chunks<double>(mats[0], nv, inds, lvals, 'r', 3);
+  for (int64_t i=0; i<nv; i++){
+    pass = pass && vals[i] == lvals[i];
+  }
+  Matrix<> W(lens[0], r, dw);
+  Matrix<> LW(lens[0], r, dw);
+  CTF_int::mttkrp_rw_chunks<double>(&W, nv, inds, vals, 'w');
+  CTF_int::mttkrp_rw_chunks<double>(&LW, nv, inds, vals, 'w', 3);
+  LW["ir"] -= W["ir"];
+  pass = pass && LW.norm2() <= 1.E-10*(W.norm2() + 1.);
+
+  for (int j=0; j<4; j++){
+    delete mats[j];
+  }
+
+  //max-times semiring, whose operators are applied through the algebraic structure
+  Semiring<> mt(0., [](double a, double b){ return std::max(a,b); }, MPI_MAX,
+                1., [](double a, double b){ return a*b; });
+  for (int j=0; j<3; j++){
+    mats[j] = new Matrix<>(lens[j], r, dw, mt);
+    mats[j]->fill_random(0., 1.);
+  }
+  Tensor<> TM(3, lens, dw, mt);
+  TM.fill_random(0., 1.);
+  pass = pass && mttkrp_check(TM, mats, "ijk", 0.);
+  Tensor<> SM(3, true, lens, dw, mt);
+  SM.fill_sp_random(0., 1., .1);
+  pass = pass && mttkrp_check(SM, mats, "ijk", 0.);
+  for (int j=0; j<3; j++){
+    delete mats[j];
+  }
+
+  if (pass){
+    if (rank == 0)
+      printf("{ M[\"ir\"] = T[\"ijk\"]*B[\"jr\"]*C[\"kr\"] with fused MTTKRP } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ M[\"ir\"] = T[\"ijk\"]*B[\"jr\"]*C[\"kr\"] with fused MTTKRP } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing fused MTTKRP with n = %d:\n",n);
+    }
+    mttkrp(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
@@ -0,0 +1,162 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup ooc_contract ooc_contract
+  * @{
+  * \brief Out-of-core contractions of file-backed tensors against in-memory contractions
+  */
+#include <ctf.hpp>
+#include <unistd.h>
+
+using namespace CTF;
+
+/**
+ * \brief name of a temporary file of the test, unique to this run by the process id of rank 0
+ */
+std::string ooc_file_name(char const * tag, World & dw){
+  int pid = (int)getpid();
+  MPI_Bcast(&pid, 1, MPI_INT, 0, dw.comm);
+  return std::string("ooc_contract_") + std::to_string(pid) + "_" + tag + ".bin";
+}
+
+/**
+ * \brief removes temporary files of the test, after they have been closed on all processes
+ */
+void ooc_remove_files(std::string const * names, int n, World & dw){
+  MPI_Barrier(dw.comm);
+  if (dw.rank == 0){
+    for (int i=0; i<n; i++){
+      MPI_File_delete(names[i].c_str(), MPI_INFO_NULL);
+    }
+  }
+  MPI_Barrier(dw.comm);
+}
+
+int ooc_contract(int     n,
+                 World & dw){
+  int rank;
+  bool pass = true;
+  int m = n*n+3;
+  int k = 2*n+5;
+  int l = n+2;
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  Matrix<> A(m, k, dw);
+  Matrix<> B(k, l, dw);
+  Matrix<> C(m, l, dw);
+  Matrix<> C_f(m, l, dw);
+  A.fill_random(-1., 1.);
+  B.fill_random(-1., 1.);
+  C.fill_random(-1., 1.);
+
+  int lens_A[] = {m, k};
+  int lens_B[] = {k, l};
+  int lens_C[] = {m, l};
+  //bound the memory so that the operands are streamed in several tiles
+  int64_t mem = ((int64_t)m*k + k*l + m*l)*sizeof(double)/dw.np;
+  std::string names[3] = {ooc_file_name("A", dw), ooc_file_name("B", dw), ooc_file_name("C", dw)};
+  {
+    File_Tensor<> fA(names[0].c_str(), 2, lens_A, dw);
+    File_Tensor<> fB(names[1].c_str(), 2, lens_B, dw);
+    File_Tensor<> fC(names[2].c_str(), 2, lens_C, dw);
+    fA.write(A);
+    fB.write(B);
+    fC.write(C);
+
+    //k is tiled as the last index of A, j as the last index of B and C
+    fC.contract(2., fA, "ik", fB, "kj", .5, "ij", mem);
+    C["ij"] = .5*C["ij"];
+    C["ij"] += 2.*A["ik"]*B["kj"];
+    fC.read(C_f);
+    C_f["ij"] -= C["ij"];
+    pass = pass && C_f.norm2() < 1.E-6;
+
+    fC.contract(1., fA, "ik", fB, "kj", 0., "ij", mem);
+    C["ij"] = A["ik"]*B["kj"];
+    fC.read(C_f);
+    C_f["ij"] -= C["ij"];
+    pass = pass && C_f.norm2() < 1.E-6;
+  }
+  ooc_remove_files(names, 3, dw);
+
+  //order four output, with the last index of the operands contracted
+  int lens_T[] = {m, l, k};
+  int lens_U[] = {l, m, k};
+  int lens_V[] = {m, l, l, m};
+  Tensor<> T(3, lens_T, dw);
+  Tensor<> U(3, lens_U, dw);
+  Tensor<> V(4, lens_V, dw);
+  Tensor<> V_f(4, lens_V, dw);
+  T.fill_random(-1., 1.);
+  U.fill_random(-1., 1.);
+  mem = ((int64_t)m*l*l*m)*sizeof(double)/dw.np;
+  {
+    File_Tensor<> fT(names[0].c_str(), 3, lens_T, dw);
+    File_Tensor<> fU(names[1].c_str(), 3, lens_U, dw);
+    File_Tensor<> fV(names[2].c_str(), 4, lens_V, dw);
+    fT.write(T);
+    fU.write(U);
+    fV.contract(1., fT, "iak", fU, "bjk", 0., "iabj", mem);
+    V["iabj"] = T["iak"]*U["bjk"];
+    fV.read(V_f);
+    V_f["iabj"] -= V["iabj"];
+    pass = pass && V_f.norm2() < 1.E-6;
+  }
+  ooc_remove_files(names, 3, dw);
+
+  if (pass){
+    if (rank == 0)
+      printf("{ C[\"ij\"] = A[\"ik\"]*B[\"kj\"] out-of-core } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ C[\"ij\"] = A[\"ik\"]*B[\"kj\"] out-of-core } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing out-of-core contractions with n = %d:\n",n);
+    }
+    ooc_contract(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
@@ -0,0 +1,101 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup spctr_reduce spctr_reduce
+  * @{
+  * \brief Products of sparse matrices with a long contracted dimension into sparse matrices, which reduce sparse partial sums over processes
+  */
+#include <ctf.hpp>
+
+using namespace CTF;
+
+int spctr_reduce(int     n,
+                 World & dw){
+  int rank;
+  bool pass = true;
+  int m = n;
+  int k = 256*n;
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  Matrix<> A(m, k, SP, dw);
+  Matrix<> B(k, m, SP, dw);
+  A.fill_sp_random(-1., 1., .1);
+  B.fill_sp_random(-1., 1., .1);
+  Matrix<> A_d(m, k, dw);
+  Matrix<> B_d(k, m, dw);
+  A_d["ij"] = A["ij"];
+  B_d["ij"] = B["ij"];
+
+  //repeated products reuse the communicators of the reduction
+  for (int it=0; it<3; it++){
+    Matrix<> C(m, m, SP, dw);
+    Matrix<> C_d(m, m, dw);
+    C["ij"] = A["ik"]*B["kj"];
+    C_d["ij"] = A_d["ik"]*B_d["kj"];
+    C_d["ij"] -= C["ij"];
+    pass = pass && C_d.norm2() <= 1.E-10*(C.norm2() + 1.);
+    A["ij"] += A["ij"];
+    A_d["ij"] += A_d["ij"];
+    //the communicators cached on the communicator of the world are split again after being freed
+    if (it == 1){
+      CTF_int::free_csr_red_comms(dw.comm);
+      CTF_int::free_csr_red_comms(dw.comm);
+    }
+  }
+
+  if (pass){
+    if (rank == 0)
+      printf("{ C[\"ij\"] = A[\"ik\"]*B[\"kj\"] with sparse A, B, C and long k } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ C[\"ij\"] = A[\"ik\"]*B[\"kj\"] with sparse A, B, C and long k } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing sparse matrix products reduced over processes with n = %d:\n",n);
+    }
+    spctr_reduce(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
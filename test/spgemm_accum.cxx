@@ -0,0 +1,138 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup spgemm_accum spgemm_accum
+  * @{
+  * \brief Sparse times sparse into sparse contractions whose rows are accumulated in both hash tables and dense arrays, against dense contractions
+  */
+#include <ctf.hpp>
+
+using namespace CTF;
+
+int spgemm_accum(int     n,
+                 World & dw){
+  int rank;
+  bool pass = true;
+  int m = 8*n;
+  int k = 4*n;
+  int l = 64*n;
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  //most rows of A have few nonzeros, so that their products are accumulated in a hash table,
+  //while a few dense rows of A yield products accumulated in a dense array
+  Matrix<> A(m, k, SP, dw);
+  A.fill_sp_random(1., 2., 2./k);
+  std::vector<int64_t> inds;
+  std::vector<double> vals;
+  if (rank == 0){
+    for (int i=0; i<m; i+=n+1){
+      for (int j=0; j<k; j++){
+        inds.push_back(i+((int64_t)j)*m);
+        vals.push_back(1.+(j%3)*.5);
+      }
+    }
+  }
+  A.write(inds.size(), inds.data(), vals.data());
+  Matrix<> A_d(m, k, dw);
+  A_d["ij"] = A["ij"];
+  Matrix<> B(k, l, SP, dw);
+  B.fill_sp_random(.5, 1.5, 4./l);
+  Matrix<> B_d(k, l, dw);
+  B_d["ij"] = B["ij"];
+
+  //sparse times sparse into sparse, accumulating into existing nonzeros
+  Matrix<> S(m, l, SP, dw);
+  Matrix<> C(m, l, dw);
+  Matrix<> C_d(m, l, dw);
+  S["ij"] = A["ik"]*B["kj"];
+  S["ij"] += 2.*A["ik"]*B["kj"];
+  C["ij"] = S["ij"];
+  C_d["ij"] = 3.*A_d["ik"]*B_d["kj"];
+  C_d["ij"] -= C["ij"];
+  pass = pass && C_d.norm2() < 1.E-6;
+
+  //bivar_function of sparse matrices into a sparse matrix
+  Function<> f([](double a, double b){ return 2.*a*b; });
+  Matrix<> S_f(m, l, SP, dw);
+  S_f["ij"] = f(A["ik"],B["kj"]);
+  C["ij"] = S_f["ij"];
+  C_d["ij"] = 2.*A_d["ik"]*B_d["kj"];
+  C_d["ij"] -= C["ij"];
+  pass = pass && C_d.norm2() < 1.E-6;
+
+  //sparse times sparse into sparse over a semiring with a custom addition
+  Semiring<> mt(0., [](double a, double b){ return std::max(a,b); }, MPI_MAX,
+                1., [](double a, double b){ return a*b; });
+  Matrix<> A_mt(m, k, SP, dw, mt);
+  Matrix<> A_d_mt(m, k, dw, mt);
+  A_mt["ij"] = A["ij"];
+  A_d_mt["ij"] = A_d["ij"];
+  Matrix<> B_mt(k, l, SP, dw, mt);
+  Matrix<> B_d_mt(k, l, dw, mt);
+  B_mt["ij"] = B["ij"];
+  B_d_mt["ij"] = B_mt["ij"];
+  Matrix<> S_mt(m, l, SP, dw, mt);
+  Matrix<> C_d_mt(m, l, dw, mt);
+  S_mt["ij"] = A_mt["ik"]*B_mt["kj"];
+  C_d_mt["ij"] = A_d_mt["ik"]*B_d_mt["kj"];
+  C["ij"] = S_mt["ij"];
+  C_d["ij"] = C_d_mt["ij"];
+  C_d["ij"] -= C["ij"];
+  pass = pass && C_d.norm2() < 1.E-6;
+
+  if (pass){
+    if (rank == 0)
+      printf("{ S[\"ij\"] = A[\"ik\"]*B[\"kj\"] with hash and dense row accumulators } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ S[\"ij\"] = A[\"ik\"]*B[\"kj\"] with hash and dense row accumulators } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing sparse matrix multiplication with hash and dense accumulators with n = %d:\n",n);
+    }
+    spgemm_accum(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
@@ -0,0 +1,131 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup spmv_skewed spmv_skewed
+  * @{
+  * \brief Sparse matrix times dense vector products of matrices with rows of very different lengths, against dense products
+  */
+#include <ctf.hpp>
+
+using namespace CTF;
+
+int spmv_skewed(int     n,
+                World & dw){
+  int rank;
+  bool pass = true;
+  int m = 16*n;
+  int k = 64*n;
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  //most rows of A are empty or have a single nonzero, while a few dense rows hold most nonzeros,
+  //so that rows are split between threads
+  Matrix<> A(m, k, SP, dw);
+  A.fill_sp_random(1., 2., .5/k);
+  std::vector<int64_t> inds;
+  std::vector<double> vals;
+  if (rank == 0){
+    for (int i=1; i<m; i+=5*n+1){
+      for (int j=0; j<k; j++){
+        inds.push_back(i+((int64_t)j)*m);
+        vals.push_back(1.+(j%5)*.25);
+      }
+    }
+  }
+  A.write(inds.size(), inds.data(), vals.data());
+  Matrix<> A_d(m, k, dw);
+  A_d["ij"] = A["ij"];
+
+  Vector<> x(k, dw);
+  x.fill_random(.5, 1.5);
+  Vector<> y(m, dw);
+  y.fill_random(-1., 1.);
+  Vector<> y_d(y);
+  Vector<> diff(m, dw);
+
+  //y = alpha*A*x + beta*y over the default semiring
+  y.contract(2., A, "ij", x, "j", .5, "i");
+  y_d.contract(2., A_d, "ij", x, "j", .5, "i");
+  diff["i"] = y["i"] - y_d["i"];
+  pass = pass && diff.norm2() < 1.E-6;
+
+  //bivar_function of a sparse matrix and a vector, accumulated into a vector
+  Function<> f([](double a, double b){ return 2.*a*b; });
+  y["i"] += f(A["ij"],x["j"]);
+  y_d["i"] += f(A_d["ij"],x["j"]);
+  diff["i"] = y["i"] - y_d["i"];
+  pass = pass && diff.norm2() < 1.E-6;
+
+  //sparse matrix times vector over a semiring with a custom addition
+  Semiring<> mt(0., [](double a, double b){ return std::max(a,b); }, MPI_MAX,
+                1., [](double a, double b){ return a*b; });
+  Matrix<> A_mt(m, k, SP, dw, mt);
+  Matrix<> A_d_mt(m, k, dw, mt);
+  A_mt["ij"] = A["ij"];
+  A_d_mt["ij"] = A_d["ij"];
+  Vector<> x_mt(k, dw, mt);
+  x_mt["i"] = x["i"];
+  Vector<> y_mt(m, dw, mt);
+  Vector<> y_d_mt(m, dw, mt);
+  y_mt["i"] = A_mt["ij"]*x_mt["j"];
+  y_d_mt["i"] = A_d_mt["ij"]*x_mt["j"];
+  y["i"] = y_mt["i"];
+  y_d["i"] = y_d_mt["i"];
+  diff["i"] = y["i"] - y_d["i"];
+  pass = pass && diff.norm2() < 1.E-6;
+
+  if (pass){
+    if (rank == 0)
+      printf("{ y[\"i\"] = A[\"ij\"]*x[\"j\"] with skewed sparse A } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ y[\"i\"] = A[\"ij\"]*x[\"j\"] with skewed sparse A } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing sparse matrix times vector with skewed rows with n = %d:\n",n);
+    }
+    spmv_skewed(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
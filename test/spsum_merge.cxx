@@ -0,0 +1,108 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup spsum_merge spsum_merge
+  * @{
+  * \brief Summations of large sparse tensors into sparse tensors, against dense summations
+  */
+#include <ctf.hpp>
+
+using namespace CTF;
+
+int spsum_merge(int     n,
+                World & dw){
+  int rank;
+  bool pass = true;
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  //enough nonzeros for the merge to be split among threads
+  int lens[] = {8*n, 8*n, 4*n};
+  Tensor<> A(3, true, lens, dw);
+  Tensor<> B(3, true, lens, dw);
+  A.fill_sp_random(-1., 1., .2);
+  B.fill_sp_random(-1., 1., .2);
+  Tensor<> A_d(3, lens, dw);
+  Tensor<> B_d(3, lens, dw);
+  A_d["ijk"] = A["ijk"];
+  B_d["ijk"] = B["ijk"];
+  Tensor<> diff(3, lens, dw);
+
+  //B = 3*A + 2*B, with keys of A and B partly overlapping
+  B.sum(3., A, "ijk", 2., "ijk");
+  B_d.sum(3., A_d, "ijk", 2., "ijk");
+  diff["ijk"] = B["ijk"] - B_d["ijk"];
+  pass = pass && diff.norm2() < 1.E-6;
+
+  //univar_function applied to entries of A
+  Function<> f([](double a){ return a*a+2.*a; });
+  B["ijk"] += f(A["ijk"]);
+  B_d["ijk"] += f(A_d["ijk"]);
+  diff["ijk"] = B["ijk"] - B_d["ijk"];
+  pass = pass && diff.norm2() < 1.E-6;
+
+  //sparse matrix replicated along a mode of the output
+  Matrix<> M(8*n, 4*n, SP, dw);
+  M.fill_sp_random(-1., 1., .3);
+  Matrix<> M_d(8*n, 4*n, dw);
+  M_d["ij"] = M["ij"];
+  B["kij"] += M["ij"];
+  B_d["kij"] += M_d["ij"];
+  diff["ijk"] = B["ijk"] - B_d["ijk"];
+  pass = pass && diff.norm2() < 1.E-6;
+
+  if (pass){
+    if (rank == 0)
+      printf("{ B[\"ijk\"] += A[\"ijk\"] with large sparse A, B } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ B[\"ijk\"] += A[\"ijk\"] with large sparse A, B } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing sums of large sparse tensors with n = %d:\n",n);
+    }
+    spsum_merge(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
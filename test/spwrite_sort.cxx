@@ -0,0 +1,187 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup spwrite_sort spwrite_sort
+  * @{
+  * \brief Writes and redistributions of sparse tensors from pairs given in descending order of key, for values of several sizes
+  */
+#include <ctf.hpp>
+
+using namespace CTF;
+
+struct spwrite_sort_el {
+  int64_t key;
+  char pad[32];
+};
+
+/**
+ * \brief value written at global index key
+ */
+int64_t spwrite_sort_val(int64_t key){
+  return key%97 + 1;
+}
+
+/**
+ * \brief writes every other index owned by this process to a sparse tensor, in descending order,
+ *        and checks the local nonzeros read back
+ */
+template <typename dtype>
+bool spwrite_sort_check(Tensor<dtype> & A, int64_t tot, World & dw){
+  int64_t nw = 0;
+  for (int64_t i=tot-1; i>=0; i--){
+    if (i%(2*dw.np) == 2*dw.rank) nw++;
+  }
+  int64_t * inds = (int64_t*)malloc(sizeof(int64_t)*std::max(nw, (int64_t)1));
+  dtype * vals = (dtype*)malloc(sizeof(dtype)*std::max(nw, (int64_t)1));
+  nw = 0;
+  for (int64_t i=tot-1; i>=0; i--){
+    if (i%(2*dw.np) == 2*dw.rank){
+      inds[nw] = i;
+      vals[nw] = (dtype)spwrite_sort_val(i);
+      nw++;
+    }
+  }
+  A.write(nw, inds, vals);
+  free(inds);
+  free(vals);
+
+  bool pass = true;
+  int64_t nloc;
+  A.read_local_nnz(&nloc, &inds, &vals);
+  for (int64_t i=0; i<nloc; i++){
+    if (inds[i]%2 != 0 || vals[i] != (dtype)spwrite_sort_val(inds[i])) pass = false;
+  }
+  int64_t nnz = nloc;
+  MPI_Allreduce(MPI_IN_PLACE, &nnz, 1, MPI_INT64_T, MPI_SUM, dw.comm);
+  if (nnz != (tot+1)/2) pass = false;
+  free(inds);
+  free(vals);
+  return pass;
+}
+
+int spwrite_sort(int     n,
+                 World & dw){
+  int rank;
+  bool pass = true;
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  int lens[] = {8*n, 8*n, 4*n};
+  int64_t tot = ((int64_t)lens[0])*lens[1]*lens[2];
+
+  Tensor<> A(3, true, lens, dw);
+  pass = pass && spwrite_sort_check(A, tot, dw);
+
+  Tensor<int> I(3, true, lens, dw);
+  pass = pass && spwrite_sort_check(I, tot, dw);
+
+  Tensor< std::complex<double> > Z(3, true, lens, dw);
+  pass = pass && spwrite_sort_check(Z, tot, dw);
+
+  //values larger than the key are sorted by key and offset
+  Set<spwrite_sort_el, false> s = Set<spwrite_sort_el, false>();
+  Tensor<spwrite_sort_el> E(3, true, lens, dw, s);
+  int64_t nw = 0;
+  for (int64_t i=tot-1; i>=0; i--){
+    if (i%(2*dw.np) == 2*dw.rank) nw++;
+  }
+  int64_t * inds = (int64_t*)malloc(sizeof(int64_t)*std::max(nw, (int64_t)1));
+  spwrite_sort_el * els = (spwrite_sort_el*)malloc(sizeof(spwrite_sort_el)*std::max(nw, (int64_t)1));
+  nw = 0;
+  for (int64_t i=tot-1; i>=0; i--){
+    if (i%(2*dw.np) == 2*dw.rank){
+      inds[nw] = i;
+      els[nw].key = i;
+      std::fill(els[nw].pad, els[nw].pad+32, (char)(i%31));
+      nw++;
+    }
+  }
+  E.write(nw, inds, els);
+  free(inds);
+  free(els);
+  int64_t nloc;
+  E.read_local_nnz(&nloc, &inds, &els);
+  for (int64_t i=0; i<nloc; i++){
+    if (els[i].key != inds[i] || els[i].pad[31] != (char)(inds[i]%31)) pass = false;
+  }
+  free(inds);
+  free(els);
+
+  //transposition of a sparse tensor redistributes and re-sorts its pairs
+  int lens_T[] = {4*n, 8*n, 8*n};
+  Tensor<> T(3, true, lens_T, dw);
+  T["kji"] = A["ijk"];
+  int64_t * inds_T;
+  double * vals_T;
+  T.read_local_nnz(&nloc, &inds_T, &vals_T);
+  for (int64_t i=0; i<nloc; i++){
+    int64_t k = inds_T[i]%lens_T[0];
+    int64_t j = (inds_T[i]/lens_T[0])%lens_T[1];
+    int64_t l = inds_T[i]/(((int64_t)lens_T[0])*lens_T[1]);
+    int64_t key_A = l + j*lens[0] + k*((int64_t)lens[0])*lens[1];
+    if (vals_T[i] != (double)spwrite_sort_val(key_A)) pass = false;
+  }
+  free(inds_T);
+  free(vals_T);
+  int64_t nnz = T.nnz_tot;
+  if (nnz != (tot+1)/2) pass = false;
+
+  int ipass = pass;
+  MPI_Allreduce(MPI_IN_PLACE, &ipass, 1, MPI_INT, MPI_MIN, dw.comm);
+  pass = ipass;
+
+  if (pass){
+    if (rank == 0)
+      printf("{ A.write(inds, vals) with descending inds, T[\"kji\"] = A[\"ijk\"] } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ A.write(inds, vals) with descending inds, T[\"kji\"] = A[\"ijk\"] } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 6;
+  } else n = 6;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing sparse writes of unsorted pairs with n = %d:\n",n);
+    }
+    spwrite_sort(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
@@ -0,0 +1,116 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup term_plan term_plan
+  * @{
+  * \brief Recording and re-execution of tensor expressions via Term_Plan
+  */
+#include <ctf.hpp>
+
+using namespace CTF;
+
+int term_plan(int     n,
+              World & dw){
+  int rank, pass;
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  Matrix<> A(n, n, NS, dw);
+  Matrix<> B(n, n, NS, dw);
+  Matrix<> C(n, n, NS, dw);
+  Matrix<> D(n, n, NS, dw);
+  Matrix<> D2(n, n, NS, dw);
+  Matrix<> D_ref(n, n, NS, dw);
+  Vector<> v(n, dw);
+
+  srand48(23*rank);
+  A.fill_random(-1.,1.);
+  B.fill_random(-1.,1.);
+  C.fill_random(-1.,1.);
+  v.fill_random(-1.,1.);
+
+  Term_Plan plan;
+  plan.record();
+  D["ij"] = 2.0*A["ik"]*B["kl"]*C["lj"];
+  D["ij"] += A["ij"]*v["j"];
+  D["ij"] += 3.0;
+  //a product of scalars only is added to every element
+  D["ij"] += Idx_Tensor(D.sr, .5)*Idx_Tensor(D.sr, 4.);
+  plan.end_record();
+  pass = plan.get_num_ops() > 0;
+
+  for (int it=0; it<3; it++){
+    // new data in the input tensors between iterations
+    A["ij"] += 0.5*B["ji"];
+    v["i"] = 0.5*v["i"];
+    plan.execute();
+
+    D_ref["ij"] = 2.0*A["ik"]*B["kl"]*C["lj"];
+    D_ref["ij"] += A["ij"]*v["j"];
+    D_ref["ij"] += 5.0;
+    D_ref["ij"] -= D["ij"];
+    if (D_ref.norm2() > 1.E-10*n*n) pass = 0;
+  }
+
+  // substitute a different output tensor
+  std::map<CTF_int::tensor*, CTF_int::tensor*> remap;
+  remap[&D] = &D2;
+  plan.execute(&remap);
+  D2["ij"] -= D["ij"];
+  if (D2.norm2() > 1.E-10*n*n) pass = 0;
+
+  if (pass){
+    if (rank == 0)
+      printf("{ recorded D[\"ij\"] = 2.0*A[\"ik\"]*B[\"kl\"]*C[\"lj\"] } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ recorded D[\"ij\"] = 2.0*A[\"ik\"]*B[\"kl\"]*C[\"lj\"] } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing recorded expression plan with n = %d:\n",n);
+    }
+    term_plan(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif
@@ -25,6 +25,30 @@
 #include "univar_function.cxx"
 #include "bivar_function.cxx"
 #include "bivar_transform.cxx"
+#include "ctr_plan_cache.cxx"
+#include "ctr_pipelined.cxx"
+#include "ctr_order.cxx"
+#include "term_plan.cxx"
+#include "ctr_batch.cxx"
+#include "int_gemm.cxx"
+#include "tropical_semiring.cxx"
+#include "ctr_epilogue.cxx"
+#include "ctr_mixed_precision.cxx"
+#include "ooc_contract.cxx"
+#include "ctr_mem_budget.cxx"
+#include "ctr_sym_packed.cxx"
+#include "ctr_autotune.cxx"
+#include "ctr_sparse_balance.cxx"
+#include "ctr_hypersparse.cxx"
+#include "spgemm_accum.cxx"
+#include "ctr_masked.cxx"
+#include "spmv_skewed.cxx"
+#include "ctr_csf.cxx"
+#include "mttkrp.cxx"
+#include "spsum_merge.cxx"
+#include "spctr_reduce.cxx"
+#include "spwrite_sort.cxx"
+#include "int_count_chunks.cxx"
 
 #include "../examples/trace.cxx"
 #include "../examples/dft_3D.cxx"
@@ -166,6 +190,102 @@ int main(int argc, char ** argv){
     if (rank == 0)
       printf("Testing multi-tensor symmetric contraction with m = %d n = %d:\n",n*n,n);
     pass.push_back(multi_tsr_sym(n^2,n, dw));
+
+    if (rank == 0)
+      printf("Testing contraction plan cache with n = %d:\n",n);
+    pass.push_back(ctr_plan_cache(n, dw));
+
+    if (rank == 0)
+      printf("Testing pipelined 2D contraction with n = %d:\n",n);
+    pass.push_back(ctr_pipelined(n, dw));
+
+    if (rank == 0)
+      printf("Testing multi-operand contraction ordering with n = %d:\n",n);
+    pass.push_back(ctr_order(n, dw));
+
+    if (rank == 0)
+      printf("Testing recorded expression plan with n = %d:\n",n);
+    pass.push_back(term_plan(n, dw));
+
+    if (rank == 0)
+      printf("Testing batched contraction with n = %d:\n",n);
+    pass.push_back(ctr_batch(n, dw));
+
+    if (rank == 0)
+      printf("Testing integer matrix multiplication with n = %d:\n",n);
+    pass.push_back(int_gemm(n, dw));
+
+    if (rank == 0)
+      printf("Testing tropical semiring contractions with n = %d:\n",n);
+    pass.push_back(tropical_semiring(n, dw));
+
+    if (rank == 0)
+      printf("Testing contractions with elementwise epilogue with n = %d:\n",n);
+    pass.push_back(ctr_epilogue(n, dw));
+
+    if (rank == 0)
+      printf("Testing mixed-precision contractions with n = %d:\n",n);
+    pass.push_back(ctr_mixed_precision(n, dw));
+
+    if (rank == 0)
+      printf("Testing out-of-core contractions with n = %d:\n",n);
+    pass.push_back(ooc_contract(n, dw));
+
+    if (rank == 0)
+      printf("Testing contractions within memory budgets with n = %d:\n",n);
+    pass.push_back(ctr_mem_budget(n, dw));
+
+    if (rank == 0)
+      printf("Testing contractions into packed symmetric tensors with n = %d:\n",n);
+    pass.push_back(ctr_sym_packed(n, dw));
+
+    if (rank == 0)
+      printf("Testing autotuned contraction mappings with n = %d:\n",n);
+    pass.push_back(ctr_autotune(n, dw));
+
+    if (rank == 0)
+      printf("Testing load-balanced sparse contractions with n = %d:\n",n);
+    pass.push_back(ctr_sparse_balance(n, dw));
+
+    if (rank == 0)
+      printf("Testing contractions of hypersparse matrices with n = %d:\n",n);
+    pass.push_back(ctr_hypersparse(n, dw));
+
+    if (rank == 0)
+      printf("Testing sparse matrix multiplication with hash and dense accumulators with n = %d:\n",n);
+    pass.push_back(spgemm_accum(n, dw));
+
+    if (rank == 0)
+      printf("Testing masked sparse contractions with n = %d:\n",n);
+    pass.push_back(ctr_masked(n, dw));
+
+    if (rank == 0)
+      printf("Testing sparse matrix times vector with skewed rows with n = %d:\n",n);
+    pass.push_back(spmv_skewed(n, dw));
+
+    if (rank == 0)
+      printf("Testing sparse tensor contractions in CSF layout with n = %d:\n",n);
+    pass.push_back(ctr_csf(n, dw));
+
+    if (rank == 0)
+      printf("Testing fused MTTKRP with n = %d:\n",n);
+    pass.push_back(mttkrp(n, dw));
+
+    if (rank == 0)
+      printf("Testing sums of large sparse tensors with n = %d:\n",n);
+    pass.push_back(spsum_merge(n, dw));
+
+    if (rank == 0)
+      printf("Testing sparse matrix products reduced over processes with n = %d:\n",n);
+    pass.push_back(spctr_reduce(n, dw));
+
+    if (rank == 0)
+      printf("Testing sparse writes of unsorted pairs with n = %d:\n",n);
+    pass.push_back(spwrite_sort(n, dw));
+
+    if (rank == 0)
+      printf("Testing element counts above the int limit with n = %d:\n",n);
+    pass.push_back(int_count_chunks(n, dw));
    
 #ifndef PROFILE 
 #ifndef BGQ
@@ -0,0 +1,219 @@
+/*Copyright (c) 2011, Edgar Solomonik, all rights reserved.*/
+
+/** \addtogroup tests
+  * @{
+  * \defgroup tropical_semiring tropical_semiring
+  * @{
+  * \brief Contractions over the built-in tropical semirings against equivalent user-defined semirings
+  */
+#include <ctf.hpp>
+
+using namespace CTF;
+
+/**
+ * \brief sets each element of a matrix to a value determined by its global index
+ */
+template <typename dtype>
+void tropical_fill(Matrix<dtype> & M, int seed){
+  int64_t npair;
+  int64_t * inds;
+  dtype * vals;
+  M.read_local(&npair, &inds, &vals);
+  for (int64_t i=0; i<npair; i++){
+    vals[i] = (dtype)(((inds[i]+seed)*7919)%23);
+  }
+  M.write(npair, inds, vals);
+  free(inds);
+  free(vals);
+}
+
+/**
+ * \brief checks that two matrices have exactly the same elements
+ */
+template <typename dtype>
+bool tropical_equal(Matrix<dtype> & A, Matrix<dtype> & B){
+  int64_t npair_A, npair_B;
+  dtype * vals_A;
+  dtype * vals_B;
+  A.read_all(&npair_A, &vals_A);
+  B.read_all(&npair_B, &vals_B);
+  bool eq = (npair_A == npair_B);
+  for (int64_t i=0; eq && i<npair_A; i++){
+    if (vals_A[i] != vals_B[i]) eq = false;
+  }
+  free(vals_A);
+  free(vals_B);
+  return eq;
+}
+
+/**
+ * \brief compares dense and, if sp, sparse-times-dense and sparse-times-sparse
+ *        products over sr_t against the same products over sr_g
+ */
+template <typename dtype>
+bool tropical_cmp(int               m,
+                  int               n,
+                  int               k,
+                  Semiring<dtype> & sr_t,
+                  Semiring<dtype> & sr_g,
+                  bool              is_max,
+                  bool              sp,
+                  World &           dw){
+  Matrix<dtype> A_t(m, k, dw, sr_t);
+  Matrix<dtype> B_t(k, n, dw, sr_t);
+  Matrix<dtype> C_t(m, n, dw, sr_t);
+  Matrix<dtype> A_g(m, k, dw, sr_g);
+  Matrix<dtype> B_g(k, n, dw, sr_g);
+  Matrix<dtype> C_g(m, n, dw, sr_g);
+  tropical_fill(A_t, 1);
+  tropical_fill(B_t, 2);
+  tropical_fill(C_t, 3);
+  tropical_fill(A_g, 1);
+  tropical_fill(B_g, 2);
+  tropical_fill(C_g, 3);
+
+  bool pass = true;
+  C_t["ij"] += A_t["ik"]*B_t["kj"];
+  C_g["ij"] += A_g["ik"]*B_g["kj"];
+  pass = pass && tropical_equal(C_t, C_g);
+
+  C_t["ij"] = A_t["ik"]*B_t["kj"];
+  C_g["ij"] = A_g["ik"]*B_g["kj"];
+  pass = pass && tropical_equal(C_t, C_g);
+  if (!sp) return pass;
+
+  //keep only large (small if is_max) elements, others are set to the additive identity
+  Matrix<dtype> S_t(m, k, SP, dw, sr_t);
+  Matrix<dtype> S_g(m, k, SP, dw, sr_g);
+  Matrix<dtype> T_t(k, n, SP, dw, sr_t);
+  Matrix<dtype> T_g(k, n, SP, dw, sr_g);
+  tropical_fill(S_t, 1);
+  tropical_fill(S_g, 1);
+  tropical_fill(T_t, 2);
+  tropical_fill(T_g, 2);
+  if (is_max){
+    S_t.sparsify([](dtype a){ return a < 8; });
+    S_g.sparsify([](dtype a){ return a < 8; });
+    T_t.sparsify([](dtype a){ return a < 8; });
+    T_g.sparsify([](dtype a){ return a < 8; });
+  } else {
+    S_t.sparsify([](dtype a){ return a > 15; });
+    S_g.sparsify([](dtype a){ return a > 15; });
+    T_t.sparsify([](dtype a){ return a > 15; });
+    T_g.sparsify([](dtype a){ return a > 15; });
+  }
+
+  C_t["ij"] += S_t["ik"]*B_t["kj"];
+  C_g["ij"] += S_g["ik"]*B_g["kj"];
+  pass = pass && tropical_equal(C_t, C_g);
+
+  C_t["ij"] += S_t["ik"]*T_t["kj"];
+  C_g["ij"] += S_g["ik"]*T_g["kj"];
+  pass = pass && tropical_equal(C_t, C_g);
+
+  return pass;
+}
+
+int tropical_semiring(int     n,
+                      World & dw){
+  int rank, pass;
+  int m = n*n+3;
+  int k = 2*n*n+5;
+  int l = n*n+1;
+
+  MPI_Comm_rank(dw.comm, &rank);
+
+  Tropical_Semiring<double> min_plus;
+  Semiring<double> min_plus_g(std::numeric_limits<double>::infinity(),
+                              [](double a, double b){ return std::min(a,b); },
+                              MPI_MIN,
+                              0.,
+                              [](double a, double b){ return a+b; });
+
+  Tropical_Semiring<int> min_plus_int;
+  Semiring<int> min_plus_int_g(INT_MAX/2,
+                               [](int a, int b){ return std::min(a,b); },
+                               MPI_MIN,
+                               0,
+                               [](int a, int b){ return a+b; });
+
+  Tropical_Semiring<int,true> max_plus;
+  Semiring<int> max_plus_g(INT_MIN/2,
+                           [](int a, int b){ return std::max(a,b); },
+                           MPI_MAX,
+                           0,
+                           [](int a, int b){ return a+b; });
+
+  //sparse kernels of Semiring<double> assume the usual arithmetic, so only compare dense products
+  pass = tropical_cmp<double>(m, l, k, min_plus, min_plus_g, false, false, dw);
+  pass = tropical_cmp<int>(m, l, k, min_plus_int, min_plus_int_g, false, true, dw) && pass;
+  pass = tropical_cmp<int>(m, l, k, max_plus, max_plus_g, true, true, dw) && pass;
+
+  //scaling leaves the finite integer "no path" sentinel unchanged
+  int X[3] = {CTF_int::tropical_addid<int,false>(), 4, CTF_int::tropical_addid<int,false>()};
+  CTF_int::tropical_scal<int,false>(3, -3, X, 1);
+  pass = pass && X[0] == INT_MAX/2 && X[1] == 1 && X[2] == INT_MAX/2;
+
+  //products with the sentinel saturate at it rather than overflowing
+  int id_min = CTF_int::tropical_addid<int,false>();
+  int id_max = CTF_int::tropical_addid<int,true>();
+  int G[4] = {id_min, id_min, id_min, 2};
+  CTF_int::tropical_gemm<int,false>('N', 'N', 1, 1, 1, 3, G, G+1, 0, G+3);
+  pass = pass && G[3] == 2 && CTF_int::tropical_mul<int,false>(id_min, id_min) == id_min;
+  pass = pass && CTF_int::tropical_mul<int,true>(id_max, id_max) == id_max;
+  pass = pass && CTF_int::tropical_mul<int,false>(INT_MIN+1, -2) == INT_MIN;
+
+  if (pass){
+    if (rank == 0)
+      printf("{ (min,+) and (max,+) C[\"ij\"] += A[\"ik\"]*B[\"kj\"] with tropical semiring } passed \n");
+  } else {
+    if (rank == 0)
+      printf("{ (min,+) and (max,+) C[\"ij\"] += A[\"ik\"]*B[\"kj\"] with tropical semiring } failed \n");
+  }
+  return pass;
+}
+
+
+#ifndef TEST_SUITE
+char* getCmdOption(char ** begin,
+                   char ** end,
+                   const   std::string & option){
+  char ** itr = std::find(begin, end, option);
+  if (itr != end && ++itr != end){
+    return *itr;
+  }
+  return 0;
+}
+
+
+int main(int argc, char ** argv){
+  int rank, np, n;
+  int in_num = argc;
+  char ** input_str = argv;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (getCmdOption(input_str, input_str+in_num, "-n")){
+    n = atoi(getCmdOption(input_str, input_str+in_num, "-n"));
+    if (n < 0) n = 7;
+  } else n = 7;
+
+  {
+    World dw(argc, argv);
+    if (rank == 0){
+      printf("Testing tropical semiring contractions with n = %d:\n",n);
+    }
+    tropical_semiring(n, dw);
+  }
+
+  MPI_Finalize();
+  return 0;
+}
+/**
+ * @}
+ * @}
+ */
+
+#endif